@@ -0,0 +1,237 @@
+#include "Benchmark.h"
+#include "AllocationTracker.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Every benchmark starts from the same rand() state
+#define BENCHMARK_SEED 12345
+
+// Stop growing the iteration count here even if a sample is still too quick to time
+#define BENCHMARK_MAX_ITERATIONS (1U << 30)
+
+#if defined(_DEBUG)
+#define BENCHMARK_CONFIG "Debug"
+#else
+#define BENCHMARK_CONFIG "Release"
+#endif
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define BENCHMARK_ARCH "x64"
+#elif defined(_M_IX86) || defined(__i386__)
+#define BENCHMARK_ARCH "x86"
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BENCHMARK_ARCH "arm64"
+#else
+#define BENCHMARK_ARCH "unknown"
+#endif
+
+static volatile unsigned long long s_sink = 0;
+
+void KeepResult(unsigned long long value)
+{
+	s_sink = s_sink + value;
+}
+
+void KeepResult(float value)
+{
+	unsigned int bits;
+	memcpy(&bits, &value, sizeof(bits));
+	KeepResult((unsigned long long)bits);
+}
+
+// The timestamp counter ticks at a fixed rate rather than with the core clock, so "cycles" are only comparable between
+// runs on the same machine. That's all the trend tracking needs.
+static unsigned long long ReadCycles()
+{
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static double Median(std::vector<double>& values)
+{
+	std::sort(values.begin(), values.end());
+	return values[values.size() / 2];
+}
+
+// ----------------------------------------------------------------------------------
+// Benchmark
+// ----------------------------------------------------------------------------------
+
+Benchmark::Benchmark(const char* name, unsigned int elementsPerOp)
+	: m_name(name)
+	, m_elementsPerOp(elementsPerOp)
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+const char* Benchmark::GetName() const
+{
+	return m_name;
+}
+
+unsigned int Benchmark::GetElementsPerOp() const
+{
+	return m_elementsPerOp;
+}
+
+// ----------------------------------------------------------------------------------
+// BenchmarkRunner
+// ----------------------------------------------------------------------------------
+
+BenchmarkRunner::BenchmarkRunner(unsigned int samples, double sampleSeconds)
+	: m_samples(samples)
+	, m_sampleSeconds(sampleSeconds)
+{
+	assert(samples > 0);
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+	for (Benchmark* benchmark : m_benchmarks)
+		delete benchmark;
+}
+
+BenchmarkResult BenchmarkRunner::Measure(Benchmark& benchmark)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	BenchmarkResult result;
+	result.name = benchmark.GetName();
+	result.elementsPerOp = benchmark.GetElementsPerOp();
+
+	// Find an iteration count that makes a sample last about m_sampleSeconds. The first runs double as a warm up.
+	unsigned int iterations = 1;
+	while (iterations < BENCHMARK_MAX_ITERATIONS)
+	{
+		Clock::time_point start = Clock::now();
+		benchmark.Run(iterations);
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (seconds >= m_sampleSeconds)
+			break;
+
+		// Aim a little past the target, but don't trust one short run enough to jump more than 10x
+		double scale = seconds > 0.0 ? (m_sampleSeconds / seconds) * 1.2 : 10.0;
+		scale = std::min(std::max(scale, 2.0), 10.0);
+		iterations = (unsigned int)std::min((double)BENCHMARK_MAX_ITERATIONS, iterations * scale);
+	}
+	result.iterations = iterations;
+
+	std::vector<double> nsPerOp;
+	std::vector<double> cyclesPerElement;
+	for (unsigned int i = 0; i < m_samples; i++)
+	{
+		Clock::time_point start = Clock::now();
+		unsigned long long startCycles = ReadCycles();
+		benchmark.Run(iterations);
+		unsigned long long cycles = ReadCycles() - startCycles;
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		nsPerOp.push_back(seconds * 1e9 / iterations);
+		cyclesPerElement.push_back((double)cycles / ((double)iterations * result.elementsPerOp));
+	}
+	result.minNsPerOp = *std::min_element(nsPerOp.begin(), nsPerOp.end());
+	result.nsPerOp = Median(nsPerOp);
+	result.cyclesPerElement = Median(cyclesPerElement);
+
+	// Counting allocations slows them down a little, so that gets a run of its own
+	AllocationTracker::SetEnabled(true);
+	AllocationTracker::BeginFrame();
+	benchmark.Run(iterations);
+	AllocationTracker::BeginFrame();
+	AllocationTracker::SetEnabled(false);
+
+	unsigned long long allocations = 0;
+	unsigned long long bytes = 0;
+	for (int i = 0; i < (int)ALLOC_TAG::COUNT; i++)
+	{
+		AllocationStats stats = AllocationTracker::GetStats((ALLOC_TAG)i);
+		allocations += stats.allocations;
+		bytes += stats.bytes;
+	}
+	result.allocationsPerOp = (double)allocations / iterations;
+	result.bytesPerOp = (double)bytes / iterations;
+
+	return result;
+}
+
+void BenchmarkRunner::Add(Benchmark* benchmark)
+{
+	m_benchmarks.push_back(benchmark);
+}
+
+void BenchmarkRunner::RunAll(const char* filter)
+{
+	m_results.clear();
+
+	printf("%-48s %12s %12s %10s %12s %14s\n", "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op", "cycles/elem");
+
+	for (Benchmark* benchmark : m_benchmarks)
+	{
+		if (filter && !strstr(benchmark->GetName(), filter))
+			continue;
+
+		srand(BENCHMARK_SEED);
+		benchmark->Setup();
+		BenchmarkResult result = Measure(*benchmark);
+		benchmark->Teardown();
+
+		printf("%-48s %12u %12.2f %10.2f %12.1f %14.2f\n", result.name, result.iterations, result.nsPerOp,
+			result.allocationsPerOp, result.bytesPerOp, result.cyclesPerElement);
+
+		m_results.push_back(result);
+	}
+}
+
+bool BenchmarkRunner::WriteJson(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+	{
+		printf("Couldn't open %s for writing \n", path);
+		return false;
+	}
+
+	fprintf(file, "{\n");
+	fprintf(file, "\t\"config\": \"%s\",\n", BENCHMARK_CONFIG);
+	fprintf(file, "\t\"arch\": \"%s\",\n", BENCHMARK_ARCH);
+	fprintf(file, "\t\"samples\": %u,\n", m_samples);
+	fprintf(file, "\t\"benchmarks\": [\n");
+
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		const BenchmarkResult& result = m_results[i];
+		fprintf(file, "\t\t{\n");
+		fprintf(file, "\t\t\t\"name\": \"%s\",\n", result.name);
+		fprintf(file, "\t\t\t\"iterations\": %u,\n", result.iterations);
+		fprintf(file, "\t\t\t\"elements_per_op\": %u,\n", result.elementsPerOp);
+		fprintf(file, "\t\t\t\"ns_per_op\": %.3f,\n", result.nsPerOp);
+		fprintf(file, "\t\t\t\"min_ns_per_op\": %.3f,\n", result.minNsPerOp);
+		fprintf(file, "\t\t\t\"allocs_per_op\": %.4f,\n", result.allocationsPerOp);
+		fprintf(file, "\t\t\t\"bytes_per_op\": %.2f,\n", result.bytesPerOp);
+		fprintf(file, "\t\t\t\"cycles_per_element\": %.3f\n", result.cyclesPerElement);
+		fprintf(file, "\t\t}%s\n", i + 1 < m_results.size() ? "," : "");
+	}
+
+	fprintf(file, "\t]\n");
+	fprintf(file, "}\n");
+	fclose(file);
+
+	return true;
+}
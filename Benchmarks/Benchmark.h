@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+
+// One thing to measure. Run does `iterations` operations back to back and is the only part that gets timed. Setup and
+// Teardown are for building and throwing away whatever Run works on.
+//
+// elementsPerOp is how many items one operation handles (cells in a grid, transforms in a hierarchy, vertices in a
+// mesh), which is what cycles per element is worked out from.
+class Benchmark
+{
+private:
+	const char* m_name;
+	unsigned int m_elementsPerOp;
+
+public:
+	Benchmark(const char* name, unsigned int elementsPerOp = 1);
+	virtual ~Benchmark();
+
+	const char* GetName() const;
+	unsigned int GetElementsPerOp() const;
+
+	virtual void Setup() {}
+	virtual void Run(unsigned int iterations) = 0;
+	virtual void Teardown() {}
+};
+
+struct BenchmarkResult
+{
+	const char* name;
+	unsigned int iterations;		// Operations per timed sample
+	unsigned int elementsPerOp;
+	double nsPerOp;					// Median over the samples
+	double minNsPerOp;				// Fastest sample
+	double allocationsPerOp;		// Heap allocations, counted in a separate untimed run
+	double bytesPerOp;
+	double cyclesPerElement;		// Timestamp counter ticks, from the median sample
+};
+
+// Benchmarks hand their results to this so the optimizer can't decide the work was never needed
+void KeepResult(unsigned long long value);
+void KeepResult(float value);
+
+// Runs every benchmark the same way: seed rand, Setup, grow the iteration count until a sample takes long enough to
+// time, take a handful of samples, then one more run with the allocation tracker on. Nothing here is random from run
+// to run, so two runs of the same build do the same work.
+class BenchmarkRunner
+{
+private:
+	std::vector<Benchmark*> m_benchmarks;
+	std::vector<BenchmarkResult> m_results;
+
+	unsigned int m_samples;
+	double m_sampleSeconds;
+
+	BenchmarkResult Measure(Benchmark& benchmark);
+
+public:
+	BenchmarkRunner(unsigned int samples = 7, double sampleSeconds = 0.05);
+	~BenchmarkRunner();
+
+	// The runner owns the benchmark from here on
+	void Add(Benchmark* benchmark);
+
+	// Runs every benchmark whose name contains filter (or all of them if filter is null) and prints a table
+	void RunAll(const char* filter);
+
+	// Writes the results of the last RunAll as JSON. Returns false if the file can't be written.
+	bool WriteJson(const char* path) const;
+};
+
+// Each file of benchmarks registers its own
+void AddEngineBenchmarks(BenchmarkRunner& runner);
+void AddGameBenchmarks(BenchmarkRunner& runner);
@@ -0,0 +1,639 @@
+#include "Benchmark.h"
+#include "BufferUtils.h"
+#include "DrawList.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "RenderManager.h"
+#include "SoftwareRenderDevice.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+#include "SimpleVertexShader.h"
+#include "InstancedPuyoVS.h"
+#include "UnlitPixelShader.h"
+#include <memory>
+#include <stddef.h>
+
+using namespace DirectX;
+
+#define DEEP_HIERARCHY_DEPTH 64
+#define WIDE_HIERARCHY_CHILDREN 512
+#define WIDE_HIERARCHY_ROW 32
+#define SPHERE_TESSELLATION 16
+#define DRAW_BATCH_SIZE 256
+#define DRAW_LIST_MATERIALS 4
+#define DRAW_LIST_MESHES 2
+#define COMMAND_LIST_COUNT 4
+
+// Destroys a material the benchmark made along with its constant buffers, and its shaders unless another of the
+// benchmark's materials is still using them
+static void DestroyMaterialResources(MaterialHandle materialHandle, bool destroyShaders = true)
+{
+	RenderManager& renderManager = RenderManager::GetSingleton();
+	Material material = renderManager.GetMaterial(materialHandle);
+
+	renderManager.DestroyMaterial(materialHandle);
+	if (material.vsCBHandle)
+		renderManager.DestroyCBResource(material.vsCBHandle);
+	if (material.psCBHandle)
+		renderManager.DestroyCBResource(material.psCBHandle);
+
+	if (destroyShaders)
+	{
+		renderManager.DestroyVShaderResource(material.vsHandle);
+		renderManager.DestroyPShaderResource(material.psHandle);
+	}
+}
+
+// A single chain of transforms, each the parent of the next. Every operation turns the root, which makes every world
+// matrix below it stale, and then brings them all up to date.
+//
+// Benchmarks are allocated with new, which only promises 8 byte alignment on x86, so they keep vectors as XMFLOAT4s.
+class DeepHierarchyBenchmark : public Benchmark
+{
+private:
+	std::unique_ptr<Transform[]> m_transforms;
+	XMFLOAT4 m_spin;
+
+public:
+	DeepHierarchyBenchmark()
+		: Benchmark("TransformSystem::UpdateAll/deep", DEEP_HIERARCHY_DEPTH)
+	{
+	}
+
+	void Setup() override
+	{
+		m_transforms.reset(new Transform[DEEP_HIERARCHY_DEPTH]);
+		for (int i = 1; i < DEEP_HIERARCHY_DEPTH; i++)
+		{
+			m_transforms[i].SetParent(&m_transforms[i - 1]);
+			m_transforms[i].SetPosition(0.0f, 1.0f, 0.0f);
+			m_transforms[i].SetRotation(XMQuaternionRotationRollPitchYaw(0.01f * i, 0.02f, 0.0f));
+		}
+
+		XMStoreFloat4(&m_spin, XMQuaternionRotationRollPitchYaw(0.0f, 0.001f, 0.0f));
+		TransformSystem::GetSingleton().UpdateAll();
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		TransformSystem& transformSystem = TransformSystem::GetSingleton();
+		XMVECTOR spin = XMLoadFloat4(&m_spin);
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			m_transforms[0].Rotate(spin);
+			transformSystem.UpdateAll();
+		}
+
+		KeepResult(XMVectorGetX(m_transforms[DEEP_HIERARCHY_DEPTH - 1].GetWorldPosition()));
+	}
+
+	void Teardown() override
+	{
+		m_transforms.reset();
+	}
+};
+
+// One root with a lot of children, all of which move every operation. This is the puyo case: local matrices get rebuilt
+// in batches and every world matrix is one multiply away from its parent's.
+class WideHierarchyBenchmark : public Benchmark
+{
+private:
+	std::unique_ptr<Transform[]> m_transforms;
+	XMFLOAT4 m_step;
+
+public:
+	WideHierarchyBenchmark()
+		: Benchmark("TransformSystem::UpdateAll/wide", WIDE_HIERARCHY_CHILDREN)
+	{
+	}
+
+	void Setup() override
+	{
+		m_transforms.reset(new Transform[WIDE_HIERARCHY_CHILDREN + 1]);
+		for (int i = 1; i <= WIDE_HIERARCHY_CHILDREN; i++)
+		{
+			m_transforms[i].SetParent(&m_transforms[0]);
+			m_transforms[i].SetPosition((float)(i % WIDE_HIERARCHY_ROW), (float)(i / WIDE_HIERARCHY_ROW), 0.0f);
+		}
+
+		m_step = XMFLOAT4(0.0f, -0.001f, 0.0f, 0.0f);
+		TransformSystem::GetSingleton().UpdateAll();
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		TransformSystem& transformSystem = TransformSystem::GetSingleton();
+		XMVECTOR step = XMLoadFloat4(&m_step);
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			for (int j = 1; j <= WIDE_HIERARCHY_CHILDREN; j++)
+				m_transforms[j].Translate(step, Transform::Space::LocalSpace);
+
+			transformSystem.UpdateAll();
+		}
+
+		KeepResult(XMVectorGetY(m_transforms[WIDE_HIERARCHY_CHILDREN].GetWorldPosition()));
+	}
+
+	void Teardown() override
+	{
+		m_transforms.reset();
+	}
+};
+
+// The CPU side of Mesh::CreateSphere. The collections are kept between operations like a loader reusing its scratch
+// buffers would, so allocations per op should be zero.
+class SphereGenerationBenchmark : public Benchmark
+{
+private:
+	VertexCollection m_vertices;
+	IndexCollection m_indices;
+
+public:
+	SphereGenerationBenchmark()
+		: Benchmark("Mesh::GenerateSphere", (SPHERE_TESSELLATION + 1) * (SPHERE_TESSELLATION * 2 + 1))
+	{
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			Mesh::GenerateSphere(m_vertices, m_indices, 1.0f, SPHERE_TESSELLATION);
+			KeepResult((unsigned long long)m_indices.back());
+		}
+	}
+
+	void Teardown() override
+	{
+		m_vertices = VertexCollection();
+		m_indices = IndexCollection();
+	}
+};
+
+// The CPU cost of drawing through the RenderManager: a constant buffer update and a draw per object, the way the game
+// draws puyos. It runs on the null device main sets up, so this is the engine's overhead plus the device's bookkeeping
+// and validation, with no driver underneath.
+class DrawWithMaterialBenchmark : public Benchmark
+{
+private:
+	// Same layout as the PerObject cbuffer in SimpleVertexShader
+	struct PerObjectData
+	{
+		XMMATRIX WorldMatrix;
+		XMMATRIX InverseTransposeWorldMatrix;
+		XMMATRIX WorldViewProjectionMatrix;
+	};
+
+	std::unique_ptr<XMFLOAT4X4[]> m_worldMatrices;
+	MeshHandle m_mesh;
+	MaterialHandle m_material;
+
+public:
+	DrawWithMaterialBenchmark()
+		: Benchmark("RenderManager::DrawWithMaterial/null", DRAW_BATCH_SIZE)
+		, m_mesh()
+		, m_material()
+	{
+	}
+
+	void Setup() override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		VSHandle vs = renderManager.CreateVShaderResource(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+		PSHandle ps = renderManager.CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+		CBHandle vscb = renderManager.CreateCBResource(sizeof(PerObjectData));
+		m_material = renderManager.CreateMaterial(vs, ps, vscb);
+		m_mesh = renderManager.CreateMeshResource(Mesh::CreateSphere(renderManager.GetDevice(), 1.0f, SPHERE_TESSELLATION));
+
+		m_worldMatrices.reset(new XMFLOAT4X4[DRAW_BATCH_SIZE]);
+		for (int i = 0; i < DRAW_BATCH_SIZE; i++)
+			XMStoreFloat4x4(&m_worldMatrices[i], XMMatrixTranslation((float)(i % WIDE_HIERARCHY_ROW), (float)(i / WIDE_HIERARCHY_ROW), 0.0f));
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		CBHandle vscb = renderManager.GetMaterial(m_material).vsCBHandle;
+		XMMATRIX viewProjection = XMMatrixOrthographicLH(800.0f, 600.0f, 0.1f, 100.0f);
+
+		PerObjectData data;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			for (int j = 0; j < DRAW_BATCH_SIZE; j++)
+			{
+				data.WorldMatrix = XMLoadFloat4x4(&m_worldMatrices[j]);
+				data.InverseTransposeWorldMatrix = data.WorldMatrix;
+				data.WorldViewProjectionMatrix = data.WorldMatrix * viewProjection;
+				renderManager.UpdateConstantBuffer(vscb, &data);
+				renderManager.DrawWithMaterial(m_mesh, m_material);
+			}
+
+			renderManager.BeginFrame();
+		}
+
+		KeepResult(renderManager.GetDevice()->GetStats().triangles);
+	}
+
+	void Teardown() override
+	{
+		m_worldMatrices.reset();
+
+		DestroyMaterialResources(m_material);
+		RenderManager::GetSingleton().DestroyMeshResource(m_mesh);
+		m_material = MaterialHandle();
+		m_mesh = MeshHandle();
+	}
+};
+
+// The DrawWithMaterial batch split between a few command lists, each recorded on whichever thread the JobSystem hands
+// it to, and then executed in order. The null device gets the default recorded lists, so this is recording and playing
+// back on top of what drawing straight away costs, less whatever the recording threads take off the main one.
+class CommandListBenchmark : public Benchmark
+{
+private:
+	// Same layout as the PerObject cbuffer in SimpleVertexShader
+	struct PerObjectData
+	{
+		XMMATRIX WorldMatrix;
+		XMMATRIX InverseTransposeWorldMatrix;
+		XMMATRIX WorldViewProjectionMatrix;
+	};
+
+	std::unique_ptr<XMFLOAT4X4[]> m_worldMatrices;
+	std::unique_ptr<RenderCommandList> m_lists[COMMAND_LIST_COUNT];
+	MeshHandle m_mesh;
+	MaterialHandle m_material;
+
+	static void Record(void* data, unsigned int index)
+	{
+		CommandListBenchmark* benchmark = (CommandListBenchmark*)data;
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		CBHandle vscb = renderManager.GetMaterial(benchmark->m_material).vsCBHandle;
+		XMMATRIX viewProjection = XMMatrixOrthographicLH(800.0f, 600.0f, 0.1f, 100.0f);
+
+		renderManager.BeginRecording(*benchmark->m_lists[index]);
+		renderManager.ResetRenderTarget();
+
+		PerObjectData objectData;
+		for (int j = index; j < DRAW_BATCH_SIZE; j += COMMAND_LIST_COUNT)
+		{
+			objectData.WorldMatrix = XMLoadFloat4x4(&benchmark->m_worldMatrices[j]);
+			objectData.InverseTransposeWorldMatrix = objectData.WorldMatrix;
+			objectData.WorldViewProjectionMatrix = objectData.WorldMatrix * viewProjection;
+			renderManager.UpdateConstantBuffer(vscb, &objectData);
+			renderManager.DrawWithMaterial(benchmark->m_mesh, benchmark->m_material);
+		}
+
+		renderManager.EndRecording();
+	}
+
+public:
+	CommandListBenchmark()
+		: Benchmark("RenderManager::ExecuteCommandList/null", DRAW_BATCH_SIZE)
+		, m_mesh()
+		, m_material()
+	{
+	}
+
+	void Setup() override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		VSHandle vs = renderManager.CreateVShaderResource(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+		PSHandle ps = renderManager.CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+		CBHandle vscb = renderManager.CreateCBResource(sizeof(PerObjectData));
+		m_material = renderManager.CreateMaterial(vs, ps, vscb);
+		m_mesh = renderManager.CreateMeshResource(Mesh::CreateSphere(renderManager.GetDevice(), 1.0f, SPHERE_TESSELLATION));
+
+		for (int i = 0; i < COMMAND_LIST_COUNT; i++)
+			m_lists[i] = renderManager.GetDevice()->CreateCommandList();
+
+		m_worldMatrices.reset(new XMFLOAT4X4[DRAW_BATCH_SIZE]);
+		for (int i = 0; i < DRAW_BATCH_SIZE; i++)
+			XMStoreFloat4x4(&m_worldMatrices[i], XMMatrixTranslation((float)(i % WIDE_HIERARCHY_ROW), (float)(i / WIDE_HIERARCHY_ROW), 0.0f));
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			JobSystem::GetSingleton().ParallelFor(COMMAND_LIST_COUNT, Record, this);
+			for (int j = 0; j < COMMAND_LIST_COUNT; j++)
+				renderManager.ExecuteCommandList(*m_lists[j]);
+
+			renderManager.BeginFrame();
+		}
+
+		KeepResult(renderManager.GetDevice()->GetStats().triangles);
+	}
+
+	void Teardown() override
+	{
+		m_worldMatrices.reset();
+		for (int i = 0; i < COMMAND_LIST_COUNT; i++)
+			m_lists[i].reset();
+
+		DestroyMaterialResources(m_material);
+		RenderManager::GetSingleton().DestroyMeshResource(m_mesh);
+		m_material = MaterialHandle();
+		m_mesh = MeshHandle();
+	}
+};
+
+// The same objects again, but with a few materials, meshes and states mixed together and submitted in no particular
+// order, the way a scene would. They go through a DrawList, so this is recording, sorting and executing with the
+// redundant binds skipped.
+class DrawListBenchmark : public Benchmark
+{
+private:
+	// Same layout as the PerObject cbuffer in SimpleVertexShader
+	struct PerObjectData
+	{
+		XMMATRIX WorldMatrix;
+		XMMATRIX InverseTransposeWorldMatrix;
+		XMMATRIX WorldViewProjectionMatrix;
+	};
+
+	std::unique_ptr<XMFLOAT4X4[]> m_worldMatrices;
+	MeshHandle m_meshes[DRAW_LIST_MESHES];
+	MaterialHandle m_materials[DRAW_LIST_MATERIALS];
+	DrawList m_drawList;
+
+public:
+	DrawListBenchmark()
+		: Benchmark("DrawList::Execute/null", DRAW_BATCH_SIZE)
+		, m_meshes()
+		, m_materials()
+	{
+	}
+
+	void Setup() override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		VSHandle vs = renderManager.CreateVShaderResource(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+		PSHandle ps = renderManager.CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+		for (int i = 0; i < DRAW_LIST_MATERIALS; i++)
+			m_materials[i] = renderManager.CreateMaterial(vs, ps, renderManager.CreateCBResource(sizeof(PerObjectData)));
+		for (int i = 0; i < DRAW_LIST_MESHES; i++)
+			m_meshes[i] = renderManager.CreateMeshResource(Mesh::CreateSphere(renderManager.GetDevice(), 1.0f, SPHERE_TESSELLATION + i));
+
+		m_worldMatrices.reset(new XMFLOAT4X4[DRAW_BATCH_SIZE]);
+		for (int i = 0; i < DRAW_BATCH_SIZE; i++)
+			XMStoreFloat4x4(&m_worldMatrices[i], XMMatrixTranslation((float)(i % WIDE_HIERARCHY_ROW), (float)(i / WIDE_HIERARCHY_ROW), 0.0f));
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		XMMATRIX viewProjection = XMMatrixOrthographicLH(800.0f, 600.0f, 0.1f, 100.0f);
+
+		PerObjectData data;
+		DrawPacket packet;
+		packet.vsConstants = &data;
+		packet.vsConstantSize = sizeof(data);
+
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			m_drawList.Clear();
+			for (int j = 0; j < DRAW_BATCH_SIZE; j++)
+			{
+				data.WorldMatrix = XMLoadFloat4x4(&m_worldMatrices[j]);
+				data.InverseTransposeWorldMatrix = data.WorldMatrix;
+				data.WorldViewProjectionMatrix = data.WorldMatrix * viewProjection;
+
+				// Steps through the materials, meshes and states at different rates so neighbours rarely match
+				packet.material = m_materials[j % DRAW_LIST_MATERIALS];
+				packet.mesh = m_meshes[(j / 3) % DRAW_LIST_MESHES];
+				packet.state.blend = (j / 5) % 2 ? BLEND_STATE::ALPHA_BLEND : BLEND_STATE::SOLID;
+				m_drawList.Submit(DrawList::MakeKey(0, packet.state, packet.material, packet.mesh, (float)j / DRAW_BATCH_SIZE), packet);
+			}
+
+			m_drawList.Sort();
+			m_drawList.Execute(renderManager);
+
+			FrameAllocator::GetSingleton().BeginFrame();
+			renderManager.BeginFrame();
+		}
+
+		KeepResult(renderManager.GetDevice()->GetStats().triangles);
+	}
+
+	void Teardown() override
+	{
+		m_worldMatrices.reset();
+		m_drawList.Clear();
+
+		// They all share the one pair of shaders, so the last material takes them with it
+		for (int i = 0; i < DRAW_LIST_MATERIALS; i++)
+		{
+			DestroyMaterialResources(m_materials[i], i == DRAW_LIST_MATERIALS - 1);
+			m_materials[i] = MaterialHandle();
+		}
+		for (int i = 0; i < DRAW_LIST_MESHES; i++)
+		{
+			RenderManager::GetSingleton().DestroyMeshResource(m_meshes[i]);
+			m_meshes[i] = MeshHandle();
+		}
+	}
+};
+
+// The same objects drawn the way the game draws puyos now: their matrices go into an instance buffer and the whole
+// batch is one draw, so the per object cost is filling in the instance data.
+class DrawInstancedWithMaterialBenchmark : public Benchmark
+{
+private:
+	// Same layout as the game's PuyoRenderData, which is what InstancedPuyoVS reads
+	struct InstanceData
+	{
+		XMFLOAT4X3 World;
+		XMFLOAT3X3 NormalMatrix;
+	};
+
+	static const VertexElement ms_elements[];
+
+	std::unique_ptr<XMFLOAT4X4[]> m_worldMatrices;
+	std::unique_ptr<InstanceData[]> m_instances;
+	InstanceBuffer m_instanceBuffer;
+	MeshHandle m_mesh;
+	MaterialHandle m_material;
+
+public:
+	DrawInstancedWithMaterialBenchmark()
+		: Benchmark("RenderManager::DrawInstancedWithMaterial/null", DRAW_BATCH_SIZE)
+		, m_mesh()
+		, m_material()
+	{
+	}
+
+	void Setup() override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		VSHandle vs = renderManager.CreateVShaderResource(g_InstancedPuyoVS, sizeof(g_InstancedPuyoVS), ms_elements, 10);
+		PSHandle ps = renderManager.CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+		CBHandle vscb = renderManager.CreateCBResource(sizeof(XMMATRIX));
+		m_material = renderManager.CreateMaterial(vs, ps, vscb);
+		m_mesh = renderManager.CreateMeshResource(Mesh::CreateSphere(renderManager.GetDevice(), 1.0f, SPHERE_TESSELLATION));
+
+		// The buffer releases itself when the benchmark goes, so it's kept for the next run
+		if (!m_instanceBuffer.buffer)
+			m_instanceBuffer.Initialize(renderManager.GetDevice(), sizeof(InstanceData), DRAW_BATCH_SIZE);
+
+		m_worldMatrices.reset(new XMFLOAT4X4[DRAW_BATCH_SIZE]);
+		m_instances.reset(new InstanceData[DRAW_BATCH_SIZE]);
+		for (int i = 0; i < DRAW_BATCH_SIZE; i++)
+			XMStoreFloat4x4(&m_worldMatrices[i], XMMatrixTranslation((float)(i % WIDE_HIERARCHY_ROW), (float)(i / WIDE_HIERARCHY_ROW), 0.0f));
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		RenderManager& renderManager = RenderManager::GetSingleton();
+		CBHandle vscb = renderManager.GetMaterial(m_material).vsCBHandle;
+		XMMATRIX viewProjection = XMMatrixOrthographicLH(800.0f, 600.0f, 0.1f, 100.0f);
+
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			for (int j = 0; j < DRAW_BATCH_SIZE; j++)
+			{
+				XMMATRIX world = XMLoadFloat4x4(&m_worldMatrices[j]);
+				XMStoreFloat4x3(&m_instances[j].World, world);
+				XMStoreFloat3x3(&m_instances[j].NormalMatrix, world);
+			}
+
+			m_instanceBuffer.Update(m_instances.get(), DRAW_BATCH_SIZE);
+			renderManager.UpdateConstantBuffer(vscb, &viewProjection);
+			renderManager.DrawInstancedWithMaterial(m_mesh, m_material, m_instanceBuffer.buffer, m_instanceBuffer.stride, DRAW_BATCH_SIZE);
+
+			renderManager.BeginFrame();
+		}
+
+		KeepResult(renderManager.GetDevice()->GetStats().triangles);
+	}
+
+	void Teardown() override
+	{
+		m_worldMatrices.reset();
+		m_instances.reset();
+
+		DestroyMaterialResources(m_material);
+		RenderManager::GetSingleton().DestroyMeshResource(m_mesh);
+		m_material = MaterialHandle();
+		m_mesh = MeshHandle();
+	}
+};
+
+const VertexElement DrawInstancedWithMaterialBenchmark::ms_elements[] =
+{
+	{ "POSITION",		0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, position),		0, false },
+	{ "NORMAL",			0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, normal),			0, false },
+	{ "TEXCOORD",		0, GPU_FORMAT::R32G32_FLOAT,	offsetof(VertexPositionNormalTexture, textureCoordinate),	0, false },
+	{ "WORLD",			0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, World) + 0,						1, true },
+	{ "WORLD",			1, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, World) + 12,						1, true },
+	{ "WORLD",			2, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, World) + 24,						1, true },
+	{ "WORLD",			3, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, World) + 36,						1, true },
+	{ "NORMALMATRIX",	0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, NormalMatrix) + 0,				1, true },
+	{ "NORMALMATRIX",	1, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, NormalMatrix) + 12,				1, true },
+	{ "NORMALMATRIX",	2, GPU_FORMAT::R32G32B32_FLOAT, offsetof(InstanceData, NormalMatrix) + 24,				1, true },
+};
+
+// The same draws again, but on a software device of its own so every one of them is really shaded: vertex kernels,
+// binning, and 8 pixel blocks spread across the JobSystem's workers. Each operation is a frame, cleared and then
+// presented, since nothing gets drawn until something asks for the pixels.
+class SoftwareDrawBenchmark : public Benchmark
+{
+private:
+	struct PerObjectData
+	{
+		XMMATRIX WorldMatrix;
+		XMMATRIX InverseTransposeWorldMatrix;
+		XMMATRIX WorldViewProjectionMatrix;
+	};
+
+	std::unique_ptr<SoftwareRenderDevice> m_device;
+	std::unique_ptr<Mesh> m_mesh;
+	std::unique_ptr<XMFLOAT4X4[]> m_worldMatrices;
+	GPUHANDLE m_vertexShader;
+	GPUHANDLE m_pixelShader;
+	GPUHANDLE m_constantBuffer;
+
+public:
+	SoftwareDrawBenchmark()
+		: Benchmark("SoftwareRenderDevice::DrawIndexed", DRAW_BATCH_SIZE)
+		, m_vertexShader(0)
+		, m_pixelShader(0)
+		, m_constantBuffer(0)
+	{
+	}
+
+	void Setup() override
+	{
+		m_device.reset(new SoftwareRenderDevice(800, 600));
+		m_vertexShader = m_device->CreateVertexShader(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+		m_pixelShader = m_device->CreatePixelShader(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+		m_constantBuffer = m_device->CreateBuffer(BUFFER_TYPE::CONSTANT, sizeof(PerObjectData), nullptr);
+		m_mesh = Mesh::CreateSphere(m_device.get(), 1.0f, SPHERE_TESSELLATION, false);
+
+		// A grid of puyo sized spheres across the whole screen
+		m_worldMatrices.reset(new XMFLOAT4X4[DRAW_BATCH_SIZE]);
+		for (int i = 0; i < DRAW_BATCH_SIZE; i++)
+		{
+			float x = -390.0f + (float)(i % WIDE_HIERARCHY_ROW) * 25.0f;
+			float y = -280.0f + (float)(i / WIDE_HIERARCHY_ROW) * 70.0f;
+			XMStoreFloat4x4(&m_worldMatrices[i], XMMatrixScaling(40.0f, 40.0f, 40.0f) * XMMatrixTranslation(x, y, 0.0f));
+		}
+
+		Viewport viewport = { 0.0f, 0.0f, 800.0f, 600.0f, 0.0f, 1.0f };
+		m_device->SetViewport(viewport);
+		m_device->SetRenderTarget(m_device->GetBackBuffer(), m_device->GetBackBufferDepth());
+		m_device->SetVertexShader(m_vertexShader);
+		m_device->SetPixelShader(m_pixelShader);
+		m_device->SetVSConstantBuffer(0, m_constantBuffer);
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		XMMATRIX viewProjection = XMMatrixTranslation(0.0f, 0.0f, 50.0f) * XMMatrixOrthographicLH(800.0f, 600.0f, 0.1f, 100.0f);
+
+		PerObjectData data;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			m_device->ClearRenderTarget(m_device->GetBackBuffer(), clearColor);
+			m_device->ClearDepthStencil(m_device->GetBackBufferDepth(), CLEAR_DEPTH | CLEAR_STENCIL, 1.0f, 0);
+
+			for (int j = 0; j < DRAW_BATCH_SIZE; j++)
+			{
+				data.WorldMatrix = XMLoadFloat4x4(&m_worldMatrices[j]);
+				data.InverseTransposeWorldMatrix = data.WorldMatrix;
+				data.WorldViewProjectionMatrix = data.WorldMatrix * viewProjection;
+				m_device->UpdateBuffer(m_constantBuffer, &data);
+				m_mesh->Draw(m_device.get());
+			}
+
+			m_device->Present();
+		}
+
+		KeepResult((unsigned long long)m_device->ReadTexture(m_device->GetBackBuffer())->color[300 * 800 + 400]);
+	}
+
+	void Teardown() override
+	{
+		m_worldMatrices.reset();
+		m_mesh.reset();
+		m_device.reset();
+	}
+};
+
+void AddEngineBenchmarks(BenchmarkRunner& runner)
+{
+	runner.Add(new DeepHierarchyBenchmark());
+	runner.Add(new WideHierarchyBenchmark());
+	runner.Add(new SphereGenerationBenchmark());
+	runner.Add(new DrawWithMaterialBenchmark());
+	runner.Add(new DrawInstancedWithMaterialBenchmark());
+	runner.Add(new DrawListBenchmark());
+	runner.Add(new CommandListBenchmark());
+	runner.Add(new SoftwareDrawBenchmark());
+}
@@ -0,0 +1,341 @@
+#include "PuyoPuyoGamePCH.h"
+#include "Benchmark.h"
+#include "ConcurrentObjectPool.h"
+#include "JobSystem.h"
+#include "ObjectPool.h"
+#include "Puyo.h"
+#include "PuyoBoard.h"
+#include "PuyoGrid.h"
+#include "PuyoValues.h"
+#include <mutex>
+#include <stdlib.h>
+
+#define GRID_CELLS (GRID_WIDTH * GRID_HEIGHT)
+
+// How many objects the allocator benchmarks keep alive at once
+#define ALLOCATOR_LIVE_OBJECTS 256
+
+// How many jobs the threaded allocator benchmarks split those objects between
+#define ALLOCATOR_THREAD_JOBS 4
+
+// About the size of a small game object. The pool and the heap benchmarks both use it.
+struct AllocatorBenchObject
+{
+	float data[16];
+};
+
+// Fills a board with random colors, leaving roughly emptyPercent of the cells as holes so gravity has work to do
+static void FillRandomBoard(PuyoBoard& board, int emptyPercent)
+{
+	board.Clear();
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		for (int j = 0; j < GRID_HEIGHT; j++)
+		{
+			if (rand() % 100 >= emptyPercent)
+				board.Set(i, j, (PUYO_COLOR)(rand() % USED_PUYO_COLORS));
+		}
+	}
+}
+
+// A full grid of random colors. FindCombos flood fills the whole thing every time it's called.
+class FindCombosBenchmark : public Benchmark
+{
+private:
+	Puyo m_puyos[GRID_CELLS];
+	PuyoGrid m_grid;
+	Puyo* m_comboStaging[GRID_CELLS];
+
+public:
+	FindCombosBenchmark()
+		: Benchmark("PuyoGrid::FindCombos", GRID_CELLS)
+	{
+	}
+
+	void Setup() override
+	{
+		for (int i = 0; i < GRID_WIDTH; i++)
+		{
+			for (int j = 0; j < GRID_HEIGHT; j++)
+			{
+				Puyo& puyo = m_puyos[i * GRID_HEIGHT + j];
+				puyo.SetRandomColor();
+				m_grid.AddPuyo(&puyo, i, j);
+			}
+		}
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+			KeepResult((unsigned long long)m_grid.FindCombos(m_comboStaging));
+	}
+
+	void Teardown() override
+	{
+		m_grid.Cleanup();
+	}
+};
+
+// Each operation copies a board full of holes and lets everything fall. The copy is a hundred bytes or so, small next to
+// the gravity pass itself.
+class GravityBenchmark : public Benchmark
+{
+private:
+	PuyoBoard m_start;
+
+public:
+	GravityBenchmark()
+		: Benchmark("PuyoBoard::ApplyGravity", GRID_CELLS)
+	{
+	}
+
+	void Setup() override
+	{
+		FillRandomBoard(m_start, 35);
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			PuyoBoard board = m_start;
+			board.ApplyGravity();
+			KeepResult((unsigned long long)board.GetHeight(i % GRID_WIDTH));
+		}
+	}
+};
+
+// Resolves the same multi-step chain every operation: clear groups, fall, repeat until the board settles
+class ChainResolutionBenchmark : public Benchmark
+{
+private:
+	PuyoBoard m_start;
+	int m_chain;
+
+public:
+	ChainResolutionBenchmark()
+		: Benchmark("PuyoBoard::ResolveChains", GRID_CELLS)
+		, m_chain(0)
+	{
+	}
+
+	void Setup() override
+	{
+		// rand() is seeded the same every run, so this always settles on the same board
+		do
+		{
+			FillRandomBoard(m_start, 10);
+			m_start.ApplyGravity();
+
+			PuyoBoard trial = m_start;
+			m_chain = trial.ResolveChains();
+		} while (m_chain < 3);
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			PuyoBoard board = m_start;
+			KeepResult((unsigned long long)board.ResolveChains());
+		}
+	}
+};
+
+// One operation is a free followed by an allocation, with ALLOCATOR_LIVE_OBJECTS alive the whole time. Objects are
+// replaced in a scattered order so the free list doesn't stay in address order.
+class ObjectPoolBenchmark : public Benchmark
+{
+private:
+	ObjectPool<AllocatorBenchObject> m_pool{ ALLOCATOR_LIVE_OBJECTS };
+	AllocatorBenchObject* m_live[ALLOCATOR_LIVE_OBJECTS];
+	unsigned int m_cursor;
+
+public:
+	ObjectPoolBenchmark()
+		: Benchmark("ObjectPool::AllocObject+FreeObject")
+		, m_cursor(0)
+	{
+	}
+
+	void Setup() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			m_live[i] = m_pool.AllocObject();
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int index = (m_cursor++ * 7) % ALLOCATOR_LIVE_OBJECTS;
+			m_pool.FreeObject(m_live[index]);
+			m_live[index] = m_pool.AllocObject();
+		}
+
+		KeepResult((unsigned long long)m_pool.Count());
+	}
+
+	void Teardown() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			m_pool.FreeObject(m_live[i]);
+	}
+};
+
+// An ObjectPool behind a lock, which is what every thread sharing one would need without ConcurrentObjectPool
+class LockedObjectPool
+{
+private:
+	ObjectPool<AllocatorBenchObject> m_pool;
+	std::mutex m_lock;
+
+public:
+	explicit LockedObjectPool(unsigned int blockSize)
+		: m_pool(blockSize)
+	{
+	}
+
+	AllocatorBenchObject* AllocObject()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_pool.AllocObject();
+	}
+
+	void FreeObject(AllocatorBenchObject* object)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_pool.FreeObject(object);
+	}
+};
+
+// The ObjectPoolBenchmark pattern on ALLOCATOR_THREAD_JOBS jobs at once, all sharing one pool. Each job replaces its
+// own objects, and one operation is a free and an allocation on every job.
+template <typename Pool>
+class ThreadedPoolBenchmark : public Benchmark
+{
+private:
+	Pool m_pool{ ALLOCATOR_LIVE_OBJECTS };
+	AllocatorBenchObject* m_live[ALLOCATOR_LIVE_OBJECTS];
+	unsigned int m_iterations;
+
+	static const unsigned int k_liveObjectsPerJob = ALLOCATOR_LIVE_OBJECTS / ALLOCATOR_THREAD_JOBS;
+
+	static void Churn(void* data, unsigned int job)
+	{
+		ThreadedPoolBenchmark* benchmark = (ThreadedPoolBenchmark*)data;
+		AllocatorBenchObject** live = &benchmark->m_live[job * k_liveObjectsPerJob];
+
+		for (unsigned int i = 0; i < benchmark->m_iterations; i++)
+		{
+			unsigned int index = (i * 7) % k_liveObjectsPerJob;
+			benchmark->m_pool.FreeObject(live[index]);
+			live[index] = benchmark->m_pool.AllocObject();
+		}
+	}
+
+public:
+	explicit ThreadedPoolBenchmark(const char* name)
+		: Benchmark(name, ALLOCATOR_THREAD_JOBS)
+		, m_iterations(0)
+	{
+	}
+
+	void Setup() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			m_live[i] = m_pool.AllocObject();
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		m_iterations = iterations;
+		JobSystem::GetSingleton().ParallelFor(ALLOCATOR_THREAD_JOBS, Churn, this);
+
+		KeepResult((unsigned long long)(size_t)m_live[0]);
+	}
+
+	void Teardown() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			m_pool.FreeObject(m_live[i]);
+	}
+};
+
+// The same pattern as ObjectPoolBenchmark, straight from the heap. This goes through operator new (which is malloc
+// underneath) rather than calling malloc directly so the allocation tracker sees it.
+class HeapBenchmark : public Benchmark
+{
+private:
+	AllocatorBenchObject* m_live[ALLOCATOR_LIVE_OBJECTS];
+	unsigned int m_cursor;
+
+public:
+	HeapBenchmark()
+		: Benchmark("new+delete")
+		, m_cursor(0)
+	{
+	}
+
+	void Setup() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			m_live[i] = new AllocatorBenchObject();
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			unsigned int index = (m_cursor++ * 7) % ALLOCATOR_LIVE_OBJECTS;
+			delete m_live[index];
+			m_live[index] = new AllocatorBenchObject();
+		}
+
+		KeepResult((unsigned long long)(size_t)m_live[0]);
+	}
+
+	void Teardown() override
+	{
+		for (int i = 0; i < ALLOCATOR_LIVE_OBJECTS; i++)
+			delete m_live[i];
+	}
+};
+
+// The random number generator behind every new puyo's color
+class RandomColorBenchmark : public Benchmark
+{
+private:
+	Puyo m_puyo;
+
+public:
+	RandomColorBenchmark()
+		: Benchmark("Puyo::SetRandomColor")
+	{
+	}
+
+	void Run(unsigned int iterations) override
+	{
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < iterations; i++)
+		{
+			m_puyo.SetRandomColor();
+			total += m_puyo.puyoColor;
+		}
+
+		KeepResult(total);
+	}
+};
+
+void AddGameBenchmarks(BenchmarkRunner& runner)
+{
+	runner.Add(new FindCombosBenchmark());
+	runner.Add(new GravityBenchmark());
+	runner.Add(new ChainResolutionBenchmark());
+	runner.Add(new ObjectPoolBenchmark());
+	runner.Add(new ThreadedPoolBenchmark<ConcurrentObjectPool<AllocatorBenchObject>>("ConcurrentObjectPool::AllocObject+FreeObject/threads"));
+	runner.Add(new ThreadedPoolBenchmark<LockedObjectPool>("ObjectPool+mutex::AllocObject+FreeObject/threads"));
+	runner.Add(new HeapBenchmark());
+	runner.Add(new RandomColorBenchmark());
+}
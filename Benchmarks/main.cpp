@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
+#include "NullRenderDevice.h"
+#include "RenderManager.h"
+#include "TransformSystem.h"
+#include <stdio.h>
+#include <string.h>
+
+// Usage: Benchmarks [-out results.json] [-filter name]
+//	-out	where the JSON goes (benchmarks.json by default)
+//	-filter	only runs benchmarks whose name contains this
+int main(int argc, char* argv[])
+{
+	const char* outPath = "benchmarks.json";
+	const char* filter = nullptr;
+
+	for (int i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "-out") == 0)
+			outPath = argv[++i];
+		else if (strcmp(argv[i], "-filter") == 0)
+			filter = argv[++i];
+	}
+
+	// Transforms (and so puyos) need the TransformSystem. Nothing here needs a window, and drawing goes to the null
+	// device so the numbers are the engine's and not the driver's. The software device benchmark shades on the
+	// JobSystem's workers, and the draw list copies its constants into the FrameAllocator.
+	JobSystem* jobSystem = new JobSystem();
+	FrameAllocator* frameAllocator = new FrameAllocator();
+	TransformSystem* transformSystem = new TransformSystem();
+	RenderManager* renderManager = new RenderManager(new NullRenderDevice(800, 600));
+
+	bool result;
+	{
+		BenchmarkRunner runner;
+		AddEngineBenchmarks(runner);
+		AddGameBenchmarks(runner);
+
+		runner.RunAll(filter);
+		result = runner.WriteJson(outPath);
+	}
+
+	delete renderManager;
+	delete transformSystem;
+	delete frameAllocator;
+	delete jobSystem;
+
+	if (result)
+		printf("Results written to %s \n", outPath);
+
+	return result ? 0 : 1;
+}
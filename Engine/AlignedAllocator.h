@@ -0,0 +1,70 @@
+#pragma once
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// _aligned_malloc is MSVC only, so everything that needs aligned memory goes through these instead
+inline void* AlignedMalloc(size_t size, size_t alignment)
+{
+#if defined(_WIN32)
+	return _aligned_malloc(size, alignment);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0)
+		return nullptr;
+
+	return memory;
+#endif
+}
+
+inline void AlignedFree(void* memory)
+{
+#if defined(_WIN32)
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+// An STL allocator that hands out memory aligned to Alignment bytes. The DirectXMath types need 16 byte alignment for
+// the SSE intrinsics, which the default allocator only guarantees on x64.
+template <typename T, size_t Alignment = 16>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		void* memory = AlignedMalloc(count * sizeof(T), Alignment);
+		if (!memory)
+			throw std::bad_alloc();
+
+		return static_cast<T*>(memory);
+	}
+
+	void deallocate(T* memory, size_t)
+	{
+		AlignedFree(memory);
+	}
+};
+
+template <typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+template <typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
@@ -0,0 +1,231 @@
+#include "AllocationTracker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+// These all live in static storage and are zero before any constructor runs, so allocations made during static
+// initialization (before main, in other translation units) are safe to count.
+static std::atomic<bool> s_enabled(false);
+static AllocationTracker::AllocationCallback s_callback = nullptr;
+
+// The frame in progress. The hook can be called from any thread, so these are atomic.
+static std::atomic<unsigned int> s_frameAllocations[(int)ALLOC_TAG::COUNT];
+static std::atomic<size_t> s_frameBytes[(int)ALLOC_TAG::COUNT];
+
+// Only touched by BeginFrame and the getters, from the main thread
+static AllocationStats s_stats[(int)ALLOC_TAG::COUNT];
+
+static thread_local ALLOC_TAG t_currentTag = ALLOC_TAG::UNTAGGED;
+static thread_local bool t_inCallback = false;
+
+static const char* s_tagNames[(int)ALLOC_TAG::COUNT] =
+{
+	"Untagged",
+	"Render",
+	"Transform",
+	"Game",
+	"AI",
+	"Lua"
+};
+
+void AllocationTracker::SetEnabled(bool enabled)
+{
+	s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool AllocationTracker::IsEnabled()
+{
+	return s_enabled.load(std::memory_order_relaxed);
+}
+
+void AllocationTracker::BeginFrame()
+{
+	if (!IsEnabled())
+		return;
+
+	for (int i = 0; i < (int)ALLOC_TAG::COUNT; i++)
+	{
+		AllocationStats& stats = s_stats[i];
+		stats.allocations = s_frameAllocations[i].exchange(0, std::memory_order_relaxed);
+		stats.bytes = s_frameBytes[i].exchange(0, std::memory_order_relaxed);
+
+		if (stats.allocations > stats.peakAllocations)
+			stats.peakAllocations = stats.allocations;
+		if (stats.bytes > stats.peakBytes)
+			stats.peakBytes = stats.bytes;
+
+		stats.totalAllocations += stats.allocations;
+		stats.totalBytes += stats.bytes;
+	}
+}
+
+ALLOC_TAG AllocationTracker::GetCurrentTag()
+{
+	return t_currentTag;
+}
+
+AllocationStats AllocationTracker::GetStats(ALLOC_TAG tag)
+{
+	return s_stats[(int)tag];
+}
+
+unsigned int AllocationTracker::GetFrameAllocations()
+{
+	unsigned int allocations = 0;
+	for (int i = 0; i < (int)ALLOC_TAG::COUNT; i++)
+		allocations += s_stats[i].allocations;
+
+	return allocations;
+}
+
+void AllocationTracker::SetCallback(AllocationCallback callback)
+{
+	s_callback = callback;
+}
+
+const char* AllocationTracker::GetTagName(ALLOC_TAG tag)
+{
+	return s_tagNames[(int)tag];
+}
+
+void AllocationTracker::PrintReport()
+{
+	printf("\n--- Heap allocations per frame ---\n");
+	printf("%-10s %12s %12s %12s %12s %14s\n", "Tag", "Last", "Last bytes", "Peak", "Peak bytes", "Total");
+
+	for (int i = 0; i < (int)ALLOC_TAG::COUNT; i++)
+	{
+		const AllocationStats& stats = s_stats[i];
+		printf("%-10s %12u %12llu %12u %12llu %14llu\n", s_tagNames[i],
+			stats.allocations, (unsigned long long)stats.bytes,
+			stats.peakAllocations, (unsigned long long)stats.peakBytes,
+			stats.totalAllocations);
+	}
+}
+
+void* AllocationTracker::LuaAlloc(void*, void* ptr, size_t osize, size_t nsize)
+{
+	// Same contract as the default lua allocator: nsize of 0 frees, anything else is a realloc. Since it's plain
+	// realloc/free underneath, it can take over a state that started out with the default one.
+	if (nsize == 0)
+	{
+		free(ptr);
+		return nullptr;
+	}
+
+	// Shrinking a block in place isn't a new allocation as far as we're concerned
+	if (nsize > osize && IsEnabled())
+		Record(ALLOC_TAG::LUA, nsize);
+
+	return realloc(ptr, nsize);
+}
+
+void AllocationTracker::Record(ALLOC_TAG tag, size_t size)
+{
+	s_frameAllocations[(int)tag].fetch_add(1, std::memory_order_relaxed);
+	s_frameBytes[(int)tag].fetch_add(size, std::memory_order_relaxed);
+
+	// Anything the callback does (printing, for one) must not come back in here
+	if (s_callback && !t_inCallback)
+	{
+		t_inCallback = true;
+		s_callback(tag, size);
+		t_inCallback = false;
+	}
+}
+
+AllocationScope::AllocationScope(ALLOC_TAG tag)
+	: m_previous(t_currentTag)
+{
+	t_currentTag = tag;
+}
+
+AllocationScope::~AllocationScope()
+{
+	t_currentTag = m_previous;
+}
+
+// ----------------------------------------------------------------------------------
+// Global operator new/delete
+// ----------------------------------------------------------------------------------
+#if !defined(ENGINE_NO_ALLOCATION_HOOK)
+
+static void* TrackedAlloc(size_t size)
+{
+	// new has to hand out a unique pointer even for 0 bytes
+	if (size == 0)
+		size = 1;
+
+	void* memory = malloc(size);
+	if (memory && s_enabled.load(std::memory_order_relaxed))
+		AllocationTracker::Record(t_currentTag, size);
+
+	return memory;
+}
+
+// Frees aren't counted. What we care about is whether the frame touched the heap at all, and every free in a steady
+// frame has an allocation to go with it.
+void* operator new(size_t size)
+{
+	void* memory = TrackedAlloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = TrackedAlloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return TrackedAlloc(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include <stddef.h>
+
+// What an allocation gets charged to. Whatever AllocationScope is innermost on the allocating thread decides the tag,
+// except for lua states using AllocationTracker::LuaAlloc, which always count as LUA.
+enum class ALLOC_TAG
+{
+	UNTAGGED,
+	RENDER,
+	TRANSFORM,
+	GAME,
+	AI,
+	LUA,
+	COUNT
+};
+
+struct AllocationStats
+{
+	// The last complete frame
+	unsigned int allocations;
+	size_t bytes;
+
+	// High water marks: the most any single frame has allocated since tracking was turned on
+	unsigned int peakAllocations;
+	size_t peakBytes;
+
+	// Everything since tracking was turned on
+	unsigned long long totalAllocations;
+	unsigned long long totalBytes;
+};
+
+// Counts heap allocations per frame, split up by subsystem. The engine replaces the global operator new/delete with
+// versions that report here, so anything that goes through new (including every std container) is seen. Lua doesn't use
+// new, so lua states have to be created with LuaAlloc to show up.
+//
+// Tracking is off until SetEnabled(true). While it's off the hook costs a single flag check per allocation, so it can
+// stay compiled in. Define ENGINE_NO_ALLOCATION_HOOK to leave the replacement operators out completely.
+//
+// The main loop is supposed to be allocation free once it has warmed up. This is how we catch the vector copy or list
+// push that sneaks back into it (see -alloctest in the game's main.cpp).
+class AllocationTracker
+{
+public:
+	typedef void(*AllocationCallback)(ALLOC_TAG tag, size_t size);
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Called by GameEngine::Run at the start of every frame. Wraps up the frame that just finished (which is what
+	// GetStats reports from then on) and starts counting a new one.
+	static void BeginFrame();
+
+	static ALLOC_TAG GetCurrentTag();
+	static AllocationStats GetStats(ALLOC_TAG tag);
+
+	// Allocations of every tag in the last complete frame
+	static unsigned int GetFrameAllocations();
+
+	// Called on every tracked allocation, from inside the allocation itself. Meant as somewhere to put a breakpoint
+	// when hunting down where an allocation comes from, so it must not allocate.
+	static void SetCallback(AllocationCallback callback);
+
+	static const char* GetTagName(ALLOC_TAG tag);
+	static void PrintReport();
+
+	// A lua_Alloc that counts everything as LUA. Hand it to lua_newstate or lua_setallocf.
+	static void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+	// Only for the operator new replacements and LuaAlloc
+	static void Record(ALLOC_TAG tag, size_t size);
+};
+
+// Charges every allocation made on this thread to tag until it goes out of scope. Scopes nest.
+class AllocationScope
+{
+private:
+	ALLOC_TAG m_previous;
+
+public:
+	explicit AllocationScope(ALLOC_TAG tag);
+	~AllocationScope();
+
+	AllocationScope(const AllocationScope&) = delete;
+	AllocationScope& operator=(const AllocationScope&) = delete;
+};
@@ -1,59 +1,82 @@
 #pragma once
-#include "DirectXIncludes.h"
-#include <comip.h>
-#include <comdef.h>
-
-
-// This is a very handy little utility that I wish I had known about when I was writing the RenderManager
-_COM_SMARTPTR_TYPEDEF(ID3D11Texture2D, __uuidof(ID3D11Texture2D));
-_COM_SMARTPTR_TYPEDEF(ID3D11RenderTargetView, __uuidof(ID3D11RenderTargetView));
-_COM_SMARTPTR_TYPEDEF(ID3D11ShaderResourceView, __uuidof(ID3D11ShaderResourceView));
-_COM_SMARTPTR_TYPEDEF(ID3D11DepthStencilView, __uuidof(ID3D11DepthStencilView));
+#include "RenderDevice.h"
 
 
+// Textures the game renders into. Both own a texture on the device and give it back when they're destroyed. The texture
+// handle is what gets passed to RenderManager::SetRenderTarget, SetPSTexture, Blit and so on.
 struct RenderTarget2D
 {
-	ID3D11Texture2DPtr texture;
-	ID3D11RenderTargetViewPtr rtView;
-	ID3D11ShaderResourceViewPtr srView;
-	UINT width;
-	UINT height;
-	UINT numMipLevels;
-	UINT multiSamples;
-	UINT msQuality;
-	DXGI_FORMAT format;
+	RenderDevice* device;
+	GPUHANDLE texture;
+	unsigned int width;
+	unsigned int height;
+	unsigned int numMipLevels;
+	unsigned int multiSamples;
+	unsigned int msQuality;
+	GPU_FORMAT format;
 	bool autoGenMipMaps;
 	
 	RenderTarget2D();
+	~RenderTarget2D();
 
-	void Initialize(ID3D11Device* device,
-					UINT width,
-				    UINT height,
-					DXGI_FORMAT format,
-					UINT numMipLevels = 1,
-					UINT multiSamples = 1,
-					UINT msQuality = 0,
+	void Initialize(RenderDevice* device,
+					unsigned int width,
+				    unsigned int height,
+					GPU_FORMAT format,
+					unsigned int numMipLevels = 1,
+					unsigned int multiSamples = 1,
+					unsigned int msQuality = 0,
 					bool autoGenMipMaps  = false);
+
+private:
+	RenderTarget2D(const RenderTarget2D&);
+	RenderTarget2D& operator=(const RenderTarget2D&);
 };
 
 struct DepthStencilBuffer
 {
-	ID3D11Texture2DPtr texture;
-	ID3D11DepthStencilViewPtr dsView;
-	ID3D11ShaderResourceViewPtr srView;
-	UINT width;
-	UINT height;
-	UINT multiSamples;
-	UINT msQuality;
-	DXGI_FORMAT format;
+	RenderDevice* device;
+	GPUHANDLE texture;
+	unsigned int width;
+	unsigned int height;
+	unsigned int multiSamples;
+	unsigned int msQuality;
+	GPU_FORMAT format;
 
 	DepthStencilBuffer();
+	~DepthStencilBuffer();
 
-	void Initialize(ID3D11Device* device,
-					UINT width,
-					UINT height,
-					DXGI_FORMAT format = DXGI_FORMAT_D24_UNORM_S8_UINT,
+	void Initialize(RenderDevice* device,
+					unsigned int width,
+					unsigned int height,
+					GPU_FORMAT format = GPU_FORMAT::D24_UNORM_S8_UINT,
 					bool useAsShaderResource = false,
-					UINT multiSamples = 1,
-					UINT msQuality = 0);
+					unsigned int multiSamples = 1,
+					unsigned int msQuality = 0);
+
+private:
+	DepthStencilBuffer(const DepthStencilBuffer&);
+	DepthStencilBuffer& operator=(const DepthStencilBuffer&);
+};
+
+// A dynamic vertex buffer for per instance data that gets rewritten every frame. Update grows it when there are more
+// instances than fit, so capacity is just a starting point.
+struct InstanceBuffer
+{
+	RenderDevice* device;
+	GPUHANDLE buffer;
+	unsigned int stride;
+	unsigned int capacity;		// In instances
+
+	InstanceBuffer();
+	~InstanceBuffer();
+
+	void Initialize(RenderDevice* device, unsigned int stride, unsigned int capacity);
+
+	// Replaces the contents with count instances. Whatever was there before is gone, even past count.
+	void Update(const void* data, unsigned int count);
+
+private:
+	InstanceBuffer(const InstanceBuffer&);
+	InstanceBuffer& operator=(const InstanceBuffer&);
 };
\ No newline at end of file
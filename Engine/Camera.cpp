@@ -1,27 +1,29 @@
 #include "Camera.h"
+#include "AlignedAllocator.h"
 
 using namespace DirectX;
 
 Camera::Camera(CAMERA_MODE mode)
-	: m_vFoV(45.0f)
+	: m_cameraMode(mode)
+	, m_vFoV(45.0f)
 	, m_aspectRatio(1.0f)
 	, m_orthoWidth(10.0f)
 	, m_orthoHeight(10.0f)
 	, m_zNear(0.1f)
 	, m_zFar(1000.0f)
 	, m_projectionDirty(true)
-	, m_cameraMode(mode)
+	, m_inverseProjectionDirty(true)
+	, m_projectionVersion(1)
+	, m_constantsProjectionVersion(0)
+	, m_constantsWorldVersion(0)
 {
-	pData = (AlignedData*)_aligned_malloc(sizeof(AlignedData), 16);
-	if (pData == NULL)
-	{
-		MessageBoxA(nullptr, "The data is NULL?!", "Error", MB_OK | MB_ICONERROR);
-	}
+	pData = (AlignedData*)AlignedMalloc(sizeof(AlignedData), 16);
+	assert(pData && "The data is NULL?!");
 }
 
 Camera::~Camera()
 {
-	_aligned_free(pData);
+	AlignedFree(pData);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------
@@ -31,7 +33,8 @@ Camera::~Camera()
 void Camera::SetMode(CAMERA_MODE mode)
 {
 	m_cameraMode = mode;
-	m_projectionDirty = true;
+	m_projectionDirty = m_inverseProjectionDirty = true;
+	m_projectionVersion++;
 }
 
 void Camera::SetPerspective(float fovy, float aspect, float zNear, float zFar)
@@ -42,6 +45,7 @@ void Camera::SetPerspective(float fovy, float aspect, float zNear, float zFar)
 	m_zFar = zFar;
 
 	m_projectionDirty = m_inverseProjectionDirty = true;
+	m_projectionVersion++;
 }
 
 void Camera::SetOrthographic(float width, float height, float zNear, float zFar)
@@ -52,6 +56,7 @@ void Camera::SetOrthographic(float width, float height, float zNear, float zFar)
 	m_zFar = zFar;
 
 	m_projectionDirty = m_inverseProjectionDirty = true;
+	m_projectionVersion++;
 }
 
 XMMATRIX Camera::GetProjectionMatrix() const
@@ -81,6 +86,26 @@ XMMATRIX Camera::GetViewMatrix() const
 	return transform.GetInverseWorldMatrix();
 }
 
+XMMATRIX Camera::GetViewProjectionMatrix() const
+{
+	return GetConstants().ViewProjection;
+}
+
+XMMATRIX Camera::GetInverseViewProjectionMatrix() const
+{
+	return GetConstants().InverseViewProjection;
+}
+
+const CameraConstants& Camera::GetConstants() const
+{
+	if (m_constantsProjectionVersion != m_projectionVersion || m_constantsWorldVersion != transform.GetWorldVersion())
+	{
+		UpdateConstants();
+	}
+
+	return pData->m_constants;
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------
 // Private Member Functions
 // ------------------------------------------------------------------------------------------------------------------------------
@@ -109,4 +134,22 @@ void Camera::UpdateInverseProjectionMatrix() const
 
 	pData->m_inverseProjectionMatrix = XMMatrixInverse(nullptr, pData->m_projectionMatrix);
 	m_inverseProjectionDirty = false;
-}
\ No newline at end of file
+}
+
+void Camera::UpdateConstants() const
+{
+	CameraConstants& constants = pData->m_constants;
+
+	constants.View = GetViewMatrix();
+	constants.Projection = GetProjectionMatrix();
+	constants.ViewProjection = constants.View * constants.Projection;
+
+	// The inverse of the view matrix is just the camera's world matrix, so no need to invert the product
+	constants.InverseViewProjection = GetInverseProjectionMatrix() * transform.GetWorldMatrix();
+
+	XMStoreFloat4(&constants.Position, XMVectorSetW(transform.GetWorldPosition(), 1.0f));
+	constants.ClipPlanes = XMFLOAT4(m_zNear, m_zFar, 0.0f, 0.0f);
+
+	m_constantsProjectionVersion = m_projectionVersion;
+	m_constantsWorldVersion = transform.GetWorldVersion();
+}
@@ -7,11 +7,24 @@ enum class CAMERA_MODE
 	Perspective
 };
 
+// Everything a render pass needs to know about the camera for a frame. Laid out in 16 byte rows so it can be
+// copied straight into a constant buffer.
+struct alignas(16) CameraConstants
+{
+	DirectX::XMMATRIX View;
+	DirectX::XMMATRIX Projection;
+	DirectX::XMMATRIX ViewProjection;
+	DirectX::XMMATRIX InverseViewProjection;
+	DirectX::XMFLOAT4 Position;		// World space, w = 1
+	DirectX::XMFLOAT4 ClipPlanes;	// Near, far, 0, 0
+};
+
 class Camera
 {
 private:
 	void UpdateProjectionMatrix() const;
 	void UpdateInverseProjectionMatrix() const;
+	void UpdateConstants() const;
 
 	CAMERA_MODE m_cameraMode;
 
@@ -27,17 +40,26 @@ private:
 
 
 	// This data must be aligned otherwise the SSE intrinsics fail and throw exceptions.
-	__declspec(align(16)) struct AlignedData
+	struct alignas(16) AlignedData
 	{
 		// An orthographic or perspective projection matrix and its inverse
 		DirectX::XMMATRIX m_projectionMatrix;
 		DirectX::XMMATRIX m_inverseProjectionMatrix;
+
+		// View, view-projection and friends, built together whenever the transform or the projection changes
+		CameraConstants m_constants;
 	};
 	AlignedData* pData;
 
 	// Flag to track whether the projection matrix needs to be recalculated
 	mutable bool m_projectionDirty, m_inverseProjectionDirty;
 
+	// Bumped every time the projection parameters change. The constants remember this and the transform's world
+	// version from when they were built, so they're rebuilt at most once per change no matter how often they're read.
+	unsigned int m_projectionVersion;
+	mutable unsigned int m_constantsProjectionVersion;
+	mutable unsigned int m_constantsWorldVersion;
+
 public:
 
 	Camera(CAMERA_MODE mode = CAMERA_MODE::Perspective);
@@ -52,5 +74,12 @@ public:
 	DirectX::XMMATRIX GetProjectionMatrix() const;
 	DirectX::XMMATRIX GetInverseProjectionMatrix() const;
 	DirectX::XMMATRIX GetViewMatrix() const;
+
+	// Cached view * projection and its inverse. Cheap to call per object.
+	DirectX::XMMATRIX GetViewProjectionMatrix() const;
+	DirectX::XMMATRIX GetInverseViewProjectionMatrix() const;
+
+	// The whole block at once, for passes that want all of it. Stays valid until the camera next changes.
+	const CameraConstants& GetConstants() const;
 };
 
@@ -0,0 +1,134 @@
+#include "ConstantRing.h"
+#include <assert.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+ConstantRing::ConstantRing(RenderDevice& device, unsigned int segmentSize)
+	: m_device(device)
+	, m_buffer(0)
+	, m_segmentSize(segmentSize)
+	, m_segment(0)
+	, m_head(0)
+	, m_uploaded(0)
+	, m_allocations(0)
+	, m_overflows(0)
+	, m_fenceWaits(0)
+{
+	assert(segmentSize > 0 && segmentSize % CONSTANT_BUFFER_OFFSET_ALIGNMENT == 0);
+
+	for (unsigned long long& fence : m_segmentFences)
+		fence = 0;
+
+	memset(&m_lastFrameStats, 0, sizeof(m_lastFrameStats));
+	memset(&m_totalStats, 0, sizeof(m_totalStats));
+
+	// Without offsets every allocation would need a buffer of its own, which is what the ring is there to avoid
+	if (m_device.SupportsConstantBufferOffsets())
+	{
+		m_buffer = m_device.CreateBuffer(BUFFER_TYPE::CONSTANT, m_segmentSize * CONSTANT_RING_FRAMES, nullptr, true);
+		if (m_buffer)
+			m_shadow.resize(m_segmentSize);
+	}
+}
+
+ConstantRing::~ConstantRing()
+{
+	if (m_buffer)
+		m_device.Release(m_buffer);
+}
+
+bool ConstantRing::IsActive() const
+{
+	return m_buffer != 0;
+}
+
+GPUHANDLE ConstantRing::GetBuffer() const
+{
+	return m_buffer;
+}
+
+unsigned int ConstantRing::GetAllocationSize(unsigned int size)
+{
+	return (size + CONSTANT_BUFFER_OFFSET_ALIGNMENT - 1) & ~(CONSTANT_BUFFER_OFFSET_ALIGNMENT - 1);
+}
+
+void* ConstantRing::Allocate(unsigned int size, unsigned int& offset)
+{
+	assert(IsActive() && size > 0);
+
+	unsigned int allocationSize = GetAllocationSize(size);
+	unsigned int start = m_head.fetch_add(allocationSize, std::memory_order_relaxed);
+	if (allocationSize > m_segmentSize || start > m_segmentSize - allocationSize)
+	{
+		m_overflows.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	m_allocations.fetch_add(1, std::memory_order_relaxed);
+	offset = m_segment * m_segmentSize + start;
+	return &m_shadow[start];
+}
+
+void ConstantRing::Upload()
+{
+	if (!IsActive())
+		return;
+
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	unsigned int end = head < m_segmentSize ? head : m_segmentSize;
+	if (end <= m_uploaded)
+		return;
+
+	m_device.UpdateBufferRange(m_buffer, m_segment * m_segmentSize + m_uploaded, &m_shadow[m_uploaded], end - m_uploaded);
+	m_uploaded = end;
+}
+
+void ConstantRing::BeginFrame()
+{
+	unsigned int head = m_head.load(std::memory_order_relaxed);
+	unsigned int used = head < m_segmentSize ? head : m_segmentSize;
+
+	if (IsActive())
+	{
+		// Everything in this segment has been drawn by now, so once the GPU gets this far it's free again
+		m_segmentFences[m_segment] = m_device.InsertFence();
+		m_segment = (m_segment + 1) % CONSTANT_RING_FRAMES;
+
+		if (!m_device.IsFenceComplete(m_segmentFences[m_segment]))
+		{
+			m_fenceWaits++;
+			m_device.WaitForFence(m_segmentFences[m_segment]);
+		}
+	}
+
+	ConstantRingStats stats;
+	stats.bytes = used;
+	stats.allocations = m_allocations.load(std::memory_order_relaxed);
+	stats.overflows = m_overflows.load(std::memory_order_relaxed);
+	stats.fenceWaits = m_fenceWaits;
+
+	m_totalStats.bytes += stats.bytes;
+	m_totalStats.allocations += stats.allocations;
+	m_totalStats.overflows += stats.overflows;
+	m_totalStats.fenceWaits += stats.fenceWaits;
+	m_lastFrameStats = stats;
+
+	m_head.store(0, std::memory_order_relaxed);
+	m_uploaded = 0;
+	m_allocations.store(0, std::memory_order_relaxed);
+	m_overflows.store(0, std::memory_order_relaxed);
+	m_fenceWaits = 0;
+}
+
+const ConstantRingStats& ConstantRing::GetStats() const
+{
+	return m_lastFrameStats;
+}
+
+const ConstantRingStats& ConstantRing::GetTotalStats() const
+{
+	return m_totalStats;
+}
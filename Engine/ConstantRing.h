@@ -0,0 +1,85 @@
+#pragma once
+#include "RenderDevice.h"
+#include <atomic>
+#include <vector>
+
+// How many frames the GPU can be behind before the ring waits for it
+#define CONSTANT_RING_FRAMES 3
+
+// What the ring handed out over a frame
+struct ConstantRingStats
+{
+	unsigned long long bytes;		// Rounded up to CONSTANT_BUFFER_OFFSET_ALIGNMENT, so a bit more than was asked for
+	unsigned int allocations;
+	unsigned int overflows;			// Allocations that didn't fit, which the caller had to do some other way
+	unsigned int fenceWaits;		// Frames that had to wait for the GPU before they could reuse their part of the ring
+};
+
+// One big dynamic constant buffer that per draw constants are carved out of, instead of every draw updating a small
+// buffer of its own and the driver having to find somewhere new to put it each time. Allocations are bound with
+// offsets, which the device has to support (the ring does nothing at all otherwise, see IsActive).
+//
+// The buffer is split into a segment per frame. Allocating just moves a counter along the current segment, and
+// BeginFrame moves on to the next, first waiting on the fence from the last time that segment was used if the GPU
+// hasn't caught up yet. Nothing is ever freed on its own.
+//
+// Allocations are written to a copy of the segment in memory, not the buffer itself, since D3D11 can only map buffers
+// on the main thread. Upload sends whatever's been allocated since the last Upload to the buffer in one go, which has
+// to happen before anything that reads it is drawn.
+//
+// Allocate is thread safe, so command lists can be recorded with it on any thread. Everything else is for the main
+// thread, with no other thread allocating.
+class ConstantRing
+{
+private:
+	RenderDevice& m_device;
+	GPUHANDLE m_buffer;
+	unsigned int m_segmentSize;
+
+	// The current segment's contents
+	std::vector<unsigned char> m_shadow;
+
+	unsigned int m_segment;
+	unsigned long long m_segmentFences[CONSTANT_RING_FRAMES];
+
+	// Where the next allocation goes and how much of the segment has been uploaded, both from the start of the segment.
+	// The head can run past the end once the segment is full.
+	std::atomic<unsigned int> m_head;
+	unsigned int m_uploaded;
+
+	std::atomic<unsigned int> m_allocations;
+	std::atomic<unsigned int> m_overflows;
+	unsigned int m_fenceWaits;
+
+	ConstantRingStats m_lastFrameStats;
+	ConstantRingStats m_totalStats;
+
+public:
+	explicit ConstantRing(RenderDevice& device, unsigned int segmentSize = 1024 * 1024);
+	~ConstantRing();
+
+	// False if the device can't bind part of a constant buffer, in which case there's no buffer to allocate from
+	bool IsActive() const;
+	GPUHANDLE GetBuffer() const;
+
+	// Room for size bytes, somewhere that can be bound at offset. Returns nullptr if the segment is full.
+	void* Allocate(unsigned int size, unsigned int& offset);
+
+	// Writes everything allocated since the last Upload to the buffer
+	void Upload();
+
+	// Moves on to the next segment, waiting for the GPU to be done with it if it has to. Anything allocated but not
+	// uploaded yet is dropped, which is fine as long as nothing was drawn with it.
+	void BeginFrame();
+
+	// GetStats reports the last complete frame and GetTotalStats every frame up to and including it
+	const ConstantRingStats& GetStats() const;
+	const ConstantRingStats& GetTotalStats() const;
+
+	// How much of the ring an allocation of size bytes takes up
+	static unsigned int GetAllocationSize(unsigned int size);
+
+private:
+	ConstantRing(const ConstantRing&);
+	ConstantRing& operator=(const ConstantRing&);
+};
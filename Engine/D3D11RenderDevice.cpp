@@ -0,0 +1,1190 @@
+#include "D3D11RenderDevice.h"
+#include <thread>
+
+using namespace Microsoft::WRL;
+
+// ----------------------------------------------------------------------------------
+// Helper Functions
+// ----------------------------------------------------------------------------------
+
+static DXGI_FORMAT ToDXGIFormat(GPU_FORMAT format)
+{
+	switch (format)
+	{
+	case GPU_FORMAT::R8G8B8A8_UNORM:		return DXGI_FORMAT_R8G8B8A8_UNORM;
+	case GPU_FORMAT::R16_UINT:				return DXGI_FORMAT_R16_UINT;
+	case GPU_FORMAT::R32_UINT:				return DXGI_FORMAT_R32_UINT;
+	case GPU_FORMAT::R32_FLOAT:				return DXGI_FORMAT_R32_FLOAT;
+	case GPU_FORMAT::R32G32_FLOAT:			return DXGI_FORMAT_R32G32_FLOAT;
+	case GPU_FORMAT::R32G32B32_FLOAT:		return DXGI_FORMAT_R32G32B32_FLOAT;
+	case GPU_FORMAT::R32G32B32A32_FLOAT:	return DXGI_FORMAT_R32G32B32A32_FLOAT;
+	case GPU_FORMAT::D16_UNORM:				return DXGI_FORMAT_D16_UNORM;
+	case GPU_FORMAT::D24_UNORM_S8_UINT:		return DXGI_FORMAT_D24_UNORM_S8_UINT;
+	case GPU_FORMAT::D32_FLOAT:				return DXGI_FORMAT_D32_FLOAT;
+	default:								return DXGI_FORMAT_UNKNOWN;
+	}
+}
+
+static D3D11_COMPARISON_FUNC ToD3D11Comparison(COMPARISON_FUNC func)
+{
+	// Same order as D3D11_COMPARISON_FUNC, which starts at 1
+	return (D3D11_COMPARISON_FUNC)((int)func + 1);
+}
+
+static D3D11_BLEND ToD3D11Blend(BLEND_FACTOR factor)
+{
+	switch (factor)
+	{
+	case BLEND_FACTOR::ZERO:			return D3D11_BLEND_ZERO;
+	case BLEND_FACTOR::SRC_ALPHA:		return D3D11_BLEND_SRC_ALPHA;
+	case BLEND_FACTOR::INV_SRC_ALPHA:	return D3D11_BLEND_INV_SRC_ALPHA;
+	default:							return D3D11_BLEND_ONE;
+	}
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+D3D11RenderDevice::D3D11RenderDevice(HWND hwnd, unsigned int width, unsigned int height, bool vSync, bool windowed)
+	: m_hwnd(hwnd)
+	, m_vSync(vSync)
+	, m_windowed(windowed)
+	, m_width(width)
+	, m_height(height)
+	, m_constantBufferOffsets(false)
+	, m_insertedFence(0)
+	, m_completedFence(0)
+	, m_backBuffer(0)
+	, m_backBufferDepth(0)
+{
+	Initialize();
+}
+
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+}
+
+const char* D3D11RenderDevice::GetName() const
+{
+	return "D3D11";
+}
+
+void D3D11RenderDevice::ReportError(const char* message)
+{
+	MessageBoxA(m_hwnd, message, "Error", MB_OK | MB_ICONERROR);
+}
+
+// This function was inspired by:
+// http://www.rastertek.com/dx11tut03.html
+DXGI_RATIONAL D3D11RenderDevice::QueryRefreshRate()
+{
+	DXGI_RATIONAL refreshRate = { 0, 1 };
+	if (m_vSync)
+	{
+		ComPtr<IDXGIFactory2> factory;
+		ComPtr<IDXGIAdapter> adapter;
+		ComPtr<IDXGIOutput> adapterOutput;
+
+		DXGI_MODE_DESC* displayModeList;
+
+		// Create a DirectX graphics interface factory.
+		HRESULT hr = CreateDXGIFactory(__uuidof(IDXGIFactory2), &factory);
+		if (FAILED(hr))
+		{
+			MessageBoxA(0,
+				TEXT("Could not create DXGIFactory instance."),
+				TEXT("Query Refresh Rate"),
+				MB_OK);
+
+			throw new std::exception("Failed to create DXGIFactory.");
+		}
+
+		hr = factory->EnumAdapters(0, &adapter);
+		if (FAILED(hr))
+		{
+			MessageBoxA(0,
+				TEXT("Failed to enumerate adapters."),
+				TEXT("Query Refresh Rate"),
+				MB_OK);
+
+			throw new std::exception("Failed to enumerate adapters.");
+		}
+
+		hr = adapter->EnumOutputs(0, &adapterOutput);
+		if (FAILED(hr))
+		{
+			MessageBoxA(0,
+				TEXT("Failed to enumerate adapter outputs."),
+				TEXT("Query Refresh Rate"),
+				MB_OK);
+
+			throw new std::exception("Failed to enumerate adapter outputs.");
+		}
+
+		UINT numDisplayModes;
+		hr = adapterOutput->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numDisplayModes, nullptr);
+		if (FAILED(hr))
+		{
+			MessageBoxA(0,
+				TEXT("Failed to query display mode list."),
+				TEXT("Query Refresh Rate"),
+				MB_OK);
+
+			throw new std::exception("Failed to query display mode list.");
+		}
+
+		displayModeList = new DXGI_MODE_DESC[numDisplayModes];
+		assert(displayModeList);
+
+		hr = adapterOutput->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numDisplayModes, displayModeList);
+		if (FAILED(hr))
+		{
+			MessageBoxA(0,
+				TEXT("Failed to query display mode list."),
+				TEXT("Query Refresh Rate"),
+				MB_OK);
+
+			throw new std::exception("Failed to query display mode list.");
+		}
+
+		// Now store the refresh rate of the monitor that matches the width and height of the requested screen.
+		for (UINT i = 0; i < numDisplayModes; ++i)
+		{
+			if (displayModeList[i].Width == m_width && displayModeList[i].Height == m_height)
+			{
+				refreshRate = displayModeList[i].RefreshRate;
+			}
+		}
+
+		delete[] displayModeList;
+	}
+
+	return refreshRate;
+}
+
+bool D3D11RenderDevice::Initialize()
+{
+	// Check for DirectX Math library support.
+	if (!DirectX::XMVerifyCPUSupport())
+	{
+		ReportError("Failed to verify DirectX Math library support.");
+		return false;
+	}
+
+	HRESULT hr = 0;
+	UINT createDeviceFlags = 0;
+
+	// These are the feature levels that we will accept.
+	D3D_FEATURE_LEVEL featureLevels[] =
+	{
+		D3D_FEATURE_LEVEL_11_1,
+		D3D_FEATURE_LEVEL_11_0,
+		D3D_FEATURE_LEVEL_10_1,
+		D3D_FEATURE_LEVEL_10_0,
+		D3D_FEATURE_LEVEL_9_3,
+		D3D_FEATURE_LEVEL_9_2,
+		D3D_FEATURE_LEVEL_9_1
+	};
+
+	// This will be the feature level that
+	// is used to create our device and swap chain.
+	D3D_FEATURE_LEVEL featureLevel;
+
+	hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE,
+		nullptr, createDeviceFlags, featureLevels, _countof(featureLevels),
+		D3D11_SDK_VERSION, &m_d3dDevice, &featureLevel, &m_d3dDeviceContext);
+
+	// If 11.1 failed, try using 11.0
+	if (hr == E_INVALIDARG)
+	{
+		hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE,
+			nullptr, createDeviceFlags, &featureLevels[1], _countof(featureLevels) - 1,
+			D3D11_SDK_VERSION, &m_d3dDevice, &featureLevel, &m_d3dDeviceContext);
+	}
+
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create DirectX 11 Device.");
+		return false;
+	}
+
+	ComPtr<IDXGIFactory2> factory;
+	hr = CreateDXGIFactory(__uuidof(IDXGIFactory2), &factory);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create IDXGIFactory2.");
+		return false;
+	}
+
+	DXGI_SWAP_CHAIN_DESC1 swapChainDesc;
+	ZeroMemory(&swapChainDesc, sizeof(DXGI_SWAP_CHAIN_DESC1));
+
+	swapChainDesc.BufferCount = 1;
+	swapChainDesc.Width = m_width;
+	swapChainDesc.Height = m_height;
+	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	swapChainDesc.SampleDesc.Count = 1;
+	swapChainDesc.SampleDesc.Quality = 0;
+	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH; // Use Alt-Enter to switch between full screen and windowed mode.
+
+	DXGI_SWAP_CHAIN_FULLSCREEN_DESC swapChainFullScreenDesc;
+	ZeroMemory(&swapChainFullScreenDesc, sizeof(DXGI_SWAP_CHAIN_FULLSCREEN_DESC));
+
+	swapChainFullScreenDesc.RefreshRate = QueryRefreshRate();
+	swapChainFullScreenDesc.Windowed = m_windowed;
+
+	hr = factory->CreateSwapChainForHwnd(m_d3dDevice.Get(), m_hwnd,
+		&swapChainDesc, &swapChainFullScreenDesc, nullptr, &m_d3dSwapChain);
+
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create swap chain.");
+		return false;
+	}
+
+	// Placeholders until Resize fills them in, so the handles never change
+	m_backBuffer = m_textures.Add(Texture());
+	m_backBufferDepth = m_textures.Add(Texture());
+
+	if (!Resize(m_width, m_height))
+	{
+		ReportError("Failed to resize the swap chain.");
+		return false;
+	}
+
+	m_immediate.reset(new Context(*this, m_d3dDeviceContext.Get(), &m_frameStats));
+
+	// Offset binding is in every 11.1 runtime, but writing a dynamic constant buffer with NO_OVERWRITE is up to the driver
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(options));
+	if (SUCCEEDED(m_d3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+		m_constantBufferOffsets = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer && m_immediate->m_context1;
+
+	ZeroMemory(&m_PresentParameters, sizeof(DXGI_PRESENT_PARAMETERS));
+
+	return true;
+}
+
+bool D3D11RenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	// Don't allow for 0 size swap chain buffers.
+	if (width == 0) width = 1;
+	if (height == 0) height = 1;
+
+	m_d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+
+	// First release the render target and depth/stencil views.
+	Texture& backBuffer = *m_textures.Get(m_backBuffer);
+	Texture& depthBuffer = *m_textures.Get(m_backBufferDepth);
+	backBuffer = Texture();
+	depthBuffer = Texture();
+
+	// Resize the swap chain buffers.
+	m_d3dSwapChain->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+
+	// Next initialize the back buffer of the swap chain and associate it to a
+	// render target view.
+	HRESULT hr = m_d3dSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer.texture);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to retrieve the swap chain back buffer.");
+		return false;
+	}
+
+	hr = m_d3dDevice->CreateRenderTargetView(backBuffer.texture.Get(), nullptr, &backBuffer.rtView);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create the RenderTargetView.");
+		return false;
+	}
+
+	backBuffer.desc.width = width;
+	backBuffer.desc.height = height;
+	backBuffer.desc.format = GPU_FORMAT::R8G8B8A8_UNORM;
+	backBuffer.desc.bindFlags = BIND_RENDER_TARGET;
+
+	// Create the depth buffer for use with the depth/stencil view.
+	D3D11_TEXTURE2D_DESC depthStencilBufferDesc;
+	ZeroMemory(&depthStencilBufferDesc, sizeof(D3D11_TEXTURE2D_DESC));
+
+	depthStencilBufferDesc.ArraySize = 1;
+	depthStencilBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	depthStencilBufferDesc.CPUAccessFlags = 0; // No CPU access required.
+	depthStencilBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	depthStencilBufferDesc.Width = width;
+	depthStencilBufferDesc.Height = height;
+	depthStencilBufferDesc.MipLevels = 1;
+	depthStencilBufferDesc.SampleDesc.Count = 1;
+	depthStencilBufferDesc.SampleDesc.Quality = 0;
+	depthStencilBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	hr = m_d3dDevice->CreateTexture2D(&depthStencilBufferDesc, nullptr, &depthBuffer.texture);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create the Depth/Stencil texture.");
+		return false;
+	}
+
+	hr = m_d3dDevice->CreateDepthStencilView(depthBuffer.texture.Get(), nullptr, &depthBuffer.dsView);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create DepthStencilView.");
+		return false;
+	}
+
+	depthBuffer.desc.width = width;
+	depthBuffer.desc.height = height;
+	depthBuffer.desc.format = GPU_FORMAT::D24_UNORM_S8_UINT;
+	depthBuffer.desc.bindFlags = BIND_DEPTH_STENCIL;
+
+	m_width = width;
+	m_height = height;
+
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Resource Creation
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE D3D11RenderDevice::CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	bufferDesc.ByteWidth = byteWidth;
+	bufferDesc.Usage = dynamic ? D3D11_USAGE_DYNAMIC : D3D11_USAGE_DEFAULT;
+	bufferDesc.CPUAccessFlags = dynamic ? D3D11_CPU_ACCESS_WRITE : 0;
+	switch (type)
+	{
+	case BUFFER_TYPE::VERTEX:	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER; break;
+	case BUFFER_TYPE::INDEX:	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER; break;
+	default:					bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER; break;
+	}
+
+	D3D11_SUBRESOURCE_DATA dataDesc;
+	ZeroMemory(&dataDesc, sizeof(D3D11_SUBRESOURCE_DATA));
+	dataDesc.pSysMem = initialData;
+
+	Buffer buffer;
+	buffer.byteWidth = byteWidth;
+	buffer.dynamic = dynamic;
+	buffer.discarded = false;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&bufferDesc, initialData ? &dataDesc : nullptr, &buffer.buffer);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create Buffer.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	if (initialData)
+		m_frameStats.bytesUploaded += byteWidth;
+
+	return m_buffers.Add(std::move(buffer));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount)
+{
+	VertexShader shader;
+
+	HRESULT hr = m_d3dDevice->CreateVertexShader(bytecode, bytecodeSize, nullptr, &shader.shader);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create Vertex Shader.");
+		return 0;
+	}
+
+	std::vector<D3D11_INPUT_ELEMENT_DESC> elementDescs(elementCount);
+	for (unsigned int i = 0; i < elementCount; i++)
+	{
+		D3D11_INPUT_ELEMENT_DESC& desc = elementDescs[i];
+		desc.SemanticName = elements[i].semantic;
+		desc.SemanticIndex = elements[i].semanticIndex;
+		desc.Format = ToDXGIFormat(elements[i].format);
+		desc.InputSlot = elements[i].inputSlot;
+		desc.AlignedByteOffset = elements[i].offset;
+		desc.InputSlotClass = elements[i].perInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+		desc.InstanceDataStepRate = elements[i].perInstance ? 1 : 0;
+	}
+
+	hr = m_d3dDevice->CreateInputLayout(elementDescs.data(), elementCount, bytecode, bytecodeSize, &shader.inputLayout);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create Vertex Shader Input Layout.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_vertexShaders.Add(std::move(shader));
+}
+
+GPUHANDLE D3D11RenderDevice::CreatePixelShader(const void* bytecode, size_t bytecodeSize)
+{
+	ComPtr<ID3D11PixelShader> shader;
+
+	HRESULT hr = m_d3dDevice->CreatePixelShader(bytecode, bytecodeSize, nullptr, &shader);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create Pixel Shader.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_pixelShaders.Add(std::move(shader));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateTexture(const TextureDesc& desc)
+{
+	DXGI_FORMAT format = ToDXGIFormat(desc.format);
+	bool isDepth = IsDepthFormat(desc.format);
+	bool isShaderResource = (desc.bindFlags & BIND_SHADER_RESOURCE) != 0;
+
+	// A depth buffer that's also read by shaders has to be created typeless, with a different format for each view
+	DXGI_FORMAT texFormat = format;
+	DXGI_FORMAT srvFormat = format;
+	if (isDepth && isShaderResource)
+	{
+		if (desc.format == GPU_FORMAT::D16_UNORM)
+		{
+			texFormat = DXGI_FORMAT_R16_TYPELESS;
+			srvFormat = DXGI_FORMAT_R16_UNORM;
+		}
+		else if (desc.format == GPU_FORMAT::D24_UNORM_S8_UINT)
+		{
+			texFormat = DXGI_FORMAT_R24G8_TYPELESS;
+			srvFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+		}
+		else
+		{
+			texFormat = DXGI_FORMAT_R32_TYPELESS;
+			srvFormat = DXGI_FORMAT_R32_FLOAT;
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = desc.width;
+	texDesc.Height = desc.height;
+	texDesc.ArraySize = 1;
+	texDesc.BindFlags = 0;
+	if (isShaderResource) texDesc.BindFlags |= D3D11_BIND_SHADER_RESOURCE;
+	if (desc.bindFlags & BIND_RENDER_TARGET) texDesc.BindFlags |= D3D11_BIND_RENDER_TARGET;
+	if (desc.bindFlags & BIND_DEPTH_STENCIL) texDesc.BindFlags |= D3D11_BIND_DEPTH_STENCIL;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.Format = texFormat;
+	texDesc.MipLevels = desc.mipLevels;
+	texDesc.MiscFlags = (desc.autoGenMipMaps && desc.mipLevels > 1) ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0;
+	texDesc.SampleDesc.Count = desc.sampleCount;
+	texDesc.SampleDesc.Quality = desc.sampleQuality;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	Texture texture;
+	texture.desc = desc;
+
+	if (FAILED(m_d3dDevice->CreateTexture2D(&texDesc, nullptr, &texture.texture)))
+	{
+		ReportError("Failed to create Texture2D.");
+		return 0;
+	}
+
+	if (desc.bindFlags & BIND_RENDER_TARGET)
+	{
+		D3D11_RENDER_TARGET_VIEW_DESC rtDesc;
+		rtDesc.Format = format;
+		rtDesc.ViewDimension = desc.sampleCount > 1 ? D3D11_RTV_DIMENSION_TEXTURE2DMS : D3D11_RTV_DIMENSION_TEXTURE2D;
+		rtDesc.Texture2D.MipSlice = 0;
+
+		if (FAILED(m_d3dDevice->CreateRenderTargetView(texture.texture.Get(), &rtDesc, &texture.rtView)))
+		{
+			ReportError("Failed to create RenderTargetView.");
+			return 0;
+		}
+	}
+
+	if (desc.bindFlags & BIND_DEPTH_STENCIL)
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+		dsvDesc.Format = format;
+		dsvDesc.ViewDimension = desc.sampleCount > 1 ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
+		dsvDesc.Texture2D.MipSlice = 0;
+		dsvDesc.Flags = 0;
+
+		if (FAILED(m_d3dDevice->CreateDepthStencilView(texture.texture.Get(), &dsvDesc, &texture.dsView)))
+		{
+			ReportError("Failed to create DepthStencilView.");
+			return 0;
+		}
+	}
+
+	if (isShaderResource)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+		srvDesc.Format = srvFormat;
+		srvDesc.ViewDimension = desc.sampleCount > 1 ? D3D11_SRV_DIMENSION_TEXTURE2DMS : D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = isDepth ? 1 : desc.mipLevels;
+		srvDesc.Texture2D.MostDetailedMip = 0;
+
+		if (FAILED(m_d3dDevice->CreateShaderResourceView(texture.texture.Get(), &srvDesc, &texture.srView)))
+		{
+			ReportError("Failed to create ShaderResourceView.");
+			return 0;
+		}
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_textures.Add(std::move(texture));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateRasterizerState(const RasterizerDesc& desc)
+{
+	// Setup rasterizer state.
+	D3D11_RASTERIZER_DESC rasterizerDesc;
+	ZeroMemory(&rasterizerDesc, sizeof(D3D11_RASTERIZER_DESC));
+
+	rasterizerDesc.CullMode = desc.cullMode == CULL_MODE::FRONT ? D3D11_CULL_FRONT : desc.cullMode == CULL_MODE::BACK ? D3D11_CULL_BACK : D3D11_CULL_NONE;
+	rasterizerDesc.DepthClipEnable = TRUE;
+	rasterizerDesc.FillMode = desc.fillMode == FILL_MODE::WIREFRAME ? D3D11_FILL_WIREFRAME : D3D11_FILL_SOLID;
+	rasterizerDesc.MultisampleEnable = FALSE;
+
+	// Create the rasterizer state object.
+	ComPtr<ID3D11RasterizerState> state;
+	HRESULT hr = m_d3dDevice->CreateRasterizerState(&rasterizerDesc, &state);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create a RasterizerState object.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_rasterizerStates.Add(std::move(state));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateDepthStencilState(const DepthStencilDesc& desc)
+{
+	D3D11_DEPTH_STENCIL_DESC depthStencilStateDesc;
+	ZeroMemory(&depthStencilStateDesc, sizeof(D3D11_DEPTH_STENCIL_DESC));
+
+	depthStencilStateDesc.DepthEnable = desc.depthEnable;
+	depthStencilStateDesc.DepthWriteMask = desc.depthWriteEnable ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
+	depthStencilStateDesc.DepthFunc = D3D11_COMPARISON_LESS;
+	depthStencilStateDesc.StencilEnable = desc.stencilEnable;
+	depthStencilStateDesc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+	depthStencilStateDesc.StencilWriteMask = desc.stencilWriteEnable ? 0xFF : 0;
+	depthStencilStateDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
+	depthStencilStateDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
+	depthStencilStateDesc.FrontFace.StencilPassOp = desc.stencilWriteEnable ? D3D11_STENCIL_OP_REPLACE : D3D11_STENCIL_OP_KEEP;
+	depthStencilStateDesc.FrontFace.StencilFunc = ToD3D11Comparison(desc.stencilFunc);
+	depthStencilStateDesc.BackFace = depthStencilStateDesc.FrontFace;
+
+	ComPtr<ID3D11DepthStencilState> state;
+	HRESULT hr = m_d3dDevice->CreateDepthStencilState(&depthStencilStateDesc, &state);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create a DepthStencilState object.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_depthStencilStates.Add(std::move(state));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateBlendState(const BlendDesc& desc)
+{
+	D3D11_BLEND_DESC blendStateDesc;
+	ZeroMemory(&blendStateDesc, sizeof(blendStateDesc));
+
+	D3D11_BLEND srcBlend = ToD3D11Blend(desc.srcBlend);
+	D3D11_BLEND destBlend = ToD3D11Blend(desc.destBlend);
+
+	blendStateDesc.RenderTarget[0].BlendEnable = (srcBlend != D3D11_BLEND_ONE) || (destBlend != D3D11_BLEND_ZERO);
+	blendStateDesc.RenderTarget[0].SrcBlend = blendStateDesc.RenderTarget[0].SrcBlendAlpha = srcBlend;
+	blendStateDesc.RenderTarget[0].DestBlend = blendStateDesc.RenderTarget[0].DestBlendAlpha = destBlend;
+	blendStateDesc.RenderTarget[0].BlendOp = blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	blendStateDesc.RenderTarget[0].RenderTargetWriteMask = desc.colorWriteEnable ? D3D11_COLOR_WRITE_ENABLE_ALL : 0;
+
+	ComPtr<ID3D11BlendState> state;
+	HRESULT hr = m_d3dDevice->CreateBlendState(&blendStateDesc, &state);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create a BlendState object.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_blendStates.Add(std::move(state));
+}
+
+GPUHANDLE D3D11RenderDevice::CreateSamplerState(const SamplerDesc& desc)
+{
+	D3D11_SAMPLER_DESC samplerStateDesc;
+	ZeroMemory(&samplerStateDesc, sizeof(samplerStateDesc));
+
+	D3D11_TEXTURE_ADDRESS_MODE addressMode = desc.addressMode == TEXTURE_ADDRESS::WRAP ? D3D11_TEXTURE_ADDRESS_WRAP : D3D11_TEXTURE_ADDRESS_CLAMP;
+
+	switch (desc.filter)
+	{
+	case TEXTURE_FILTER::POINT:		samplerStateDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT; break;
+	case TEXTURE_FILTER::LINEAR:	samplerStateDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR; break;
+	default:						samplerStateDesc.Filter = D3D11_FILTER_ANISOTROPIC; break;
+	}
+	samplerStateDesc.AddressU = addressMode;
+	samplerStateDesc.AddressV = addressMode;
+	samplerStateDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerStateDesc.MaxAnisotropy = 1;//(m_d3dDevice->GetFeatureLevel() > D3D_FEATURE_LEVEL_9_1) ? 16 : 2;
+	samplerStateDesc.MipLODBias = 0.0f;
+	samplerStateDesc.MinLOD = -FLT_MAX;
+	samplerStateDesc.MaxLOD = FLT_MAX;
+	samplerStateDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+
+	ComPtr<ID3D11SamplerState> state;
+	HRESULT hr = m_d3dDevice->CreateSamplerState(&samplerStateDesc, &state);
+	if (FAILED(hr))
+	{
+		ReportError("Failed to create a SamplerState object.");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_samplerStates.Add(std::move(state));
+}
+
+void D3D11RenderDevice::Release(GPUHANDLE handle)
+{
+	// The swap chain's buffers belong to the device
+	if (handle == m_backBuffer || handle == m_backBufferDepth)
+		return;
+
+	switch (GetGPUHandleKind(handle))
+	{
+	case GPU_RESOURCE::BUFFER:				m_buffers.Remove(handle); break;
+	case GPU_RESOURCE::VERTEX_SHADER:		m_vertexShaders.Remove(handle); break;
+	case GPU_RESOURCE::PIXEL_SHADER:		m_pixelShaders.Remove(handle); break;
+	case GPU_RESOURCE::TEXTURE:				m_textures.Remove(handle); break;
+	case GPU_RESOURCE::RASTERIZER_STATE:	m_rasterizerStates.Remove(handle); break;
+	case GPU_RESOURCE::DEPTH_STENCIL_STATE:	m_depthStencilStates.Remove(handle); break;
+	case GPU_RESOURCE::BLEND_STATE:			m_blendStates.Remove(handle); break;
+	case GPU_RESOURCE::SAMPLER_STATE:		m_samplerStates.Remove(handle); break;
+	default:								break;
+	}
+}
+
+unsigned int D3D11RenderDevice::GetBufferSize(GPUHANDLE buffer) const
+{
+	const Buffer* item = m_buffers.Get(buffer);
+	return item ? item->byteWidth : 0;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Contexts
+// ---------------------------------------------------------------------------------------------------------------
+
+D3D11RenderDevice::Context::Context(D3D11RenderDevice& device, ID3D11DeviceContext* context, RenderDeviceStats* stats)
+	: m_device(device)
+	, m_context(context)
+	, m_deferred(stats == nullptr)
+	, m_stats(stats ? stats : &m_recordedStats)
+{
+	memset(&m_recordedStats, 0, sizeof(m_recordedStats));
+	m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	// Fails on a runtime older than 11.1, which just leaves it null
+	m_context.As(&m_context1);
+}
+
+void D3D11RenderDevice::Context::UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount)
+{
+	Buffer* target = m_device.m_buffers.Get(buffer);
+	assert(target && data && byteCount <= target->byteWidth);
+
+	if (byteCount == 0)
+		byteCount = target->byteWidth;
+
+	// Dynamic buffers can't be written with UpdateSubresource. Discarding hands back fresh memory rather than waiting on
+	// draws that still read the old contents.
+	if (target->dynamic)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (FAILED(m_context->Map(target->buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			m_device.ReportError("Failed to map a dynamic Buffer.");
+			return;
+		}
+
+		memcpy(mapped.pData, data, byteCount);
+		m_context->Unmap(target->buffer.Get(), 0);
+
+		// Only a discard on the immediate context lets UpdateBufferRange use NO_OVERWRITE
+		if (!m_deferred)
+			target->discarded = true;
+	}
+	else if (byteCount < target->byteWidth)
+	{
+		// The box starts at 0, which also keeps clear of the runtime's deferred context bug with boxed updates (it
+		// offsets the source by the box when the driver doesn't do command lists itself)
+		D3D11_BOX box = { 0, 0, 0, byteCount, 1, 1 };
+		m_context->UpdateSubresource(target->buffer.Get(), 0, &box, data, 0, 0);
+	}
+	else
+	{
+		m_context->UpdateSubresource(target->buffer.Get(), 0, nullptr, data, 0, 0);
+	}
+
+	m_stats->bytesUploaded += byteCount;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Pipeline State
+// ---------------------------------------------------------------------------------------------------------------
+
+void D3D11RenderDevice::Context::SetVertexShader(GPUHANDLE shader)
+{
+	VertexShader* vs = m_device.m_vertexShaders.Get(shader);
+	m_context->VSSetShader(vs ? vs->shader.Get() : nullptr, nullptr, 0);
+	m_context->IASetInputLayout(vs ? vs->inputLayout.Get() : nullptr);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetPixelShader(GPUHANDLE shader)
+{
+	ComPtr<ID3D11PixelShader>* ps = m_device.m_pixelShaders.Get(shader);
+	m_context->PSSetShader(ps ? ps->Get() : nullptr, nullptr, 0);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset)
+{
+	Buffer* vb = m_device.m_buffers.Get(buffer);
+	ID3D11Buffer* d3dBuffer = vb ? vb->buffer.Get() : nullptr;
+	m_context->IASetVertexBuffers(slot, 1, &d3dBuffer, &stride, &offset);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format)
+{
+	Buffer* ib = m_device.m_buffers.Get(buffer);
+	m_context->IASetIndexBuffer(ib ? ib->buffer.Get() : nullptr, ToDXGIFormat(format), 0);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	Buffer* cb = m_device.m_buffers.Get(buffer);
+	ID3D11Buffer* d3dBuffer = cb ? cb->buffer.Get() : nullptr;
+	if (offset != 0 || byteCount != 0)
+	{
+		// Counted in float4s. Leaving byteCount at 0 still means the rest of the buffer.
+		assert(m_context1 && "Binding part of a constant buffer needs the 11.1 runtime");
+		UINT firstConstant = offset / 16;
+		UINT numConstants = (byteCount != 0 ? byteCount : (cb ? cb->byteWidth - offset : 0)) / 16;
+		m_context1->VSSetConstantBuffers1(slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+	}
+	else
+	{
+		m_context->VSSetConstantBuffers(slot, 1, &d3dBuffer);
+	}
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	Buffer* cb = m_device.m_buffers.Get(buffer);
+	ID3D11Buffer* d3dBuffer = cb ? cb->buffer.Get() : nullptr;
+	if (offset != 0 || byteCount != 0)
+	{
+		// Counted in float4s. Leaving byteCount at 0 still means the rest of the buffer.
+		assert(m_context1 && "Binding part of a constant buffer needs the 11.1 runtime");
+		UINT firstConstant = offset / 16;
+		UINT numConstants = (byteCount != 0 ? byteCount : (cb ? cb->byteWidth - offset : 0)) / 16;
+		m_context1->PSSetConstantBuffers1(slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+	}
+	else
+	{
+		m_context->PSSetConstantBuffers(slot, 1, &d3dBuffer);
+	}
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetPSTexture(unsigned int slot, GPUHANDLE texture)
+{
+	Texture* tex = m_device.m_textures.Get(texture);
+	ID3D11ShaderResourceView* srv = tex ? tex->srView.Get() : nullptr;
+	m_context->PSSetShaderResources(slot, 1, &srv);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetPSSampler(unsigned int slot, GPUHANDLE sampler)
+{
+	ComPtr<ID3D11SamplerState>* state = m_device.m_samplerStates.Get(sampler);
+	ID3D11SamplerState* d3dState = state ? state->Get() : nullptr;
+	m_context->PSSetSamplers(slot, 1, &d3dState);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetRasterizerState(GPUHANDLE state)
+{
+	ComPtr<ID3D11RasterizerState>* rs = m_device.m_rasterizerStates.Get(state);
+	m_context->RSSetState(rs ? rs->Get() : nullptr);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef)
+{
+	ComPtr<ID3D11DepthStencilState>* dss = m_device.m_depthStencilStates.Get(state);
+	m_context->OMSetDepthStencilState(dss ? dss->Get() : nullptr, stencilRef);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetBlendState(GPUHANDLE state)
+{
+	ComPtr<ID3D11BlendState>* bs = m_device.m_blendStates.Get(state);
+	m_context->OMSetBlendState(bs ? bs->Get() : nullptr, nullptr, 0xFFFFFFFF);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetViewport(const Viewport& viewport)
+{
+	D3D11_VIEWPORT d3dViewport;
+	d3dViewport.TopLeftX = viewport.topLeftX;
+	d3dViewport.TopLeftY = viewport.topLeftY;
+	d3dViewport.Width = viewport.width;
+	d3dViewport.Height = viewport.height;
+	d3dViewport.MinDepth = viewport.minDepth;
+	d3dViewport.MaxDepth = viewport.maxDepth;
+
+	m_context->RSSetViewports(1, &d3dViewport);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil)
+{
+	Texture* color = m_device.m_textures.Get(colorTarget);
+	Texture* depth = m_device.m_textures.Get(depthStencil);
+	ID3D11RenderTargetView* rtv = color ? color->rtView.Get() : nullptr;
+
+	m_context->OMSetRenderTargets(1, &rtv, depth ? depth->dsView.Get() : nullptr);
+	m_stats->stateChanges++;
+}
+
+void D3D11RenderDevice::Context::ClearState()
+{
+	m_context->ClearState();
+
+	// Nothing in the engine draws anything but triangle lists, and ClearState forgets that too
+	m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D11RenderDevice::Context::ClearRenderTarget(GPUHANDLE target, const float color[4])
+{
+	Texture* texture = m_device.m_textures.Get(target);
+	assert(texture && texture->rtView);
+
+	m_context->ClearRenderTargetView(texture->rtView.Get(), color);
+}
+
+void D3D11RenderDevice::Context::ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil)
+{
+	Texture* texture = m_device.m_textures.Get(target);
+	assert(texture && texture->dsView);
+
+	UINT d3dFlags = 0;
+	if (clearFlags & CLEAR_DEPTH) d3dFlags |= D3D11_CLEAR_DEPTH;
+	if (clearFlags & CLEAR_STENCIL) d3dFlags |= D3D11_CLEAR_STENCIL;
+
+	m_context->ClearDepthStencilView(texture->dsView.Get(), d3dFlags, depth, stencil);
+}
+
+void D3D11RenderDevice::Context::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	m_context->Draw(vertexCount, startVertex);
+	m_stats->draws++;
+	m_stats->triangles += vertexCount / 3;
+}
+
+void D3D11RenderDevice::Context::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	m_context->DrawIndexed(indexCount, startIndex, baseVertex);
+	m_stats->draws++;
+	m_stats->triangles += indexCount / 3;
+}
+
+void D3D11RenderDevice::Context::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	m_context->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+	m_stats->draws++;
+	m_stats->triangles += (unsigned long long)(indexCount / 3) * instanceCount;
+}
+
+void D3D11RenderDevice::Context::Close()
+{
+	assert(m_deferred && "Only command lists can be closed");
+	assert(!m_commandList && "The list has already been closed");
+
+	// FALSE leaves the deferred context with nothing bound for the next recording, which is what a new list looks like
+	if (FAILED(m_context->FinishCommandList(FALSE, &m_commandList)))
+		m_device.ReportError("Failed to finish a command list.");
+
+	m_context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Immediate Context
+// ---------------------------------------------------------------------------------------------------------------
+
+// The device draws straight away through its immediate context
+void D3D11RenderDevice::UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount)
+{
+	m_immediate->UpdateBuffer(buffer, data, byteCount);
+}
+
+void D3D11RenderDevice::UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount)
+{
+	Buffer* target = m_buffers.Get(buffer);
+	assert(target && target->dynamic && data && offset <= target->byteWidth && byteCount <= target->byteWidth - offset);
+
+	// NO_OVERWRITE isn't allowed on a buffer that's never been discarded, so the first write does that instead. The
+	// rest of the buffer is undefined afterwards, which is fine since nothing's written it yet either.
+	D3D11_MAP mapType = target->discarded ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(m_d3dDeviceContext->Map(target->buffer.Get(), 0, mapType, 0, &mapped)))
+	{
+		ReportError("Failed to map a dynamic Buffer.");
+		return;
+	}
+
+	memcpy((char*)mapped.pData + offset, data, byteCount);
+	m_d3dDeviceContext->Unmap(target->buffer.Get(), 0);
+	target->discarded = true;
+
+	m_frameStats.bytesUploaded += byteCount;
+}
+
+bool D3D11RenderDevice::SupportsConstantBufferOffsets() const
+{
+	return m_constantBufferOffsets;
+}
+
+void D3D11RenderDevice::SetVertexShader(GPUHANDLE shader)
+{
+	m_immediate->SetVertexShader(shader);
+}
+
+void D3D11RenderDevice::SetPixelShader(GPUHANDLE shader)
+{
+	m_immediate->SetPixelShader(shader);
+}
+
+void D3D11RenderDevice::SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset)
+{
+	m_immediate->SetVertexBuffer(slot, buffer, stride, offset);
+}
+
+void D3D11RenderDevice::SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format)
+{
+	m_immediate->SetIndexBuffer(buffer, format);
+}
+
+void D3D11RenderDevice::SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	m_immediate->SetVSConstantBuffer(slot, buffer, offset, byteCount);
+}
+
+void D3D11RenderDevice::SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	m_immediate->SetPSConstantBuffer(slot, buffer, offset, byteCount);
+}
+
+void D3D11RenderDevice::SetPSTexture(unsigned int slot, GPUHANDLE texture)
+{
+	m_immediate->SetPSTexture(slot, texture);
+}
+
+void D3D11RenderDevice::SetPSSampler(unsigned int slot, GPUHANDLE sampler)
+{
+	m_immediate->SetPSSampler(slot, sampler);
+}
+
+void D3D11RenderDevice::SetRasterizerState(GPUHANDLE state)
+{
+	m_immediate->SetRasterizerState(state);
+}
+
+void D3D11RenderDevice::SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef)
+{
+	m_immediate->SetDepthStencilState(state, stencilRef);
+}
+
+void D3D11RenderDevice::SetBlendState(GPUHANDLE state)
+{
+	m_immediate->SetBlendState(state);
+}
+
+void D3D11RenderDevice::SetViewport(const Viewport& viewport)
+{
+	m_immediate->SetViewport(viewport);
+}
+
+void D3D11RenderDevice::SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil)
+{
+	m_immediate->SetRenderTarget(colorTarget, depthStencil);
+}
+
+void D3D11RenderDevice::ClearState()
+{
+	m_immediate->ClearState();
+}
+
+void D3D11RenderDevice::ClearRenderTarget(GPUHANDLE target, const float color[4])
+{
+	m_immediate->ClearRenderTarget(target, color);
+}
+
+void D3D11RenderDevice::ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil)
+{
+	m_immediate->ClearDepthStencil(target, clearFlags, depth, stencil);
+}
+
+void D3D11RenderDevice::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	m_immediate->Draw(vertexCount, startVertex);
+}
+
+void D3D11RenderDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	m_immediate->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderDevice::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	m_immediate->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Command Lists
+// ---------------------------------------------------------------------------------------------------------------
+
+std::unique_ptr<RenderCommandList> D3D11RenderDevice::CreateCommandList()
+{
+	ComPtr<ID3D11DeviceContext> deferred;
+	if (FAILED(m_d3dDevice->CreateDeferredContext(0, &deferred)))
+	{
+		ReportError("Failed to create a deferred context.");
+		return nullptr;
+	}
+
+	return std::unique_ptr<RenderCommandList>(new Context(*this, deferred.Get(), nullptr));
+}
+
+void D3D11RenderDevice::ExecuteCommandList(RenderCommandList& list)
+{
+	// Only ever handed lists it made itself
+	Context& context = static_cast<Context&>(list);
+	assert(context.m_deferred && context.m_commandList && "Close a command list before executing it");
+
+	// FALSE clears the immediate context's state afterwards, rather than putting back what was bound before
+	m_d3dDeviceContext->ExecuteCommandList(context.m_commandList.Get(), FALSE);
+	m_immediate->ClearState();
+	context.m_commandList.Reset();
+
+	// What the list did counts towards the frame it's executed in
+	AddStats(m_frameStats, context.m_recordedStats);
+	memset(&context.m_recordedStats, 0, sizeof(context.m_recordedStats));
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Fences
+// ---------------------------------------------------------------------------------------------------------------
+
+unsigned long long D3D11RenderDevice::InsertFence()
+{
+	PendingFence fence;
+	fence.value = ++m_insertedFence;
+
+	if (!m_freeQueries.empty())
+	{
+		fence.query = std::move(m_freeQueries.back());
+		m_freeQueries.pop_back();
+	}
+	else
+	{
+		D3D11_QUERY_DESC queryDesc = { D3D11_QUERY_EVENT, 0 };
+		if (FAILED(m_d3dDevice->CreateQuery(&queryDesc, &fence.query)))
+			ReportError("Failed to create a fence Query.");
+	}
+
+	if (fence.query)
+		m_d3dDeviceContext->End(fence.query.Get());
+
+	m_pendingFences.push_back(std::move(fence));
+	return m_insertedFence;
+}
+
+void D3D11RenderDevice::RetireFences(bool flush)
+{
+	while (!m_pendingFences.empty())
+	{
+		PendingFence& fence = m_pendingFences.front();
+		if (fence.query)
+		{
+			if (m_d3dDeviceContext->GetData(fence.query.Get(), nullptr, 0, flush ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				break;
+			m_freeQueries.push_back(std::move(fence.query));
+		}
+
+		m_completedFence = fence.value;
+		m_pendingFences.pop_front();
+	}
+}
+
+bool D3D11RenderDevice::IsFenceComplete(unsigned long long fence)
+{
+	assert(fence <= m_insertedFence && "That fence hasn't been inserted yet");
+
+	if (fence > m_completedFence)
+		RetireFences(false);
+	return fence <= m_completedFence;
+}
+
+void D3D11RenderDevice::WaitForFence(unsigned long long fence)
+{
+	assert(fence <= m_insertedFence && "That fence hasn't been inserted yet");
+
+	while (fence > m_completedFence)
+	{
+		RetireFences(true);
+		if (fence > m_completedFence)
+			std::this_thread::yield();
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Swap Chain
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE D3D11RenderDevice::GetBackBuffer() const
+{
+	return m_backBuffer;
+}
+
+GPUHANDLE D3D11RenderDevice::GetBackBufferDepth() const
+{
+	return m_backBufferDepth;
+}
+
+unsigned int D3D11RenderDevice::GetBackBufferWidth() const
+{
+	return m_width;
+}
+
+unsigned int D3D11RenderDevice::GetBackBufferHeight() const
+{
+	return m_height;
+}
+
+void D3D11RenderDevice::Present()
+{
+	m_d3dSwapChain->Present1(m_vSync ? 1 : 0, 0, &m_PresentParameters);
+}
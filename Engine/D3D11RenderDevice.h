@@ -0,0 +1,192 @@
+#pragma once
+#include "DirectXIncludes.h"
+#include "RenderDevice.h"
+#include <deque>
+
+// The RenderDevice that actually draws things, on a D3D11 device with a swap chain for the given window
+class D3D11RenderDevice : public RenderDevice
+{
+private:
+	struct Buffer
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+		unsigned int byteWidth;
+		bool dynamic;
+		bool discarded;		// Whether it's been mapped with DISCARD yet, which NO_OVERWRITE has to come after
+	};
+
+	struct VertexShader
+	{
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> shader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	};
+
+	// Whichever views the texture's bind flags asked for. The back buffer only has a render target view.
+	struct Texture
+	{
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> rtView;
+		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> dsView;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srView;
+		TextureDesc desc;
+	};
+
+	// Commands go to a device context, either the immediate one or a deferred one recording a command list. The device
+	// draws through an immediate Context of its own; deferred ones keep what they drew to themselves until the list is
+	// executed, since recording can happen on any thread.
+	class Context : public RenderCommandList
+	{
+	private:
+		D3D11RenderDevice& m_device;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_context;
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext1> m_context1;	// Null without the 11.1 runtime
+		bool m_deferred;
+		RenderDeviceStats m_recordedStats;
+		RenderDeviceStats* m_stats;
+
+		// What Close finished, until it's executed
+		Microsoft::WRL::ComPtr<ID3D11CommandList> m_commandList;
+
+		friend class D3D11RenderDevice;
+
+	public:
+		// Deferred when stats is null
+		Context(D3D11RenderDevice& device, ID3D11DeviceContext* context, RenderDeviceStats* stats);
+
+		void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) override;
+
+		void SetVertexShader(GPUHANDLE shader) override;
+		void SetPixelShader(GPUHANDLE shader) override;
+		void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) override;
+		void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) override;
+		void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+		void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+		void SetPSTexture(unsigned int slot, GPUHANDLE texture) override;
+		void SetPSSampler(unsigned int slot, GPUHANDLE sampler) override;
+		void SetRasterizerState(GPUHANDLE state) override;
+		void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) override;
+		void SetBlendState(GPUHANDLE state) override;
+		void SetViewport(const Viewport& viewport) override;
+		void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) override;
+		void ClearState() override;
+
+		void ClearRenderTarget(GPUHANDLE target, const float color[4]) override;
+		void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) override;
+
+		void Draw(unsigned int vertexCount, unsigned int startVertex) override;
+		void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+		void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+
+		void Close() override;
+	};
+
+	HWND m_hwnd;
+	bool m_vSync;
+	bool m_windowed;
+	unsigned int m_width;
+	unsigned int m_height;
+
+	// Direct3D device and swap chain.
+	Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dDeviceContext;
+	Microsoft::WRL::ComPtr<IDXGISwapChain1> m_d3dSwapChain;
+	std::unique_ptr<Context> m_immediate;
+
+	// Whether constant buffers can be bound in part and written with NO_OVERWRITE, which the ring needs
+	bool m_constantBufferOffsets;
+
+	// Fences are event queries, done in order, so one that's finished means the ones before it are too. Queries are
+	// reused once they're done. A fence whose query couldn't be made has a null one and counts as done once it's
+	// first in line.
+	struct PendingFence
+	{
+		unsigned long long value;
+		Microsoft::WRL::ComPtr<ID3D11Query> query;
+	};
+
+	std::deque<PendingFence> m_pendingFences;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> m_freeQueries;
+	unsigned long long m_insertedFence;
+	unsigned long long m_completedFence;
+
+	// Present parameters used by the IDXGISwapChain1::Present1 method
+	DXGI_PRESENT_PARAMETERS m_PresentParameters;
+
+	GPUResourceTable<Buffer, GPU_RESOURCE::BUFFER> m_buffers;
+	GPUResourceTable<VertexShader, GPU_RESOURCE::VERTEX_SHADER> m_vertexShaders;
+	GPUResourceTable<Microsoft::WRL::ComPtr<ID3D11PixelShader>, GPU_RESOURCE::PIXEL_SHADER> m_pixelShaders;
+	GPUResourceTable<Texture, GPU_RESOURCE::TEXTURE> m_textures;
+	GPUResourceTable<Microsoft::WRL::ComPtr<ID3D11RasterizerState>, GPU_RESOURCE::RASTERIZER_STATE> m_rasterizerStates;
+	GPUResourceTable<Microsoft::WRL::ComPtr<ID3D11DepthStencilState>, GPU_RESOURCE::DEPTH_STENCIL_STATE> m_depthStencilStates;
+	GPUResourceTable<Microsoft::WRL::ComPtr<ID3D11BlendState>, GPU_RESOURCE::BLEND_STATE> m_blendStates;
+	GPUResourceTable<Microsoft::WRL::ComPtr<ID3D11SamplerState>, GPU_RESOURCE::SAMPLER_STATE> m_samplerStates;
+
+	// The swap chain's buffers live in the texture table like everything else
+	GPUHANDLE m_backBuffer;
+	GPUHANDLE m_backBufferDepth;
+
+	bool Initialize();
+	DXGI_RATIONAL QueryRefreshRate();
+	void ReportError(const char* message);
+
+	// Moves m_completedFence up past whatever the GPU has finished. flush makes sure the queries are on their way to
+	// the GPU at all, which waiting needs.
+	void RetireFences(bool flush);
+
+public:
+	D3D11RenderDevice(HWND hwnd, unsigned int width, unsigned int height, bool vSync, bool windowed);
+	~D3D11RenderDevice();
+
+	const char* GetName() const override;
+
+	GPUHANDLE CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic = false) override;
+	GPUHANDLE CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount) override;
+	GPUHANDLE CreatePixelShader(const void* bytecode, size_t bytecodeSize) override;
+	GPUHANDLE CreateTexture(const TextureDesc& desc) override;
+	GPUHANDLE CreateRasterizerState(const RasterizerDesc& desc) override;
+	GPUHANDLE CreateDepthStencilState(const DepthStencilDesc& desc) override;
+	GPUHANDLE CreateBlendState(const BlendDesc& desc) override;
+	GPUHANDLE CreateSamplerState(const SamplerDesc& desc) override;
+	void Release(GPUHANDLE handle) override;
+	unsigned int GetBufferSize(GPUHANDLE buffer) const override;
+
+	void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) override;
+	void UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount) override;
+	bool SupportsConstantBufferOffsets() const override;
+
+	void SetVertexShader(GPUHANDLE shader) override;
+	void SetPixelShader(GPUHANDLE shader) override;
+	void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) override;
+	void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) override;
+	void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSTexture(unsigned int slot, GPUHANDLE texture) override;
+	void SetPSSampler(unsigned int slot, GPUHANDLE sampler) override;
+	void SetRasterizerState(GPUHANDLE state) override;
+	void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) override;
+	void SetBlendState(GPUHANDLE state) override;
+	void SetViewport(const Viewport& viewport) override;
+	void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) override;
+	void ClearState() override;
+
+	void ClearRenderTarget(GPUHANDLE target, const float color[4]) override;
+	void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) override;
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+
+	unsigned long long InsertFence() override;
+	bool IsFenceComplete(unsigned long long fence) override;
+	void WaitForFence(unsigned long long fence) override;
+
+	std::unique_ptr<RenderCommandList> CreateCommandList() override;
+	void ExecuteCommandList(RenderCommandList& list) override;
+
+	GPUHANDLE GetBackBuffer() const override;
+	GPUHANDLE GetBackBufferDepth() const override;
+	unsigned int GetBackBufferWidth() const override;
+	unsigned int GetBackBufferHeight() const override;
+	bool Resize(unsigned int width, unsigned int height) override;
+	void Present() override;
+};
@@ -0,0 +1,246 @@
+#include "DrawList.h"
+#include "FrameAllocator.h"
+#include <assert.h>
+#include <string.h>
+
+// The state field, most significant first: depth/stencil state, stencil ref, rasterizer state, blend state
+#define DRAW_STATE_DEPTH_STENCIL_BITS 4
+#define DRAW_STATE_STENCIL_REF_BITS 8
+#define DRAW_STATE_RASTERIZER_BITS 2
+#define DRAW_STATE_BLEND_BITS 3
+
+static_assert(DRAW_KEY_PASS_SHIFT + DRAW_KEY_PASS_BITS == 64, "The sort key fields have to fill 64 bits");
+static_assert(DRAW_STATE_DEPTH_STENCIL_BITS + DRAW_STATE_STENCIL_REF_BITS + DRAW_STATE_RASTERIZER_BITS + DRAW_STATE_BLEND_BITS == DRAW_KEY_STATE_BITS,
+	"The state fields have to fill the state bits");
+static_assert(DEPTH_STENCIL_STATE_COUNT <= (1 << DRAW_STATE_DEPTH_STENCIL_BITS), "Not enough bits for the depth/stencil states");
+static_assert(RASTERIZER_STATE_COUNT <= (1 << DRAW_STATE_RASTERIZER_BITS), "Not enough bits for the rasterizer states");
+static_assert(BLEND_STATE_COUNT <= (1 << DRAW_STATE_BLEND_BITS), "Not enough bits for the blend states");
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+static inline uint64_t Field(uint64_t value, unsigned int bits, unsigned int shift)
+{
+	return (value & ((1ULL << bits) - 1)) << shift;
+}
+
+DrawList::DrawList()
+	: m_sorted(true)
+{
+	Clear();
+}
+
+DrawList::~DrawList()
+{
+}
+
+uint64_t DrawList::MakeKey(unsigned int pass, const DrawState& state, MaterialHandle material, MeshHandle mesh, float depth)
+{
+	assert(pass < DRAW_LIST_MAX_PASSES);
+
+	uint64_t stateBits =
+		Field(state.depthStencil, DRAW_STATE_DEPTH_STENCIL_BITS, DRAW_STATE_STENCIL_REF_BITS + DRAW_STATE_RASTERIZER_BITS + DRAW_STATE_BLEND_BITS) |
+		Field(state.stencilRef, DRAW_STATE_STENCIL_REF_BITS, DRAW_STATE_RASTERIZER_BITS + DRAW_STATE_BLEND_BITS) |
+		Field(state.rasterizer, DRAW_STATE_RASTERIZER_BITS, DRAW_STATE_BLEND_BITS) |
+		Field(state.blend, DRAW_STATE_BLEND_BITS, 0);
+
+	// Written so NaN ends up at 0 too
+	float clamped = depth > 0.0f ? (depth < 1.0f ? depth : 1.0f) : 0.0f;
+	uint64_t depthBits = (uint64_t)(clamped * (float)((1 << DRAW_KEY_DEPTH_BITS) - 1));
+
+	return
+		Field(pass, DRAW_KEY_PASS_BITS, DRAW_KEY_PASS_SHIFT) |
+		Field(stateBits, DRAW_KEY_STATE_BITS, DRAW_KEY_STATE_SHIFT) |
+		Field(material.GetIndex(), DRAW_KEY_MATERIAL_BITS, DRAW_KEY_MATERIAL_SHIFT) |
+		Field(mesh.GetIndex(), DRAW_KEY_MESH_BITS, DRAW_KEY_MESH_SHIFT) |
+		Field(depthBits, DRAW_KEY_DEPTH_BITS, DRAW_KEY_DEPTH_SHIFT);
+}
+
+unsigned int DrawList::GetPass(uint64_t key)
+{
+	return (unsigned int)(key >> DRAW_KEY_PASS_SHIFT);
+}
+
+void DrawList::Clear()
+{
+	m_packets.clear();
+	m_pipelines.clear();
+	m_entries.clear();
+	m_sorted = true;
+	m_lastMaterial = MaterialHandle();
+	m_lastPipeline = PipelineHandle();
+
+	memset(&m_lastVSConstants, 0, sizeof(m_lastVSConstants));
+	memset(&m_lastPSConstants, 0, sizeof(m_lastPSConstants));
+}
+
+const void* DrawList::CopyConstants(const void* data, unsigned int size, ConstantCopy& last)
+{
+	if (!data)
+		return nullptr;
+
+	// Game code tends to submit a run of packets with the same constants, so it's worth checking the last ones
+	if (data == last.source && size == last.size && memcmp(data, last.copy, size) == 0)
+		return last.copy;
+
+	void* copy = FrameAllocator::GetSingleton().Allocate(size);
+	memcpy(copy, data, size);
+
+	last.source = data;
+	last.copy = copy;
+	last.size = size;
+	return copy;
+}
+
+PipelineHandle DrawList::GetPipeline(MaterialHandle material, const DrawState& state)
+{
+	// The stencil ref isn't part of the pipeline, it's set along with it
+	if (material == m_lastMaterial && state.rasterizer == m_lastState.rasterizer &&
+		state.depthStencil == m_lastState.depthStencil && state.blend == m_lastState.blend)
+		return m_lastPipeline;
+
+	RenderManager& renderManager = RenderManager::GetSingleton();
+	const Material& materialDesc = renderManager.GetMaterial(material);
+	m_lastPipeline = renderManager.CreatePipelineState(PipelineState(materialDesc.vsHandle, materialDesc.psHandle,
+		state.rasterizer, state.depthStencil, state.blend));
+	m_lastMaterial = material;
+	m_lastState = state;
+	return m_lastPipeline;
+}
+
+void DrawList::Submit(uint64_t key, const DrawPacket& packet)
+{
+	assert(packet.mesh && packet.material);
+	assert(!packet.vsConstants || packet.vsConstantSize > 0);
+	assert(!packet.psConstants || packet.psConstantSize > 0);
+
+	DrawPacket stored = packet;
+	stored.vsConstants = CopyConstants(packet.vsConstants, packet.vsConstantSize, m_lastVSConstants);
+	stored.psConstants = CopyConstants(packet.psConstants, packet.psConstantSize, m_lastPSConstants);
+
+	SortEntry entry;
+	entry.key = key;
+	entry.packet = (unsigned int)m_packets.size();
+
+	m_packets.push_back(stored);
+	m_pipelines.push_back(GetPipeline(packet.material, packet.state));
+	m_entries.push_back(entry);
+	m_sorted = false;
+}
+
+void DrawList::Sort()
+{
+	size_t count = m_entries.size();
+	m_sorted = true;
+	if (count < 2)
+		return;
+
+	// Bytes that are the same in every key can't change the order, and with the handful of passes, states and
+	// materials a frame has, most of them are
+	uint64_t differing = 0;
+	for (size_t i = 1; i < count; i++)
+		differing |= m_entries[i].key ^ m_entries[0].key;
+
+	m_scratch.resize(count);
+	SortEntry* source = m_entries.data();
+	SortEntry* destination = m_scratch.data();
+
+	for (unsigned int shift = 0; shift < 64; shift += RADIX_BITS)
+	{
+		if (((differing >> shift) & (RADIX_BUCKETS - 1)) == 0)
+			continue;
+
+		size_t offsets[RADIX_BUCKETS] = {};
+		for (size_t i = 0; i < count; i++)
+			offsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++;
+
+		size_t total = 0;
+		for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+		{
+			size_t bucketCount = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucketCount;
+		}
+
+		// Going through in order keeps it stable, so equal keys draw in the order they were submitted
+		for (size_t i = 0; i < count; i++)
+			destination[offsets[(source[i].key >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+
+		SortEntry* swap = source;
+		source = destination;
+		destination = swap;
+	}
+
+	if (source != m_entries.data())
+		m_entries.swap(m_scratch);
+}
+
+void DrawList::Execute(RenderManager& renderManager)
+{
+	Execute(renderManager, 0, m_entries.size());
+}
+
+void DrawList::Execute(RenderManager& renderManager, unsigned int pass)
+{
+	assert(pass < DRAW_LIST_MAX_PASSES);
+
+	// The passes are in the top bits, so each one is a single run of the sorted entries
+	size_t first = 0;
+	while (first < m_entries.size() && GetPass(m_entries[first].key) < pass)
+		first++;
+
+	size_t last = first;
+	while (last < m_entries.size() && GetPass(m_entries[last].key) == pass)
+		last++;
+
+	Execute(renderManager, first, last);
+}
+
+void DrawList::Execute(RenderManager& renderManager, size_t first, size_t last)
+{
+	assert(m_sorted && "Sort the draw list before executing it");
+
+	// The RenderManager skips state that's already bound, so only the constants have to be tracked here
+	const Material* material = nullptr;
+	MaterialHandle materialHandle;
+	CBHandle vsBuffer, psBuffer;
+	const void* vsConstants = nullptr;
+	const void* psConstants = nullptr;
+
+	for (size_t i = first; i < last; i++)
+	{
+		unsigned int index = m_entries[i].packet;
+		const DrawPacket& packet = m_packets[index];
+
+		renderManager.SetPipelineState(m_pipelines[index], packet.state.stencilRef);
+		renderManager.SetMaterial(packet.material);
+		if (packet.material != materialHandle)
+		{
+			material = &renderManager.GetMaterial(packet.material);
+			materialHandle = packet.material;
+		}
+
+		if (packet.vsConstants && (material->vsCBHandle != vsBuffer || packet.vsConstants != vsConstants))
+		{
+			renderManager.UpdateConstantBuffer(material->vsCBHandle, packet.vsConstants);
+			vsBuffer = material->vsCBHandle;
+			vsConstants = packet.vsConstants;
+		}
+		if (packet.psConstants && (material->psCBHandle != psBuffer || packet.psConstants != psConstants))
+		{
+			renderManager.UpdateConstantBuffer(material->psCBHandle, packet.psConstants);
+			psBuffer = material->psCBHandle;
+			psConstants = packet.psConstants;
+		}
+
+		if (packet.instanceCount > 0)
+			renderManager.DrawMeshInstanced(packet.mesh, packet.instanceBuffer, packet.instanceStride, packet.instanceCount, packet.startInstance);
+		else
+			renderManager.DrawMesh(packet.mesh);
+	}
+}
+
+unsigned int DrawList::Count() const
+{
+	return (unsigned int)m_packets.size();
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "RenderManager.h"
+#include <stdint.h>
+#include <vector>
+
+// The fixed function state a draw needs, in the RenderManager's pre-configured flavours
+struct DrawState
+{
+	RASTERIZER_STATE rasterizer;
+	DEPTH_STENCIL_STATE depthStencil;
+	unsigned char stencilRef;
+	BLEND_STATE blend;
+
+	DrawState()
+		: rasterizer(CULL_BACK)
+		, depthStencil(READ_WRITE)
+		, stencilRef(0)
+		, blend(SOLID)
+	{}
+
+	DrawState(RASTERIZER_STATE rasterizer, DEPTH_STENCIL_STATE depthStencil, unsigned char stencilRef, BLEND_STATE blend)
+		: rasterizer(rasterizer)
+		, depthStencil(depthStencil)
+		, stencilRef(stencilRef)
+		, blend(blend)
+	{}
+};
+
+// Everything one draw needs. Constant data is optional: leave it null and the material's constant buffer is left as it
+// is. An instanceCount of 0 is a plain draw, anything else draws the mesh instanced from instanceBuffer.
+struct DrawPacket
+{
+	MeshHandle mesh;
+	MaterialHandle material;
+	DrawState state;
+
+	// Copied when the packet is submitted, so these only have to live until Submit returns. They have to be as big as
+	// the material's constant buffers, same as with RenderManager::UpdateConstantBuffer.
+	const void* vsConstants;
+	unsigned int vsConstantSize;
+	const void* psConstants;
+	unsigned int psConstantSize;
+
+	GPUHANDLE instanceBuffer;
+	unsigned int instanceStride;
+	unsigned int instanceCount;
+	unsigned int startInstance;
+
+	DrawPacket()
+		: vsConstants(nullptr)
+		, vsConstantSize(0)
+		, psConstants(nullptr)
+		, psConstantSize(0)
+		, instanceBuffer(0)
+		, instanceStride(0)
+		, instanceCount(0)
+		, startInstance(0)
+	{}
+};
+
+// Sort key layout, most significant bits first. Packets are drawn in key order, so everything in a pass goes together,
+// then everything with the same state, then the same material, then the same mesh, and depth breaks ties. The
+// material and mesh fields hold their handles' slots. Slots that don't fit in their field just share a bucket with
+// others; the packet still draws the right thing, it only batches a little worse.
+#define DRAW_KEY_PASS_BITS 4
+#define DRAW_KEY_STATE_BITS 17
+#define DRAW_KEY_MATERIAL_BITS 13
+#define DRAW_KEY_MESH_BITS 12
+#define DRAW_KEY_DEPTH_BITS 18
+
+#define DRAW_KEY_DEPTH_SHIFT 0
+#define DRAW_KEY_MESH_SHIFT (DRAW_KEY_DEPTH_SHIFT + DRAW_KEY_DEPTH_BITS)
+#define DRAW_KEY_MATERIAL_SHIFT (DRAW_KEY_MESH_SHIFT + DRAW_KEY_MESH_BITS)
+#define DRAW_KEY_STATE_SHIFT (DRAW_KEY_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS)
+#define DRAW_KEY_PASS_SHIFT (DRAW_KEY_STATE_SHIFT + DRAW_KEY_STATE_BITS)
+
+#define DRAW_LIST_MAX_PASSES (1 << DRAW_KEY_PASS_BITS)
+
+// A frame's worth of draws, recorded in whatever order game code gets to them and then issued sorted by key, skipping
+// any state, material, mesh or constant buffer that's already bound. Packets and their constants live until Clear, with
+// the constants copied into the FrameAllocator, so a list has to be cleared every frame (or at least every other one).
+//
+// Submit turns each packet's shaders and state into a RenderManager pipeline state, so it has to happen on the main
+// thread. Execute can happen on a recording thread.
+//
+// Sorting is an LSD radix sort on the keys, 8 bits at a time, skipping any byte that's the same in every key. The
+// storage is kept between frames, so once a list has seen its biggest frame recording doesn't allocate.
+class DrawList
+{
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		unsigned int packet;
+	};
+
+	std::vector<DrawPacket> m_packets;
+	std::vector<PipelineHandle> m_pipelines;
+	std::vector<SortEntry> m_entries;
+	std::vector<SortEntry> m_scratch;
+	bool m_sorted;
+
+	// The last constants submitted and where their copy went, so packets sharing constants share one copy
+	struct ConstantCopy
+	{
+		const void* source;
+		const void* copy;
+		unsigned int size;
+	};
+
+	ConstantCopy m_lastVSConstants;
+	ConstantCopy m_lastPSConstants;
+
+	// The last pipeline looked up, since packets tend to come in runs with the same material and state
+	MaterialHandle m_lastMaterial;
+	DrawState m_lastState;
+	PipelineHandle m_lastPipeline;
+
+	const void* CopyConstants(const void* data, unsigned int size, ConstantCopy& last);
+	PipelineHandle GetPipeline(MaterialHandle material, const DrawState& state);
+	void Execute(RenderManager& renderManager, size_t first, size_t last);
+
+public:
+	DrawList();
+	~DrawList();
+
+	// Builds a key from its parts. depth is clamped to [0, 1]; smaller depths draw first within a bucket, so pass
+	// 1 - depth to get back to front.
+	static uint64_t MakeKey(unsigned int pass, const DrawState& state, MaterialHandle material, MeshHandle mesh, float depth = 0.0f);
+	static unsigned int GetPass(uint64_t key);
+
+	void Clear();
+	void Submit(uint64_t key, const DrawPacket& packet);
+	void Sort();
+
+	// Draws the sorted packets, either all of them or just one pass's. Sort has to have been called since the last Submit.
+	void Execute(RenderManager& renderManager);
+	void Execute(RenderManager& renderManager, unsigned int pass);
+
+	unsigned int Count() const;
+
+private:
+	DrawList(const DrawList&);
+	DrawList& operator=(const DrawList&);
+};
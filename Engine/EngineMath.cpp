@@ -0,0 +1,131 @@
+#include "EngineMath.h"
+
+#if defined(__AVX2__) && defined(_XM_SSE_INTRINSICS_)
+#include <immintrin.h>
+#define ENGINE_MATH_AVX2
+#endif
+
+using namespace DirectX;
+
+// ----------------------------------------------------------------------------------
+// AVX2 helpers
+// ----------------------------------------------------------------------------------
+#if defined(ENGINE_MATH_AVX2)
+
+// Puts a row of one matrix in the low half and the same row of another in the high half
+static inline __m256 LoadRowPair(const XMMATRIX& low, const XMMATRIX& high, int row)
+{
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(low.r[row]), high.r[row], 1);
+}
+
+static inline __m256 MultiplyAdd(__m256 a, __m256 b, __m256 c)
+{
+#if defined(__FMA__)
+	return _mm256_fmadd_ps(a, b, c);
+#else
+	return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+#endif
+}
+
+// Multiplies a pair of rows (one from each of two matrices) by a pair of right hand matrices. The permutes splat each
+// element within its own half, so both rows get the usual x * r0 + y * r1 + z * r2 + w * r3.
+static inline __m256 TransformRowPair(__m256 rows, const __m256* right)
+{
+	__m256 result = _mm256_mul_ps(_mm256_permute_ps(rows, 0x00), right[0]);
+	result = MultiplyAdd(_mm256_permute_ps(rows, 0x55), right[1], result);
+	result = MultiplyAdd(_mm256_permute_ps(rows, 0xAA), right[2], result);
+	return MultiplyAdd(_mm256_permute_ps(rows, 0xFF), right[3], result);
+}
+
+static inline void StoreRowPair(XMMATRIX& low, XMMATRIX& high, int row, __m256 value)
+{
+	low.r[row] = _mm256_castps256_ps128(value);
+	high.r[row] = _mm256_extractf128_ps(value, 1);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------------
+// Batch functions
+// ----------------------------------------------------------------------------------
+void EngineMath::MultiplyMatrices(const XMMATRIX* a, const XMMATRIX* b, XMMATRIX* result, size_t count)
+{
+	size_t i = 0;
+
+#if defined(ENGINE_MATH_AVX2)
+	for (; i + 2 <= count; i += 2)
+	{
+		// Load all of b first so it doesn't matter if result is b
+		__m256 right[4];
+		for (int row = 0; row < 4; row++)
+			right[row] = LoadRowPair(b[i], b[i + 1], row);
+
+		for (int row = 0; row < 4; row++)
+			StoreRowPair(result[i], result[i + 1], row, TransformRowPair(LoadRowPair(a[i], a[i + 1], row), right));
+	}
+#endif
+
+	for (; i < count; i++)
+		result[i] = XMMatrixMultiply(a[i], b[i]);
+}
+
+void EngineMath::MultiplyMatrices(const XMMATRIX* matrices, const XMMATRIX& m, XMMATRIX* result, size_t count)
+{
+	size_t i = 0;
+
+#if defined(ENGINE_MATH_AVX2)
+	__m256 right[4];
+	for (int row = 0; row < 4; row++)
+		right[row] = LoadRowPair(m, m, row);
+
+	for (; i + 2 <= count; i += 2)
+	{
+		for (int row = 0; row < 4; row++)
+			StoreRowPair(result[i], result[i + 1], row, TransformRowPair(LoadRowPair(matrices[i], matrices[i + 1], row), right));
+	}
+#endif
+
+	for (; i < count; i++)
+		result[i] = XMMatrixMultiply(matrices[i], m);
+}
+
+void EngineMath::TransformPoints(const XMFLOAT3* points, const XMMATRIX& m, XMFLOAT3* result, size_t count)
+{
+	size_t i = 0;
+
+#if defined(ENGINE_MATH_AVX2)
+	XMFLOAT4X4 f;
+	XMStoreFloat4x4(&f, m);
+
+	// Eight points at a time, pulled apart into x, y and z registers
+	const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+	for (; i + 8 <= count; i += 8)
+	{
+		const float* source = &points[i].x;
+		__m256 x = _mm256_i32gather_ps(source, stride, 4);
+		__m256 y = _mm256_i32gather_ps(source + 1, stride, 4);
+		__m256 z = _mm256_i32gather_ps(source + 2, stride, 4);
+
+		__m256 out[4];
+		for (int column = 0; column < 4; column++)
+		{
+			__m256 value = _mm256_set1_ps(f.m[3][column]);
+			value = MultiplyAdd(z, _mm256_set1_ps(f.m[2][column]), value);
+			value = MultiplyAdd(y, _mm256_set1_ps(f.m[1][column]), value);
+			out[column] = MultiplyAdd(x, _mm256_set1_ps(f.m[0][column]), value);
+		}
+
+		__m256 w = out[3];
+		float xs[8], ys[8], zs[8];
+		_mm256_storeu_ps(xs, _mm256_div_ps(out[0], w));
+		_mm256_storeu_ps(ys, _mm256_div_ps(out[1], w));
+		_mm256_storeu_ps(zs, _mm256_div_ps(out[2], w));
+
+		for (int j = 0; j < 8; j++)
+			result[i + j] = XMFLOAT3(xs[j], ys[j], zs[j]);
+	}
+#endif
+
+	for (; i < count; i++)
+		XMStoreFloat3(&result[i], XMVector3TransformCoord(XMLoadFloat3(&points[i]), m));
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+// The one place the engine gets its math from. On Windows that's DirectXMath, same as always. Everywhere else (or on
+// Windows with ENGINE_PORTABLE_MATH defined) it's PortableMath.h, which provides the same DirectX:: names with SSE,
+// NEON or scalar backends, so Transform, TransformSystem and Camera build on Linux too.
+#if defined(_WIN32) && !defined(ENGINE_PORTABLE_MATH)
+#include <DirectXMath.h>
+#include <DirectXColors.h>
+
+// Declare the XM_CALLCONV macro if we are using an old version of the DirectX Math library.
+// For more information about DirecX Math Library internals, see http://msdn.microsoft.com/en-us/library/windows/desktop/ee418728(v=vs.85).aspx
+#if (DIRECTXMATH_VERSION < 305) && !defined(XM_CALLCONV)
+#define XM_CALLCONV __fastcall
+typedef const DirectX::XMVECTOR& HXMVECTOR;
+typedef const DirectX::XMMATRIX& FXMMATRIX;
+#endif
+#else
+#include "PortableMath.h"
+#endif
+
+#include <stddef.h>
+
+// Batch versions of the hot matrix operations, for when there are a lot of them to do at once. With AVX2 enabled
+// (/arch:AVX2 or -mavx2) these work on two matrices or eight points per instruction; otherwise they loop over the
+// regular functions. The output may be the same array as an input.
+namespace EngineMath
+{
+	// result[i] = a[i] * b[i]
+	void MultiplyMatrices(const DirectX::XMMATRIX* a, const DirectX::XMMATRIX* b, DirectX::XMMATRIX* result, size_t count);
+
+	// result[i] = matrices[i] * m. For example, a batch of world matrices times the same view-projection matrix.
+	void MultiplyMatrices(const DirectX::XMMATRIX* matrices, const DirectX::XMMATRIX& m, DirectX::XMMATRIX* result, size_t count);
+
+	// result[i] = points[i] transformed by m, divided through by w (XMVector3TransformCoord)
+	void TransformPoints(const DirectX::XMFLOAT3* points, const DirectX::XMMATRIX& m, DirectX::XMFLOAT3* result, size_t count);
+}
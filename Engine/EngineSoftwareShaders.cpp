@@ -0,0 +1,88 @@
+#include "SoftwareShader.h"
+#include "BlitVertexShader.h"
+#include "BlitPixelShader.h"
+#include "SimpleVertexShader.h"
+#include "UnlitPixelShader.h"
+
+// C++ versions of the shaders in Engine/Data, for the software device. Each one does what the HLSL does, eight vertices
+// or pixels at a time.
+
+// ----------------------------------------------------------------------------------
+// BlitVertexShader.hlsl
+// ----------------------------------------------------------------------------------
+static void BlitVS(const SoftwareShaderResources&, SoftwareVertexBatch& batch)
+{
+	for (int c = 0; c < 3; c++)
+		SIMDFloat::Load(batch.inputs[0][c]).Store(batch.position[c]);
+	SIMDFloat(1.0f).Store(batch.position[3]);
+
+	// TexCoord
+	SIMDFloat::Load(batch.inputs[1][0]).Store(batch.varyings[0]);
+	SIMDFloat::Load(batch.inputs[1][1]).Store(batch.varyings[1]);
+}
+
+// ----------------------------------------------------------------------------------
+// BlitPixelShader.hlsl
+// ----------------------------------------------------------------------------------
+static void BlitPS(const SoftwareShaderResources& resources, SoftwarePixelBatch& batch)
+{
+	SIMDFloat texel[4];
+	SampleTexture(resources.textures[0], resources.samplers[0], SIMDFloat::Load(batch.varyings[0]), SIMDFloat::Load(batch.varyings[1]), texel);
+	for (int c = 0; c < 4; c++)
+		texel[c].Store(batch.color[c]);
+}
+
+// ----------------------------------------------------------------------------------
+// SimpleVertexShader.hlsl
+// ----------------------------------------------------------------------------------
+
+static void SimpleVS(const SoftwareShaderResources& resources, SoftwareVertexBatch& batch)
+{
+	// PerObject: WorldMatrix, InverseTransposeWorldMatrix, WorldViewProjectionMatrix
+	const float* perObject = (const float*)resources.constantBuffers[0];
+	const float* world = perObject;
+	const float* inverseTransposeWorld = perObject + 16;
+	const float* worldViewProjection = perObject + 32;
+
+	SIMDFloat px = SIMDFloat::Load(batch.inputs[0][0]), py = SIMDFloat::Load(batch.inputs[0][1]), pz = SIMDFloat::Load(batch.inputs[0][2]);
+	SIMDFloat nx = SIMDFloat::Load(batch.inputs[1][0]), ny = SIMDFloat::Load(batch.inputs[1][1]), nz = SIMDFloat::Load(batch.inputs[1][2]);
+
+	TransformVector(worldViewProjection, px, py, pz, true, 4, batch.position);
+
+	// PositionWS, then NormalWS through the upper 3x3 only
+	TransformVector(world, px, py, pz, true, 4, batch.varyings);
+	TransformVector(inverseTransposeWorld, nx, ny, nz, false, 3, batch.varyings + 4);
+
+	// TexCoord
+	SIMDFloat::Load(batch.inputs[2][0]).Store(batch.varyings[7]);
+	SIMDFloat::Load(batch.inputs[2][1]).Store(batch.varyings[8]);
+}
+
+const SoftwareVertexShader g_SoftwareSimpleVertexShader = { SimpleVS, { { "POSITION", 0 }, { "NORMAL", 0 }, { "TEXCOORD", 0 } }, 3, 9 };
+
+// ----------------------------------------------------------------------------------
+// UnlitPixelShader.hlsl (the engine's, which shows the normal)
+// ----------------------------------------------------------------------------------
+static void UnlitPS(const SoftwareShaderResources&, SoftwarePixelBatch& batch)
+{
+	for (int c = 0; c < 3; c++)
+		SIMDFloat::Load(batch.varyings[4 + c]).Store(batch.color[c]);
+	SIMDFloat(1.0f).Store(batch.color[3]);
+}
+
+// ----------------------------------------------------------------------------------
+// Registration
+// ----------------------------------------------------------------------------------
+void RegisterEngineSoftwareShaders()
+{
+	SoftwareVertexShader blitVS = { BlitVS, { { "POSITION", 0 }, { "TEXCOORD", 0 } }, 2, 2 };
+	RegisterSoftwareVertexShader(g_BlitVertexShader, sizeof(g_BlitVertexShader), blitVS);
+
+	SoftwarePixelShader blitPS = { BlitPS, 2 };
+	RegisterSoftwarePixelShader(g_BlitPixelShader, sizeof(g_BlitPixelShader), blitPS);
+
+	RegisterSoftwareVertexShader(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), g_SoftwareSimpleVertexShader);
+
+	SoftwarePixelShader unlitPS = { UnlitPS, 7 };
+	RegisterSoftwarePixelShader(g_UnlitPixelShader, sizeof(g_UnlitPixelShader), unlitPS);
+}
@@ -0,0 +1,165 @@
+#include "FrameAllocator.h"
+#include "AlignedAllocator.h"
+#include <stdint.h>
+
+// Overflow blocks are at least this big so a frame that runs out doesn't go to the heap for every allocation
+#define FRAME_OVERFLOW_BLOCK_SIZE (64 * 1024)
+
+// ----------------------------------------------------------------------------------
+// Singleton Stuff
+// ----------------------------------------------------------------------------------
+template<> FrameAllocator* Singleton<FrameAllocator>::msSingleton = 0;
+FrameAllocator& FrameAllocator::GetSingleton(void)
+{
+	assert(msSingleton);
+	return *msSingleton;
+}
+
+FrameAllocator* FrameAllocator::GetSingletonPtr(void)
+{
+	return msSingleton;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+FrameAllocator::FrameAllocator(size_t bytesPerFrame)
+	: m_current(0)
+	, m_frameIndex(0)
+	, m_highWater(0)
+{
+	for (Buffer& buffer : m_buffers)
+	{
+		buffer.memory = (char*)AlignedMalloc(bytesPerFrame, 64);
+		assert(buffer.memory && "Failed to allocate the frame buffers");
+		buffer.capacity = bytesPerFrame;
+		buffer.used = 0;
+		buffer.overflowUsed = 0;
+	}
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	for (Buffer& buffer : m_buffers)
+	{
+		for (void* block : buffer.overflow)
+			AlignedFree(block);
+
+		AlignedFree(buffer.memory);
+	}
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Private Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+void FrameAllocator::ResetBuffer(Buffer& buffer)
+{
+	if (!buffer.overflow.empty())
+	{
+		// The last frame that used this buffer didn't fit, so swap it for one that would have
+		for (void* block : buffer.overflow)
+			AlignedFree(block);
+		buffer.overflow.clear();
+
+		// A bit of slack on top of the high water mark for alignment padding
+		size_t needed = m_highWater + m_highWater / 8;
+		size_t capacity = buffer.capacity;
+		while (capacity < needed)
+			capacity *= 2;
+
+		AlignedFree(buffer.memory);
+		buffer.memory = (char*)AlignedMalloc(capacity, 64);
+		assert(buffer.memory && "Failed to grow a frame buffer");
+		buffer.capacity = capacity;
+	}
+
+	buffer.used = 0;
+	buffer.overflowUsed = 0;
+}
+
+void* FrameAllocator::AllocateOverflow(Buffer& buffer, size_t size, size_t alignment)
+{
+	// Each overflow allocation gets its own block unless it's small, in which case it shares the newest one. The
+	// first few bytes of every block remember how much of it has been used.
+	const size_t header = 64;
+	if (!buffer.overflow.empty() && size + alignment <= FRAME_OVERFLOW_BLOCK_SIZE - header)
+	{
+		// Blocks are only 64 byte aligned unless they were made for something bigger, so align the address rather
+		// than the offset
+		char* block = (char*)buffer.overflow.back();
+		size_t& blockUsed = *(size_t*)block;
+		uintptr_t address = ((uintptr_t)block + blockUsed + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		size_t offset = (size_t)(address - (uintptr_t)block);
+		if (offset + size <= FRAME_OVERFLOW_BLOCK_SIZE)
+		{
+			blockUsed = offset + size;
+			buffer.overflowUsed += size;
+			return block + offset;
+		}
+	}
+
+	size_t blockSize = size + header > FRAME_OVERFLOW_BLOCK_SIZE ? size + header : FRAME_OVERFLOW_BLOCK_SIZE;
+	char* block = (char*)AlignedMalloc(blockSize, alignment > header ? alignment : header);
+	assert(block && "Out of memory for frame allocations");
+	buffer.overflow.push_back(block);
+
+	size_t offset = alignment > header ? alignment : header;
+	*(size_t*)block = offset + size;
+	buffer.overflowUsed += size;
+
+	return block + offset;
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Public Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+void FrameAllocator::BeginFrame()
+{
+	size_t used = GetBytesUsed();
+	if (used > m_highWater)
+		m_highWater = used;
+
+	m_current ^= 1;
+	m_frameIndex++;
+
+	ResetBuffer(m_buffers[m_current]);
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+	Buffer& buffer = m_buffers[m_current];
+
+	size_t offset = (buffer.used + alignment - 1) & ~(alignment - 1);
+	if (offset + size <= buffer.capacity && alignment <= 64)
+	{
+		buffer.used = offset + size;
+		return buffer.memory + offset;
+	}
+
+	return AllocateOverflow(buffer, size, alignment);
+}
+
+size_t FrameAllocator::GetBytesUsed() const
+{
+	const Buffer& buffer = m_buffers[m_current];
+	return buffer.used + buffer.overflowUsed;
+}
+
+size_t FrameAllocator::GetCapacity() const
+{
+	return m_buffers[m_current].capacity;
+}
+
+size_t FrameAllocator::GetHighWater() const
+{
+	return m_highWater;
+}
+
+unsigned int FrameAllocator::GetFrameIndex() const
+{
+	return m_frameIndex;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "Singleton.h"
+#include <stddef.h>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// A bump allocator for data that only has to live for a frame or two: per-object constant data, draw lists, AI
+// snapshots, event lists and so on. Allocating is just moving a pointer forward, and nothing is ever freed on its own.
+// Instead GameEngine::Run calls BeginFrame at the start of every frame, which throws away everything allocated two
+// frames ago in one go.
+//
+// There are two buffers and they take turns, so anything allocated during a frame is still valid for the whole of the
+// next one. That's handy for handing results from one frame to the next (last frame's AI snapshot, for instance).
+//
+// If a frame needs more than the buffer holds, the extra goes into overflow blocks from the heap. The next time that
+// buffer comes around it gets replaced by one big enough for everything, so after a frame or two of warming up there are
+// no heap allocations at all.
+//
+// Not thread safe. Everything here is meant to be called from the main loop.
+class FrameAllocator : public Singleton<FrameAllocator>
+{
+private:
+	struct Buffer
+	{
+		char* memory;
+		size_t capacity;
+		size_t used;
+
+		// Blocks taken from the heap once memory ran out, and how many bytes went into them
+		std::vector<void*> overflow;
+		size_t overflowUsed;
+	};
+
+	Buffer m_buffers[2];
+	unsigned int m_current;
+	unsigned int m_frameIndex;
+
+	// The most memory a single frame has asked for
+	size_t m_highWater;
+
+	void ResetBuffer(Buffer& buffer);
+	void* AllocateOverflow(Buffer& buffer, size_t size, size_t alignment);
+
+public:
+	explicit FrameAllocator(size_t bytesPerFrame = 1024 * 1024);
+	~FrameAllocator();
+
+	// Swaps buffers and empties the one that's about to be used. Everything allocated before the previous call
+	// to BeginFrame is gone after this.
+	void BeginFrame();
+
+	// Never returns nullptr. alignment must be a power of two.
+	void* Allocate(size_t size, size_t alignment = 16);
+
+	// Room for count objects of type T, value initialized. Destructors are never run, so T has to be trivially
+	// destructible.
+	template <typename T>
+	T* AllocArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value, "Frame allocations are never destroyed");
+
+		T* items = static_cast<T*>(Allocate(count * sizeof(T), alignof(T) > 16 ? alignof(T) : 16));
+		for (size_t i = 0; i < count; i++)
+			new(&items[i]) T();
+
+		return items;
+	}
+
+	// Bytes handed out so far this frame, including any overflow
+	size_t GetBytesUsed() const;
+	size_t GetCapacity() const;
+	size_t GetHighWater() const;
+	unsigned int GetFrameIndex() const;
+
+	static FrameAllocator& GetSingleton(void);
+	static FrameAllocator* GetSingletonPtr(void);
+};
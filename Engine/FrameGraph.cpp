@@ -0,0 +1,436 @@
+#include "FrameGraph.h"
+#include "AllocationTracker.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+// Marks a resource no pass that runs uses
+#define UNUSED_RESOURCE 0xFFFFFFFF
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+FrameGraph::FrameGraph()
+	: m_device(nullptr)
+	, m_compiled(false)
+	, m_frame(0)
+{
+	memset(&m_stats, 0, sizeof(m_stats));
+	memset(&m_lastFrameStats, 0, sizeof(m_lastFrameStats));
+	memset(&m_totalStats, 0, sizeof(m_totalStats));
+}
+
+FrameGraph::~FrameGraph()
+{
+	for (PooledTexture& pooled : m_pool)
+		m_device->Release(pooled.texture);
+}
+
+void FrameGraph::Reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_reads.clear();
+	m_order.clear();
+	m_compiled = false;
+
+	m_frame++;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+FGHANDLE FrameGraph::CreateTexture(const char* name, const FrameGraphTextureDesc& desc)
+{
+	assert(!m_compiled && "Textures have to be declared before the graph's compiled");
+	assert(desc.format != GPU_FORMAT::UNKNOWN);
+
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.texture = 0;
+	resource.imported = false;
+	resource.output = false;
+	resource.firstUse = resource.lastUse = UNUSED_RESOURCE;
+
+	m_resources.push_back(resource);
+	return (FGHANDLE)m_resources.size() - 1;
+}
+
+FGHANDLE FrameGraph::ImportTexture(const char* name, GPUHANDLE texture)
+{
+	assert(!m_compiled && "Textures have to be declared before the graph's compiled");
+	assert(texture != 0);
+
+	Resource resource;
+	resource.name = name;
+	resource.texture = texture;
+	resource.imported = true;
+	resource.output = false;
+	resource.firstUse = resource.lastUse = UNUSED_RESOURCE;
+
+	m_resources.push_back(resource);
+	return (FGHANDLE)m_resources.size() - 1;
+}
+
+void FrameGraph::MarkOutput(FGHANDLE resource)
+{
+	assert(resource < m_resources.size());
+	m_resources[resource].output = true;
+}
+
+unsigned int FrameGraph::AddPass(const char* name, FrameGraphPassFunction function, void* data)
+{
+	assert(!m_compiled && "Passes have to be added before the graph's compiled");
+	assert(function);
+
+	Pass pass;
+	memset(&pass, 0, sizeof(pass));
+	pass.name = name;
+	pass.function = function;
+	pass.data = data;
+	pass.color = INVALID_FGHANDLE;
+	pass.depth = INVALID_FGHANDLE;
+
+	m_passes.push_back(pass);
+	return (unsigned int)m_passes.size() - 1;
+}
+
+void FrameGraph::SetRenderTarget(unsigned int pass, FGHANDLE color, FGHANDLE depth)
+{
+	assert(pass < m_passes.size());
+	assert(color == INVALID_FGHANDLE || color < m_resources.size());
+	assert(depth == INVALID_FGHANDLE || depth < m_resources.size());
+
+	m_passes[pass].color = color;
+	m_passes[pass].depth = depth;
+}
+
+void FrameGraph::ClearColor(unsigned int pass, const float color[4])
+{
+	assert(pass < m_passes.size());
+
+	m_passes[pass].clearColor = true;
+	memcpy(m_passes[pass].clearColorValue, color, sizeof(m_passes[pass].clearColorValue));
+}
+
+void FrameGraph::ClearDepthStencil(unsigned int pass, unsigned int clearFlags, float depth, unsigned char stencil)
+{
+	assert(pass < m_passes.size());
+
+	m_passes[pass].clearDepthFlags = clearFlags;
+	m_passes[pass].clearDepth = depth;
+	m_passes[pass].clearStencil = stencil;
+}
+
+void FrameGraph::ReadTexture(unsigned int pass, FGHANDLE texture, unsigned int slot)
+{
+	assert(pass < m_passes.size());
+	assert(texture < m_resources.size());
+
+	Read read;
+	read.pass = pass;
+	read.resource = texture;
+	read.slot = slot;
+	m_reads.push_back(read);
+}
+
+bool FrameGraph::ClearsAll(const Pass& pass, FGHANDLE resource) const
+{
+	if (resource == pass.color)
+		return pass.clearColor;
+
+	// There's no telling whether an imported one has a stencil, so it has to be cleared too
+	const Resource& depth = m_resources[resource];
+	bool hasStencil = depth.imported || HasStencil(depth.desc.format);
+	return (pass.clearDepthFlags & CLEAR_DEPTH) && (!hasStencil || (pass.clearDepthFlags & CLEAR_STENCIL));
+}
+
+void FrameGraph::Cull()
+{
+	// Working back from the outputs, a resource is needed if something further on reads what's in it now
+	std::vector<unsigned char>& needed = m_needed;
+	needed.resize(m_resources.size());
+	for (size_t i = 0; i < m_resources.size(); i++)
+		needed[i] = m_resources[i].output;
+
+	for (size_t i = m_passes.size(); i-- > 0;)
+	{
+		Pass& pass = m_passes[i];
+		bool hasTargets = pass.color != INVALID_FGHANDLE || pass.depth != INVALID_FGHANDLE;
+		bool colorNeeded = pass.color != INVALID_FGHANDLE && needed[pass.color];
+		bool depthNeeded = pass.depth != INVALID_FGHANDLE && needed[pass.depth];
+
+		pass.culled = hasTargets && !colorNeeded && !depthNeeded;
+		if (pass.culled)
+		{
+			m_stats.culledPasses++;
+			continue;
+		}
+
+		// Anything this pass clears, nobody needs from before it. Anything it draws over, they do.
+		if (pass.color != INVALID_FGHANDLE)
+			needed[pass.color] = !ClearsAll(pass, pass.color);
+		if (pass.depth != INVALID_FGHANDLE)
+			needed[pass.depth] = !ClearsAll(pass, pass.depth);
+
+		for (const Read& read : m_reads)
+		{
+			if (read.pass == i)
+				needed[read.resource] = 1;
+		}
+	}
+}
+
+TextureDesc FrameGraph::GetTextureDesc(const FrameGraphTextureDesc& desc) const
+{
+	TextureDesc textureDesc;
+	textureDesc.width = desc.width ? desc.width : m_device->GetBackBufferWidth();
+	textureDesc.height = desc.height ? desc.height : m_device->GetBackBufferHeight();
+	textureDesc.format = desc.format;
+	textureDesc.bindFlags = BIND_SHADER_RESOURCE | (IsDepthFormat(desc.format) ? BIND_DEPTH_STENCIL : BIND_RENDER_TARGET);
+	return textureDesc;
+}
+
+void FrameGraph::AllocateTextures()
+{
+	// Handed out in the order they're first used, so one that's finished with can go to the next one that starts
+	std::vector<unsigned int>& transients = m_transients;
+	transients.clear();
+	for (unsigned int i = 0; i < (unsigned int)m_resources.size(); i++)
+	{
+		if (!m_resources[i].imported && m_resources[i].firstUse != UNUSED_RESOURCE)
+			transients.push_back(i);
+	}
+
+	std::sort(transients.begin(), transients.end(), [this](unsigned int a, unsigned int b)
+	{
+		return m_resources[a].firstUse < m_resources[b].firstUse ||
+			(m_resources[a].firstUse == m_resources[b].firstUse && a < b);
+	});
+
+	for (unsigned int index : transients)
+	{
+		Resource& resource = m_resources[index];
+		TextureDesc desc = GetTextureDesc(resource.desc);
+		unsigned long long bytes = (unsigned long long)desc.width * desc.height * GetFormatSize(desc.format);
+
+		PooledTexture* found = nullptr;
+		for (PooledTexture& pooled : m_pool)
+		{
+			bool free = pooled.lastFrame != m_frame || pooled.freeAfter < resource.firstUse;
+			if (free && pooled.desc.width == desc.width && pooled.desc.height == desc.height &&
+				pooled.desc.format == desc.format && pooled.desc.bindFlags == desc.bindFlags)
+			{
+				found = &pooled;
+				break;
+			}
+		}
+
+		if (!found)
+		{
+			PooledTexture pooled;
+			pooled.desc = desc;
+			pooled.texture = m_device->CreateTexture(desc);
+			pooled.lastFrame = m_frame - 1;
+			pooled.freeAfter = 0;
+
+			// The device has already said what went wrong, and the passes using it just don't draw anything
+			if (!pooled.texture)
+				continue;
+
+			m_pool.push_back(pooled);
+			found = &m_pool.back();
+			m_stats.texturesCreated++;
+		}
+
+		if (found->lastFrame != m_frame)
+		{
+			m_stats.pooledTextures++;
+			m_stats.pooledBytes += bytes;
+		}
+
+		found->lastFrame = m_frame;
+		found->freeAfter = resource.lastUse;
+		resource.texture = found->texture;
+
+		m_stats.transientTextures++;
+		m_stats.transientBytes += bytes;
+	}
+
+	// Anything that's sat unused for a while probably isn't coming back, like textures the size of the old back buffer
+	for (size_t i = 0; i < m_pool.size();)
+	{
+		if (m_frame - m_pool[i].lastFrame > FRAME_GRAPH_POOL_FRAMES)
+		{
+			m_device->Release(m_pool[i].texture);
+			m_pool[i] = m_pool.back();
+			m_pool.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void FrameGraph::Compile(RenderDevice* device)
+{
+	assert(!m_compiled && "Already compiled");
+	assert(device && (!m_device || m_device == device));
+	m_device = device;
+
+	m_stats.passes = (unsigned int)m_passes.size();
+	Cull();
+
+	for (unsigned int i = 0; i < (unsigned int)m_passes.size(); i++)
+	{
+		if (!m_passes[i].culled)
+			m_order.push_back(i);
+	}
+
+	// Work out where each resource is first and last used among the passes that are left
+	for (unsigned int position = 0; position < (unsigned int)m_order.size(); position++)
+	{
+		unsigned int passIndex = m_order[position];
+		const Pass& pass = m_passes[passIndex];
+
+		FGHANDLE used[2] = { pass.color, pass.depth };
+		for (FGHANDLE handle : used)
+		{
+			if (handle == INVALID_FGHANDLE)
+				continue;
+
+			Resource& resource = m_resources[handle];
+			if (resource.firstUse == UNUSED_RESOURCE)
+				resource.firstUse = position;
+			resource.lastUse = position;
+		}
+
+		for (const Read& read : m_reads)
+		{
+			if (read.pass != passIndex)
+				continue;
+
+			Resource& resource = m_resources[read.resource];
+			if (resource.firstUse == UNUSED_RESOURCE)
+				resource.firstUse = position;
+			resource.lastUse = position;
+		}
+
+		if (pass.clearColor && pass.color != INVALID_FGHANDLE)
+			m_stats.clears++;
+		if (pass.clearDepthFlags && pass.depth != INVALID_FGHANDLE)
+			m_stats.clears++;
+	}
+
+	AllocateTextures();
+	m_compiled = true;
+}
+
+void FrameGraph::RunPass(RenderManager& renderManager, unsigned int passIndex) const
+{
+	const Pass& pass = m_passes[passIndex];
+	GPUHANDLE color = pass.color != INVALID_FGHANDLE ? m_resources[pass.color].texture : 0;
+	GPUHANDLE depth = pass.depth != INVALID_FGHANDLE ? m_resources[pass.depth].texture : 0;
+
+	if (color || depth)
+		renderManager.SetRenderTarget(color, depth);
+	if (pass.clearColor && color)
+		renderManager.ClearRenderTarget(color, pass.clearColorValue);
+	if (pass.clearDepthFlags && depth)
+		renderManager.ClearDepthStencil(depth, pass.clearDepthFlags, pass.clearDepth, pass.clearStencil);
+
+	for (const Read& read : m_reads)
+	{
+		if (read.pass == passIndex)
+			renderManager.SetPSTexture(read.slot, m_resources[read.resource].texture);
+	}
+
+	pass.function(pass.data, *this);
+
+	// So the next pass can draw into them
+	for (const Read& read : m_reads)
+	{
+		if (read.pass == passIndex)
+			renderManager.SetPSTexture(read.slot, 0);
+	}
+}
+
+void FrameGraph::RecordPass(void* data, unsigned int index)
+{
+	FrameGraph* graph = (FrameGraph*)data;
+	RenderManager& renderManager = RenderManager::GetSingleton();
+
+	AllocationScope allocScope(ALLOC_TAG::RENDER);
+	renderManager.BeginRecording(*graph->m_commandLists[index]);
+	graph->RunPass(renderManager, graph->m_order[index]);
+	renderManager.EndRecording();
+}
+
+void FrameGraph::Execute(RenderManager& renderManager, bool record)
+{
+	if (!m_compiled)
+		Compile(renderManager.GetDevice());
+
+	if (record)
+	{
+		while (m_commandLists.size() < m_order.size())
+			m_commandLists.push_back(m_device->CreateCommandList());
+
+		JobSystem::GetSingleton().ParallelFor((unsigned int)m_order.size(), RecordPass, this);
+
+		for (size_t i = 0; i < m_order.size(); i++)
+			renderManager.ExecuteCommandList(*m_commandLists[i]);
+	}
+	else
+	{
+		for (unsigned int pass : m_order)
+			RunPass(renderManager, pass);
+	}
+
+	m_lastFrameStats = m_stats;
+	m_totalStats.passes += m_stats.passes;
+	m_totalStats.culledPasses += m_stats.culledPasses;
+	m_totalStats.transientTextures += m_stats.transientTextures;
+	m_totalStats.pooledTextures += m_stats.pooledTextures;
+	m_totalStats.texturesCreated += m_stats.texturesCreated;
+	m_totalStats.clears += m_stats.clears;
+	m_totalStats.transientBytes += m_stats.transientBytes;
+	m_totalStats.pooledBytes += m_stats.pooledBytes;
+}
+
+GPUHANDLE FrameGraph::GetTexture(FGHANDLE resource) const
+{
+	assert(m_compiled && "Textures are only known once the graph's compiled");
+	assert(resource < m_resources.size());
+
+	return m_resources[resource].texture;
+}
+
+bool FrameGraph::IsCulled(unsigned int pass) const
+{
+	assert(m_compiled && pass < m_passes.size());
+	return m_passes[pass].culled;
+}
+
+unsigned int FrameGraph::GetPassCount() const
+{
+	return (unsigned int)m_passes.size();
+}
+
+const char* FrameGraph::GetPassName(unsigned int pass) const
+{
+	assert(pass < m_passes.size());
+	return m_passes[pass].name;
+}
+
+const FrameGraphStats& FrameGraph::GetStats() const
+{
+	return m_lastFrameStats;
+}
+
+const FrameGraphStats& FrameGraph::GetTotalStats() const
+{
+	return m_totalStats;
+}
@@ -0,0 +1,199 @@
+#pragma once
+#include "RenderManager.h"
+#include <memory>
+#include <vector>
+
+// Resources are indices into the frame's list, good until the next Reset
+typedef unsigned int FGHANDLE;
+#define INVALID_FGHANDLE 0xFFFFFFFF
+
+// How many frames a pooled texture can go unused before it's released
+#define FRAME_GRAPH_POOL_FRAMES 8
+
+// A texture for the graph to find somewhere for. 0 for the width or height means the back buffer's. Depth formats
+// make a depth stencil buffer and anything else a render target, and either can be read by shaders.
+struct FrameGraphTextureDesc
+{
+	unsigned int width;
+	unsigned int height;
+	GPU_FORMAT format;
+
+	FrameGraphTextureDesc()
+		: width(0)
+		, height(0)
+		, format(GPU_FORMAT::UNKNOWN)
+	{}
+
+	explicit FrameGraphTextureDesc(GPU_FORMAT format, unsigned int width = 0, unsigned int height = 0)
+		: width(width)
+		, height(height)
+		, format(format)
+	{}
+};
+
+// What the graph did over a frame
+struct FrameGraphStats
+{
+	unsigned int passes;
+	unsigned int culledPasses;
+	unsigned int transientTextures;		// Ones a pass that ran used
+	unsigned int pooledTextures;		// Textures those went into
+	unsigned int texturesCreated;
+	unsigned int clears;
+	unsigned long long transientBytes;	// What the transient textures would take up with a texture each
+	unsigned long long pooledBytes;		// What they really took up
+};
+
+class FrameGraph;
+
+// Draws a pass. Its targets are bound, cleared if it asked for that, and the textures it reads are in their slots.
+typedef void(*FrameGraphPassFunction)(void* data, const FrameGraph& graph);
+
+// A frame's passes, declared up front along with the textures each one draws into and reads, and then drawn in one go.
+// Every frame goes Reset, then textures and passes, then Execute.
+//
+// Passes run in the order they were added, which is always one that works since a pass can only use what was declared
+// before it. What the graph adds is knowing who uses what:
+// - Passes nothing needs are culled. A pass is needed if it draws into something marked as an output, or into
+//   something a needed pass reads, or if it has no targets at all. A pass that clears a target all the way means
+//   whatever was drawn into it before doesn't count.
+// - Clears belong to the pass that asked for them, so they happen right before it and not at all if it's culled.
+// - Transient textures (the ones from CreateTexture) only exist from the first pass that uses them to the last, and
+//   come from a pool that's kept between frames. Two with the same size and format that aren't alive at the same time
+//   share a texture. D3D11 can't put different textures in the same memory, so that's as far as aliasing goes.
+//
+// A transient texture starts out with whatever the last one in its texture left there, so the first pass to use it
+// should clear it (or draw over all of it).
+//
+// Main thread only. When passes are recorded, their functions run on the job system's threads, so they can only draw,
+// the same as anything else that records.
+class FrameGraph
+{
+private:
+	struct Resource
+	{
+		const char* name;
+		FrameGraphTextureDesc desc;
+		GPUHANDLE texture;
+		bool imported;
+		bool output;
+
+		// Positions in m_order, so only set once it's compiled
+		unsigned int firstUse;
+		unsigned int lastUse;
+	};
+
+	struct Pass
+	{
+		const char* name;
+		FrameGraphPassFunction function;
+		void* data;
+
+		FGHANDLE color;
+		FGHANDLE depth;
+
+		bool clearColor;
+		float clearColorValue[4];
+		unsigned int clearDepthFlags;
+		float clearDepth;
+		unsigned char clearStencil;
+
+		bool culled;
+	};
+
+	struct Read
+	{
+		unsigned int pass;
+		FGHANDLE resource;
+		unsigned int slot;
+	};
+
+	struct PooledTexture
+	{
+		TextureDesc desc;
+		GPUHANDLE texture;
+		unsigned int lastFrame;		// The last frame anything was in it
+		unsigned int freeAfter;		// The last position its current resource is used at, this frame
+	};
+
+	RenderDevice* m_device;
+
+	std::vector<Resource> m_resources;
+	std::vector<Pass> m_passes;
+	std::vector<Read> m_reads;
+	bool m_compiled;
+
+	// The passes that weren't culled
+	std::vector<unsigned int> m_order;
+
+	std::vector<PooledTexture> m_pool;
+	unsigned int m_frame;
+
+	// Scratch for Cull and AllocateTextures, kept so compiling doesn't allocate once they've grown to fit
+	std::vector<unsigned char> m_needed;
+	std::vector<unsigned int> m_transients;
+
+	// A command list per pass that runs, for recording them all at once
+	std::vector<std::unique_ptr<RenderCommandList>> m_commandLists;
+
+	FrameGraphStats m_stats;
+	FrameGraphStats m_lastFrameStats;
+	FrameGraphStats m_totalStats;
+
+	bool ClearsAll(const Pass& pass, FGHANDLE resource) const;
+	void Cull();
+	void AllocateTextures();
+	TextureDesc GetTextureDesc(const FrameGraphTextureDesc& desc) const;
+
+	void RunPass(RenderManager& renderManager, unsigned int pass) const;
+	static void RecordPass(void* data, unsigned int index);
+
+public:
+	FrameGraph();
+	~FrameGraph();
+
+	// Forgets last frame's passes and textures, but keeps the pooled textures for this one
+	void Reset();
+
+	// A texture that only this frame's passes use, which the graph finds a texture for
+	FGHANDLE CreateTexture(const char* name, const FrameGraphTextureDesc& desc);
+
+	// A texture that lives outside the graph, like the back buffer
+	FGHANDLE ImportTexture(const char* name, GPUHANDLE texture);
+
+	// Keeps the passes that draw into the resource from being culled
+	void MarkOutput(FGHANDLE resource);
+
+	// Passes are identified by the index this returns. name has to outlive the frame (a literal is fine).
+	unsigned int AddPass(const char* name, FrameGraphPassFunction function, void* data);
+
+	// Bound before the pass runs. Either can be INVALID_FGHANDLE.
+	void SetRenderTarget(unsigned int pass, FGHANDLE color, FGHANDLE depth = INVALID_FGHANDLE);
+	void ClearColor(unsigned int pass, const float color[4]);
+	void ClearDepthStencil(unsigned int pass, unsigned int clearFlags, float depth = 1.0f, unsigned char stencil = 0);
+
+	// Bound to the pixel shader slot before the pass runs, and unbound after
+	void ReadTexture(unsigned int pass, FGHANDLE texture, unsigned int slot);
+
+	// Culls, orders and finds textures for everything. Execute does this if it hasn't been done yet.
+	void Compile(RenderDevice* device);
+
+	// Draws every pass that wasn't culled. Recorded, each pass goes into its own command list on whichever thread the
+	// job system gives it to, and then they're all executed in order on this one. Otherwise they're drawn here.
+	void Execute(RenderManager& renderManager, bool record = false);
+
+	// Only once it's compiled
+	GPUHANDLE GetTexture(FGHANDLE resource) const;
+	bool IsCulled(unsigned int pass) const;
+
+	unsigned int GetPassCount() const;
+	const char* GetPassName(unsigned int pass) const;
+
+	// GetStats reports the last frame executed and GetTotalStats every frame up to and including it
+	const FrameGraphStats& GetStats() const;
+	const FrameGraphStats& GetTotalStats() const;
+
+private:
+	FrameGraph(const FrameGraph&);
+	FrameGraph& operator=(const FrameGraph&);
+};
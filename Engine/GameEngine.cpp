@@ -1,4 +1,11 @@
 #include "GameEngine.h"
+#include "NullRenderDevice.h"
+#include "SoftwareRenderDevice.h"
+
+#if defined(_WIN32)
+#include "WindowsManager.h"
+#include "D3D11RenderDevice.h"
+#endif
 
 // ----------------------------------------------------------------------------------
 // Singleton Stuff
@@ -23,19 +30,56 @@ GameEngine* GameEngine::GetSingletonPtr(void)
 // each system is created and destroyed. When used correctly, the user should be able to
 // simply initialize a single GameEngine instance at the start of their game and delete
 // that object when execution is complete.
-GameEngine::GameEngine(int windowWidth, int windowHeight, bool vSync, bool windowed)
+GameEngine::GameEngine(int windowWidth, int windowHeight, bool vSync, bool windowed, RENDER_BACKEND renderBackend)
+	: m_windowsManager(nullptr)
+	, m_renderBackend(renderBackend)
 {
-	m_windowsManager = new WindowsManager(windowWidth, windowHeight, vSync, windowed);
+	// First in and last out, since anything might hand it work
+	m_jobSystem = new JobSystem();
+
+	RenderDevice* renderDevice;
+	if (m_renderBackend == RENDER_BACKEND::HEADLESS)
+	{
+		// No window, so nothing to present to
+		renderDevice = new NullRenderDevice(windowWidth, windowHeight);
+	}
+	else if (m_renderBackend == RENDER_BACKEND::SOFTWARE)
+	{
+		// No window here either. The frames are only ever read back.
+		renderDevice = new SoftwareRenderDevice(windowWidth, windowHeight);
+	}
+	else
+	{
+#if defined(_WIN32)
+		m_windowsManager = new WindowsManager(windowWidth, windowHeight, vSync, windowed);
+		renderDevice = new D3D11RenderDevice(m_windowsManager->GetWindowHandle(), m_windowsManager->GetClientWidth(),
+			m_windowsManager->GetClientHeight(), vSync, windowed);
+#else
+		// There's no D3D11 (or window) to be had here. Only the headless backends are any use.
+		assert(!"The D3D11 backend needs Windows");
+		(void)vSync;
+		(void)windowed;
+		renderDevice = new NullRenderDevice(windowWidth, windowHeight);
+#endif
+	}
+
 	m_inputManager = new InputManager();
-	m_renderManager = new RenderManager();
+	m_renderManager = new RenderManager(renderDevice);
+	m_transformSystem = new TransformSystem();
+	m_frameAllocator = new FrameAllocator();
 }
 
 
 GameEngine::~GameEngine()
 {
+	delete m_frameAllocator;
+	delete m_transformSystem;
 	delete m_renderManager;
 	delete m_inputManager;
+#if defined(_WIN32)
 	delete m_windowsManager;
+#endif
+	delete m_jobSystem;
 }
 
 // ToDo: Build a GameTimer class and change the callback to accept the elapsed time
@@ -43,14 +87,18 @@ bool GameEngine::Run(bool(*UpdateGame)(double dt))
 {
 	assert(UpdateGame);
 
+#if defined(_WIN32)
 	MSG msg;
-	bool result = true;
 	ZeroMemory(&msg, sizeof(MSG));
+#endif
+	bool result = true;
 
 	// Loop until we are explicitly told to stop from within the loop
 	while (true)
 	{
-		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+#if defined(_WIN32)
+		// There's no window to get messages for when running headless
+		if (m_windowsManager && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 		{
 			TranslateMessage(&msg);
 			DispatchMessage(&msg);
@@ -60,6 +108,13 @@ bool GameEngine::Run(bool(*UpdateGame)(double dt))
 		{
 			break;
 		}
+#endif
+
+		// Anything allocated from the frame allocator two frames ago is done with now, and the heap allocation, render
+		// device and constant ring counts roll over to a new frame
+		m_frameAllocator->BeginFrame();
+		AllocationTracker::BeginFrame();
+		m_renderManager->BeginFrame();
 
 		// Call the main gameloop function
 		if (!UpdateGame(m_gameTimer.Update()))
@@ -1,9 +1,26 @@
 #pragma once
 #include "Singleton.h"
 #include "InputManager.h"
-#include "WindowsManager.h"
 #include "RenderManager.h"
+#include "TransformSystem.h"
+#include "FrameAllocator.h"
+#include "AllocationTracker.h"
 #include "GameTimer.h"
+#include "JobSystem.h"
+
+// Only GameEngine.cpp needs the window itself, and only on Windows. Keeping windows.h out of here lets the headless
+// backends build everywhere else.
+class WindowsManager;
+
+// Which RenderDevice the RenderManager is given. HEADLESS doesn't open a window at all and renders with a
+// NullRenderDevice, which checks every call instead of drawing. SOFTWARE doesn't open a window either, but really draws
+// every frame with a SoftwareRenderDevice, on the CPU.
+enum class RENDER_BACKEND
+{
+	D3D11,
+	HEADLESS,
+	SOFTWARE
+};
 
 class GameEngine : public Singleton<GameEngine>
 {
@@ -11,11 +28,15 @@ private:
 	WindowsManager* m_windowsManager;
 	InputManager*	m_inputManager;
 	RenderManager*	m_renderManager;
+	TransformSystem* m_transformSystem;
+	FrameAllocator* m_frameAllocator;
+	JobSystem*		m_jobSystem;
 
 	GameTimer		m_gameTimer;
+	RENDER_BACKEND	m_renderBackend;
 
 public:
-	GameEngine(int windowWidth, int windowHeight, bool vSync, bool windowed);
+	GameEngine(int windowWidth, int windowHeight, bool vSync, bool windowed, RENDER_BACKEND renderBackend = RENDER_BACKEND::D3D11);
 	~GameEngine();
 
 	bool Run(bool(*UpdateGame)(double dt));
@@ -1,18 +1,39 @@
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
 #include "GameTimer.h"
 
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <chrono>
+#endif
 
-
-GameTimer::GameTimer()
+// The performance counter on Windows, and the steady clock (in nanoseconds) anywhere else
+int64_t GameTimer::ReadCounter()
 {
+#if defined(_WIN32)
 	LARGE_INTEGER li;
-
 	QueryPerformanceCounter(&li);
-	m_prevTime = m_startTime = li.QuadPart;
+	return li.QuadPart;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
 
+int64_t GameTimer::ReadFrequency()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER li;
 	QueryPerformanceFrequency(&li);
-	m_frequency = li.QuadPart;
+	return li.QuadPart;
+#else
+	return 1000000000;
+#endif
+}
+
+GameTimer::GameTimer()
+{
+	m_prevTime = m_startTime = ReadCounter();
+	m_frequency = ReadFrequency();
 
 	m_deltaTime = 0.0;
 }
@@ -24,10 +45,7 @@ GameTimer::~GameTimer()
 
 double GameTimer::Update()
 {
-	LARGE_INTEGER li;
-
-	QueryPerformanceCounter(&li);
-	__int64 curTime = li.QuadPart;
+	int64_t curTime = ReadCounter();
 	m_deltaTime = static_cast<double>(curTime - m_prevTime) / static_cast<double>(m_frequency);
 	m_prevTime = curTime;
 
@@ -1,10 +1,12 @@
 #pragma once
+#include <stdint.h>
+
 class GameTimer
 {
 private:
-	_int64 m_startTime;
-	_int64 m_prevTime;
-	_int64 m_frequency;
+	int64_t m_startTime;
+	int64_t m_prevTime;
+	int64_t m_frequency;
 	double m_deltaTime;
 
 public:
@@ -13,5 +15,9 @@ public:
 
 	double Update();
 	double GetDeltaTime();
+
+	// Raw ticks, for anything that wants to time itself. There are ReadFrequency() of them a second.
+	static int64_t ReadCounter();
+	static int64_t ReadFrequency();
 };
 
@@ -0,0 +1,168 @@
+#include "JobSystem.h"
+
+// Set on worker threads, and on any thread while it runs a ParallelFor, so a nested ParallelFor knows to run inline
+static thread_local bool t_insideJob = false;
+
+// ----------------------------------------------------------------------------------
+// Singleton Stuff
+// ----------------------------------------------------------------------------------
+template<> JobSystem* Singleton<JobSystem>::msSingleton = 0;
+JobSystem& JobSystem::GetSingleton(void)
+{
+	assert(msSingleton);
+	return *msSingleton;
+}
+
+JobSystem* JobSystem::GetSingletonPtr(void)
+{
+	return msSingleton;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+JobSystem::JobSystem(unsigned int workerCount)
+	: m_function(nullptr)
+	, m_data(nullptr)
+	, m_count(0)
+	, m_batch(0)
+	, m_quit(false)
+	, m_nextIndex(0)
+	, m_remaining(0)
+	, m_activeWorkers(0)
+	, m_busy(false)
+{
+	if (workerCount == JOB_SYSTEM_AUTO_WORKERS)
+	{
+		// The main thread does its share, so one less than there are hardware threads. hardware_concurrency is
+		// allowed to return 0 if it doesn't know.
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	m_workers.reserve(workerCount);
+	for (unsigned int i = 0; i < workerCount; i++)
+		m_workers.push_back(std::thread(&JobSystem::WorkerMain, this));
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_quit = true;
+	}
+	m_wakeWorkers.notify_all();
+
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Private Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+void JobSystem::WorkerMain()
+{
+	t_insideJob = true;
+	unsigned int lastBatch = 0;
+
+	while (true)
+	{
+		JobFunction function;
+		void* data;
+		unsigned int count;
+		{
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_wakeWorkers.wait(lock, [&] { return m_quit || m_batch != lastBatch; });
+			if (m_quit)
+				return;
+
+			// Woke up too late, the others already finished it. Signing in now would keep this worker running the old
+			// function against the counters of whatever batch comes next.
+			lastBatch = m_batch;
+			if (m_remaining.load(std::memory_order_acquire) == 0)
+				continue;
+
+			function = m_function;
+			data = m_data;
+			count = m_count;
+			m_activeWorkers++;
+		}
+
+		RunJobs(function, data, count);
+
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_activeWorkers--;
+		}
+		m_batchDone.notify_all();
+	}
+}
+
+void JobSystem::RunJobs(JobFunction function, void* data, unsigned int count)
+{
+	while (true)
+	{
+		unsigned int index = m_nextIndex.fetch_add(1, std::memory_order_relaxed);
+		if (index >= count)
+			return;
+
+		function(data, index);
+
+		// Whoever finishes the last one wakes up the thread waiting in ParallelFor
+		if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_batchDone.notify_all();
+		}
+	}
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Public Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+void JobSystem::ParallelFor(unsigned int count, JobFunction function, void* data)
+{
+	assert(function);
+	if (count == 0)
+		return;
+
+	// Nothing to share with, or already inside a loop (ours or someone else's). Either way it's quicker to just do it.
+	bool expected = false;
+	if (m_workers.empty() || count == 1 || t_insideJob || !m_busy.compare_exchange_strong(expected, true))
+	{
+		for (unsigned int i = 0; i < count; i++)
+			function(data, i);
+		return;
+	}
+
+	t_insideJob = true;
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		m_function = function;
+		m_data = data;
+		m_count = count;
+		m_nextIndex.store(0, std::memory_order_relaxed);
+		m_remaining.store(count, std::memory_order_relaxed);
+		m_batch++;
+	}
+	m_wakeWorkers.notify_all();
+
+	RunJobs(function, data, count);
+
+	// Every index being done isn't quite enough: a worker that woke up late could still be about to read m_nextIndex,
+	// and it mustn't see the next batch's counters before it has signed in to it. So wait for the workers to leave too.
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_batchDone.wait(lock, [&] { return m_remaining.load(std::memory_order_acquire) == 0 && m_activeWorkers == 0; });
+	}
+
+	t_insideJob = false;
+	m_busy.store(false, std::memory_order_release);
+}
+
+unsigned int JobSystem::GetWorkerCount() const
+{
+	return (unsigned int)m_workers.size();
+}
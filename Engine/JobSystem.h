@@ -0,0 +1,60 @@
+#pragma once
+#include "Singleton.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A job is a plain function run once for every index of a ParallelFor, with whatever data the caller handed in
+typedef void(*JobFunction)(void* data, unsigned int index);
+
+// Pick a worker count from the number of hardware threads
+#define JOB_SYSTEM_AUTO_WORKERS 0xFFFFFFFF
+
+// A fixed pool of worker threads for splitting a loop over every core. There is no queue of jobs: the only thing it can
+// do is ParallelFor, which hands indices out to the workers and the calling thread until they run out, then returns
+// once all of them are done. That's all the software renderer needs, and it means a call doesn't allocate anything.
+//
+// One ParallelFor runs at a time. A ParallelFor called from inside a job (or while another thread's ParallelFor is
+// running) just runs its loop on the calling thread, so nesting them is safe, only not any faster.
+class JobSystem : public Singleton<JobSystem>
+{
+private:
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_lock;
+	std::condition_variable m_wakeWorkers;
+	std::condition_variable m_batchDone;
+
+	// The loop currently being handed out. m_batch counts up every time there's a new one, so a worker can tell it
+	// hasn't already seen it.
+	JobFunction m_function;
+	void* m_data;
+	unsigned int m_count;
+	unsigned int m_batch;
+	bool m_quit;
+
+	std::atomic<unsigned int> m_nextIndex;
+	std::atomic<unsigned int> m_remaining;
+	unsigned int m_activeWorkers;	// Workers still inside RunJobs for the current batch, guarded by m_lock
+
+	std::atomic<bool> m_busy;
+
+	void WorkerMain();
+	void RunJobs(JobFunction function, void* data, unsigned int count);
+
+public:
+	explicit JobSystem(unsigned int workerCount = JOB_SYSTEM_AUTO_WORKERS);
+	~JobSystem();
+
+	// Calls function(data, i) for every i in [0, count), spread over the workers and the calling thread, in no
+	// particular order. Returns when every call has returned.
+	void ParallelFor(unsigned int count, JobFunction function, void* data);
+
+	// Not counting the thread that calls ParallelFor, which always helps out
+	unsigned int GetWorkerCount() const;
+
+	static JobSystem& GetSingleton(void);
+	static JobSystem* GetSingletonPtr(void);
+};
@@ -1,43 +1,71 @@
-#include "DirectXIncludes.h"
 #include "Mesh.h"
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdexcept>
 
 using namespace DirectX;
-using namespace Microsoft::WRL;
 
-const D3D11_INPUT_ELEMENT_DESC VertexPositionNormalTexture::InputElements[] =
+const VertexElement VertexPositionNormalTexture::InputElements[] =
 {
-    { "POSITION",   0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    { "NORMAL",     0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-    { "TEXCOORD",   0, DXGI_FORMAT_R32G32_FLOAT,    0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "POSITION",   0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, position), 0, false },
+    { "NORMAL",     0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, normal), 0, false },
+    { "TEXCOORD",   0, GPU_FORMAT::R32G32_FLOAT,    offsetof(VertexPositionNormalTexture, textureCoordinate), 0, false },
 };
 
 Mesh::Mesh()
-    : m_IndexCount( 0 )
+    : m_Device( nullptr )
+    , m_VertexBuffer( 0 )
+    , m_IndexBuffer( 0 )
+    , m_IndexCount( 0 )
 {}
 
 Mesh::~Mesh()
 {
-    // Allocated resources will be cleaned automatically when the pointers go out of scope.
+    if ( m_Device )
+    {
+        m_Device->Release( m_VertexBuffer );
+        m_Device->Release( m_IndexBuffer );
+    }
 }
 
-void Mesh::Draw( ID3D11DeviceContext* pDeviceContext )
+void Mesh::Draw( RenderContext* context )
 {
-    assert( pDeviceContext );
+    Bind( context );
+    DrawBound( context );
+}
 
-    const UINT strides[] = { sizeof(VertexPositionNormalTexture) };
-    const UINT offsets[] = { 0 };
+void Mesh::DrawInstanced( RenderContext* context, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance )
+{
+    Bind( context );
+    DrawBoundInstanced( context, instanceBuffer, instanceStride, instanceCount, startInstance );
+}
 
-    pDeviceContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-    pDeviceContext->IASetVertexBuffers( 0, 1, m_VertexBuffer.GetAddressOf(), strides, offsets );
-    pDeviceContext->IASetIndexBuffer( m_IndexBuffer.Get(), DXGI_FORMAT_R16_UINT, 0 );
-    pDeviceContext->DrawIndexed( m_IndexCount, 0, 0 );
+void Mesh::Bind( RenderContext* context )
+{
+    assert( context && m_Device );
+
+    context->SetVertexBuffer( 0, m_VertexBuffer, sizeof(VertexPositionNormalTexture) );
+    context->SetIndexBuffer( m_IndexBuffer, GPU_FORMAT::R16_UINT );
 }
 
-std::unique_ptr<Mesh> Mesh::CreateSphere( ID3D11DeviceContext* pDeviceContext, float diameter, size_t tessellation, bool rhcoords )
+void Mesh::DrawBound( RenderContext* context )
 {
-    VertexCollection vertices;
-    IndexCollection indices;
+    assert( context && m_Device );
 
+    context->DrawIndexed( m_IndexCount, 0, 0 );
+}
+
+void Mesh::DrawBoundInstanced( RenderContext* context, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance )
+{
+    assert( context && m_Device );
+
+    context->SetVertexBuffer( 1, instanceBuffer, instanceStride );
+    context->DrawIndexedInstanced( m_IndexCount, instanceCount, 0, 0, startInstance );
+}
+
+void Mesh::GenerateSphere( VertexCollection& vertices, IndexCollection& indices, float diameter, size_t tessellation )
+{
     if (tessellation < 3)
         throw std::out_of_range("tessellation parameter out of range");
 
@@ -45,6 +73,12 @@ std::unique_ptr<Mesh> Mesh::CreateSphere( ID3D11DeviceContext* pDeviceContext, f
     size_t verticalSegments = tessellation;
     size_t horizontalSegments = tessellation * 2;
 
+    // The sizes are known up front, so fill the collections without them having to grow along the way
+    vertices.clear();
+    indices.clear();
+    vertices.reserve((verticalSegments + 1) * (horizontalSegments + 1));
+    indices.reserve(verticalSegments * (horizontalSegments + 1) * 6);
+
     // Create rings of vertices at progressively higher latitudes.
     for (size_t i = 0; i <= verticalSegments; i++)
     {
@@ -94,16 +128,24 @@ std::unique_ptr<Mesh> Mesh::CreateSphere( ID3D11DeviceContext* pDeviceContext, f
             indices.push_back(nextI * stride + nextJ);
         }
     }
+}
+
+std::unique_ptr<Mesh> Mesh::CreateSphere( RenderDevice* device, float diameter, size_t tessellation, bool rhcoords )
+{
+    VertexCollection vertices;
+    IndexCollection indices;
+
+    GenerateSphere( vertices, indices, diameter, tessellation );
 
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize( pDeviceContext, vertices, indices, rhcoords );
+    mesh->Initialize( device, vertices, indices, rhcoords );
 
     return mesh;
 }
 
-std::unique_ptr<Mesh> Mesh::CreateCube( ID3D11DeviceContext* deviceContext, float size, bool rhcoords )
+std::unique_ptr<Mesh> Mesh::CreateCube( RenderDevice* device, float size, bool rhcoords )
 {
     // A cube has six faces, each one pointing in a different direction.
     const int FaceCount = 6;
@@ -162,7 +204,7 @@ std::unique_ptr<Mesh> Mesh::CreateCube( ID3D11DeviceContext* deviceContext, floa
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(deviceContext, vertices, indices, rhcoords);
+    mesh->Initialize(device, vertices, indices, rhcoords);
 
     return mesh;
 }
@@ -233,7 +275,7 @@ static void CreateCylinderCap(VertexCollection& vertices, IndexCollection& indic
     }
 }
 
-std::unique_ptr<Mesh> Mesh::CreateCone( ID3D11DeviceContext* deviceContext, float diameter, float height, size_t tessellation, bool rhcoords )
+std::unique_ptr<Mesh> Mesh::CreateCone( RenderDevice* device, float diameter, float height, size_t tessellation, bool rhcoords )
 {
     VertexCollection vertices;
     IndexCollection indices;
@@ -279,12 +321,12 @@ std::unique_ptr<Mesh> Mesh::CreateCone( ID3D11DeviceContext* deviceContext, floa
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(deviceContext, vertices, indices, rhcoords);
+    mesh->Initialize(device, vertices, indices, rhcoords);
 
     return mesh;
 }
 
-std::unique_ptr<Mesh> Mesh::CreateTorus(_In_ ID3D11DeviceContext* deviceContext, float diameter, float thickness, size_t tessellation, bool rhcoords)
+std::unique_ptr<Mesh> Mesh::CreateTorus(RenderDevice* device, float diameter, float thickness, size_t tessellation, bool rhcoords)
 {
     VertexCollection vertices;
     IndexCollection indices;
@@ -342,12 +384,12 @@ std::unique_ptr<Mesh> Mesh::CreateTorus(_In_ ID3D11DeviceContext* deviceContext,
     // Create the primitive object.
     std::unique_ptr<Mesh> mesh(new Mesh());
 
-    mesh->Initialize(deviceContext, vertices, indices, rhcoords);
+    mesh->Initialize(device, vertices, indices, rhcoords);
 
     return mesh;
 }
 
-std::unique_ptr<Mesh> Mesh::CreateQuad(ID3D11DeviceContext* deviceContext, float width, float height, bool rhcoords)
+std::unique_ptr<Mesh> Mesh::CreateQuad(RenderDevice* device, float width, float height, bool rhcoords)
 {
 	VertexCollection vertices;
 	IndexCollection indices;
@@ -355,10 +397,10 @@ std::unique_ptr<Mesh> Mesh::CreateQuad(ID3D11DeviceContext* deviceContext, float
 
 	// NOTE: The y-component of the UV coordinates is actually flipped to account for DirectX's sampling from the top left corner
 	XMVECTOR bottomLeft = g_XMIdentityR0 * width * -0.5f + g_XMIdentityR1 * height * -0.5f;
-	vertices.push_back(VertexPositionNormalTexture(bottomLeft													, g_XMIdentityR2, {0.0f, 1.0f}));
-	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR1 * height							, g_XMIdentityR2, {0.0f, 0.0f}));
-	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR1 * height + g_XMIdentityR0 * width, g_XMIdentityR2, {1.0f, 0.0f}));
-	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR0 * width							, g_XMIdentityR2, {1.0f, 1.0f}));
+	vertices.push_back(VertexPositionNormalTexture(bottomLeft													, g_XMIdentityR2, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR1 * height							, g_XMIdentityR2, XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f)));
+	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR1 * height + g_XMIdentityR0 * width, g_XMIdentityR2, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f)));
+	vertices.push_back(VertexPositionNormalTexture(bottomLeft + g_XMIdentityR0 * width							, g_XMIdentityR2, XMVectorSet(1.0f, 1.0f, 0.0f, 0.0f)));
 
 	indices.push_back(0);
 	indices.push_back(1);
@@ -368,34 +410,11 @@ std::unique_ptr<Mesh> Mesh::CreateQuad(ID3D11DeviceContext* deviceContext, float
 	indices.push_back(3);
 
 	std::unique_ptr<Mesh> mesh(new Mesh());
-	mesh->Initialize(deviceContext, vertices, indices, rhcoords);
+	mesh->Initialize(device, vertices, indices, rhcoords);
 
 	return mesh;
 }
 
-// Helper for creating a D3D vertex or index buffer.
-template<typename T>
-static void CreateBuffer(_In_ ID3D11Device* device, T const& data, D3D11_BIND_FLAG bindFlags, _Outptr_ ID3D11Buffer** pBuffer)
-{
-    assert( pBuffer != 0 );
-
-    D3D11_BUFFER_DESC bufferDesc = { 0 };
-
-    bufferDesc.ByteWidth = (UINT)data.size() * sizeof(T::value_type);
-    bufferDesc.BindFlags = bindFlags;
-    bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-
-    D3D11_SUBRESOURCE_DATA dataDesc = { 0 };
-
-    dataDesc.pSysMem = data.data();
-
-    HRESULT hr = device->CreateBuffer(&bufferDesc, &dataDesc, pBuffer);
-    if ( FAILED(hr) )
-    {
-        throw std::exception("Failed to create buffer.");
-    }
-}
-
 // Helper for flipping winding of geometric primitives for LH vs. RH coords
 static void ReverseWinding( IndexCollection& indices, VertexCollection& vertices )
 {
@@ -411,20 +430,21 @@ static void ReverseWinding( IndexCollection& indices, VertexCollection& vertices
     }
 }
 
-void Mesh::Initialize( ID3D11DeviceContext* deviceContext, VertexCollection& vertices, IndexCollection& indices, bool rhcoords )
+void Mesh::Initialize( RenderDevice* device, VertexCollection& vertices, IndexCollection& indices, bool rhcoords )
 {
     if ( vertices.size() >= USHRT_MAX )
-        throw std::exception("Too many vertices for 16-bit index buffer");
+        throw std::length_error("Too many vertices for 16-bit index buffer");
 
     if ( !rhcoords )
         ReverseWinding( indices, vertices );
 
-    ComPtr<ID3D11Device> device;
-    deviceContext->GetDevice(&device);
+    m_Device = device;
+    m_VertexBuffer = device->CreateBuffer( BUFFER_TYPE::VERTEX, (unsigned int)(vertices.size() * sizeof(VertexPositionNormalTexture)), vertices.data() );
+    m_IndexBuffer = device->CreateBuffer( BUFFER_TYPE::INDEX, (unsigned int)(indices.size() * sizeof(uint16_t)), indices.data() );
 
-    CreateBuffer( device.Get(), vertices, D3D11_BIND_VERTEX_BUFFER, &m_VertexBuffer );
-    CreateBuffer( device.Get(), indices, D3D11_BIND_INDEX_BUFFER, &m_IndexBuffer );
+    if ( !m_VertexBuffer || !m_IndexBuffer )
+        throw std::runtime_error("Failed to create buffer.");
 
-    m_IndexCount = static_cast<UINT>( indices.size() );
+    m_IndexCount = static_cast<unsigned int>( indices.size() );
 }
 
@@ -6,7 +6,11 @@
  */
 #pragma once
 
+#include "EngineMath.h"
+#include "RenderDevice.h"
 #include <memory>
+#include <stdint.h>
+#include <vector>
 
 // Vertex struct holding position, normal vector, and texture mapping information.
 struct VertexPositionNormalTexture
@@ -32,7 +36,7 @@ struct VertexPositionNormalTexture
     DirectX::XMFLOAT2 textureCoordinate;
 
     static const int InputElementCount = 3;
-    static const D3D11_INPUT_ELEMENT_DESC InputElements[InputElementCount];
+    static const VertexElement InputElements[InputElementCount];
 };
 
 typedef std::vector<VertexPositionNormalTexture> VertexCollection;
@@ -42,13 +46,27 @@ class Mesh
 {
 public:
     
-    void Draw( ID3D11DeviceContext* pDeviceContext );
+    void Draw( RenderContext* context );
 
-    static std::unique_ptr<Mesh> CreateCube( ID3D11DeviceContext* deviceContext, float size = 1.0f, bool rhcoords = true);
-    static std::unique_ptr<Mesh> CreateSphere( ID3D11DeviceContext* deviceContext, float diameter = 1.0f, size_t tessellation = 16, bool rhcoords = true);
-    static std::unique_ptr<Mesh> CreateCone( ID3D11DeviceContext* deviceContext, float diameter = 1.0f, float height = 1.0f, size_t tessellation = 32, bool rhcoords = true);
-    static std::unique_ptr<Mesh> CreateTorus( ID3D11DeviceContext* deviceContext, float diameter = 1.0f, float thickness = 0.333f, size_t tessellation = 32, bool rhcoords = true);
-	static std::unique_ptr<Mesh> CreateQuad(ID3D11DeviceContext* deviceContext, float width = 1.0f, float height = 1.0f, bool rhcoords = true);
+    // Draws instanceCount copies in one go, with per instance data read from instanceBuffer in vertex buffer slot 1.
+    // The vertex shader's input layout has to say which elements come from there.
+    void DrawInstanced( RenderContext* context, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance = 0 );
+
+    // Draw and DrawInstanced in two parts, for callers that keep track of which mesh is bound and can skip binding
+    // the same one again. The Draw*Bound functions expect this mesh's buffers to be the ones bound.
+    // Any context will do, a command list included, as long as it belongs to the device that made the mesh.
+    void Bind( RenderContext* context );
+    void DrawBound( RenderContext* context );
+    void DrawBoundInstanced( RenderContext* context, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance = 0 );
+
+    static std::unique_ptr<Mesh> CreateCube( RenderDevice* device, float size = 1.0f, bool rhcoords = true);
+    static std::unique_ptr<Mesh> CreateSphere( RenderDevice* device, float diameter = 1.0f, size_t tessellation = 16, bool rhcoords = true);
+    static std::unique_ptr<Mesh> CreateCone( RenderDevice* device, float diameter = 1.0f, float height = 1.0f, size_t tessellation = 32, bool rhcoords = true);
+    static std::unique_ptr<Mesh> CreateTorus( RenderDevice* device, float diameter = 1.0f, float thickness = 0.333f, size_t tessellation = 32, bool rhcoords = true);
+	static std::unique_ptr<Mesh> CreateQuad(RenderDevice* device, float width = 1.0f, float height = 1.0f, bool rhcoords = true);
+
+    // Just the geometry CreateSphere uploads, without needing a device. Replaces whatever was in the collections.
+    static void GenerateSphere( VertexCollection& vertices, IndexCollection& indices, float diameter = 1.0f, size_t tessellation = 16 );
 
 protected:
 
@@ -59,10 +77,12 @@ private:
     Mesh( const Mesh& copy );
     virtual ~Mesh();
 
-    void Initialize( ID3D11DeviceContext* deviceContext, VertexCollection& vertices, IndexCollection& indices, bool rhcoords );
+    void Initialize( RenderDevice* device, VertexCollection& vertices, IndexCollection& indices, bool rhcoords );
     
-    Microsoft::WRL::ComPtr<ID3D11Buffer> m_VertexBuffer;
-    Microsoft::WRL::ComPtr<ID3D11Buffer> m_IndexBuffer;
+    // The device the buffers came from, so they can be given back to it
+    RenderDevice* m_Device;
+    GPUHANDLE m_VertexBuffer;
+    GPUHANDLE m_IndexBuffer;
 
-    UINT m_IndexCount;
+    unsigned int m_IndexCount;
 };
\ No newline at end of file
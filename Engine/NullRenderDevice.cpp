@@ -0,0 +1,834 @@
+#include "NullRenderDevice.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// D3D11 wants constant buffers in multiples of 16 bytes
+#define CONSTANT_BUFFER_ALIGNMENT 16
+
+// ----------------------------------------------------------------------------------
+// Helper Functions
+// ----------------------------------------------------------------------------------
+
+static const char* GetResourceName(GPU_RESOURCE kind)
+{
+	switch (kind)
+	{
+	case GPU_RESOURCE::BUFFER:				return "buffer";
+	case GPU_RESOURCE::VERTEX_SHADER:		return "vertex shader";
+	case GPU_RESOURCE::PIXEL_SHADER:		return "pixel shader";
+	case GPU_RESOURCE::TEXTURE:				return "texture";
+	case GPU_RESOURCE::RASTERIZER_STATE:	return "rasterizer state";
+	case GPU_RESOURCE::DEPTH_STENCIL_STATE:	return "depth/stencil state";
+	case GPU_RESOURCE::BLEND_STATE:			return "blend state";
+	case GPU_RESOURCE::SAMPLER_STATE:		return "sampler state";
+	default:								return "nothing";
+	}
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+NullRenderDevice::NullRenderDevice(unsigned int width, unsigned int height)
+	: m_vertexShader(0)
+	, m_pixelShader(0)
+	, m_indexBuffer(0)
+	, m_indexFormat(GPU_FORMAT::UNKNOWN)
+	, m_rasterizerState(0)
+	, m_depthStencilState(0)
+	, m_stencilRef(0)
+	, m_blendState(0)
+	, m_colorTarget(0)
+	, m_depthTarget(0)
+	, m_presentCount(0)
+	, m_reportedErrors(0)
+{
+	ClearState();
+
+	// Same formats as the D3D11 swap chain
+	TextureDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.format = GPU_FORMAT::R8G8B8A8_UNORM;
+	desc.bindFlags = BIND_RENDER_TARGET;
+	m_backBuffer = m_textures.Add(TextureDesc(desc));
+
+	desc.format = GPU_FORMAT::D24_UNORM_S8_UINT;
+	desc.bindFlags = BIND_DEPTH_STENCIL;
+	m_backBufferDepth = m_textures.Add(TextureDesc(desc));
+}
+
+NullRenderDevice::~NullRenderDevice()
+{
+}
+
+const char* NullRenderDevice::GetName() const
+{
+	return "Null";
+}
+
+void NullRenderDevice::ReportError(const char* format, ...)
+{
+	m_frameStats.validationErrors++;
+
+	if (m_reportedErrors++ >= NULL_DEVICE_MAX_REPORTS)
+		return;
+
+	printf("NullRenderDevice: ");
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf(" \n");
+
+	if (m_reportedErrors == NULL_DEVICE_MAX_REPORTS)
+		printf("NullRenderDevice: That's %u errors, the rest won't be printed \n", NULL_DEVICE_MAX_REPORTS);
+}
+
+void NullRenderDevice::CountStateChange(bool redundant)
+{
+	m_frameStats.stateChanges++;
+	if (redundant)
+		m_frameStats.redundantStateChanges++;
+}
+
+bool NullRenderDevice::ValidateHandle(GPUHANDLE handle, GPU_RESOURCE kind, bool allowNull, const char* call)
+{
+	if (handle == 0)
+	{
+		if (!allowNull)
+			ReportError("%s was given a null %s", call, GetResourceName(kind));
+		return allowNull;
+	}
+
+	bool live;
+	switch (kind)
+	{
+	case GPU_RESOURCE::BUFFER:				live = m_buffers.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::VERTEX_SHADER:		live = m_vertexShaders.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::PIXEL_SHADER:		live = m_pixelShaders.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::TEXTURE:				live = m_textures.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::RASTERIZER_STATE:	live = m_rasterizerStates.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::DEPTH_STENCIL_STATE:	live = m_depthStencilStates.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::BLEND_STATE:			live = m_blendStates.Get(handle) != nullptr; break;
+	case GPU_RESOURCE::SAMPLER_STATE:		live = m_samplerStates.Get(handle) != nullptr; break;
+	default:								live = false; break;
+	}
+
+	if (!live)
+	{
+		if (GetGPUHandleKind(handle) != kind)
+			ReportError("%s wants a %s but was given a %s (0x%08X)", call, GetResourceName(kind), GetResourceName(GetGPUHandleKind(handle)), handle);
+		else
+			ReportError("%s was given a %s that has been released (0x%08X)", call, GetResourceName(kind), handle);
+	}
+
+	return live;
+}
+
+bool NullRenderDevice::ValidateBytecode(const void* bytecode, size_t bytecodeSize, const char* call)
+{
+	// Anything fxc compiled starts with this
+	if (!bytecode || bytecodeSize < 4 || memcmp(bytecode, "DXBC", 4) != 0)
+	{
+		ReportError("%s was given something that isn't compiled shader bytecode", call);
+		return false;
+	}
+
+	return true;
+}
+
+void NullRenderDevice::ValidatePipeline(const char* call)
+{
+	const VertexShader* vertexShader = m_vertexShaders.Get(m_vertexShader);
+	if (!vertexShader)
+		ReportError("%s with no vertex shader bound", call);
+
+	// Every slot the input layout reads from needs something in it. A layout with no elements still needs slot 0.
+	unsigned int slots = vertexShader ? (vertexShader->vertexSlots | vertexShader->instanceSlots) : 0;
+	for (unsigned int slot = 0; slot < NULL_DEVICE_VERTEX_BUFFER_SLOTS; slot++)
+	{
+		if (((slots & (1U << slot)) || (slots == 0 && slot == 0)) && m_vertexBuffers[slot] == 0)
+			ReportError("%s with no vertex buffer bound in slot %u", call, slot);
+	}
+
+	if (m_colorTarget == 0 && m_depthTarget == 0)
+		ReportError("%s with no render target or depth/stencil buffer bound", call);
+
+	if (m_viewport.width <= 0.0f || m_viewport.height <= 0.0f)
+		ReportError("%s with no viewport set", call);
+
+	// The stencil test needs somewhere to keep the stencil
+	const DepthStencilDesc* depthStencil = m_depthStencilStates.Get(m_depthStencilState);
+	if (depthStencil && depthStencil->stencilEnable && m_depthTarget != 0 && !HasStencil(m_textures.Get(m_depthTarget)->format))
+		ReportError("%s uses the stencil but the depth buffer bound has no stencil", call);
+}
+
+void NullRenderDevice::ValidateConstantRange(const char* call, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	const Buffer* constants = m_buffers.Get(buffer);
+	if (constants->type != BUFFER_TYPE::CONSTANT)
+	{
+		ReportError("%s was given a buffer that wasn't created as a constant buffer", call);
+		return;
+	}
+
+	// Binding the whole thing is the same as binding from 0 to the end
+	unsigned int size = byteCount != 0 ? byteCount : constants->byteWidth - offset;
+	if (offset % CONSTANT_BUFFER_OFFSET_ALIGNMENT != 0 || (byteCount != 0 && byteCount % CONSTANT_BUFFER_OFFSET_ALIGNMENT != 0))
+		ReportError("%s: offsets and sizes have to be multiples of %u, not %u and %u", call, CONSTANT_BUFFER_OFFSET_ALIGNMENT, offset, byteCount);
+	else if (offset >= constants->byteWidth || size > constants->byteWidth - offset)
+		ReportError("%s: %u bytes at %u runs past the end of a %u byte buffer", call, size, offset, constants->byteWidth);
+	else if (size > CONSTANT_BUFFER_MAX_BOUND_SIZE)
+		ReportError("%s: a shader can only see %u bytes of a constant buffer, not %u", call, CONSTANT_BUFFER_MAX_BOUND_SIZE, size);
+}
+
+void NullRenderDevice::ValidateVertexRange(const char* call, unsigned int startVertex, unsigned int vertexCount)
+{
+	const VertexShader* vertexShader = m_vertexShaders.Get(m_vertexShader);
+	for (unsigned int slot = 0; vertexShader && slot < NULL_DEVICE_VERTEX_BUFFER_SLOTS; slot++)
+	{
+		const Buffer* vertices = m_buffers.Get(m_vertexBuffers[slot]);
+		if (!(vertexShader->vertexSlots & (1U << slot)) || !vertices)
+			continue;
+
+		if (m_vertexOffsets[slot] + ((unsigned long long)startVertex + vertexCount) * m_vertexStrides[slot] > vertices->byteWidth)
+			ReportError("%s: vertices %u to %u run past the end of the vertex buffer in slot %u", call, startVertex, startVertex + vertexCount, slot);
+	}
+}
+
+void NullRenderDevice::ValidateInstanceRange(const char* call, unsigned int startInstance, unsigned int instanceCount)
+{
+	const VertexShader* vertexShader = m_vertexShaders.Get(m_vertexShader);
+	for (unsigned int slot = 0; vertexShader && slot < NULL_DEVICE_VERTEX_BUFFER_SLOTS; slot++)
+	{
+		const Buffer* instances = m_buffers.Get(m_vertexBuffers[slot]);
+		if (!(vertexShader->instanceSlots & (1U << slot)) || !instances)
+			continue;
+
+		if (m_vertexOffsets[slot] + ((unsigned long long)startInstance + instanceCount) * m_vertexStrides[slot] > instances->byteWidth)
+			ReportError("%s: instances %u to %u run past the end of the vertex buffer in slot %u", call, startInstance, startInstance + instanceCount, slot);
+	}
+}
+
+void NullRenderDevice::Unbind(GPUHANDLE handle)
+{
+	GPUHANDLE* bindings[] = { &m_vertexShader, &m_pixelShader, &m_indexBuffer, &m_rasterizerState,
+		&m_depthStencilState, &m_blendState, &m_colorTarget, &m_depthTarget };
+	for (GPUHANDLE* binding : bindings)
+	{
+		if (*binding == handle)
+			*binding = 0;
+	}
+
+	for (int i = 0; i < NULL_DEVICE_VERTEX_BUFFER_SLOTS; i++)
+	{
+		if (m_vertexBuffers[i] == handle) m_vertexBuffers[i] = 0;
+	}
+
+	for (int i = 0; i < NULL_DEVICE_CONSTANT_BUFFER_SLOTS; i++)
+	{
+		if (m_vsConstantBuffers[i] == handle) m_vsConstantBuffers[i] = 0;
+		if (m_psConstantBuffers[i] == handle) m_psConstantBuffers[i] = 0;
+	}
+
+	for (int i = 0; i < NULL_DEVICE_TEXTURE_SLOTS; i++)
+	{
+		if (m_psTextures[i] == handle) m_psTextures[i] = 0;
+	}
+
+	for (int i = 0; i < NULL_DEVICE_SAMPLER_SLOTS; i++)
+	{
+		if (m_psSamplers[i] == handle) m_psSamplers[i] = 0;
+	}
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Resource Creation
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE NullRenderDevice::CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic)
+{
+	if (byteWidth == 0)
+	{
+		ReportError("CreateBuffer was asked for an empty buffer");
+		return 0;
+	}
+
+	// Bigger than a shader can see is fine, as long as it's only ever bound a part at a time. That's checked when it's bound.
+	if (type == BUFFER_TYPE::CONSTANT && byteWidth % CONSTANT_BUFFER_ALIGNMENT != 0)
+	{
+		ReportError("CreateBuffer: constant buffers have to be a multiple of %u bytes, not %u", CONSTANT_BUFFER_ALIGNMENT, byteWidth);
+		return 0;
+	}
+
+	Buffer buffer;
+	buffer.type = type;
+	buffer.byteWidth = byteWidth;
+	buffer.dynamic = dynamic;
+
+	m_frameStats.resourcesCreated++;
+	if (initialData)
+		m_frameStats.bytesUploaded += byteWidth;
+
+	return m_buffers.Add(std::move(buffer));
+}
+
+GPUHANDLE NullRenderDevice::CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount)
+{
+	if (!ValidateBytecode(bytecode, bytecodeSize, "CreateVertexShader"))
+		return 0;
+
+	if (elementCount > 0 && !elements)
+	{
+		ReportError("CreateVertexShader was told about %u vertex elements but not given any", elementCount);
+		return 0;
+	}
+
+	VertexShader shader;
+	shader.elementCount = elementCount;
+	shader.vertexSlots = 0;
+	shader.instanceSlots = 0;
+
+	for (unsigned int i = 0; i < elementCount; i++)
+	{
+		if (!elements[i].semantic || GetFormatSize(elements[i].format) == 0)
+		{
+			ReportError("CreateVertexShader: vertex element %u needs a semantic and a format", i);
+			return 0;
+		}
+
+		if (elements[i].inputSlot >= NULL_DEVICE_VERTEX_BUFFER_SLOTS)
+		{
+			ReportError("CreateVertexShader: %s%u is in slot %u, there are only %u", elements[i].semantic, elements[i].semanticIndex,
+				elements[i].inputSlot, NULL_DEVICE_VERTEX_BUFFER_SLOTS);
+			return 0;
+		}
+
+		// D3D11 won't have per vertex and per instance data sharing a buffer
+		unsigned int slotBit = 1U << elements[i].inputSlot;
+		(elements[i].perInstance ? shader.instanceSlots : shader.vertexSlots) |= slotBit;
+		if (shader.vertexSlots & shader.instanceSlots & slotBit)
+		{
+			ReportError("CreateVertexShader: slot %u has both per vertex and per instance elements in it", elements[i].inputSlot);
+			return 0;
+		}
+
+		for (unsigned int j = 0; j < i; j++)
+		{
+			if (strcmp(elements[i].semantic, elements[j].semantic) == 0 && elements[i].semanticIndex == elements[j].semanticIndex)
+			{
+				ReportError("CreateVertexShader: %s%u is in the vertex layout twice", elements[i].semantic, elements[i].semanticIndex);
+				return 0;
+			}
+		}
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_vertexShaders.Add(std::move(shader));
+}
+
+GPUHANDLE NullRenderDevice::CreatePixelShader(const void* bytecode, size_t bytecodeSize)
+{
+	if (!ValidateBytecode(bytecode, bytecodeSize, "CreatePixelShader"))
+		return 0;
+
+	PixelShader shader;
+	shader.bytecodeSize = bytecodeSize;
+
+	m_frameStats.resourcesCreated++;
+	return m_pixelShaders.Add(std::move(shader));
+}
+
+GPUHANDLE NullRenderDevice::CreateTexture(const TextureDesc& desc)
+{
+	if (desc.width == 0 || desc.height == 0 || desc.mipLevels == 0 || desc.sampleCount == 0)
+	{
+		ReportError("CreateTexture was asked for a %ux%u texture with %u mips and %u samples", desc.width, desc.height, desc.mipLevels, desc.sampleCount);
+		return 0;
+	}
+
+	if (desc.format == GPU_FORMAT::UNKNOWN || desc.bindFlags == 0)
+	{
+		ReportError("CreateTexture needs a format and something to bind the texture as");
+		return 0;
+	}
+
+	bool isDepth = IsDepthFormat(desc.format);
+	if (isDepth && (desc.bindFlags & BIND_RENDER_TARGET))
+	{
+		ReportError("CreateTexture: a depth format can't be a render target");
+		return 0;
+	}
+
+	if (!isDepth && (desc.bindFlags & BIND_DEPTH_STENCIL))
+	{
+		ReportError("CreateTexture: only depth formats can be depth/stencil buffers");
+		return 0;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_textures.Add(TextureDesc(desc));
+}
+
+GPUHANDLE NullRenderDevice::CreateRasterizerState(const RasterizerDesc&)
+{
+	StateObject state = { true };
+	m_frameStats.resourcesCreated++;
+	return m_rasterizerStates.Add(std::move(state));
+}
+
+GPUHANDLE NullRenderDevice::CreateDepthStencilState(const DepthStencilDesc& desc)
+{
+	m_frameStats.resourcesCreated++;
+	return m_depthStencilStates.Add(DepthStencilDesc(desc));
+}
+
+GPUHANDLE NullRenderDevice::CreateBlendState(const BlendDesc&)
+{
+	StateObject state = { true };
+	m_frameStats.resourcesCreated++;
+	return m_blendStates.Add(std::move(state));
+}
+
+GPUHANDLE NullRenderDevice::CreateSamplerState(const SamplerDesc&)
+{
+	StateObject state = { true };
+	m_frameStats.resourcesCreated++;
+	return m_samplerStates.Add(std::move(state));
+}
+
+void NullRenderDevice::Release(GPUHANDLE handle)
+{
+	if (handle == m_backBuffer || handle == m_backBufferDepth)
+	{
+		ReportError("Release: the back buffers belong to the device");
+		return;
+	}
+
+	if (!ValidateHandle(handle, GetGPUHandleKind(handle), false, "Release"))
+		return;
+
+	switch (GetGPUHandleKind(handle))
+	{
+	case GPU_RESOURCE::BUFFER:				m_buffers.Remove(handle); break;
+	case GPU_RESOURCE::VERTEX_SHADER:		m_vertexShaders.Remove(handle); break;
+	case GPU_RESOURCE::PIXEL_SHADER:		m_pixelShaders.Remove(handle); break;
+	case GPU_RESOURCE::TEXTURE:				m_textures.Remove(handle); break;
+	case GPU_RESOURCE::RASTERIZER_STATE:	m_rasterizerStates.Remove(handle); break;
+	case GPU_RESOURCE::DEPTH_STENCIL_STATE:	m_depthStencilStates.Remove(handle); break;
+	case GPU_RESOURCE::BLEND_STATE:			m_blendStates.Remove(handle); break;
+	case GPU_RESOURCE::SAMPLER_STATE:		m_samplerStates.Remove(handle); break;
+	default:								break;
+	}
+
+	Unbind(handle);
+}
+
+unsigned int NullRenderDevice::GetBufferSize(GPUHANDLE buffer) const
+{
+	const Buffer* item = m_buffers.Get(buffer);
+	return item ? item->byteWidth : 0;
+}
+
+void NullRenderDevice::UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount)
+{
+	if (!ValidateHandle(buffer, GPU_RESOURCE::BUFFER, false, "UpdateBuffer"))
+		return;
+
+	if (!data)
+	{
+		ReportError("UpdateBuffer was given no data");
+		return;
+	}
+
+	const Buffer* target = m_buffers.Get(buffer);
+	if (byteCount > target->byteWidth)
+	{
+		ReportError("UpdateBuffer was given %u bytes for a %u byte buffer", byteCount, target->byteWidth);
+		return;
+	}
+
+	if (byteCount != 0 && byteCount != target->byteWidth && target->type == BUFFER_TYPE::CONSTANT)
+	{
+		ReportError("UpdateBuffer: constant buffers have to be updated whole");
+		return;
+	}
+
+	m_frameStats.bytesUploaded += byteCount != 0 ? byteCount : target->byteWidth;
+}
+
+void NullRenderDevice::UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount)
+{
+	if (!ValidateHandle(buffer, GPU_RESOURCE::BUFFER, false, "UpdateBufferRange"))
+		return;
+
+	if (!data || byteCount == 0)
+	{
+		ReportError("UpdateBufferRange was given no data");
+		return;
+	}
+
+	const Buffer* target = m_buffers.Get(buffer);
+	if (!target->dynamic)
+	{
+		ReportError("UpdateBufferRange: only dynamic buffers can be written in part");
+		return;
+	}
+
+	if (offset > target->byteWidth || byteCount > target->byteWidth - offset)
+	{
+		ReportError("UpdateBufferRange was given %u bytes at %u for a %u byte buffer", byteCount, offset, target->byteWidth);
+		return;
+	}
+
+	m_frameStats.bytesUploaded += byteCount;
+}
+
+bool NullRenderDevice::SupportsConstantBufferOffsets() const
+{
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Pipeline State
+// ---------------------------------------------------------------------------------------------------------------
+
+void NullRenderDevice::SetVertexShader(GPUHANDLE shader)
+{
+	ValidateHandle(shader, GPU_RESOURCE::VERTEX_SHADER, true, "SetVertexShader");
+	CountStateChange(shader == m_vertexShader);
+	m_vertexShader = shader;
+}
+
+void NullRenderDevice::SetPixelShader(GPUHANDLE shader)
+{
+	ValidateHandle(shader, GPU_RESOURCE::PIXEL_SHADER, true, "SetPixelShader");
+	CountStateChange(shader == m_pixelShader);
+	m_pixelShader = shader;
+}
+
+void NullRenderDevice::SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot >= NULL_DEVICE_VERTEX_BUFFER_SLOTS)
+	{
+		ReportError("SetVertexBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	if (ValidateHandle(buffer, GPU_RESOURCE::BUFFER, true, "SetVertexBuffer") && buffer != 0)
+	{
+		if (m_buffers.Get(buffer)->type != BUFFER_TYPE::VERTEX)
+			ReportError("SetVertexBuffer was given a buffer that wasn't created as a vertex buffer");
+		if (stride == 0)
+			ReportError("SetVertexBuffer was given a stride of 0");
+	}
+
+	CountStateChange(buffer == m_vertexBuffers[slot] && stride == m_vertexStrides[slot] && offset == m_vertexOffsets[slot]);
+	m_vertexBuffers[slot] = buffer;
+	m_vertexStrides[slot] = stride;
+	m_vertexOffsets[slot] = offset;
+}
+
+void NullRenderDevice::SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format)
+{
+	if (ValidateHandle(buffer, GPU_RESOURCE::BUFFER, true, "SetIndexBuffer") && buffer != 0)
+	{
+		if (m_buffers.Get(buffer)->type != BUFFER_TYPE::INDEX)
+			ReportError("SetIndexBuffer was given a buffer that wasn't created as an index buffer");
+		if (format != GPU_FORMAT::R16_UINT && format != GPU_FORMAT::R32_UINT)
+			ReportError("SetIndexBuffer: indices have to be R16_UINT or R32_UINT");
+	}
+
+	CountStateChange(buffer == m_indexBuffer && format == m_indexFormat);
+	m_indexBuffer = buffer;
+	m_indexFormat = format;
+}
+
+void NullRenderDevice::SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	if (slot >= NULL_DEVICE_CONSTANT_BUFFER_SLOTS)
+	{
+		ReportError("SetVSConstantBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	if (ValidateHandle(buffer, GPU_RESOURCE::BUFFER, true, "SetVSConstantBuffer") && buffer != 0)
+		ValidateConstantRange("SetVSConstantBuffer", buffer, offset, byteCount);
+
+	CountStateChange(buffer == m_vsConstantBuffers[slot] && offset == m_vsConstantOffsets[slot] && byteCount == m_vsConstantSizes[slot]);
+	m_vsConstantBuffers[slot] = buffer;
+	m_vsConstantOffsets[slot] = offset;
+	m_vsConstantSizes[slot] = byteCount;
+}
+
+void NullRenderDevice::SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	if (slot >= NULL_DEVICE_CONSTANT_BUFFER_SLOTS)
+	{
+		ReportError("SetPSConstantBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	if (ValidateHandle(buffer, GPU_RESOURCE::BUFFER, true, "SetPSConstantBuffer") && buffer != 0)
+		ValidateConstantRange("SetPSConstantBuffer", buffer, offset, byteCount);
+
+	CountStateChange(buffer == m_psConstantBuffers[slot] && offset == m_psConstantOffsets[slot] && byteCount == m_psConstantSizes[slot]);
+	m_psConstantBuffers[slot] = buffer;
+	m_psConstantOffsets[slot] = offset;
+	m_psConstantSizes[slot] = byteCount;
+}
+
+void NullRenderDevice::SetPSTexture(unsigned int slot, GPUHANDLE texture)
+{
+	if (slot >= NULL_DEVICE_TEXTURE_SLOTS)
+	{
+		ReportError("SetPSTexture: there's no slot %u", slot);
+		return;
+	}
+
+	if (ValidateHandle(texture, GPU_RESOURCE::TEXTURE, true, "SetPSTexture") && texture != 0)
+	{
+		if ((m_textures.Get(texture)->bindFlags & BIND_SHADER_RESOURCE) == 0)
+		{
+			ReportError("SetPSTexture was given a texture that wasn't created as a shader resource");
+		}
+		else if (texture == m_colorTarget || texture == m_depthTarget)
+		{
+			// D3D11 binds null instead, which is never what was meant
+			ReportError("SetPSTexture: texture 0x%08X is bound as a target, so it can't be read from", texture);
+			texture = 0;
+		}
+	}
+
+	CountStateChange(texture == m_psTextures[slot]);
+	m_psTextures[slot] = texture;
+}
+
+void NullRenderDevice::SetPSSampler(unsigned int slot, GPUHANDLE sampler)
+{
+	if (slot >= NULL_DEVICE_SAMPLER_SLOTS)
+	{
+		ReportError("SetPSSampler: there's no slot %u", slot);
+		return;
+	}
+
+	ValidateHandle(sampler, GPU_RESOURCE::SAMPLER_STATE, true, "SetPSSampler");
+	CountStateChange(sampler == m_psSamplers[slot]);
+	m_psSamplers[slot] = sampler;
+}
+
+void NullRenderDevice::SetRasterizerState(GPUHANDLE state)
+{
+	ValidateHandle(state, GPU_RESOURCE::RASTERIZER_STATE, true, "SetRasterizerState");
+	CountStateChange(state == m_rasterizerState);
+	m_rasterizerState = state;
+}
+
+void NullRenderDevice::SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef)
+{
+	ValidateHandle(state, GPU_RESOURCE::DEPTH_STENCIL_STATE, true, "SetDepthStencilState");
+	if (stencilRef > 0xFF)
+		ReportError("SetDepthStencilState: the stencil is 8 bits, so a reference of %u won't work", stencilRef);
+
+	CountStateChange(state == m_depthStencilState && stencilRef == m_stencilRef);
+	m_depthStencilState = state;
+	m_stencilRef = stencilRef;
+}
+
+void NullRenderDevice::SetBlendState(GPUHANDLE state)
+{
+	ValidateHandle(state, GPU_RESOURCE::BLEND_STATE, true, "SetBlendState");
+	CountStateChange(state == m_blendState);
+	m_blendState = state;
+}
+
+void NullRenderDevice::SetViewport(const Viewport& viewport)
+{
+	if (viewport.width <= 0.0f || viewport.height <= 0.0f)
+		ReportError("SetViewport: %f x %f is an empty viewport", viewport.width, viewport.height);
+
+	if (viewport.minDepth < 0.0f || viewport.maxDepth > 1.0f || viewport.minDepth > viewport.maxDepth)
+		ReportError("SetViewport: depth range %f to %f is outside 0 to 1", viewport.minDepth, viewport.maxDepth);
+
+	CountStateChange(memcmp(&viewport, &m_viewport, sizeof(Viewport)) == 0);
+	m_viewport = viewport;
+}
+
+void NullRenderDevice::SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil)
+{
+	bool colorValid = ValidateHandle(colorTarget, GPU_RESOURCE::TEXTURE, true, "SetRenderTarget") && colorTarget != 0;
+	bool depthValid = ValidateHandle(depthStencil, GPU_RESOURCE::TEXTURE, true, "SetRenderTarget") && depthStencil != 0;
+
+	const TextureDesc* color = colorValid ? m_textures.Get(colorTarget) : nullptr;
+	const TextureDesc* depth = depthValid ? m_textures.Get(depthStencil) : nullptr;
+
+	if (color && (color->bindFlags & BIND_RENDER_TARGET) == 0)
+		ReportError("SetRenderTarget was given a color target that wasn't created as a render target");
+
+	if (depth && (depth->bindFlags & BIND_DEPTH_STENCIL) == 0)
+		ReportError("SetRenderTarget was given a depth target that wasn't created as a depth/stencil buffer");
+
+	if (color && depth && (color->width != depth->width || color->height != depth->height))
+	{
+		ReportError("SetRenderTarget: the %ux%u render target and %ux%u depth buffer aren't the same size",
+			color->width, color->height, depth->width, depth->height);
+	}
+
+	// D3D11 quietly unbinds anything being read from that's about to be written to. The game should have done that itself.
+	for (int i = 0; i < NULL_DEVICE_TEXTURE_SLOTS; i++)
+	{
+		if (m_psTextures[i] != 0 && (m_psTextures[i] == colorTarget || m_psTextures[i] == depthStencil))
+		{
+			ReportError("SetRenderTarget: texture 0x%08X is still bound to pixel shader slot %d", m_psTextures[i], i);
+			m_psTextures[i] = 0;
+		}
+	}
+
+	CountStateChange(colorTarget == m_colorTarget && depthStencil == m_depthTarget);
+	m_colorTarget = colorTarget;
+	m_depthTarget = depthStencil;
+}
+
+void NullRenderDevice::ClearState()
+{
+	m_vertexShader = 0;
+	m_pixelShader = 0;
+	m_indexBuffer = 0;
+	m_indexFormat = GPU_FORMAT::UNKNOWN;
+	m_rasterizerState = 0;
+	m_depthStencilState = 0;
+	m_stencilRef = 0;
+	m_blendState = 0;
+	m_colorTarget = 0;
+	m_depthTarget = 0;
+
+	memset(m_vertexBuffers, 0, sizeof(m_vertexBuffers));
+	memset(m_vertexStrides, 0, sizeof(m_vertexStrides));
+	memset(m_vertexOffsets, 0, sizeof(m_vertexOffsets));
+	memset(m_vsConstantBuffers, 0, sizeof(m_vsConstantBuffers));
+	memset(m_psConstantBuffers, 0, sizeof(m_psConstantBuffers));
+	memset(m_vsConstantOffsets, 0, sizeof(m_vsConstantOffsets));
+	memset(m_psConstantOffsets, 0, sizeof(m_psConstantOffsets));
+	memset(m_vsConstantSizes, 0, sizeof(m_vsConstantSizes));
+	memset(m_psConstantSizes, 0, sizeof(m_psConstantSizes));
+	memset(m_psTextures, 0, sizeof(m_psTextures));
+	memset(m_psSamplers, 0, sizeof(m_psSamplers));
+	memset(&m_viewport, 0, sizeof(m_viewport));
+}
+
+void NullRenderDevice::ClearRenderTarget(GPUHANDLE target, const float[4])
+{
+	if (ValidateHandle(target, GPU_RESOURCE::TEXTURE, false, "ClearRenderTarget") && (m_textures.Get(target)->bindFlags & BIND_RENDER_TARGET) == 0)
+		ReportError("ClearRenderTarget was given a texture that isn't a render target");
+}
+
+void NullRenderDevice::ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char)
+{
+	if (ValidateHandle(target, GPU_RESOURCE::TEXTURE, false, "ClearDepthStencil") && (m_textures.Get(target)->bindFlags & BIND_DEPTH_STENCIL) == 0)
+		ReportError("ClearDepthStencil was given a texture that isn't a depth/stencil buffer");
+
+	if ((clearFlags & (CLEAR_DEPTH | CLEAR_STENCIL)) == 0)
+		ReportError("ClearDepthStencil wasn't told to clear anything");
+
+	if (depth < 0.0f || depth > 1.0f)
+		ReportError("ClearDepthStencil: %f is outside the depth range", depth);
+}
+
+void NullRenderDevice::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	ValidatePipeline("Draw");
+	ValidateVertexRange("Draw", startVertex, vertexCount);
+	ValidateInstanceRange("Draw", 0, 1);
+
+	if (vertexCount % 3 != 0)
+		ReportError("Draw: %u vertices isn't a whole number of triangles", vertexCount);
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += vertexCount / 3;
+}
+
+void NullRenderDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int)
+{
+	ValidatePipeline("DrawIndexed");
+	ValidateInstanceRange("DrawIndexed", 0, 1);
+
+	const Buffer* indices = m_buffers.Get(m_indexBuffer);
+	if (!indices)
+		ReportError("DrawIndexed with no index buffer bound");
+	else if ((unsigned long long)(startIndex + indexCount) * GetFormatSize(m_indexFormat) > indices->byteWidth)
+		ReportError("DrawIndexed: indices %u to %u run past the end of the index buffer", startIndex, startIndex + indexCount);
+
+	if (indexCount % 3 != 0)
+		ReportError("DrawIndexed: %u indices isn't a whole number of triangles", indexCount);
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += indexCount / 3;
+}
+
+void NullRenderDevice::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int, unsigned int startInstance)
+{
+	ValidatePipeline("DrawIndexedInstanced");
+	ValidateInstanceRange("DrawIndexedInstanced", startInstance, instanceCount);
+
+	const Buffer* indices = m_buffers.Get(m_indexBuffer);
+	if (!indices)
+		ReportError("DrawIndexedInstanced with no index buffer bound");
+	else if ((unsigned long long)(startIndex + indexCount) * GetFormatSize(m_indexFormat) > indices->byteWidth)
+		ReportError("DrawIndexedInstanced: indices %u to %u run past the end of the index buffer", startIndex, startIndex + indexCount);
+
+	if (indexCount % 3 != 0)
+		ReportError("DrawIndexedInstanced: %u indices isn't a whole number of triangles", indexCount);
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += (unsigned long long)(indexCount / 3) * instanceCount;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Swap Chain
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE NullRenderDevice::GetBackBuffer() const
+{
+	return m_backBuffer;
+}
+
+GPUHANDLE NullRenderDevice::GetBackBufferDepth() const
+{
+	return m_backBufferDepth;
+}
+
+unsigned int NullRenderDevice::GetBackBufferWidth() const
+{
+	return m_textures.Get(m_backBuffer)->width;
+}
+
+unsigned int NullRenderDevice::GetBackBufferHeight() const
+{
+	return m_textures.Get(m_backBuffer)->height;
+}
+
+bool NullRenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	// Don't allow for 0 size swap chain buffers.
+	if (width == 0) width = 1;
+	if (height == 0) height = 1;
+
+	m_textures.Get(m_backBuffer)->width = width;
+	m_textures.Get(m_backBuffer)->height = height;
+	m_textures.Get(m_backBufferDepth)->width = width;
+	m_textures.Get(m_backBufferDepth)->height = height;
+
+	return true;
+}
+
+void NullRenderDevice::Present()
+{
+	m_presentCount++;
+}
+
+unsigned int NullRenderDevice::GetPresentCount() const
+{
+	return m_presentCount;
+}
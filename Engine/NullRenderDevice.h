@@ -0,0 +1,158 @@
+#pragma once
+#include "RenderDevice.h"
+
+// Shader slots the null device keeps track of. Same limits as D3D11.
+#define NULL_DEVICE_VERTEX_BUFFER_SLOTS 32
+#define NULL_DEVICE_CONSTANT_BUFFER_SLOTS 14
+#define NULL_DEVICE_TEXTURE_SLOTS 128
+#define NULL_DEVICE_SAMPLER_SLOTS 16
+
+// Stop printing validation errors after this many. They're still counted.
+#define NULL_DEVICE_MAX_REPORTS 64
+
+// A RenderDevice that doesn't draw anything, for running the game and benchmarks on machines without a GPU. Nothing
+// touches a graphics API, so it builds anywhere the engine does.
+//
+// Instead of drawing it checks every call the way the D3D11 debug layer would (handles of the right kind that haven't
+// been released, a full pipeline bound at draw time, index ranges inside their buffers, constant buffer sizes, targets
+// of matching sizes, textures bound as a shader resource and a target at once) and counts what the real device would
+// have been asked to do. Problems are printed and counted in RenderDeviceStats::validationErrors rather than asserted,
+// so a headless run can report all of them and fail at the end.
+class NullRenderDevice : public RenderDevice
+{
+private:
+	struct Buffer
+	{
+		BUFFER_TYPE type;
+		unsigned int byteWidth;
+		bool dynamic;
+	};
+
+	// Which vertex buffer slots the input layout reads from, one bit each
+	struct VertexShader
+	{
+		unsigned int elementCount;
+		unsigned int vertexSlots;
+		unsigned int instanceSlots;
+	};
+
+	struct PixelShader
+	{
+		size_t bytecodeSize;
+	};
+
+	// Most state objects have nothing worth keeping, only whether they're alive
+	struct StateObject
+	{
+		bool valid;
+	};
+
+	GPUResourceTable<Buffer, GPU_RESOURCE::BUFFER> m_buffers;
+	GPUResourceTable<VertexShader, GPU_RESOURCE::VERTEX_SHADER> m_vertexShaders;
+	GPUResourceTable<PixelShader, GPU_RESOURCE::PIXEL_SHADER> m_pixelShaders;
+	GPUResourceTable<TextureDesc, GPU_RESOURCE::TEXTURE> m_textures;
+	GPUResourceTable<StateObject, GPU_RESOURCE::RASTERIZER_STATE> m_rasterizerStates;
+	GPUResourceTable<DepthStencilDesc, GPU_RESOURCE::DEPTH_STENCIL_STATE> m_depthStencilStates;
+	GPUResourceTable<StateObject, GPU_RESOURCE::BLEND_STATE> m_blendStates;
+	GPUResourceTable<StateObject, GPU_RESOURCE::SAMPLER_STATE> m_samplerStates;
+
+	GPUHANDLE m_backBuffer;
+	GPUHANDLE m_backBufferDepth;
+
+	// Everything that's bound right now, to check draws against and to spot binds that change nothing
+	GPUHANDLE m_vertexShader;
+	GPUHANDLE m_pixelShader;
+	GPUHANDLE m_vertexBuffers[NULL_DEVICE_VERTEX_BUFFER_SLOTS];
+	unsigned int m_vertexStrides[NULL_DEVICE_VERTEX_BUFFER_SLOTS];
+	unsigned int m_vertexOffsets[NULL_DEVICE_VERTEX_BUFFER_SLOTS];
+	GPUHANDLE m_indexBuffer;
+	GPU_FORMAT m_indexFormat;
+	GPUHANDLE m_vsConstantBuffers[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	GPUHANDLE m_psConstantBuffers[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_vsConstantOffsets[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_psConstantOffsets[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_vsConstantSizes[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_psConstantSizes[NULL_DEVICE_CONSTANT_BUFFER_SLOTS];
+	GPUHANDLE m_psTextures[NULL_DEVICE_TEXTURE_SLOTS];
+	GPUHANDLE m_psSamplers[NULL_DEVICE_SAMPLER_SLOTS];
+	GPUHANDLE m_rasterizerState;
+	GPUHANDLE m_depthStencilState;
+	unsigned int m_stencilRef;
+	GPUHANDLE m_blendState;
+	Viewport m_viewport;
+	GPUHANDLE m_colorTarget;
+	GPUHANDLE m_depthTarget;
+
+	unsigned int m_presentCount;
+	unsigned int m_reportedErrors;
+
+	void ReportError(const char* format, ...);
+	void CountStateChange(bool redundant);
+
+	// Returns true if handle is 0 (when allowed) or a live resource of the given kind, and reports it otherwise
+	bool ValidateHandle(GPUHANDLE handle, GPU_RESOURCE kind, bool allowNull, const char* call);
+	bool ValidateBytecode(const void* bytecode, size_t bytecodeSize, const char* call);
+	void ValidatePipeline(const char* call);
+
+	// Checks the buffer is a constant buffer and the part of it being bound is one a shader can see
+	void ValidateConstantRange(const char* call, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount);
+
+	// Checks that the vertex buffers the bound input layout reads from have room for the given vertices or instances
+	void ValidateVertexRange(const char* call, unsigned int startVertex, unsigned int vertexCount);
+	void ValidateInstanceRange(const char* call, unsigned int startInstance, unsigned int instanceCount);
+
+	// Forgets any binding of a released resource, since the engine can't bind it again either
+	void Unbind(GPUHANDLE handle);
+
+public:
+	NullRenderDevice(unsigned int width, unsigned int height);
+	~NullRenderDevice();
+
+	const char* GetName() const override;
+
+	GPUHANDLE CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic = false) override;
+	GPUHANDLE CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount) override;
+	GPUHANDLE CreatePixelShader(const void* bytecode, size_t bytecodeSize) override;
+	GPUHANDLE CreateTexture(const TextureDesc& desc) override;
+	GPUHANDLE CreateRasterizerState(const RasterizerDesc& desc) override;
+	GPUHANDLE CreateDepthStencilState(const DepthStencilDesc& desc) override;
+	GPUHANDLE CreateBlendState(const BlendDesc& desc) override;
+	GPUHANDLE CreateSamplerState(const SamplerDesc& desc) override;
+	void Release(GPUHANDLE handle) override;
+	unsigned int GetBufferSize(GPUHANDLE buffer) const override;
+
+	void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) override;
+	void UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount) override;
+	bool SupportsConstantBufferOffsets() const override;
+
+	void SetVertexShader(GPUHANDLE shader) override;
+	void SetPixelShader(GPUHANDLE shader) override;
+	void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) override;
+	void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) override;
+	void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSTexture(unsigned int slot, GPUHANDLE texture) override;
+	void SetPSSampler(unsigned int slot, GPUHANDLE sampler) override;
+	void SetRasterizerState(GPUHANDLE state) override;
+	void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) override;
+	void SetBlendState(GPUHANDLE state) override;
+	void SetViewport(const Viewport& viewport) override;
+	void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) override;
+	void ClearState() override;
+
+	void ClearRenderTarget(GPUHANDLE target, const float color[4]) override;
+	void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) override;
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+
+	GPUHANDLE GetBackBuffer() const override;
+	GPUHANDLE GetBackBufferDepth() const override;
+	unsigned int GetBackBufferWidth() const override;
+	unsigned int GetBackBufferHeight() const override;
+	bool Resize(unsigned int width, unsigned int height) override;
+	void Present() override;
+
+	unsigned int GetPresentCount() const;
+};
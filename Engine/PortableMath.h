@@ -0,0 +1,910 @@
+#pragma once
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// A stand-in for the parts of DirectXMath the engine uses, for builds that don't have the Windows SDK. It lives in the
+// DirectX namespace and keeps the same names and conventions (row vectors, left handed, XMMatrixMultiply(A, B) means
+// "A then B"), so Transform, TransformSystem and Camera compile against it unchanged. Only include it through
+// EngineMath.h, which picks between this and the real thing.
+//
+// Like DirectXMath, the backend is chosen at compile time: SSE (using SSE4.1 where it helps), NEON, or plain floats
+// if _XM_NO_INTRINSICS_ is defined or neither is available. Only the handful of primitives at the top are written per
+// backend; everything else is built on top of them.
+
+#if !defined(_XM_NO_INTRINSICS_) && !defined(_XM_SSE_INTRINSICS_) && !defined(_XM_ARM_NEON_INTRINSICS_)
+#if defined(__SSE2__) || defined(__x86_64__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _XM_SSE_INTRINSICS_
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define _XM_ARM_NEON_INTRINSICS_
+#else
+#define _XM_NO_INTRINSICS_
+#endif
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_) && defined(__SSE4_1__) && !defined(_XM_SSE4_INTRINSICS_)
+#define _XM_SSE4_INTRINSICS_
+#endif
+
+#if defined(_XM_SSE_INTRINSICS_)
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#if defined(_XM_SSE4_INTRINSICS_)
+#include <smmintrin.h>
+#endif
+#elif defined(_XM_ARM_NEON_INTRINSICS_)
+#include <arm_neon.h>
+#endif
+
+#ifndef XM_CALLCONV
+#define XM_CALLCONV
+#endif
+
+namespace DirectX
+{
+
+const float XM_PI		= 3.141592654f;
+const float XM_2PI		= 6.283185307f;
+const float XM_PIDIV2	= 1.570796327f;
+const float XM_PIDIV4	= 0.785398163f;
+
+inline float XMConvertToRadians(float degrees) { return degrees * (XM_PI / 180.0f); }
+inline float XMConvertToDegrees(float radians) { return radians * (180.0f / XM_PI); }
+
+inline void XMScalarSinCos(float* sin, float* cos, float value)
+{
+	*sin = sinf(value);
+	*cos = cosf(value);
+}
+
+// ----------------------------------------------------------------------------------
+// Types
+// ----------------------------------------------------------------------------------
+
+#if defined(_XM_SSE_INTRINSICS_)
+typedef __m128 XMVECTOR;
+#elif defined(_XM_ARM_NEON_INTRINSICS_)
+typedef float32x4_t XMVECTOR;
+#else
+struct alignas(16) XMVECTOR
+{
+	union
+	{
+		float vector4_f32[4];
+		uint32_t vector4_u32[4];
+	};
+};
+#endif
+
+// All vectors are passed by value; nothing here is big enough for the register passing rules to matter
+typedef const XMVECTOR FXMVECTOR;
+typedef const XMVECTOR GXMVECTOR;
+typedef const XMVECTOR HXMVECTOR;
+typedef const XMVECTOR& CXMVECTOR;
+
+struct alignas(16) XMMATRIX
+{
+	XMVECTOR r[4];
+
+	XMMATRIX() {}
+	XMMATRIX(XMVECTOR r0, XMVECTOR r1, XMVECTOR r2, XMVECTOR r3) { r[0] = r0; r[1] = r1; r[2] = r2; r[3] = r3; }
+	XMMATRIX(float m00, float m01, float m02, float m03,
+			 float m10, float m11, float m12, float m13,
+			 float m20, float m21, float m22, float m23,
+			 float m30, float m31, float m32, float m33);
+
+	XMMATRIX& operator*=(const XMMATRIX& other);
+	XMMATRIX operator*(const XMMATRIX& other) const;
+};
+
+typedef const XMMATRIX& FXMMATRIX;
+typedef const XMMATRIX& CXMMATRIX;
+
+// Constants that can be written as literals and used as vectors
+struct XMVECTORF32
+{
+	union
+	{
+		float f[4];
+		XMVECTOR v;
+	};
+
+	operator XMVECTOR() const { return v; }
+	operator const float*() const { return f; }
+};
+
+struct XMVECTORU32
+{
+	union
+	{
+		uint32_t u[4];
+		XMVECTOR v;
+	};
+
+	operator XMVECTOR() const { return v; }
+};
+
+struct XMFLOAT2
+{
+	float x, y;
+
+	XMFLOAT2() {}
+	XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3
+{
+	float x, y, z;
+
+	XMFLOAT3() {}
+	XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4
+{
+	float x, y, z, w;
+
+	XMFLOAT4() {}
+	XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct alignas(16) XMFLOAT4A : public XMFLOAT4
+{
+	XMFLOAT4A() {}
+	XMFLOAT4A(float _x, float _y, float _z, float _w) : XMFLOAT4(_x, _y, _z, _w) {}
+};
+
+struct XMFLOAT4X4
+{
+	union
+	{
+		float m[4][4];
+		struct
+		{
+			float _11, _12, _13, _14;
+			float _21, _22, _23, _24;
+			float _31, _32, _33, _34;
+			float _41, _42, _43, _44;
+		};
+	};
+
+	XMFLOAT4X4() {}
+};
+
+struct XMFLOAT4X3
+{
+	union
+	{
+		float m[4][3];
+		struct
+		{
+			float _11, _12, _13;
+			float _21, _22, _23;
+			float _31, _32, _33;
+			float _41, _42, _43;
+		};
+	};
+
+	XMFLOAT4X3() {}
+};
+
+struct XMFLOAT3X3
+{
+	union
+	{
+		float m[3][3];
+		struct
+		{
+			float _11, _12, _13;
+			float _21, _22, _23;
+			float _31, _32, _33;
+		};
+	};
+
+	XMFLOAT3X3() {}
+};
+
+static const XMVECTORF32 g_XMOne				= { { { 1.0f, 1.0f, 1.0f, 1.0f } } };
+static const XMVECTORF32 g_XMZero				= { { { 0.0f, 0.0f, 0.0f, 0.0f } } };
+static const XMVECTORF32 g_XMIdentityR0			= { { { 1.0f, 0.0f, 0.0f, 0.0f } } };
+static const XMVECTORF32 g_XMIdentityR1			= { { { 0.0f, 1.0f, 0.0f, 0.0f } } };
+static const XMVECTORF32 g_XMIdentityR2			= { { { 0.0f, 0.0f, 1.0f, 0.0f } } };
+static const XMVECTORF32 g_XMIdentityR3			= { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+static const XMVECTORF32 g_XMOneHalf			= { { { 0.5f, 0.5f, 0.5f, 0.5f } } };
+static const XMVECTORF32 g_XMNegativeOneHalf	= { { { -0.5f, -0.5f, -0.5f, -0.5f } } };
+static const XMVECTORF32 g_XMNegateX			= { { { -1.0f, 1.0f, 1.0f, 1.0f } } };
+static const XMVECTORU32 g_XMSelect1000			= { { { 0xFFFFFFFF, 0, 0, 0 } } };
+static const XMVECTORU32 g_XMSelect1100			= { { { 0xFFFFFFFF, 0xFFFFFFFF, 0, 0 } } };
+static const XMVECTORU32 g_XMSelect1110			= { { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0 } } };
+static const XMVECTORU32 g_XMSelect0001			= { { { 0, 0, 0, 0xFFFFFFFF } } };
+
+// DirectXColors.h has the whole palette. These are the ones the engine and game actually use.
+namespace Colors
+{
+	static const XMVECTORF32 Black				= { { { 0.0f, 0.0f, 0.0f, 1.0f } } };
+}
+
+// ----------------------------------------------------------------------------------
+// Backend primitives
+// ----------------------------------------------------------------------------------
+
+#if defined(_XM_SSE_INTRINSICS_)
+
+inline XMVECTOR XM_CALLCONV XMVectorZero() { return _mm_setzero_ps(); }
+inline XMVECTOR XM_CALLCONV XMVectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+inline XMVECTOR XM_CALLCONV XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+inline XMVECTOR XM_CALLCONV XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return _mm_add_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return _mm_sub_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return _mm_div_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline XMVECTOR XM_CALLCONV XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return _mm_min_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return _mm_max_ps(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorSqrt(FXMVECTOR v) { return _mm_sqrt_ps(v); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatX(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatY(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatW(FXMVECTOR v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)); }
+
+inline XMVECTOR XM_CALLCONV XMVectorSelect(FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR control)
+{
+	return _mm_or_ps(_mm_andnot_ps(control, v1), _mm_and_ps(v2, control));
+}
+
+inline float XM_CALLCONV XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+
+inline void XM_CALLCONV XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { _mm_storeu_ps(&destination->x, v); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4(const XMFLOAT4* source) { return _mm_loadu_ps(&source->x); }
+inline void XM_CALLCONV XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { _mm_store_ps(&destination->x, v); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4A(const XMFLOAT4A* source) { return _mm_load_ps(&source->x); }
+
+// Sums of products across lanes, with the result in every lane
+inline XMVECTOR XM_CALLCONV XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+{
+#if defined(_XM_SSE4_INTRINSICS_)
+	return _mm_dp_ps(a, b, 0xFF);
+#else
+	XMVECTOR product = _mm_mul_ps(a, b);
+	XMVECTOR swapped = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1));
+	XMVECTOR sums = _mm_add_ps(product, swapped);
+	swapped = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+	return _mm_add_ps(sums, swapped);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+{
+#if defined(_XM_SSE4_INTRINSICS_)
+	return _mm_dp_ps(a, b, 0x7F);
+#else
+	XMVECTOR product = _mm_mul_ps(a, b);
+	XMVECTOR y = _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1));
+	XMVECTOR z = _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 2, 2, 2));
+	XMVECTOR sum = _mm_add_ss(_mm_add_ss(product, y), z);
+	return _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(0, 0, 0, 0));
+#endif
+}
+
+#elif defined(_XM_ARM_NEON_INTRINSICS_)
+
+inline XMVECTOR XM_CALLCONV XMVectorZero() { return vdupq_n_f32(0.0f); }
+
+inline XMVECTOR XM_CALLCONV XMVectorSet(float x, float y, float z, float w)
+{
+	float values[4] = { x, y, z, w };
+	return vld1q_f32(values);
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorReplicate(float value) { return vdupq_n_f32(value); }
+inline XMVECTOR XM_CALLCONV XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return vaddq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return vsubq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return vmulq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return vmlaq_f32(c, a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMin(FXMVECTOR a, FXMVECTOR b) { return vminq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorMax(FXMVECTOR a, FXMVECTOR b) { return vmaxq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatX(FXMVECTOR v) { return vdupq_lane_f32(vget_low_f32(v), 0); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatY(FXMVECTOR v) { return vdupq_lane_f32(vget_low_f32(v), 1); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ(FXMVECTOR v) { return vdupq_lane_f32(vget_high_f32(v), 0); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatW(FXMVECTOR v) { return vdupq_lane_f32(vget_high_f32(v), 1); }
+
+#if defined(__aarch64__)
+inline XMVECTOR XM_CALLCONV XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return vdivq_f32(a, b); }
+inline XMVECTOR XM_CALLCONV XMVectorSqrt(FXMVECTOR v) { return vsqrtq_f32(v); }
+#else
+// 32 bit ARM has no vector divide or square root, so refine the estimates instead
+inline XMVECTOR XM_CALLCONV XMVectorDivide(FXMVECTOR a, FXMVECTOR b)
+{
+	float32x4_t reciprocal = vrecpeq_f32(b);
+	reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+	reciprocal = vmulq_f32(vrecpsq_f32(b, reciprocal), reciprocal);
+	return vmulq_f32(a, reciprocal);
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSqrt(FXMVECTOR v)
+{
+	float values[4];
+	vst1q_f32(values, v);
+	return XMVectorSet(sqrtf(values[0]), sqrtf(values[1]), sqrtf(values[2]), sqrtf(values[3]));
+}
+#endif
+
+inline XMVECTOR XM_CALLCONV XMVectorSelect(FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR control)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(control), v2, v1);
+}
+
+inline float XM_CALLCONV XMVectorGetX(FXMVECTOR v) { return vgetq_lane_f32(v, 0); }
+
+inline void XM_CALLCONV XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { vst1q_f32(&destination->x, v); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4(const XMFLOAT4* source) { return vld1q_f32(&source->x); }
+inline void XM_CALLCONV XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { vst1q_f32(&destination->x, v); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4A(const XMFLOAT4A* source) { return vld1q_f32(&source->x); }
+
+inline XMVECTOR XM_CALLCONV XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	float32x4_t product = vmulq_f32(a, b);
+	float32x2_t sum = vadd_f32(vget_low_f32(product), vget_high_f32(product));
+	sum = vpadd_f32(sum, sum);
+	return vcombine_f32(sum, sum);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	float32x4_t product = vmulq_f32(a, b);
+	float32x2_t xy = vpadd_f32(vget_low_f32(product), vget_low_f32(product));
+	float32x2_t sum = vadd_f32(xy, vdup_lane_f32(vget_high_f32(product), 0));
+	sum = vdup_lane_f32(sum, 0);
+	return vcombine_f32(sum, sum);
+}
+
+#else
+
+inline XMVECTOR XM_CALLCONV XMVectorSet(float x, float y, float z, float w)
+{
+	XMVECTOR v;
+	v.vector4_f32[0] = x;
+	v.vector4_f32[1] = y;
+	v.vector4_f32[2] = z;
+	v.vector4_f32[3] = w;
+	return v;
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorZero() { return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f); }
+inline XMVECTOR XM_CALLCONV XMVectorReplicate(float value) { return XMVectorSet(value, value, value, value); }
+
+#define XM_SCALAR_OP(a, b, op) XMVectorSet(a.vector4_f32[0] op b.vector4_f32[0], a.vector4_f32[1] op b.vector4_f32[1], \
+										   a.vector4_f32[2] op b.vector4_f32[2], a.vector4_f32[3] op b.vector4_f32[3])
+
+inline XMVECTOR XM_CALLCONV XMVectorAdd(FXMVECTOR a, FXMVECTOR b) { return XM_SCALAR_OP(a, b, +); }
+inline XMVECTOR XM_CALLCONV XMVectorSubtract(FXMVECTOR a, FXMVECTOR b) { return XM_SCALAR_OP(a, b, -); }
+inline XMVECTOR XM_CALLCONV XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return XM_SCALAR_OP(a, b, *); }
+inline XMVECTOR XM_CALLCONV XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return XM_SCALAR_OP(a, b, /); }
+
+#undef XM_SCALAR_OP
+
+inline XMVECTOR XM_CALLCONV XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+{
+	return XMVectorAdd(XMVectorMultiply(a, b), c);
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorMin(FXMVECTOR a, FXMVECTOR b)
+{
+	return XMVectorSet(fminf(a.vector4_f32[0], b.vector4_f32[0]), fminf(a.vector4_f32[1], b.vector4_f32[1]),
+					   fminf(a.vector4_f32[2], b.vector4_f32[2]), fminf(a.vector4_f32[3], b.vector4_f32[3]));
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorMax(FXMVECTOR a, FXMVECTOR b)
+{
+	return XMVectorSet(fmaxf(a.vector4_f32[0], b.vector4_f32[0]), fmaxf(a.vector4_f32[1], b.vector4_f32[1]),
+					   fmaxf(a.vector4_f32[2], b.vector4_f32[2]), fmaxf(a.vector4_f32[3], b.vector4_f32[3]));
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSqrt(FXMVECTOR v)
+{
+	return XMVectorSet(sqrtf(v.vector4_f32[0]), sqrtf(v.vector4_f32[1]), sqrtf(v.vector4_f32[2]), sqrtf(v.vector4_f32[3]));
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatX(FXMVECTOR v) { return XMVectorReplicate(v.vector4_f32[0]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatY(FXMVECTOR v) { return XMVectorReplicate(v.vector4_f32[1]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatZ(FXMVECTOR v) { return XMVectorReplicate(v.vector4_f32[2]); }
+inline XMVECTOR XM_CALLCONV XMVectorSplatW(FXMVECTOR v) { return XMVectorReplicate(v.vector4_f32[3]); }
+
+inline XMVECTOR XM_CALLCONV XMVectorSelect(FXMVECTOR v1, FXMVECTOR v2, FXMVECTOR control)
+{
+	XMVECTOR result;
+	for (int i = 0; i < 4; i++)
+		result.vector4_u32[i] = (v1.vector4_u32[i] & ~control.vector4_u32[i]) | (v2.vector4_u32[i] & control.vector4_u32[i]);
+
+	return result;
+}
+
+inline float XM_CALLCONV XMVectorGetX(FXMVECTOR v) { return v.vector4_f32[0]; }
+
+inline void XM_CALLCONV XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { memcpy(destination, v.vector4_f32, sizeof(XMFLOAT4)); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4(const XMFLOAT4* source) { return XMVectorSet(source->x, source->y, source->z, source->w); }
+inline void XM_CALLCONV XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { XMStoreFloat4(destination, v); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat4A(const XMFLOAT4A* source) { return XMLoadFloat4(source); }
+
+inline XMVECTOR XM_CALLCONV XMVector4Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	return XMVectorReplicate(a.vector4_f32[0] * b.vector4_f32[0] + a.vector4_f32[1] * b.vector4_f32[1] +
+							 a.vector4_f32[2] * b.vector4_f32[2] + a.vector4_f32[3] * b.vector4_f32[3]);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+{
+	return XMVectorReplicate(a.vector4_f32[0] * b.vector4_f32[0] + a.vector4_f32[1] * b.vector4_f32[1] +
+							 a.vector4_f32[2] * b.vector4_f32[2]);
+}
+
+// The SIMD types get these operators from the compiler. The struct needs them spelled out.
+inline XMVECTOR XM_CALLCONV operator+(FXMVECTOR v) { return v; }
+inline XMVECTOR XM_CALLCONV operator-(FXMVECTOR v) { return XMVectorSubtract(XMVectorZero(), v); }
+inline XMVECTOR XM_CALLCONV operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+inline XMVECTOR XM_CALLCONV operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+inline XMVECTOR XM_CALLCONV operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+inline XMVECTOR XM_CALLCONV operator/(FXMVECTOR a, FXMVECTOR b) { return XMVectorDivide(a, b); }
+inline XMVECTOR XM_CALLCONV operator*(FXMVECTOR v, float s) { return XMVectorMultiply(v, XMVectorReplicate(s)); }
+inline XMVECTOR XM_CALLCONV operator*(float s, FXMVECTOR v) { return XMVectorMultiply(XMVectorReplicate(s), v); }
+inline XMVECTOR XM_CALLCONV operator/(FXMVECTOR v, float s) { return XMVectorDivide(v, XMVectorReplicate(s)); }
+inline XMVECTOR& XM_CALLCONV operator+=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorAdd(a, b); return a; }
+inline XMVECTOR& XM_CALLCONV operator-=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorSubtract(a, b); return a; }
+inline XMVECTOR& XM_CALLCONV operator*=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorMultiply(a, b); return a; }
+inline XMVECTOR& XM_CALLCONV operator/=(XMVECTOR& a, FXMVECTOR b) { a = XMVectorDivide(a, b); return a; }
+
+#endif
+
+// The compiler's operators don't look through XMVECTORF32's conversion, so mixing it with vectors and floats needs these
+inline XMVECTOR XM_CALLCONV operator+(FXMVECTOR a, const XMVECTORF32& b) { return XMVectorAdd(a, b); }
+inline XMVECTOR XM_CALLCONV operator+(const XMVECTORF32& a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+inline XMVECTOR XM_CALLCONV operator-(FXMVECTOR a, const XMVECTORF32& b) { return XMVectorSubtract(a, b); }
+inline XMVECTOR XM_CALLCONV operator-(const XMVECTORF32& a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+inline XMVECTOR XM_CALLCONV operator*(FXMVECTOR a, const XMVECTORF32& b) { return XMVectorMultiply(a, b); }
+inline XMVECTOR XM_CALLCONV operator*(const XMVECTORF32& a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+inline XMVECTOR XM_CALLCONV operator*(const XMVECTORF32& v, float s) { return XMVectorMultiply(v, XMVectorReplicate(s)); }
+inline XMVECTOR XM_CALLCONV operator*(float s, const XMVECTORF32& v) { return XMVectorMultiply(XMVectorReplicate(s), v); }
+inline XMVECTOR& XM_CALLCONV operator+=(XMVECTOR& a, const XMVECTORF32& b) { a = XMVectorAdd(a, b); return a; }
+inline XMVECTOR& XM_CALLCONV operator-=(XMVECTOR& a, const XMVECTORF32& b) { a = XMVectorSubtract(a, b); return a; }
+inline XMVECTOR& XM_CALLCONV operator*=(XMVECTOR& a, const XMVECTORF32& b) { a = XMVectorMultiply(a, b); return a; }
+
+// ----------------------------------------------------------------------------------
+// Vector functions (shared by every backend)
+// ----------------------------------------------------------------------------------
+
+inline XMVECTOR XM_CALLCONV XMVectorSplatOne() { return g_XMOne; }
+inline XMVECTOR XM_CALLCONV XMVectorNegate(FXMVECTOR v) { return XMVectorSubtract(XMVectorZero(), v); }
+inline XMVECTOR XM_CALLCONV XMVectorScale(FXMVECTOR v, float scale) { return XMVectorMultiply(v, XMVectorReplicate(scale)); }
+inline XMVECTOR XM_CALLCONV XMVectorReciprocal(FXMVECTOR v) { return XMVectorDivide(g_XMOne, v); }
+
+inline float XM_CALLCONV XMVectorGetY(FXMVECTOR v) { return XMVectorGetX(XMVectorSplatY(v)); }
+inline float XM_CALLCONV XMVectorGetZ(FXMVECTOR v) { return XMVectorGetX(XMVectorSplatZ(v)); }
+inline float XM_CALLCONV XMVectorGetW(FXMVECTOR v) { return XMVectorGetX(XMVectorSplatW(v)); }
+
+inline XMVECTOR XM_CALLCONV XMVectorSetW(FXMVECTOR v, float w)
+{
+	return XMVectorSelect(v, XMVectorReplicate(w), g_XMSelect0001);
+}
+
+inline XMVECTOR XM_CALLCONV XMVectorAbs(FXMVECTOR v) { return XMVectorMax(v, XMVectorNegate(v)); }
+
+// Picks lanes of v by index, e.g. XMVectorSwizzle<0, 2, 3, 3>(v) is (x, z, w, w)
+template<uint32_t SwizzleX, uint32_t SwizzleY, uint32_t SwizzleZ, uint32_t SwizzleW>
+inline XMVECTOR XM_CALLCONV XMVectorSwizzle(FXMVECTOR v)
+{
+	static_assert(SwizzleX < 4 && SwizzleY < 4 && SwizzleZ < 4 && SwizzleW < 4, "Swizzle indices must be 0 to 3");
+#if defined(_XM_SSE_INTRINSICS_)
+	return _mm_shuffle_ps(v, v, _MM_SHUFFLE(SwizzleW, SwizzleZ, SwizzleY, SwizzleX));
+#else
+	XMVECTORF32 lanes;
+	lanes.v = v;
+	return XMVectorSet(lanes.f[SwizzleX], lanes.f[SwizzleY], lanes.f[SwizzleZ], lanes.f[SwizzleW]);
+#endif
+}
+
+inline XMVECTOR XM_CALLCONV XMLoadFloat(const float* source) { return XMVectorSet(*source, 0.0f, 0.0f, 0.0f); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat3(const XMFLOAT3* source) { return XMVectorSet(source->x, source->y, source->z, 0.0f); }
+inline XMVECTOR XM_CALLCONV XMLoadFloat2(const XMFLOAT2* source) { return XMVectorSet(source->x, source->y, 0.0f, 0.0f); }
+
+inline void XM_CALLCONV XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v)
+{
+	XMFLOAT4 temp;
+	XMStoreFloat4(&temp, v);
+	*destination = XMFLOAT3(temp.x, temp.y, temp.z);
+}
+
+inline void XM_CALLCONV XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v)
+{
+	XMFLOAT4 temp;
+	XMStoreFloat4(&temp, v);
+	*destination = XMFLOAT2(temp.x, temp.y);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+inline XMVECTOR XM_CALLCONV XMVector3Length(FXMVECTOR v) { return XMVectorSqrt(XMVector3Dot(v, v)); }
+inline XMVECTOR XM_CALLCONV XMVector4Length(FXMVECTOR v) { return XMVectorSqrt(XMVector4Dot(v, v)); }
+
+inline XMVECTOR XM_CALLCONV XMVector3Normalize(FXMVECTOR v)
+{
+	XMVECTOR length = XMVector3Length(v);
+	if (XMVectorGetX(length) <= 0.0f)
+		return XMVectorZero();
+
+	return XMVectorDivide(v, length);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector4Normalize(FXMVECTOR v)
+{
+	XMVECTOR length = XMVector4Length(v);
+	if (XMVectorGetX(length) <= 0.0f)
+		return XMVectorZero();
+
+	return XMVectorDivide(v, length);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+{
+	XMFLOAT4 fa, fb;
+	XMStoreFloat4(&fa, a);
+	XMStoreFloat4(&fb, b);
+
+	return XMVectorSet(fa.y * fb.z - fa.z * fb.y, fa.z * fb.x - fa.x * fb.z, fa.x * fb.y - fa.y * fb.x, 0.0f);
+}
+
+// Row vector times matrix: v.x * r0 + v.y * r1 + v.z * r2 + v.w * r3
+inline XMVECTOR XM_CALLCONV XMVector4Transform(FXMVECTOR v, FXMMATRIX m)
+{
+	XMVECTOR result = XMVectorMultiply(XMVectorSplatX(v), m.r[0]);
+	result = XMVectorMultiplyAdd(XMVectorSplatY(v), m.r[1], result);
+	result = XMVectorMultiplyAdd(XMVectorSplatZ(v), m.r[2], result);
+	return XMVectorMultiplyAdd(XMVectorSplatW(v), m.r[3], result);
+}
+
+// Treats v as a point (w = 1)
+inline XMVECTOR XM_CALLCONV XMVector3Transform(FXMVECTOR v, FXMMATRIX m)
+{
+	XMVECTOR result = XMVectorMultiplyAdd(XMVectorSplatX(v), m.r[0], m.r[3]);
+	result = XMVectorMultiplyAdd(XMVectorSplatY(v), m.r[1], result);
+	return XMVectorMultiplyAdd(XMVectorSplatZ(v), m.r[2], result);
+}
+
+// As above, then divides through by w
+inline XMVECTOR XM_CALLCONV XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+{
+	XMVECTOR result = XMVector3Transform(v, m);
+	return XMVectorDivide(result, XMVectorSplatW(result));
+}
+
+// Treats v as a direction (w = 0)
+inline XMVECTOR XM_CALLCONV XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m)
+{
+	XMVECTOR result = XMVectorMultiply(XMVectorSplatX(v), m.r[0]);
+	result = XMVectorMultiplyAdd(XMVectorSplatY(v), m.r[1], result);
+	return XMVectorMultiplyAdd(XMVectorSplatZ(v), m.r[2], result);
+}
+
+// ----------------------------------------------------------------------------------
+// Quaternions
+// ----------------------------------------------------------------------------------
+
+inline XMVECTOR XM_CALLCONV XMQuaternionIdentity() { return g_XMIdentityR3; }
+
+inline XMVECTOR XM_CALLCONV XMQuaternionConjugate(FXMVECTOR q)
+{
+	static const XMVECTORF32 negateXYZ = { { { -1.0f, -1.0f, -1.0f, 1.0f } } };
+	return XMVectorMultiply(q, negateXYZ);
+}
+
+// Same order as DirectXMath: the result rotates by q1 and then by q2
+inline XMVECTOR XM_CALLCONV XMQuaternionMultiply(FXMVECTOR q1, FXMVECTOR q2)
+{
+	XMFLOAT4 a, b;
+	XMStoreFloat4(&a, q1);
+	XMStoreFloat4(&b, q2);
+
+	return XMVectorSet((b.w * a.x) + (b.x * a.w) + (b.y * a.z) - (b.z * a.y),
+					   (b.w * a.y) - (b.x * a.z) + (b.y * a.w) + (b.z * a.x),
+					   (b.w * a.z) + (b.x * a.y) - (b.y * a.x) + (b.z * a.w),
+					   (b.w * a.w) - (b.x * a.x) - (b.y * a.y) - (b.z * a.z));
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionNormalize(FXMVECTOR q) { return XMVector4Normalize(q); }
+
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationNormal(FXMVECTOR axis, float angle)
+{
+	float halfAngle = 0.5f * angle;
+	XMVECTOR scale = XMVectorSetW(XMVectorReplicate(sinf(halfAngle)), cosf(halfAngle));
+	return XMVectorMultiply(XMVectorSetW(axis, 1.0f), scale);
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationAxis(FXMVECTOR axis, float angle)
+{
+	return XMQuaternionRotationNormal(XMVector3Normalize(axis), angle);
+}
+
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationRollPitchYaw(float pitch, float yaw, float roll)
+{
+	float sp = sinf(0.5f * pitch), cp = cosf(0.5f * pitch);
+	float sy = sinf(0.5f * yaw), cy = cosf(0.5f * yaw);
+	float sr = sinf(0.5f * roll), cr = cosf(0.5f * roll);
+
+	return XMVectorSet(cr * sp * cy + sr * cp * sy,
+					   cr * cp * sy - sr * sp * cy,
+					   sr * cp * cy - cr * sp * sy,
+					   cr * cp * cy + sr * sp * sy);
+}
+
+inline XMVECTOR XM_CALLCONV XMVector3Rotate(FXMVECTOR v, FXMVECTOR q)
+{
+	XMVECTOR a = XMVectorSelect(XMVectorZero(), v, g_XMSelect1110);
+	XMVECTOR result = XMQuaternionMultiply(XMQuaternionConjugate(q), a);
+	return XMQuaternionMultiply(result, q);
+}
+
+// ----------------------------------------------------------------------------------
+// Matrices
+// ----------------------------------------------------------------------------------
+
+inline XMMATRIX XM_CALLCONV XMMatrixIdentity()
+{
+	return XMMATRIX(g_XMIdentityR0, g_XMIdentityR1, g_XMIdentityR2, g_XMIdentityR3);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixSet(float m00, float m01, float m02, float m03,
+										float m10, float m11, float m12, float m13,
+										float m20, float m21, float m22, float m23,
+										float m30, float m31, float m32, float m33)
+{
+	return XMMATRIX(XMVectorSet(m00, m01, m02, m03), XMVectorSet(m10, m11, m12, m13),
+					XMVectorSet(m20, m21, m22, m23), XMVectorSet(m30, m31, m32, m33));
+}
+
+inline XMMATRIX::XMMATRIX(float m00, float m01, float m02, float m03,
+						  float m10, float m11, float m12, float m13,
+						  float m20, float m21, float m22, float m23,
+						  float m30, float m31, float m32, float m33)
+{
+	*this = XMMatrixSet(m00, m01, m02, m03, m10, m11, m12, m13, m20, m21, m22, m23, m30, m31, m32, m33);
+}
+
+inline XMMATRIX XM_CALLCONV XMLoadFloat4x4(const XMFLOAT4X4* source)
+{
+	const XMFLOAT4* rows = reinterpret_cast<const XMFLOAT4*>(source->m);
+	return XMMATRIX(XMLoadFloat4(&rows[0]), XMLoadFloat4(&rows[1]), XMLoadFloat4(&rows[2]), XMLoadFloat4(&rows[3]));
+}
+
+inline void XM_CALLCONV XMStoreFloat4x4(XMFLOAT4X4* destination, FXMMATRIX m)
+{
+	XMFLOAT4* rows = reinterpret_cast<XMFLOAT4*>(destination->m);
+	for (int i = 0; i < 4; i++)
+		XMStoreFloat4(&rows[i], m.r[i]);
+}
+
+inline void XM_CALLCONV XMStoreFloat4x3(XMFLOAT4X3* destination, FXMMATRIX m)
+{
+	XMFLOAT3* rows = reinterpret_cast<XMFLOAT3*>(destination->m);
+	for (int i = 0; i < 4; i++)
+		XMStoreFloat3(&rows[i], m.r[i]);
+}
+
+inline void XM_CALLCONV XMStoreFloat3x3(XMFLOAT3X3* destination, FXMMATRIX m)
+{
+	XMFLOAT3* rows = reinterpret_cast<XMFLOAT3*>(destination->m);
+	for (int i = 0; i < 3; i++)
+		XMStoreFloat3(&rows[i], m.r[i]);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+{
+	XMMATRIX result;
+	for (int i = 0; i < 4; i++)
+		result.r[i] = XMVector4Transform(a.r[i], b);
+
+	return result;
+}
+
+inline XMMATRIX& XMMATRIX::operator*=(const XMMATRIX& other)
+{
+	*this = XMMatrixMultiply(*this, other);
+	return *this;
+}
+
+inline XMMATRIX XMMATRIX::operator*(const XMMATRIX& other) const
+{
+	return XMMatrixMultiply(*this, other);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixTranspose(FXMMATRIX m)
+{
+#if defined(_XM_SSE_INTRINSICS_)
+	XMMATRIX result = m;
+	_MM_TRANSPOSE4_PS(result.r[0], result.r[1], result.r[2], result.r[3]);
+	return result;
+#else
+	XMFLOAT4X4 source, transposed;
+	XMStoreFloat4x4(&source, m);
+	for (int i = 0; i < 4; i++)
+		for (int j = 0; j < 4; j++)
+			transposed.m[i][j] = source.m[j][i];
+
+	return XMLoadFloat4x4(&transposed);
+#endif
+}
+
+// General 4x4 inverse by cofactors. Writes the determinant to *determinant if it's asked for, and like DirectXMath
+// returns garbage (not a crash) for a singular matrix.
+inline XMMATRIX XM_CALLCONV XMMatrixInverse(XMVECTOR* determinant, FXMMATRIX m)
+{
+	XMFLOAT4X4 f;
+	XMStoreFloat4x4(&f, m);
+	const float* a = &f.m[0][0];
+	float inv[16];
+
+	inv[0]  =  a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+	inv[4]  = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+	inv[8]  =  a[4] * a[9]  * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+	inv[12] = -a[4] * a[9]  * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+	inv[1]  = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+	inv[5]  =  a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+	inv[9]  = -a[0] * a[9]  * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+	inv[13] =  a[0] * a[9]  * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+	inv[2]  =  a[1] * a[6]  * a[15] - a[1] * a[7]  * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7]  - a[13] * a[3] * a[6];
+	inv[6]  = -a[0] * a[6]  * a[15] + a[0] * a[7]  * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7]  + a[12] * a[3] * a[6];
+	inv[10] =  a[0] * a[5]  * a[15] - a[0] * a[7]  * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7]  - a[12] * a[3] * a[5];
+	inv[14] = -a[0] * a[5]  * a[14] + a[0] * a[6]  * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6]  + a[12] * a[2] * a[5];
+	inv[3]  = -a[1] * a[6]  * a[11] + a[1] * a[7]  * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9]  * a[2] * a[7]  + a[9]  * a[3] * a[6];
+	inv[7]  =  a[0] * a[6]  * a[11] - a[0] * a[7]  * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8]  * a[2] * a[7]  - a[8]  * a[3] * a[6];
+	inv[11] = -a[0] * a[5]  * a[11] + a[0] * a[7]  * a[9]  + a[4] * a[1] * a[11] - a[4] * a[3] * a[9]  - a[8]  * a[1] * a[7]  + a[8]  * a[3] * a[5];
+	inv[15] =  a[0] * a[5]  * a[10] - a[0] * a[6]  * a[9]  - a[4] * a[1] * a[10] + a[4] * a[2] * a[9]  + a[8]  * a[1] * a[6]  - a[8]  * a[2] * a[5];
+
+	float det = a[0] * inv[0] + a[1] * inv[4] + a[2] * inv[8] + a[3] * inv[12];
+	if (determinant)
+		*determinant = XMVectorReplicate(det);
+
+	float invDet = 1.0f / det;
+	XMFLOAT4X4 result;
+	float* r = &result.m[0][0];
+	for (int i = 0; i < 16; i++)
+		r[i] = inv[i] * invDet;
+
+	return XMLoadFloat4x4(&result);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixTranslation(float x, float y, float z)
+{
+	return XMMATRIX(g_XMIdentityR0, g_XMIdentityR1, g_XMIdentityR2, XMVectorSet(x, y, z, 1.0f));
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixTranslationFromVector(FXMVECTOR offset)
+{
+	return XMMATRIX(g_XMIdentityR0, g_XMIdentityR1, g_XMIdentityR2, XMVectorSelect(g_XMIdentityR3, offset, g_XMSelect1110));
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixScaling(float x, float y, float z)
+{
+	return XMMATRIX(XMVectorSet(x, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, y, 0.0f, 0.0f),
+					XMVectorSet(0.0f, 0.0f, z, 0.0f), g_XMIdentityR3);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixScalingFromVector(FXMVECTOR scale)
+{
+	return XMMATRIX(XMVectorMultiply(scale, g_XMIdentityR0), XMVectorMultiply(scale, g_XMIdentityR1),
+					XMVectorMultiply(scale, g_XMIdentityR2), g_XMIdentityR3);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixRotationY(float angle)
+{
+	float sin, cos;
+	XMScalarSinCos(&sin, &cos, angle);
+
+	return XMMATRIX(XMVectorSet(cos, 0.0f, -sin, 0.0f), g_XMIdentityR1, XMVectorSet(sin, 0.0f, cos, 0.0f), g_XMIdentityR3);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixRotationQuaternion(FXMVECTOR quaternion)
+{
+	XMFLOAT4 q;
+	XMStoreFloat4(&q, quaternion);
+
+	float x2 = q.x + q.x, y2 = q.y + q.y, z2 = q.z + q.z;
+	float xx = q.x * x2, yy = q.y * y2, zz = q.z * z2;
+	float xy = q.x * y2, xz = q.x * z2, yz = q.y * z2;
+	float wx = q.w * x2, wy = q.w * y2, wz = q.w * z2;
+
+	return XMMATRIX(XMVectorSet(1.0f - yy - zz, xy + wz, xz - wy, 0.0f),
+					XMVectorSet(xy - wz, 1.0f - xx - zz, yz + wx, 0.0f),
+					XMVectorSet(xz + wy, yz - wx, 1.0f - xx - yy, 0.0f),
+					g_XMIdentityR3);
+}
+
+// Reads the rotation out of the upper 3x3, which must be orthonormal. Picks the largest of x, y, z and w to divide by
+// so it stays accurate for every rotation.
+inline XMVECTOR XM_CALLCONV XMQuaternionRotationMatrix(FXMMATRIX m)
+{
+	XMFLOAT4X4 f;
+	XMStoreFloat4x4(&f, m);
+	float r00 = f.m[0][0], r01 = f.m[0][1], r02 = f.m[0][2];
+	float r10 = f.m[1][0], r11 = f.m[1][1], r12 = f.m[1][2];
+	float r20 = f.m[2][0], r21 = f.m[2][1], r22 = f.m[2][2];
+
+	if (r22 <= 0.0f)
+	{
+		float dif10 = r11 - r00;
+		float omr22 = 1.0f - r22;
+		if (dif10 <= 0.0f)
+		{
+			float fourXSqr = omr22 - dif10;
+			float inv4x = 0.5f / sqrtf(fourXSqr);
+			return XMVectorSet(fourXSqr * inv4x, (r01 + r10) * inv4x, (r02 + r20) * inv4x, (r12 - r21) * inv4x);
+		}
+		else
+		{
+			float fourYSqr = omr22 + dif10;
+			float inv4y = 0.5f / sqrtf(fourYSqr);
+			return XMVectorSet((r01 + r10) * inv4y, fourYSqr * inv4y, (r12 + r21) * inv4y, (r20 - r02) * inv4y);
+		}
+	}
+	else
+	{
+		float sum10 = r11 + r00;
+		float opr22 = 1.0f + r22;
+		if (sum10 <= 0.0f)
+		{
+			float fourZSqr = opr22 - sum10;
+			float inv4z = 0.5f / sqrtf(fourZSqr);
+			return XMVectorSet((r02 + r20) * inv4z, (r12 + r21) * inv4z, fourZSqr * inv4z, (r01 - r10) * inv4z);
+		}
+		else
+		{
+			float fourWSqr = opr22 + sum10;
+			float inv4w = 0.5f / sqrtf(fourWSqr);
+			return XMVectorSet((r12 - r21) * inv4w, (r20 - r02) * inv4w, (r01 - r10) * inv4w, fourWSqr * inv4w);
+		}
+	}
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixLookToLH(FXMVECTOR eyePosition, FXMVECTOR eyeDirection, FXMVECTOR upDirection)
+{
+	XMVECTOR r2 = XMVector3Normalize(eyeDirection);
+	XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(upDirection, r2));
+	XMVECTOR r1 = XMVector3Cross(r2, r0);
+
+	XMVECTOR negEye = XMVectorNegate(eyePosition);
+	XMVECTOR d0 = XMVector3Dot(r0, negEye);
+	XMVECTOR d1 = XMVector3Dot(r1, negEye);
+	XMVECTOR d2 = XMVector3Dot(r2, negEye);
+
+	XMMATRIX m(XMVectorSelect(d0, r0, g_XMSelect1110),
+			   XMVectorSelect(d1, r1, g_XMSelect1110),
+			   XMVectorSelect(d2, r2, g_XMSelect1110),
+			   g_XMIdentityR3);
+
+	return XMMatrixTranspose(m);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixLookAtLH(FXMVECTOR eyePosition, FXMVECTOR focusPosition, FXMVECTOR upDirection)
+{
+	return XMMatrixLookToLH(eyePosition, XMVectorSubtract(focusPosition, eyePosition), upDirection);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+{
+	float height = cosf(0.5f * fovAngleY) / sinf(0.5f * fovAngleY);
+	float width = height / aspectRatio;
+	float range = farZ / (farZ - nearZ);
+
+	return XMMatrixSet(width, 0.0f, 0.0f, 0.0f,
+					   0.0f, height, 0.0f, 0.0f,
+					   0.0f, 0.0f, range, 1.0f,
+					   0.0f, 0.0f, -range * nearZ, 0.0f);
+}
+
+inline XMMATRIX XM_CALLCONV XMMatrixOrthographicLH(float viewWidth, float viewHeight, float nearZ, float farZ)
+{
+	float range = 1.0f / (farZ - nearZ);
+
+	return XMMatrixSet(2.0f / viewWidth, 0.0f, 0.0f, 0.0f,
+					   0.0f, 2.0f / viewHeight, 0.0f, 0.0f,
+					   0.0f, 0.0f, range, 0.0f,
+					   0.0f, 0.0f, -range * nearZ, 1.0f);
+}
+
+}
@@ -0,0 +1,403 @@
+#include "RecordedCommandList.h"
+#include <assert.h>
+#include <string.h>
+
+// Every command starts with one of these, and its arguments come straight after. Everything's copied in and out with
+// memcpy, so nothing in the stream has to be aligned.
+struct CommandHeader
+{
+	unsigned char command;
+	unsigned int size;		// Of what follows the header
+};
+
+// ----------------------------------------------------------------------------------
+// Arguments
+// ----------------------------------------------------------------------------------
+
+struct HandleArgs
+{
+	GPUHANDLE handle;
+};
+
+struct SlotArgs
+{
+	unsigned int slot;
+	GPUHANDLE handle;
+};
+
+struct ConstantBufferArgs
+{
+	unsigned int slot;
+	GPUHANDLE buffer;
+	unsigned int offset;
+	unsigned int byteCount;
+};
+
+// The data being uploaded follows these
+struct UpdateBufferArgs
+{
+	GPUHANDLE buffer;
+	unsigned int byteCount;
+};
+
+struct VertexBufferArgs
+{
+	unsigned int slot;
+	GPUHANDLE buffer;
+	unsigned int stride;
+	unsigned int offset;
+};
+
+struct IndexBufferArgs
+{
+	GPUHANDLE buffer;
+	GPU_FORMAT format;
+};
+
+struct DepthStencilStateArgs
+{
+	GPUHANDLE state;
+	unsigned int stencilRef;
+};
+
+struct RenderTargetArgs
+{
+	GPUHANDLE colorTarget;
+	GPUHANDLE depthStencil;
+};
+
+struct ClearRenderTargetArgs
+{
+	GPUHANDLE target;
+	float color[4];
+};
+
+struct ClearDepthStencilArgs
+{
+	GPUHANDLE target;
+	unsigned int clearFlags;
+	float depth;
+	unsigned char stencil;
+};
+
+struct DrawArgs
+{
+	unsigned int vertexCount;
+	unsigned int startVertex;
+};
+
+struct DrawIndexedArgs
+{
+	unsigned int indexCount;
+	unsigned int startIndex;
+	int baseVertex;
+};
+
+struct DrawIndexedInstancedArgs
+{
+	unsigned int indexCount;
+	unsigned int instanceCount;
+	unsigned int startIndex;
+	int baseVertex;
+	unsigned int startInstance;
+};
+
+struct NoArgs
+{
+};
+
+template <typename T>
+static T Read(const unsigned char* position)
+{
+	T args;
+	memcpy(&args, position, sizeof(T));
+	return args;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+RecordedCommandList::RecordedCommandList(const RenderDevice& device)
+	: m_device(device)
+	, m_closed(false)
+{
+}
+
+RecordedCommandList::~RecordedCommandList()
+{
+}
+
+template <typename T>
+void RecordedCommandList::Write(COMMAND command, const T& args, const void* extra, unsigned int extraSize)
+{
+	assert(!m_closed && "Reset the list before recording into it again");
+
+	CommandHeader header;
+	header.command = (unsigned char)command;
+	header.size = (unsigned int)sizeof(T) + extraSize;
+
+	size_t position = m_commands.size();
+	m_commands.resize(position + sizeof(header) + header.size);
+
+	unsigned char* out = m_commands.data() + position;
+	memcpy(out, &header, sizeof(header));
+	memcpy(out + sizeof(header), &args, sizeof(T));
+	if (extraSize > 0)
+		memcpy(out + sizeof(header) + sizeof(T), extra, extraSize);
+}
+
+void RecordedCommandList::UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount)
+{
+	// The data has to be copied now, since the caller is free to change it as soon as this returns
+	unsigned int size = byteCount != 0 ? byteCount : m_device.GetBufferSize(buffer);
+	assert(data && size > 0 && "UpdateBuffer needs data and a live buffer");
+
+	UpdateBufferArgs args = { buffer, byteCount };
+	Write(COMMAND::UPDATE_BUFFER, args, data, size);
+}
+
+void RecordedCommandList::SetVertexShader(GPUHANDLE shader)
+{
+	HandleArgs args = { shader };
+	Write(COMMAND::SET_VERTEX_SHADER, args);
+}
+
+void RecordedCommandList::SetPixelShader(GPUHANDLE shader)
+{
+	HandleArgs args = { shader };
+	Write(COMMAND::SET_PIXEL_SHADER, args);
+}
+
+void RecordedCommandList::SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset)
+{
+	VertexBufferArgs args = { slot, buffer, stride, offset };
+	Write(COMMAND::SET_VERTEX_BUFFER, args);
+}
+
+void RecordedCommandList::SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format)
+{
+	IndexBufferArgs args = { buffer, format };
+	Write(COMMAND::SET_INDEX_BUFFER, args);
+}
+
+void RecordedCommandList::SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	ConstantBufferArgs args = { slot, buffer, offset, byteCount };
+	Write(COMMAND::SET_VS_CONSTANT_BUFFER, args);
+}
+
+void RecordedCommandList::SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	ConstantBufferArgs args = { slot, buffer, offset, byteCount };
+	Write(COMMAND::SET_PS_CONSTANT_BUFFER, args);
+}
+
+void RecordedCommandList::SetPSTexture(unsigned int slot, GPUHANDLE texture)
+{
+	SlotArgs args = { slot, texture };
+	Write(COMMAND::SET_PS_TEXTURE, args);
+}
+
+void RecordedCommandList::SetPSSampler(unsigned int slot, GPUHANDLE sampler)
+{
+	SlotArgs args = { slot, sampler };
+	Write(COMMAND::SET_PS_SAMPLER, args);
+}
+
+void RecordedCommandList::SetRasterizerState(GPUHANDLE state)
+{
+	HandleArgs args = { state };
+	Write(COMMAND::SET_RASTERIZER_STATE, args);
+}
+
+void RecordedCommandList::SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef)
+{
+	DepthStencilStateArgs args = { state, stencilRef };
+	Write(COMMAND::SET_DEPTH_STENCIL_STATE, args);
+}
+
+void RecordedCommandList::SetBlendState(GPUHANDLE state)
+{
+	HandleArgs args = { state };
+	Write(COMMAND::SET_BLEND_STATE, args);
+}
+
+void RecordedCommandList::SetViewport(const Viewport& viewport)
+{
+	Write(COMMAND::SET_VIEWPORT, viewport);
+}
+
+void RecordedCommandList::SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil)
+{
+	RenderTargetArgs args = { colorTarget, depthStencil };
+	Write(COMMAND::SET_RENDER_TARGET, args);
+}
+
+void RecordedCommandList::ClearState()
+{
+	Write(COMMAND::CLEAR_STATE, NoArgs());
+}
+
+void RecordedCommandList::ClearRenderTarget(GPUHANDLE target, const float color[4])
+{
+	ClearRenderTargetArgs args;
+	args.target = target;
+	memcpy(args.color, color, sizeof(args.color));
+	Write(COMMAND::CLEAR_RENDER_TARGET, args);
+}
+
+void RecordedCommandList::ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil)
+{
+	ClearDepthStencilArgs args = { target, clearFlags, depth, stencil };
+	Write(COMMAND::CLEAR_DEPTH_STENCIL, args);
+}
+
+void RecordedCommandList::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	DrawArgs args = { vertexCount, startVertex };
+	Write(COMMAND::DRAW, args);
+}
+
+void RecordedCommandList::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	DrawIndexedArgs args = { indexCount, startIndex, baseVertex };
+	Write(COMMAND::DRAW_INDEXED, args);
+}
+
+void RecordedCommandList::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	DrawIndexedInstancedArgs args = { indexCount, instanceCount, startIndex, baseVertex, startInstance };
+	Write(COMMAND::DRAW_INDEXED_INSTANCED, args);
+}
+
+void RecordedCommandList::Close()
+{
+	m_closed = true;
+}
+
+bool RecordedCommandList::IsClosed() const
+{
+	return m_closed;
+}
+
+void RecordedCommandList::Replay(RenderContext& context) const
+{
+	const unsigned char* position = m_commands.data();
+	const unsigned char* end = position + m_commands.size();
+
+	while (position < end)
+	{
+		CommandHeader header = Read<CommandHeader>(position);
+		const unsigned char* args = position + sizeof(header);
+		position = args + header.size;
+
+		switch ((COMMAND)header.command)
+		{
+		case COMMAND::UPDATE_BUFFER:
+		{
+			UpdateBufferArgs update = Read<UpdateBufferArgs>(args);
+			context.UpdateBuffer(update.buffer, args + sizeof(update), update.byteCount);
+			break;
+		}
+		case COMMAND::SET_VERTEX_SHADER:		context.SetVertexShader(Read<HandleArgs>(args).handle); break;
+		case COMMAND::SET_PIXEL_SHADER:			context.SetPixelShader(Read<HandleArgs>(args).handle); break;
+		case COMMAND::SET_VERTEX_BUFFER:
+		{
+			VertexBufferArgs vb = Read<VertexBufferArgs>(args);
+			context.SetVertexBuffer(vb.slot, vb.buffer, vb.stride, vb.offset);
+			break;
+		}
+		case COMMAND::SET_INDEX_BUFFER:
+		{
+			IndexBufferArgs ib = Read<IndexBufferArgs>(args);
+			context.SetIndexBuffer(ib.buffer, ib.format);
+			break;
+		}
+		case COMMAND::SET_VS_CONSTANT_BUFFER:
+		{
+			ConstantBufferArgs cb = Read<ConstantBufferArgs>(args);
+			context.SetVSConstantBuffer(cb.slot, cb.buffer, cb.offset, cb.byteCount);
+			break;
+		}
+		case COMMAND::SET_PS_CONSTANT_BUFFER:
+		{
+			ConstantBufferArgs cb = Read<ConstantBufferArgs>(args);
+			context.SetPSConstantBuffer(cb.slot, cb.buffer, cb.offset, cb.byteCount);
+			break;
+		}
+		case COMMAND::SET_PS_TEXTURE:
+		{
+			SlotArgs texture = Read<SlotArgs>(args);
+			context.SetPSTexture(texture.slot, texture.handle);
+			break;
+		}
+		case COMMAND::SET_PS_SAMPLER:
+		{
+			SlotArgs sampler = Read<SlotArgs>(args);
+			context.SetPSSampler(sampler.slot, sampler.handle);
+			break;
+		}
+		case COMMAND::SET_RASTERIZER_STATE:		context.SetRasterizerState(Read<HandleArgs>(args).handle); break;
+		case COMMAND::SET_DEPTH_STENCIL_STATE:
+		{
+			DepthStencilStateArgs state = Read<DepthStencilStateArgs>(args);
+			context.SetDepthStencilState(state.state, state.stencilRef);
+			break;
+		}
+		case COMMAND::SET_BLEND_STATE:			context.SetBlendState(Read<HandleArgs>(args).handle); break;
+		case COMMAND::SET_VIEWPORT:				context.SetViewport(Read<Viewport>(args)); break;
+		case COMMAND::SET_RENDER_TARGET:
+		{
+			RenderTargetArgs targets = Read<RenderTargetArgs>(args);
+			context.SetRenderTarget(targets.colorTarget, targets.depthStencil);
+			break;
+		}
+		case COMMAND::CLEAR_STATE:				context.ClearState(); break;
+		case COMMAND::CLEAR_RENDER_TARGET:
+		{
+			ClearRenderTargetArgs clear = Read<ClearRenderTargetArgs>(args);
+			context.ClearRenderTarget(clear.target, clear.color);
+			break;
+		}
+		case COMMAND::CLEAR_DEPTH_STENCIL:
+		{
+			ClearDepthStencilArgs clear = Read<ClearDepthStencilArgs>(args);
+			context.ClearDepthStencil(clear.target, clear.clearFlags, clear.depth, clear.stencil);
+			break;
+		}
+		case COMMAND::DRAW:
+		{
+			DrawArgs draw = Read<DrawArgs>(args);
+			context.Draw(draw.vertexCount, draw.startVertex);
+			break;
+		}
+		case COMMAND::DRAW_INDEXED:
+		{
+			DrawIndexedArgs draw = Read<DrawIndexedArgs>(args);
+			context.DrawIndexed(draw.indexCount, draw.startIndex, draw.baseVertex);
+			break;
+		}
+		case COMMAND::DRAW_INDEXED_INSTANCED:
+		{
+			DrawIndexedInstancedArgs draw = Read<DrawIndexedInstancedArgs>(args);
+			context.DrawIndexedInstanced(draw.indexCount, draw.instanceCount, draw.startIndex, draw.baseVertex, draw.startInstance);
+			break;
+		}
+		default:
+			assert(false && "Unknown command in a recorded list");
+			return;
+		}
+	}
+}
+
+void RecordedCommandList::Reset()
+{
+	m_commands.clear();
+	m_closed = false;
+}
+
+size_t RecordedCommandList::GetSize() const
+{
+	return m_commands.size();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "RenderDevice.h"
+#include <vector>
+
+// The RenderCommandList for devices that don't have a way of their own: every call is written into a buffer, buffer
+// updates along with a copy of their data, and Replay makes the same calls again in the same order. Nothing is checked
+// while recording. Whatever is wrong with a call shows up when it's played back on the device.
+//
+// The buffer is kept when the list is reset, so a list recorded every frame stops allocating once it's seen its
+// biggest frame.
+class RecordedCommandList : public RenderCommandList
+{
+private:
+	enum class COMMAND : unsigned char
+	{
+		UPDATE_BUFFER,
+		SET_VERTEX_SHADER,
+		SET_PIXEL_SHADER,
+		SET_VERTEX_BUFFER,
+		SET_INDEX_BUFFER,
+		SET_VS_CONSTANT_BUFFER,
+		SET_PS_CONSTANT_BUFFER,
+		SET_PS_TEXTURE,
+		SET_PS_SAMPLER,
+		SET_RASTERIZER_STATE,
+		SET_DEPTH_STENCIL_STATE,
+		SET_BLEND_STATE,
+		SET_VIEWPORT,
+		SET_RENDER_TARGET,
+		CLEAR_STATE,
+		CLEAR_RENDER_TARGET,
+		CLEAR_DEPTH_STENCIL,
+		DRAW,
+		DRAW_INDEXED,
+		DRAW_INDEXED_INSTANCED
+	};
+
+	// Only asked how big buffers are, for updates that don't say
+	const RenderDevice& m_device;
+
+	std::vector<unsigned char> m_commands;
+	bool m_closed;
+
+	// Appends a command and its arguments, plus extraSize bytes from extra after them
+	template <typename T>
+	void Write(COMMAND command, const T& args, const void* extra = nullptr, unsigned int extraSize = 0);
+
+public:
+	explicit RecordedCommandList(const RenderDevice& device);
+	~RecordedCommandList();
+
+	void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) override;
+
+	void SetVertexShader(GPUHANDLE shader) override;
+	void SetPixelShader(GPUHANDLE shader) override;
+	void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) override;
+	void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) override;
+	void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSTexture(unsigned int slot, GPUHANDLE texture) override;
+	void SetPSSampler(unsigned int slot, GPUHANDLE sampler) override;
+	void SetRasterizerState(GPUHANDLE state) override;
+	void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) override;
+	void SetBlendState(GPUHANDLE state) override;
+	void SetViewport(const Viewport& viewport) override;
+	void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) override;
+	void ClearState() override;
+
+	void ClearRenderTarget(GPUHANDLE target, const float color[4]) override;
+	void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) override;
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+
+	void Close() override;
+
+	bool IsClosed() const;
+
+	// Makes every recorded call on context, in order
+	void Replay(RenderContext& context) const;
+
+	// Empties the list so it can be recorded again
+	void Reset();
+
+	// How many bytes the recorded calls take up
+	size_t GetSize() const;
+};
@@ -0,0 +1,121 @@
+#include "RenderDevice.h"
+#include "RecordedCommandList.h"
+#include <assert.h>
+#include <string.h>
+
+// ----------------------------------------------------------------------------------
+// Format Helpers
+// ----------------------------------------------------------------------------------
+
+unsigned int GetFormatSize(GPU_FORMAT format)
+{
+	switch (format)
+	{
+	case GPU_FORMAT::R16_UINT:
+	case GPU_FORMAT::D16_UNORM:
+		return 2;
+	case GPU_FORMAT::R8G8B8A8_UNORM:
+	case GPU_FORMAT::R32_UINT:
+	case GPU_FORMAT::R32_FLOAT:
+	case GPU_FORMAT::D24_UNORM_S8_UINT:
+	case GPU_FORMAT::D32_FLOAT:
+		return 4;
+	case GPU_FORMAT::R32G32_FLOAT:
+		return 8;
+	case GPU_FORMAT::R32G32B32_FLOAT:
+		return 12;
+	case GPU_FORMAT::R32G32B32A32_FLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+bool IsDepthFormat(GPU_FORMAT format)
+{
+	return format == GPU_FORMAT::D16_UNORM || format == GPU_FORMAT::D24_UNORM_S8_UINT || format == GPU_FORMAT::D32_FLOAT;
+}
+
+bool HasStencil(GPU_FORMAT format)
+{
+	return format == GPU_FORMAT::D24_UNORM_S8_UINT;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+RenderDevice::RenderDevice()
+{
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+	memset(&m_lastFrameStats, 0, sizeof(m_lastFrameStats));
+	memset(&m_totalStats, 0, sizeof(m_totalStats));
+	m_lastFence = 0;
+}
+
+RenderDevice::~RenderDevice()
+{
+}
+
+void RenderDevice::AddStats(RenderDeviceStats& total, const RenderDeviceStats& stats)
+{
+	total.draws += stats.draws;
+	total.triangles += stats.triangles;
+	total.stateChanges += stats.stateChanges;
+	total.redundantStateChanges += stats.redundantStateChanges;
+	total.bytesUploaded += stats.bytesUploaded;
+	total.resourcesCreated += stats.resourcesCreated;
+	total.validationErrors += stats.validationErrors;
+}
+
+unsigned long long RenderDevice::InsertFence()
+{
+	return ++m_lastFence;
+}
+
+bool RenderDevice::IsFenceComplete(unsigned long long fence)
+{
+	return fence <= m_lastFence;
+}
+
+void RenderDevice::WaitForFence(unsigned long long fence)
+{
+	assert(IsFenceComplete(fence) && "Nothing can finish a fence that hasn't been inserted yet");
+}
+
+std::unique_ptr<RenderCommandList> RenderDevice::CreateCommandList()
+{
+	return std::unique_ptr<RenderCommandList>(new RecordedCommandList(*this));
+}
+
+void RenderDevice::ExecuteCommandList(RenderCommandList& list)
+{
+	// Only ever handed lists it made itself, and a backend that makes its own kind overrides this too
+	RecordedCommandList& recorded = static_cast<RecordedCommandList&>(list);
+	assert(recorded.IsClosed() && "Close a command list before executing it");
+
+	// The list can't see what was bound before it, and nothing it binds is left bound afterwards, the same as D3D11
+	ClearState();
+	recorded.Replay(*this);
+	ClearState();
+
+	recorded.Reset();
+}
+
+void RenderDevice::BeginFrame()
+{
+	AddStats(m_totalStats, m_frameStats);
+
+	m_lastFrameStats = m_frameStats;
+	memset(&m_frameStats, 0, sizeof(m_frameStats));
+}
+
+const RenderDeviceStats& RenderDevice::GetStats() const
+{
+	return m_lastFrameStats;
+}
+
+const RenderDeviceStats& RenderDevice::GetTotalStats() const
+{
+	return m_totalStats;
+}
@@ -0,0 +1,457 @@
+#pragma once
+#include <assert.h>
+#include <stddef.h>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// The compiled shader headers (fxc /Fh) declare their bytecode with the Windows typedef. Repeating it is fine when
+// windows.h has been included too, it's the same type.
+typedef unsigned char BYTE;
+
+// Everything a RenderDevice creates is referred to by one of these. The top 4 bits say what kind of resource it is, so a
+// backend can tell when it's handed a texture where it wanted a buffer. The low 16 bits index that kind's table, and the
+// 12 in between hold the generation of the slot, like SlotArray's handles, so a handle to something that was released is
+// still caught after its slot has been reused. Generations start at 1, so 0 is never a valid handle, and wherever a
+// handle is optional it means "nothing".
+typedef unsigned int GPUHANDLE;
+
+#define GPU_HANDLE_INDEX_BITS 16
+#define GPU_HANDLE_GENERATION_BITS 12
+#define GPU_HANDLE_INDEX_MASK ((1U << GPU_HANDLE_INDEX_BITS) - 1)
+#define GPU_HANDLE_GENERATION_MASK ((1U << GPU_HANDLE_GENERATION_BITS) - 1)
+#define GPU_HANDLE_KIND_SHIFT (GPU_HANDLE_INDEX_BITS + GPU_HANDLE_GENERATION_BITS)
+
+enum class GPU_RESOURCE : unsigned char
+{
+	NONE,
+	BUFFER,
+	VERTEX_SHADER,
+	PIXEL_SHADER,
+	TEXTURE,
+	RASTERIZER_STATE,
+	DEPTH_STENCIL_STATE,
+	BLEND_STATE,
+	SAMPLER_STATE,
+	COUNT
+};
+
+static_assert((unsigned int)GPU_RESOURCE::COUNT <= (1U << (32 - GPU_HANDLE_KIND_SHIFT)), "GPU_RESOURCE doesn't fit in a GPUHANDLE");
+
+inline GPUHANDLE MakeGPUHandle(GPU_RESOURCE kind, unsigned int index, unsigned int generation)
+{
+	return ((unsigned int)kind << GPU_HANDLE_KIND_SHIFT) | (generation << GPU_HANDLE_INDEX_BITS) | index;
+}
+
+inline GPU_RESOURCE GetGPUHandleKind(GPUHANDLE handle)
+{
+	return (GPU_RESOURCE)(handle >> GPU_HANDLE_KIND_SHIFT);
+}
+
+inline unsigned int GetGPUHandleIndex(GPUHANDLE handle)
+{
+	return handle & GPU_HANDLE_INDEX_MASK;
+}
+
+inline unsigned int GetGPUHandleGeneration(GPUHANDLE handle)
+{
+	return (handle >> GPU_HANDLE_INDEX_BITS) & GPU_HANDLE_GENERATION_MASK;
+}
+
+// Only the formats something in the engine or the game actually uses
+enum class GPU_FORMAT
+{
+	UNKNOWN,
+	R8G8B8A8_UNORM,
+	R16_UINT,
+	R32_UINT,
+	R32_FLOAT,
+	R32G32_FLOAT,
+	R32G32B32_FLOAT,
+	R32G32B32A32_FLOAT,
+	D16_UNORM,
+	D24_UNORM_S8_UINT,
+	D32_FLOAT,
+	COUNT
+};
+
+// Size of one texel/element in bytes, 0 for UNKNOWN
+unsigned int GetFormatSize(GPU_FORMAT format);
+bool IsDepthFormat(GPU_FORMAT format);
+bool HasStencil(GPU_FORMAT format);
+
+// One attribute of a vertex, for building the input layout that goes with a vertex shader. Attributes can come from more
+// than one vertex buffer, and per instance ones step once per instance instead of once per vertex. Leaving the last two
+// out gives the usual per vertex attribute from slot 0.
+struct VertexElement
+{
+	const char* semantic;
+	unsigned int semanticIndex;
+	GPU_FORMAT format;
+	unsigned int offset;	// Bytes from the start of the vertex
+	unsigned int inputSlot;	// Which vertex buffer it's in
+	bool perInstance;
+};
+
+enum class BUFFER_TYPE
+{
+	VERTEX,
+	INDEX,
+	CONSTANT
+};
+
+// What a texture can be bound as. They can be combined.
+enum TEXTURE_BIND
+{
+	BIND_SHADER_RESOURCE	= 0x1,
+	BIND_RENDER_TARGET		= 0x2,
+	BIND_DEPTH_STENCIL		= 0x4
+};
+
+// Depth textures that are also shader resources are created typeless behind the scenes, so asking for
+// D24_UNORM_S8_UINT with BIND_SHADER_RESOURCE just works.
+struct TextureDesc
+{
+	unsigned int width;
+	unsigned int height;
+	GPU_FORMAT format;
+	unsigned int mipLevels;
+	unsigned int sampleCount;
+	unsigned int sampleQuality;
+	unsigned int bindFlags;
+	bool autoGenMipMaps;
+
+	TextureDesc()
+		: width(0)
+		, height(0)
+		, format(GPU_FORMAT::UNKNOWN)
+		, mipLevels(1)
+		, sampleCount(1)
+		, sampleQuality(0)
+		, bindFlags(0)
+		, autoGenMipMaps(false)
+	{}
+};
+
+enum class CULL_MODE
+{
+	NONE,
+	FRONT,
+	BACK
+};
+
+enum class FILL_MODE
+{
+	SOLID,
+	WIREFRAME
+};
+
+enum class COMPARISON_FUNC
+{
+	NEVER,
+	LESS,
+	EQUAL,
+	LESS_EQUAL,
+	GREATER,
+	NOT_EQUAL,
+	GREATER_EQUAL,
+	ALWAYS
+};
+
+enum class BLEND_FACTOR
+{
+	ZERO,
+	ONE,
+	SRC_ALPHA,
+	INV_SRC_ALPHA
+};
+
+enum class TEXTURE_FILTER
+{
+	POINT,
+	LINEAR,
+	ANISOTROPIC
+};
+
+enum class TEXTURE_ADDRESS
+{
+	WRAP,
+	CLAMP
+};
+
+// The state descriptions only cover the knobs the RenderManager's preconfigured states turn. Anything not in here is
+// left at the D3D11 defaults.
+struct RasterizerDesc
+{
+	CULL_MODE cullMode;
+	FILL_MODE fillMode;
+};
+
+struct DepthStencilDesc
+{
+	bool depthEnable;
+	bool depthWriteEnable;
+	bool stencilEnable;
+	bool stencilWriteEnable;		// Writes the stencil reference wherever the stencil test passes
+	COMPARISON_FUNC stencilFunc;
+};
+
+struct BlendDesc
+{
+	BLEND_FACTOR srcBlend;
+	BLEND_FACTOR destBlend;
+	bool colorWriteEnable;
+};
+
+struct SamplerDesc
+{
+	TEXTURE_FILTER filter;
+	TEXTURE_ADDRESS addressMode;
+};
+
+struct Viewport
+{
+	float topLeftX;
+	float topLeftY;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+enum CLEAR_FLAG
+{
+	CLEAR_DEPTH		= 0x1,
+	CLEAR_STENCIL	= 0x2
+};
+
+// Where a bound part of a constant buffer can start, and what its size has to be a multiple of. It's 16 float4s on
+// D3D11.1.
+#define CONSTANT_BUFFER_OFFSET_ALIGNMENT 256
+
+// The most of a constant buffer a shader can see at once, which is also as big as a whole one bound can be: 4096 float4s
+#define CONSTANT_BUFFER_MAX_BOUND_SIZE (4096 * 16)
+
+// What a device did over a frame. Every backend counts draws, binds and uploads. Redundant binds and validation errors
+// are only picked up by the null device, which is the one that goes looking for them.
+struct RenderDeviceStats
+{
+	unsigned int draws;
+	unsigned long long triangles;
+	unsigned int stateChanges;				// Calls that bind a shader, buffer, texture, state object, target or viewport
+	unsigned int redundantStateChanges;		// The ones that bound what was already bound
+	unsigned long long bytesUploaded;		// Initial buffer data and buffer updates
+	unsigned int resourcesCreated;
+	unsigned int validationErrors;
+};
+
+// Storage for one kind of resource in a backend. Released slots get reused, so indices stay small, with the slot's
+// generation bumped so handles to whatever was there before stay invalid.
+template<typename T, GPU_RESOURCE Kind>
+class GPUResourceTable
+{
+private:
+	std::vector<T> m_items;
+	std::vector<unsigned short> m_generations;
+	std::vector<bool> m_live;
+	std::vector<unsigned int> m_freeSlots;
+
+public:
+	GPUHANDLE Add(T&& item)
+	{
+		unsigned int index;
+		if (!m_freeSlots.empty())
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+			m_items[index] = std::move(item);
+			m_live[index] = true;
+		}
+		else
+		{
+			index = (unsigned int)m_items.size();
+			assert(index <= GPU_HANDLE_INDEX_MASK && "Out of GPU resource slots");
+
+			m_items.push_back(std::move(item));
+			m_generations.push_back(1);
+			m_live.push_back(true);
+		}
+
+		return MakeGPUHandle(Kind, index, m_generations[index]);
+	}
+
+	// Null if the handle is for some other kind of resource or has been released
+	T* Get(GPUHANDLE handle)
+	{
+		if (GetGPUHandleKind(handle) != Kind)
+			return nullptr;
+
+		unsigned int index = GetGPUHandleIndex(handle);
+		if (index >= m_items.size() || !m_live[index] || m_generations[index] != GetGPUHandleGeneration(handle))
+			return nullptr;
+
+		return &m_items[index];
+	}
+
+	const T* Get(GPUHANDLE handle) const
+	{
+		return const_cast<GPUResourceTable*>(this)->Get(handle);
+	}
+
+	bool Remove(GPUHANDLE handle)
+	{
+		T* item = Get(handle);
+		if (!item)
+			return false;
+
+		unsigned int index = GetGPUHandleIndex(handle);
+		*item = T();
+		m_generations[index] = (unsigned short)((m_generations[index] % GPU_HANDLE_GENERATION_MASK) + 1);
+		m_live[index] = false;
+		m_freeSlots.push_back(index);
+		return true;
+	}
+};
+
+// The half of a RenderDevice that issues commands: updating buffers, binding things, clearing and drawing. The device is
+// one itself, for drawing straight away on the thread that owns it, and so is a RenderCommandList, for recording on any
+// other thread.
+class RenderContext
+{
+public:
+	virtual ~RenderContext() {}
+
+	// Replaces the contents of a buffer. byteCount of 0 means all of it, so data has to be as big as the buffer is.
+	// Only vertex and index buffers can be updated in part, and for a dynamic buffer whatever comes after byteCount is
+	// gone afterwards (it's thrown away and a fresh one handed out, so the GPU never has to wait).
+	virtual void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) = 0;
+
+	// Setting a vertex shader also sets the input layout that was created with it
+	virtual void SetVertexShader(GPUHANDLE shader) = 0;
+	virtual void SetPixelShader(GPUHANDLE shader) = 0;
+	virtual void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) = 0;
+	virtual void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) = 0;
+
+	// offset and byteCount bind just part of the buffer, which the shader sees as if it were the whole thing. Both have
+	// to be multiples of CONSTANT_BUFFER_OFFSET_ALIGNMENT, and leaving them at 0 binds all of it. Only devices that
+	// SupportsConstantBufferOffsets can do anything but the whole buffer.
+	virtual void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) = 0;
+	virtual void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) = 0;
+
+	virtual void SetPSTexture(unsigned int slot, GPUHANDLE texture) = 0;
+	virtual void SetPSSampler(unsigned int slot, GPUHANDLE sampler) = 0;
+	virtual void SetRasterizerState(GPUHANDLE state) = 0;
+	virtual void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) = 0;
+	virtual void SetBlendState(GPUHANDLE state) = 0;
+	virtual void SetViewport(const Viewport& viewport) = 0;
+
+	// Either target can be 0. Like D3D11, binding a texture as a target unbinds it from any shader resource slots.
+	virtual void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) = 0;
+
+	// Unbinds everything, viewport and targets included, and puts the states back to the defaults
+	virtual void ClearState() = 0;
+
+	virtual void ClearRenderTarget(GPUHANDLE target, const float color[4]) = 0;
+	virtual void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) = 0;
+
+	virtual void Draw(unsigned int vertexCount, unsigned int startVertex) = 0;
+	virtual void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+
+	// Draws the indexed geometry instanceCount times in one go. Per instance attributes are read from startInstance on.
+	virtual void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+};
+
+// Commands recorded for later, so several threads can build up a frame at once. On D3D11 this is a deferred context,
+// elsewhere a plain list of the calls that gets played back on the device.
+//
+// Same as a deferred context, a list starts out with nothing at all bound (not even a viewport) and can't see what the
+// device or any other list had bound. Executing one leaves nothing bound on the device either.
+class RenderCommandList : public RenderContext
+{
+public:
+	// Has to be called on the recording thread once everything's been recorded, before the list is executed
+	virtual void Close() = 0;
+};
+
+// Everything the engine needs from a graphics API: buffers, shaders, state objects, render targets, draws and present.
+// RenderManager and Mesh only ever talk to the GPU through one of these, so a backend can be swapped without them
+// noticing. D3D11RenderDevice is the real one. NullRenderDevice draws nothing and checks every call instead, for
+// machines without a GPU.
+//
+// Everything is drawn as triangle lists. Create functions return 0 when they fail, after the backend has reported why.
+//
+// The device itself is only for the thread that owns it. Other threads can record into command lists, each into its
+// own, as long as nothing is created or released while they do.
+class RenderDevice : public RenderContext
+{
+protected:
+	RenderDeviceStats m_frameStats;
+
+	static void AddStats(RenderDeviceStats& total, const RenderDeviceStats& stats);
+
+private:
+	RenderDeviceStats m_lastFrameStats;
+	RenderDeviceStats m_totalStats;
+
+	// For the default fences, which are done as soon as they're inserted
+	unsigned long long m_lastFence;
+
+public:
+	RenderDevice();
+	virtual ~RenderDevice();
+
+	virtual const char* GetName() const = 0;
+
+	// Resource creation. initialData may be null, in which case the buffer starts out zeroed. Dynamic buffers are for
+	// data that's rewritten every frame, like instance data.
+	virtual GPUHANDLE CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic = false) = 0;
+	virtual GPUHANDLE CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount) = 0;
+	virtual GPUHANDLE CreatePixelShader(const void* bytecode, size_t bytecodeSize) = 0;
+	virtual GPUHANDLE CreateTexture(const TextureDesc& desc) = 0;
+	virtual GPUHANDLE CreateRasterizerState(const RasterizerDesc& desc) = 0;
+	virtual GPUHANDLE CreateDepthStencilState(const DepthStencilDesc& desc) = 0;
+	virtual GPUHANDLE CreateBlendState(const BlendDesc& desc) = 0;
+	virtual GPUHANDLE CreateSamplerState(const SamplerDesc& desc) = 0;
+	virtual void Release(GPUHANDLE handle) = 0;
+
+	// 0 if the handle isn't a live buffer
+	virtual unsigned int GetBufferSize(GPUHANDLE buffer) const = 0;
+
+	// Writes part of a dynamic buffer and leaves the rest of it alone, without waiting for the GPU or handing out fresh
+	// memory the way UpdateBuffer does. That makes it the caller's job not to write anywhere a draw the GPU hasn't
+	// finished yet might still read, which is what fences are for.
+	virtual void UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount) = 0;
+
+	// Whether constant buffers can be bound in part, and dynamic constant buffers written with UpdateBufferRange.
+	// D3D11 needs the 11.1 runtime and a driver that does both.
+	virtual bool SupportsConstantBufferOffsets() const = 0;
+
+	// A fence is done once the GPU has finished everything issued before it was inserted. Values only go up, and 0 is
+	// always done. The defaults are for devices that finish everything as it's issued.
+	virtual unsigned long long InsertFence();
+	virtual bool IsFenceComplete(unsigned long long fence);
+	virtual void WaitForFence(unsigned long long fence);
+
+	// The default list records the calls and ExecuteCommandList plays them back on the device, so a backend only has
+	// to override these if it has something better.
+	virtual std::unique_ptr<RenderCommandList> CreateCommandList();
+
+	// Plays back a closed list in order, after everything the device has been asked to do so far. The list is empty
+	// afterwards, ready to be recorded again.
+	virtual void ExecuteCommandList(RenderCommandList& list);
+
+	// The back buffer and its depth/stencil buffer are textures like any other, except that they belong to the device.
+	// Their handles stay the same across a Resize.
+	virtual GPUHANDLE GetBackBuffer() const = 0;
+	virtual GPUHANDLE GetBackBufferDepth() const = 0;
+	virtual unsigned int GetBackBufferWidth() const = 0;
+	virtual unsigned int GetBackBufferHeight() const = 0;
+	virtual bool Resize(unsigned int width, unsigned int height) = 0;
+	virtual void Present() = 0;
+
+	// Rolls the stats over to a new frame. GetStats reports the last complete frame and GetTotalStats every
+	// frame up to and including it.
+	void BeginFrame();
+	const RenderDeviceStats& GetStats() const;
+	const RenderDeviceStats& GetTotalStats() const;
+};
@@ -1,7 +1,8 @@
 #include "RenderManager.h"
-#include "WindowsManager.h"
 #include "BlitVertexShader.h"
 #include "BlitPixelShader.h"
+#include <assert.h>
+#include <string.h>
 
 using namespace DirectX;
 
@@ -21,769 +22,988 @@ RenderManager* RenderManager::GetSingletonPtr(void)
 }
 
 // ----------------------------------------------------------------------------------
-// Helper Functions
+// Implementation
 // ----------------------------------------------------------------------------------
 
-// This function was inspired by:
-// http://www.rastertek.com/dx11tut03.html
-DXGI_RATIONAL QueryRefreshRate()
+// A placement offset for constants that went into the constant buffer itself, because the ring was full
+#define CONSTANTS_IN_BUFFER 0xFFFFFFFF
+
+// A texture slot that may or may not still have what was last bound to it
+#define UNKNOWN_TEXTURE 0xFFFFFFFF
+
+// Constant buffer struct definition for blitting
+//-------------------------------------------------------
+struct BlitConstantBufferVertex
 {
-	DXGI_RATIONAL refreshRate = { 0, 1 };
-	if (WindowsManager::GetSingleton().GetVSync())
-	{
-		Microsoft::WRL::ComPtr<IDXGIFactory2> factory;
-		Microsoft::WRL::ComPtr<IDXGIAdapter> adapter;
-		Microsoft::WRL::ComPtr<IDXGIOutput> adapterOutput;
+	XMMATRIX WorldViewProjectionMatrix;
+};
 
-		DXGI_MODE_DESC* displayModeList;
+thread_local RenderManager::ContextBindings RenderManager::s_recording;
 
-		// Create a DirectX graphics interface factory.
-		HRESULT hr = CreateDXGIFactory(__uuidof(IDXGIFactory2), &factory);
-		if (FAILED(hr))
-		{
-			MessageBoxA(0,
-				TEXT("Could not create DXGIFactory instance."),
-				TEXT("Query Refresh Rate"),
-				MB_OK);
+RenderManager::ContextBindings::ContextBindings()
+	: generation(1)
+{
+	memset(&stats, 0, sizeof(stats));
+	Reset(nullptr);
+}
 
-			throw new std::exception("Failed to create DXGIFactory.");
-		}
+void RenderManager::ContextBindings::Reset(RenderContext* newContext)
+{
+	context = newContext;
+	mesh = MeshHandle();
+	vs = VSHandle();
+	ps = PSHandle();
+	material = MaterialHandle();
+	renderTarget = depthStencil = 0;
+	vsConstants = psConstants = CBHandle();
+	vsConstantsDirty = psConstantsDirty = false;
 
-		hr = factory->EnumAdapters(0, &adapter);
-		if (FAILED(hr))
-		{
-			MessageBoxA(0,
-				TEXT("Failed to enumerate adapters."),
-				TEXT("Query Refresh Rate"),
-				MB_OK);
+	pipeline = PipelineHandle();
+	rasterizer = RASTERIZER_STATE_COUNT;
+	depthStencilState = DEPTH_STENCIL_STATE_COUNT;
+	stencilRef = 0;
+	blend = BLEND_STATE_COUNT;
+	for (GPUHANDLE& texture : textures)
+		texture = 0;
+	for (SAMPLER_STATE& sampler : samplers)
+		sampler = SAMPLER_STATE_COUNT;
+}
 
-			throw new std::exception("Failed to enumerate adapters.");
-		}
+RenderManager::RenderManager(RenderDevice* device) 
+	: m_device(device)
+	, m_constantRing(*device)
+	, m_recordingThreads(0)
+{
+	assert(m_device);
+	memset(&m_stateStats, 0, sizeof(m_stateStats));
+	memset(&m_lastStateStats, 0, sizeof(m_lastStateStats));
+	memset(&m_totalStateStats, 0, sizeof(m_totalStateStats));
+	m_immediate.context = m_device.get();
 
-		hr = adapter->EnumOutputs(0, &adapterOutput);
-		if (FAILED(hr))
-		{
-			MessageBoxA(0,
-				TEXT("Failed to enumerate adapter outputs."),
-				TEXT("Query Refresh Rate"),
-				MB_OK);
+	// The states have to exist before Initialize sets any of them
+	InitStates();
+	Initialize();
+}
 
-			throw new std::exception("Failed to enumerate adapter outputs.");
-		}
+RenderManager::~RenderManager()
+{
+	// Give everything back before the device goes away. Meshes release their own buffers.
+	m_meshes.Clear();
 
-		UINT numDisplayModes;
-		hr = adapterOutput->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numDisplayModes, nullptr);
-		if (FAILED(hr))
-		{
-			MessageBoxA(0,
-				TEXT("Failed to query display mode list."),
-				TEXT("Query Refresh Rate"),
-				MB_OK);
+	m_vertexShaders.ForEach([this](VSHandle, GPUHANDLE vs) { m_device->Release(vs); });
+	m_pixelShaders.ForEach([this](PSHandle, GPUHANDLE ps) { m_device->Release(ps); });
+	m_constantBuffers.ForEach([this](CBHandle, ConstantBuffer& cb) { m_device->Release(cb.buffer); });
 
-			throw new std::exception("Failed to query display mode list.");
-		}
+	for (GPUHANDLE state : m_rasterizerStates)
+		m_device->Release(state);
+	for (GPUHANDLE state : m_depthStencilStates)
+		m_device->Release(state);
+	for (GPUHANDLE state : m_blendStates)
+		m_device->Release(state);
+	for (GPUHANDLE state : m_samplerStates)
+		m_device->Release(state);
+}
 
-		displayModeList = new DXGI_MODE_DESC[numDisplayModes];
-		assert(displayModeList);
+bool RenderManager::Initialize()
+{
+// START DEBUG
+	SetViewport((float)m_device->GetBackBufferWidth(),
+				(float)m_device->GetBackBufferHeight());
 
-		hr = adapterOutput->GetDisplayModeList(DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_ENUM_MODES_INTERLACED, &numDisplayModes, displayModeList);
-		if (FAILED(hr))
-		{
-			MessageBoxA(0,
-				TEXT("Failed to query display mode list."),
-				TEXT("Query Refresh Rate"),
-				MB_OK);
+	SetRasterizerState(CULL_BACK);
+	SetDepthStencilState(DEPTH_STENCIL_STATE::READ_WRITE);
+	SetBlendState(SOLID);
+	
+	ResetRenderTarget();
+// END DEBUG
 
-			throw new std::exception("Failed to query display mode list.");
-		}
+	// Asset Creation!
+	VSHandle blitVS = CreateVShaderResource(g_BlitVertexShader, sizeof(g_BlitVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+	PSHandle blitPS = CreatePShaderResource(g_BlitPixelShader, sizeof(g_BlitPixelShader));
+	//CBHandle blitCB = CreateCBResource(sizeof(BlitConstantBufferVertex));
+	m_blitMaterial = CreateMaterial(blitVS, blitPS);
+	m_blitQuad	   = CreateMeshResource(Mesh::CreateQuad(m_device.get(), 2.0f, 2.0f));
+	m_blitVS	   = blitVS;
 
-		// Now store the refresh rate of the monitor that matches the width and height of the requested screen.
-		for (UINT i = 0; i < numDisplayModes; ++i)
-		{
-			if (displayModeList[i].Width == WindowsManager::GetSingleton().GetClientWidth() &&
-				displayModeList[i].Height == WindowsManager::GetSingleton().GetClientHeight())
-			{
-				refreshRate = displayModeList[i].RefreshRate;
-			}
-		}
+	return true;
+}
 
-		delete[] displayModeList;
-	}
+bool RenderManager::InitStates()
+{
+	return
+		CreateRasterizerState(CULL_MODE::FRONT, FILL_MODE::SOLID, &m_rasterizerStates[CULL_FRONT]) &&
+		CreateRasterizerState(CULL_MODE::BACK, FILL_MODE::SOLID, &m_rasterizerStates[CULL_BACK]) &&
+		CreateRasterizerState(CULL_MODE::NONE, FILL_MODE::SOLID, &m_rasterizerStates[CULL_NONE]) &&
+		CreateRasterizerState(CULL_MODE::NONE, FILL_MODE::WIREFRAME, &m_rasterizerStates[WIREFRAME]) &&
+
+		CreateDepthStencilState(true, true, false, false, COMPARISON_FUNC::ALWAYS, &m_depthStencilStates[READ_WRITE]) &&
+		CreateDepthStencilState(true, false, false, false, COMPARISON_FUNC::ALWAYS, &m_depthStencilStates[READ_ONLY]) &&
+		CreateDepthStencilState(false, true, false, false, COMPARISON_FUNC::ALWAYS, &m_depthStencilStates[WRITE_ONLY]) &&
+		CreateDepthStencilState(false, false, false, false, COMPARISON_FUNC::ALWAYS, &m_depthStencilStates[DEPTH_NONE]) &&
+		CreateDepthStencilState(true, false, true, true, COMPARISON_FUNC::ALWAYS, &m_depthStencilStates[STENCIL_WRITE]) &&
+		CreateDepthStencilState(true, true, true, false, COMPARISON_FUNC::GREATER, &m_depthStencilStates[STENCIL_GT]) &&
+		CreateDepthStencilState(true, true, true, false, COMPARISON_FUNC::LESS, &m_depthStencilStates[STENCIL_LT]) &&
+		CreateDepthStencilState(true, true, true, false, COMPARISON_FUNC::EQUAL, &m_depthStencilStates[STENCIL_EQ]) &&
+		CreateDepthStencilState(false, false, true, false, COMPARISON_FUNC::GREATER, &m_depthStencilStates[READONLY_STENCIL_GT]) &&
+		CreateDepthStencilState(false, false, true, false, COMPARISON_FUNC::LESS, &m_depthStencilStates[READONLY_STENCIL_LT]) &&
+		CreateDepthStencilState(false, false, true, false, COMPARISON_FUNC::EQUAL, &m_depthStencilStates[READONLY_STENCIL_EQ]) &&
 
-	return refreshRate;
+		CreateBlendState(BLEND_FACTOR::ONE, BLEND_FACTOR::ZERO, true, &m_blendStates[SOLID]) &&
+		CreateBlendState(BLEND_FACTOR::SRC_ALPHA, BLEND_FACTOR::INV_SRC_ALPHA, true, &m_blendStates[ALPHA_BLEND]) &&
+		CreateBlendState(BLEND_FACTOR::ONE, BLEND_FACTOR::INV_SRC_ALPHA, true, &m_blendStates[PREMULTIPLIED_ALPHA]) &&
+		CreateBlendState(BLEND_FACTOR::SRC_ALPHA, BLEND_FACTOR::ONE, true, &m_blendStates[ADDITIVE_BLEND]) &&
+		CreateBlendState(BLEND_FACTOR::SRC_ALPHA, BLEND_FACTOR::ONE, false, &m_blendStates[NO_COLOR]) &&
+
+		CreateSamplerState(TEXTURE_FILTER::POINT, TEXTURE_ADDRESS::CLAMP, &m_samplerStates[POINT_CLAMP]) &&
+		CreateSamplerState(TEXTURE_FILTER::POINT, TEXTURE_ADDRESS::WRAP, &m_samplerStates[POINT_WRAP]) &&
+		CreateSamplerState(TEXTURE_FILTER::LINEAR, TEXTURE_ADDRESS::CLAMP, &m_samplerStates[LINEAR_CLAMP]) &&
+		CreateSamplerState(TEXTURE_FILTER::LINEAR, TEXTURE_ADDRESS::WRAP, &m_samplerStates[LINEAR_WRAP]) &&
+		CreateSamplerState(TEXTURE_FILTER::ANISOTROPIC, TEXTURE_ADDRESS::CLAMP, &m_samplerStates[ANISOTROPIC_CLAMP]) &&
+		CreateSamplerState(TEXTURE_FILTER::ANISOTROPIC, TEXTURE_ADDRESS::WRAP, &m_samplerStates[ANISOTROPIC_WRAP]);
 }
 
-// ----------------------------------------------------------------------------------
-// Implementation
-// ----------------------------------------------------------------------------------
+// The device reports anything that goes wrong while creating these, so the helpers only have to pass the result on.
+bool RenderManager::CreateRasterizerState(CULL_MODE cullMode, FILL_MODE fillMode, GPUHANDLE* pResult)
+{
+	RasterizerDesc rasterizerDesc;
+	rasterizerDesc.cullMode = cullMode;
+	rasterizerDesc.fillMode = fillMode;
 
-// Constant buffer struct definition for blitting
-//-------------------------------------------------------
-struct BlitConstantBufferVertex
+	*pResult = m_device->CreateRasterizerState(rasterizerDesc);
+	return *pResult != 0;
+}
+
+bool RenderManager::CreateDepthStencilState(bool enable, bool writeEnable, bool stencilEnable, bool stencilWriteEnable, COMPARISON_FUNC stencilFunc, GPUHANDLE* pResult)
 {
-	XMMATRIX WorldViewProjectionMatrix;
-};
+	DepthStencilDesc depthStencilStateDesc;
+	depthStencilStateDesc.depthEnable = enable;
+	depthStencilStateDesc.depthWriteEnable = writeEnable;
+	depthStencilStateDesc.stencilEnable = stencilEnable;
+	depthStencilStateDesc.stencilWriteEnable = stencilWriteEnable;
+	depthStencilStateDesc.stencilFunc = stencilFunc;
+
+	*pResult = m_device->CreateDepthStencilState(depthStencilStateDesc);
+	return *pResult != 0;
+}
 
-RenderManager::RenderManager() 
-	: m_d3dDevice(nullptr)
-	, m_d3dDeviceContext(nullptr)
-	, m_d3dSwapChain(nullptr)
-	, m_d3dRenderTargetView(nullptr)
-	, m_d3dDepthStencilView(nullptr)
-	, m_d3dDepthStencilBuffer(nullptr)
-	, m_meshID(0)
-	, m_vsID(0)
-	, m_psID(0)
-	, m_cbID(0)
-	, m_matID(0)
-	, m_curMesh(0)
-	, m_curVS(0)
-	, m_curPS(0)
-	, m_curMat(0)
+bool RenderManager::CreateBlendState(BLEND_FACTOR srcBlend, BLEND_FACTOR destBlend, bool colorWriteEnable, GPUHANDLE* pResult)
 {
-	Initialize();
-	InitStates();
+	BlendDesc blendStateDesc;
+	blendStateDesc.srcBlend = srcBlend;
+	blendStateDesc.destBlend = destBlend;
+	blendStateDesc.colorWriteEnable = colorWriteEnable;
+
+	*pResult = m_device->CreateBlendState(blendStateDesc);
+	return *pResult != 0;
 }
 
-RenderManager::~RenderManager()
+bool RenderManager::CreateSamplerState(TEXTURE_FILTER filter, TEXTURE_ADDRESS addressMode, GPUHANDLE* pResult)
 {
+	SamplerDesc samplerStateDesc;
+	samplerStateDesc.filter = filter;
+	samplerStateDesc.addressMode = addressMode;
+
+	*pResult = m_device->CreateSamplerState(samplerStateDesc);
+	return *pResult != 0;
 }
 
-bool RenderManager::ResizeSwapChain(int width, int height)
+RenderDevice* RenderManager::GetDevice() const
 {
-	// Don't allow for 0 size swap chain buffers.
-	if (width <= 0) width = 1;
-	if (height <= 0) height = 1;
+	return m_device.get();
+}
 
-	m_d3dDeviceContext->OMSetRenderTargets(0, nullptr, nullptr);
+GPUHANDLE RenderManager::GetBackBuffer() const
+{
+	return m_device->GetBackBuffer();
+}
 
-	// First release the render target and depth/stencil views.
-	m_d3dRenderTargetView.Reset();
-	m_d3dDepthStencilView.Reset();
-	m_d3dDepthStencilBuffer.Reset();
+GPUHANDLE RenderManager::GetBackBufferDepth() const
+{
+	return m_device->GetBackBufferDepth();
+}
 
-	// Resize the swap chain buffers.
-	m_d3dSwapChain->ResizeBuffers(1, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, 0);
+RenderManager::ContextBindings& RenderManager::GetBindings()
+{
+	return s_recording.context ? s_recording : m_immediate;
+}
 
-	// Next initialize the back buffer of the swap chain and associate it to a 
-	// render target view.
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> backBuffer;
-	HRESULT hr = m_d3dSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), &backBuffer);
-	if (FAILED(hr))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to retrieve the swap chain back buffer.", "Error", MB_OK | MB_ICONERROR);
-		return false;
-	}
+void RenderManager::ResetRenderTarget()
+{
+	SetRenderTarget(m_device->GetBackBuffer(), m_device->GetBackBufferDepth());
+}
 
-	hr = m_d3dDevice->CreateRenderTargetView(backBuffer.Get(), nullptr, &m_d3dRenderTargetView);
-	if (FAILED(hr))
+void RenderManager::SetRenderTarget(GPUHANDLE renderTarget, GPUHANDLE depthStencil)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.renderTarget == renderTarget && bindings.depthStencil == depthStencil)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create the RenderTargetView.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	backBuffer.Reset();
-
-	// Create the depth buffer for use with the depth/stencil view.
-	D3D11_TEXTURE2D_DESC depthStencilBufferDesc;
-	ZeroMemory(&depthStencilBufferDesc, sizeof(D3D11_TEXTURE2D_DESC));
-
-	depthStencilBufferDesc.ArraySize = 1;
-	depthStencilBufferDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	depthStencilBufferDesc.CPUAccessFlags = 0; // No CPU access required.
-	depthStencilBufferDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	depthStencilBufferDesc.Width = width;
-	depthStencilBufferDesc.Height = height;
-	depthStencilBufferDesc.MipLevels = 1;
-	depthStencilBufferDesc.SampleDesc.Count = 1;
-	depthStencilBufferDesc.SampleDesc.Quality = 0;
-	depthStencilBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	hr = m_d3dDevice->CreateTexture2D(&depthStencilBufferDesc, nullptr, &m_d3dDepthStencilBuffer);
-	if (FAILED(hr))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create the Depth/Stencil texture.", "Error", MB_OK | MB_ICONERROR);
-		return false;
-	}
+	bindings.context->SetRenderTarget(renderTarget, depthStencil);
+	bindings.stats.binds++;
 
-	hr = m_d3dDevice->CreateDepthStencilView(m_d3dDepthStencilBuffer.Get(), nullptr, &m_d3dDepthStencilView);
-	if (FAILED(hr))
+	bindings.renderTarget = renderTarget;
+	bindings.depthStencil = depthStencil;
+
+	// D3D11 takes anything that's about to be drawn to out of the shader stages
+	for (GPUHANDLE& texture : bindings.textures)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create DepthStencilView.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		if (texture != 0 && (texture == renderTarget || texture == depthStencil))
+			texture = UNKNOWN_TEXTURE;
 	}
+}
 
-	return true;
+void RenderManager::ClearRenderTarget(GPUHANDLE renderTarget, const float clearColor[4])
+{
+	GetBindings().context->ClearRenderTarget(renderTarget, clearColor);
 }
 
+void RenderManager::ClearDepthStencil(GPUHANDLE depthStencil, unsigned int clearFlags, float clearDepth, unsigned char clearStencil)
+{
+	GetBindings().context->ClearDepthStencil(depthStencil, clearFlags, clearDepth, clearStencil);
+}
 
-bool RenderManager::Initialize()
+void RenderManager::SetPSTexture(unsigned int slot, GPUHANDLE texture)
 {
-	// Check for DirectX Math library support.
-	if (!DirectX::XMVerifyCPUSupport())
+	ContextBindings& bindings = GetBindings();
+	if (slot < RENDER_MANAGER_TEXTURE_SLOTS)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to verify DirectX Math library support.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		if (bindings.textures[slot] == texture)
+		{
+			bindings.stats.bindsAvoided++;
+			return;
+		}
+
+		// D3D11 binds nothing instead of a texture that's also a render target, so there's no telling what's there
+		bool isTarget = texture != 0 && (texture == bindings.renderTarget || texture == bindings.depthStencil);
+		bindings.textures[slot] = isTarget ? UNKNOWN_TEXTURE : texture;
 	}
 
-	HRESULT hr = 0;
-	UINT createDeviceFlags = 0;
+	bindings.context->SetPSTexture(slot, texture);
+	bindings.stats.binds++;
+}
 
-	// These are the feature levels that we will accept.
-	D3D_FEATURE_LEVEL featureLevels[] =
+void RenderManager::SetRasterizerState(RASTERIZER_STATE state)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.rasterizer == state)
 	{
-		D3D_FEATURE_LEVEL_11_1,
-		D3D_FEATURE_LEVEL_11_0,
-		D3D_FEATURE_LEVEL_10_1,
-		D3D_FEATURE_LEVEL_10_0,
-		D3D_FEATURE_LEVEL_9_3,
-		D3D_FEATURE_LEVEL_9_2,
-		D3D_FEATURE_LEVEL_9_1
-	};
+		bindings.stats.bindsAvoided++;
+		return;
+	}
 
-	// This will be the feature level that 
-	// is used to create our device and swap chain.
-	D3D_FEATURE_LEVEL featureLevel;
+	bindings.context->SetRasterizerState(m_rasterizerStates[state]);
+	bindings.stats.binds++;
 
-	hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE,
-		nullptr, createDeviceFlags, featureLevels, _countof(featureLevels),
-		D3D11_SDK_VERSION, &m_d3dDevice, &featureLevel, &m_d3dDeviceContext);
+	bindings.rasterizer = state;
+	bindings.pipeline = PipelineHandle();
+}
 
-	// If 11.1 failed, try using 11.0
-	if (hr == E_INVALIDARG)
+void RenderManager::SetDepthStencilState(DEPTH_STENCIL_STATE state, unsigned int depthStencilWriteValue)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.depthStencilState == state && bindings.stencilRef == depthStencilWriteValue)
 	{
-		hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_HARDWARE,
-			nullptr, createDeviceFlags, &featureLevels[1], _countof(featureLevels) - 1,
-			D3D11_SDK_VERSION, &m_d3dDevice, &featureLevel, &m_d3dDeviceContext);
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	if (FAILED(hr))
+	bindings.context->SetDepthStencilState(m_depthStencilStates[state], depthStencilWriteValue);
+	bindings.stats.binds++;
+
+	bindings.depthStencilState = state;
+	bindings.stencilRef = depthStencilWriteValue;
+	bindings.pipeline = PipelineHandle();
+}
+
+void RenderManager::SetBlendState(BLEND_STATE state)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.blend == state)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create DirectX 11 Device.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	Microsoft::WRL::ComPtr<IDXGIFactory2> factory;
-	hr = CreateDXGIFactory(__uuidof(IDXGIFactory2), &factory);
-	if (FAILED(hr))
+	bindings.context->SetBlendState(m_blendStates[state]);
+	bindings.stats.binds++;
+
+	bindings.blend = state;
+	bindings.pipeline = PipelineHandle();
+}
+
+void RenderManager::SetSamplerState(SAMPLER_STATE state, unsigned int startSlot, unsigned int numSamplers)
+{
+	ContextBindings& bindings = GetBindings();
+	for (unsigned int i = 0; i < numSamplers; ++i)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create IDXGIFactory2.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		unsigned int slot = startSlot + i;
+		if (slot < RENDER_MANAGER_SAMPLER_SLOTS)
+		{
+			if (bindings.samplers[slot] == state)
+			{
+				bindings.stats.bindsAvoided++;
+				continue;
+			}
+
+			bindings.samplers[slot] = state;
+		}
+
+		bindings.context->SetPSSampler(slot, m_samplerStates[state]);
+		bindings.stats.binds++;
 	}
+}
 
-	DXGI_SWAP_CHAIN_DESC1 swapChainDesc;
-	ZeroMemory(&swapChainDesc, sizeof(DXGI_SWAP_CHAIN_DESC1));
+void RenderManager::Blit(GPUHANDLE src, GPUHANDLE dst, SAMPLER_STATE samplerState, bool useDepth)
+{
+	ContextBindings& bindings = GetBindings();
 
-	swapChainDesc.BufferCount = 1;
-	swapChainDesc.Width = WindowsManager::GetSingleton().GetClientWidth();
-	swapChainDesc.Height = WindowsManager::GetSingleton().GetClientHeight();
-	swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-	swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	swapChainDesc.SampleDesc.Count = 1;
-	swapChainDesc.SampleDesc.Quality = 0;
-	swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
-	swapChainDesc.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH; // Use Alt-Enter to switch between full screen and windowed mode.
+	// Save the previous render targets
+	GPUHANDLE rt = bindings.renderTarget;
+	GPUHANDLE ds = bindings.depthStencil;
 
-	DXGI_SWAP_CHAIN_FULLSCREEN_DESC swapChainFullScreenDesc;
-	ZeroMemory(&swapChainFullScreenDesc, sizeof(DXGI_SWAP_CHAIN_FULLSCREEN_DESC));
+	SetRenderTarget(dst == 0 ? m_device->GetBackBuffer() : dst, useDepth ? ds : 0);
+	SetPSTexture(0, src);
+	SetSamplerState(samplerState);
 
-	swapChainFullScreenDesc.RefreshRate = QueryRefreshRate();
-	swapChainFullScreenDesc.Windowed = WindowsManager::GetSingleton().GetWindowed();
+	DrawWithMaterial(m_blitQuad, m_blitMaterial);
 
-	hr = factory->CreateSwapChainForHwnd(m_d3dDevice.Get(), WindowsManager::GetSingleton().GetWindowHandle(),
-		&swapChainDesc, &swapChainFullScreenDesc, nullptr, &m_d3dSwapChain);
+	// Restore the original render targets
+	SetRenderTarget(rt, ds);
+}
 
-	if (FAILED(hr))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to create swap chain.", "Error", MB_OK | MB_ICONERROR);
-		return false;
-	}
+void RenderManager::RenderFullscreen(PSHandle pShader, GPUHANDLE dst)
+{
+	ContextBindings& bindings = GetBindings();
 
-	if (!ResizeSwapChain(WindowsManager::GetSingleton().GetClientWidth(), WindowsManager::GetSingleton().GetClientHeight()))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(), 
-			"Failed to resize the swap chain.", "Error", MB_OK | MB_ICONERROR);
-		return false;
-	}
+	// Save the previous render targets
+	GPUHANDLE rt = bindings.renderTarget;
+	GPUHANDLE ds = bindings.depthStencil;
 
-// START DEBUG
-	SetViewport((float)WindowsManager::GetSingleton().GetClientWidth(),
-				(float)WindowsManager::GetSingleton().GetClientHeight());
+	SetRenderTarget(dst == 0 ? m_device->GetBackBuffer() : dst, 0);
+	SetVertexShader(m_blitVS);
+	SetPixelShader(pShader);
 
-	SetRasterizerState(CULL_BACK);
-	SetDepthStencilState(DEPTH_STENCIL_STATE::READ_WRITE);
-	
-	m_d3dDeviceContext->OMSetRenderTargets(1, m_d3dRenderTargetView.GetAddressOf(), m_d3dDepthStencilView.Get());
-// END DEBUG
+	DrawMesh(m_blitQuad);
 
-	ZeroMemory(&m_PresentParameters, sizeof(DXGI_PRESENT_PARAMETERS));
+	SetRenderTarget(rt, ds);
+}
 
-	// Asset Creation!
-	RHANDLE blitVS = CreateVShaderResource(g_BlitVertexShader, sizeof(g_BlitVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
-	RHANDLE blitPS = CreatePShaderResource(g_BlitPixelShader, sizeof(g_BlitPixelShader));
-	//RHANDLE blitCB = CreateCBResource(sizeof(BlitConstantBufferVertex));
-	m_blitMaterial = CreateMaterial(blitVS, blitPS);
-	m_blitQuad	   = CreateMeshResource(Mesh::CreateQuad(m_d3dDeviceContext.Get(), 2.0f, 2.0f));
-	m_blitVS	   = blitVS;
+void RenderManager::SetViewport(float width, float height, float topLeftX, float topLeftY, float minDepth, float maxDepth)
+{
+	// Lists get theirs in BeginRecording
+	assert(!s_recording.context && "Set the viewport before recording");
 
-	return true;
+	m_viewport.topLeftX = topLeftX;
+	m_viewport.topLeftY = topLeftY;
+	m_viewport.width = width;
+	m_viewport.height = height;
+	m_viewport.minDepth = minDepth;
+	m_viewport.maxDepth = maxDepth;
+
+	m_device->SetViewport(m_viewport);
 }
 
-bool RenderManager::InitStates()
+void RenderManager::Clear(const float clearColor[4], float clearDepth, unsigned char clearStencil)
 {
-	return
-		CreateRasterizerState(D3D11_CULL_FRONT, D3D11_FILL_SOLID, &m_rasterizerStates[CULL_FRONT]) &&
-		CreateRasterizerState(D3D11_CULL_BACK, D3D11_FILL_SOLID, &m_rasterizerStates[CULL_BACK]) &&
-		CreateRasterizerState(D3D11_CULL_NONE, D3D11_FILL_SOLID, &m_rasterizerStates[CULL_NONE]) &&
-		CreateRasterizerState(D3D11_CULL_NONE, D3D11_FILL_WIREFRAME, &m_rasterizerStates[WIREFRAME]) &&
-
-		CreateDepthStencilState(true, true, false, false, D3D11_COMPARISON_ALWAYS, &m_depthStencilStates[READ_WRITE]) &&
-		CreateDepthStencilState(true, false, false, false, D3D11_COMPARISON_ALWAYS, &m_depthStencilStates[READ_ONLY]) &&
-		CreateDepthStencilState(false, true, false, false, D3D11_COMPARISON_ALWAYS, &m_depthStencilStates[WRITE_ONLY]) &&
-		CreateDepthStencilState(false, false, false, false, D3D11_COMPARISON_ALWAYS, &m_depthStencilStates[DEPTH_NONE]) &&
-		CreateDepthStencilState(true, false, true, true, D3D11_COMPARISON_ALWAYS, &m_depthStencilStates[STENCIL_WRITE]) &&
-		CreateDepthStencilState(true, true, true, false, D3D11_COMPARISON_GREATER, &m_depthStencilStates[STENCIL_GT]) &&
-		CreateDepthStencilState(true, true, true, false, D3D11_COMPARISON_LESS, &m_depthStencilStates[STENCIL_LT]) &&
-		CreateDepthStencilState(true, true, true, false, D3D11_COMPARISON_EQUAL, &m_depthStencilStates[STENCIL_EQ]) &&
-		CreateDepthStencilState(false, false, true, false, D3D11_COMPARISON_GREATER, &m_depthStencilStates[READONLY_STENCIL_GT]) &&
-		CreateDepthStencilState(false, false, true, false, D3D11_COMPARISON_LESS, &m_depthStencilStates[READONLY_STENCIL_LT]) &&
-		CreateDepthStencilState(false, false, true, false, D3D11_COMPARISON_EQUAL, &m_depthStencilStates[READONLY_STENCIL_EQ]) &&
-
-		CreateBlendState(D3D11_BLEND_ONE, D3D11_BLEND_ZERO, true, &m_blendStates[SOLID]) &&
-		CreateBlendState(D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_INV_SRC_ALPHA, true, &m_blendStates[ALPHA_BLEND]) &&
-		CreateBlendState(D3D11_BLEND_ONE, D3D11_BLEND_INV_SRC_ALPHA, true, &m_blendStates[PREMULTIPLIED_ALPHA]) &&
-		CreateBlendState(D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_ONE, true, &m_blendStates[ADDITIVE_BLEND]) &&
-		CreateBlendState(D3D11_BLEND_SRC_ALPHA, D3D11_BLEND_ONE, false, &m_blendStates[NO_COLOR]) &&
-
-		CreateSamplerState(D3D11_FILTER_MIN_MAG_MIP_POINT, D3D11_TEXTURE_ADDRESS_CLAMP, &m_samplerStates[POINT_CLAMP]) &&
-		CreateSamplerState(D3D11_FILTER_MIN_MAG_MIP_POINT, D3D11_TEXTURE_ADDRESS_WRAP, &m_samplerStates[POINT_WRAP]) &&
-		CreateSamplerState(D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_TEXTURE_ADDRESS_CLAMP, &m_samplerStates[LINEAR_CLAMP]) &&
-		CreateSamplerState(D3D11_FILTER_MIN_MAG_MIP_LINEAR, D3D11_TEXTURE_ADDRESS_WRAP, &m_samplerStates[LINEAR_WRAP]) &&
-		CreateSamplerState(D3D11_FILTER_ANISOTROPIC, D3D11_TEXTURE_ADDRESS_CLAMP, &m_samplerStates[ANISOTROPIC_CLAMP]) &&
-		CreateSamplerState(D3D11_FILTER_ANISOTROPIC, D3D11_TEXTURE_ADDRESS_WRAP, &m_samplerStates[ANISOTROPIC_WRAP]);
-}
-
-bool RenderManager::CreateRasterizerState(D3D11_CULL_MODE cullMode, D3D11_FILL_MODE fillMode, ID3D11RasterizerState** pResult)
-{
-	// Setup rasterizer state.
-	D3D11_RASTERIZER_DESC rasterizerDesc;
-	ZeroMemory(&rasterizerDesc, sizeof(D3D11_RASTERIZER_DESC));
-
-	rasterizerDesc.CullMode = cullMode;
-	rasterizerDesc.DepthClipEnable = TRUE;
-	rasterizerDesc.FillMode = fillMode;
-	rasterizerDesc.MultisampleEnable = FALSE;
-
-	// Create the rasterizer state object.
-	HRESULT hr = m_d3dDevice->CreateRasterizerState(&rasterizerDesc, pResult);
-	if (FAILED(hr))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create a RasterizerState object.", "Error", MB_OK | MB_ICONERROR);
-
-		return false;
-	}
+	ContextBindings& bindings = GetBindings();
+	if (bindings.renderTarget != 0)
+		bindings.context->ClearRenderTarget(bindings.renderTarget, clearColor);
+	if (bindings.depthStencil != 0)
+		bindings.context->ClearDepthStencil(bindings.depthStencil, CLEAR_DEPTH | CLEAR_STENCIL, clearDepth, clearStencil);
+}
 
-	return true;
+void RenderManager::BeginRecording(RenderCommandList& list)
+{
+	assert(!s_recording.context && "This thread is already recording a command list");
+
+	// Nothing placed for an earlier list carries over
+	s_recording.Reset(&list);
+	s_recording.generation++;
+	s_recording.bufferUpdates.clear();
+	m_recordingThreads++;
+
+	list.SetViewport(m_viewport);
 }
 
-bool RenderManager::CreateDepthStencilState(bool enable, bool writeEnable, bool stencilEnable, bool stencilWriteEnable, D3D11_COMPARISON_FUNC stencilFunc, ID3D11DepthStencilState** pResult)
+void RenderManager::EndRecording()
 {
-	D3D11_DEPTH_STENCIL_DESC depthStencilStateDesc;
-	ZeroMemory(&depthStencilStateDesc, sizeof(D3D11_DEPTH_STENCIL_DESC));
+	assert(s_recording.context && "This thread isn't recording a command list");
 
-	depthStencilStateDesc.DepthEnable = enable;
-	depthStencilStateDesc.DepthWriteMask = writeEnable ? D3D11_DEPTH_WRITE_MASK_ALL : D3D11_DEPTH_WRITE_MASK_ZERO;
-	depthStencilStateDesc.DepthFunc = D3D11_COMPARISON_LESS;
-	depthStencilStateDesc.StencilEnable = stencilEnable;
-	depthStencilStateDesc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
-	depthStencilStateDesc.StencilWriteMask = stencilWriteEnable ? 0xFF : 0;
-	depthStencilStateDesc.FrontFace.StencilDepthFailOp = D3D11_STENCIL_OP_KEEP;
-	depthStencilStateDesc.FrontFace.StencilFailOp = D3D11_STENCIL_OP_KEEP;
-	depthStencilStateDesc.FrontFace.StencilPassOp = stencilWriteEnable ? D3D11_STENCIL_OP_REPLACE : D3D11_STENCIL_OP_KEEP;
-	depthStencilStateDesc.FrontFace.StencilFunc = stencilFunc;
-	depthStencilStateDesc.BackFace = depthStencilStateDesc.FrontFace;
+	// Only BeginRecording puts anything here
+	RenderCommandList* list = static_cast<RenderCommandList*>(s_recording.context);
+	list->Close();
+	s_recording.Reset(nullptr);
 
-	HRESULT hr = m_d3dDevice->CreateDepthStencilState(&depthStencilStateDesc, pResult);
-	if (FAILED(hr))
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create a DepthStencilState object.", "Error", MB_OK | MB_ICONERROR);
+		std::lock_guard<std::mutex> lock(m_stateStatsLock);
+		AddStateStats(m_stateStats, s_recording.stats);
+	}
 
-		return false;
+	if (!s_recording.bufferUpdates.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_listBufferUpdatesLock);
+		for (CBHandle cbHandle : s_recording.bufferUpdates)
+			m_listBufferUpdates.push_back({ list, cbHandle });
 	}
+	memset(&s_recording.stats, 0, sizeof(s_recording.stats));
 
-	return true;
+	m_recordingThreads--;
 }
 
-bool RenderManager::CreateBlendState(D3D11_BLEND srcBlend, D3D11_BLEND destBlend, bool colorWriteEnable, ID3D11BlendState** pResult)
+void RenderManager::ExecuteCommandList(RenderCommandList& list)
 {
-	D3D11_BLEND_DESC blendStateDesc;
-	ZeroMemory(&blendStateDesc, sizeof(blendStateDesc));
+	assert(!s_recording.context && "Command lists are executed on the main thread, not while recording");
+	assert(m_recordingThreads == 0 && "Wait for the other threads to finish recording before executing anything");
 
-	blendStateDesc.RenderTarget[0].BlendEnable = (srcBlend != D3D11_BLEND_ONE) || (destBlend != D3D11_BLEND_ZERO);
-	blendStateDesc.RenderTarget[0].SrcBlend = blendStateDesc.RenderTarget[0].SrcBlendAlpha = srcBlend;
-	blendStateDesc.RenderTarget[0].DestBlend = blendStateDesc.RenderTarget[0].DestBlendAlpha = destBlend;
-	blendStateDesc.RenderTarget[0].BlendOp = blendStateDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-	blendStateDesc.RenderTarget[0].RenderTargetWriteMask = colorWriteEnable ? D3D11_COLOR_WRITE_ENABLE_ALL : 0;
+	// Whatever the list put in the ring has to be in the buffer before it's drawn
+	m_constantRing.Upload();
+	m_device->ExecuteCommandList(list);
 
-	HRESULT hr = m_d3dDevice->CreateBlendState(&blendStateDesc, pResult);
-	if (FAILED(hr))
+	// Anything the list wrote to a constant buffer itself goes back to what the main thread last put there
+	for (size_t i = 0; i < m_listBufferUpdates.size();)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create a BlendState object.", "Error", MB_OK | MB_ICONERROR);
+		if (m_listBufferUpdates[i].list != &list)
+		{
+			i++;
+			continue;
+		}
 
-		return false;
+		CBHandle cbHandle = m_listBufferUpdates[i].cbHandle;
+		if (m_constantBuffers.IsValid(cbHandle))
+		{
+			const ConstantBuffer& cb = m_constantBuffers.Get(cbHandle);
+			m_device->UpdateBuffer(cb.buffer, cb.contents.data());
+		}
+
+		m_listBufferUpdates[i] = m_listBufferUpdates.back();
+		m_listBufferUpdates.pop_back();
 	}
 
-	return true;
+	// That left nothing bound on the device, so nothing can be skipped until it's been set again
+	GPUHANDLE rt = m_immediate.renderTarget;
+	GPUHANDLE ds = m_immediate.depthStencil;
+
+	m_immediate.Reset(m_device.get());
+
+	m_device->SetViewport(m_viewport);
+	SetRenderTarget(rt, ds);
 }
 
-bool RenderManager::CreateSamplerState(D3D11_FILTER filter, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** pResult)
+void RenderManager::BeginFrame()
 {
-	D3D11_SAMPLER_DESC samplerStateDesc;
-	ZeroMemory(&samplerStateDesc, sizeof(samplerStateDesc));
+	assert(m_recordingThreads == 0 && "Start a new frame once recording has finished");
 
-	samplerStateDesc.Filter = filter;
-	samplerStateDesc.AddressU = addressMode;
-	samplerStateDesc.AddressV = addressMode;
-	samplerStateDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-	samplerStateDesc.MaxAnisotropy = 1;//(m_d3dDevice->GetFeatureLevel() > D3D_FEATURE_LEVEL_9_1) ? 16 : 2;
-	samplerStateDesc.MipLODBias = 0.0f;
-	samplerStateDesc.MinLOD = -FLT_MAX;
-	samplerStateDesc.MaxLOD = FLT_MAX;
-	samplerStateDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	m_device->BeginFrame();
+	m_constantRing.BeginFrame();
 
-	HRESULT hr = m_d3dDevice->CreateSamplerState(&samplerStateDesc, pResult);
-	if (FAILED(hr))
-	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create a SamplerState object.", "Error", MB_OK | MB_ICONERROR);
+	// A list that was recorded but never executed never wrote anything either
+	m_listBufferUpdates.clear();
 
-		return false;
-	}
+	AddStateStats(m_stateStats, m_immediate.stats);
+	memset(&m_immediate.stats, 0, sizeof(m_immediate.stats));
+	AddStateStats(m_totalStateStats, m_stateStats);
+	m_lastStateStats = m_stateStats;
+	memset(&m_stateStats, 0, sizeof(m_stateStats));
 
-	return true;
+	// Last frame's placements are in a part of the ring that's going to be reused, so anything bound has to be placed
+	// again from the copies before it's drawn with
+	m_immediate.generation++;
+	m_immediate.vsConstantsDirty = (bool)m_immediate.vsConstants;
+	m_immediate.psConstantsDirty = (bool)m_immediate.psConstants;
 }
 
-ID3D11Device* RenderManager::GetDevice() const
+void RenderManager::AddStateStats(StateCacheStats& total, const StateCacheStats& stats)
 {
-	return m_d3dDevice.Get();
+	total.binds += stats.binds;
+	total.bindsAvoided += stats.bindsAvoided;
+	total.pipelineChanges += stats.pipelineChanges;
+	total.pipelineChangesAvoided += stats.pipelineChangesAvoided;
 }
 
-ID3D11DeviceContext* RenderManager::GetDeviceContext() const
+const StateCacheStats& RenderManager::GetStateCacheStats() const
 {
-	return m_d3dDeviceContext.Get();
+	return m_lastStateStats;
 }
 
-ID3D11RenderTargetView** RenderManager::GetBackBufferRT() const
+const StateCacheStats& RenderManager::GetTotalStateCacheStats() const
 {
-	return const_cast<ID3D11RenderTargetView**>(m_d3dRenderTargetView.GetAddressOf());
+	return m_totalStateStats;
 }
 
-ID3D11DepthStencilView** RenderManager::GetDepthStencil() const
+const ConstantRing& RenderManager::GetConstantRing() const
 {
-	return const_cast<ID3D11DepthStencilView**>(m_d3dDepthStencilView.GetAddressOf());
+	return m_constantRing;
 }
 
-
-void RenderManager::ResetRenderTarget()
+void RenderManager::Present()
 {
-	m_d3dDeviceContext->OMSetRenderTargets(1, m_d3dRenderTargetView.GetAddressOf(), m_d3dDepthStencilView.Get());
+	assert(!s_recording.context && "Present on the main thread, after executing the command lists");
+
+	m_device->Present();
 }
 
-void RenderManager::SetRasterizerState(RASTERIZER_STATE state)
+// ---------------------------------------------------------------------------------------------------------------
+// Resource Creation and Management functions
+// ---------------------------------------------------------------------------------------------------------------
+
+MeshHandle RenderManager::CreateMeshResource(std::unique_ptr<Mesh> mesh)
 {
-	m_d3dDeviceContext->RSSetState(m_rasterizerStates[state].Get());
+	if (!mesh)
+		return MeshHandle();
+
+	return m_meshes.Add(move(mesh));
 }
 
-void RenderManager::SetDepthStencilState(DEPTH_STENCIL_STATE state, UINT depthStencilWriteValue)
+VSHandle RenderManager::CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount)
 {
-	m_d3dDeviceContext->OMSetDepthStencilState(m_depthStencilStates[state].Get(), depthStencilWriteValue);
+	GPUHANDLE shader = m_device->CreateVertexShader(shaderBytecode, bytecodeSize, elements, elementCount);
+	if (!shader)
+		return VSHandle();
+
+	return m_vertexShaders.Add(shader);
 }
 
-void RenderManager::SetBlendState(BLEND_STATE state)
+PSHandle RenderManager::CreatePShaderResource(const void* shaderBytecode, size_t bytecodeSize)
 {
-	m_d3dDeviceContext->OMSetBlendState(m_blendStates[state].Get(), nullptr, 0xFFFFFFFF);
+	GPUHANDLE shader = m_device->CreatePixelShader(shaderBytecode, bytecodeSize);
+	if (!shader)
+		return PSHandle();
+
+	return m_pixelShaders.Add(shader);
 }
 
-void RenderManager::SetSamplerState(SAMPLER_STATE state, UINT startSlot, UINT numSamplers)
+CBHandle RenderManager::CreateCBResource(size_t bufferSize)
 {
-	m_d3dDeviceContext->PSSetSamplers(startSlot, numSamplers, m_samplerStates[state].GetAddressOf());
+	GPUHANDLE buffer = m_device->CreateBuffer(BUFFER_TYPE::CONSTANT, (unsigned int)bufferSize, nullptr);
+	if (!buffer)
+		return CBHandle();
+
+	ConstantBuffer cb;
+	cb.buffer = buffer;
+	cb.size = (unsigned int)bufferSize;
+	cb.contents.assign(bufferSize, 0);
+	return m_constantBuffers.Add(std::move(cb));
 }
 
-void RenderManager::Blit(ID3D11ShaderResourceView* src, ID3D11RenderTargetView* dst, SAMPLER_STATE samplerState, bool useDepth)
+MaterialHandle RenderManager::CreateMaterial(VSHandle vShader, PSHandle pShader, CBHandle vCBuffer, CBHandle pCBuffer)
 {
-	// Save the previous render targets
-	ID3D11RenderTargetView* rt;
-	ID3D11DepthStencilView* ds;
-	m_d3dDeviceContext->OMGetRenderTargets(1, &rt, &ds);
+	assert(m_vertexShaders.IsValid(vShader));
+	assert(m_pixelShaders.IsValid(pShader));
+	assert(!vCBuffer || m_constantBuffers.IsValid(vCBuffer));
+	assert(!pCBuffer || m_constantBuffers.IsValid(pCBuffer));
 
-	m_d3dDeviceContext->OMSetRenderTargets(1, dst == nullptr ? m_d3dRenderTargetView.GetAddressOf() : &dst, useDepth ? ds : nullptr);
-	m_d3dDeviceContext->PSSetShaderResources(0, 1, &src);
-	m_d3dDeviceContext->PSSetSamplers(0, 1, m_samplerStates[samplerState].GetAddressOf());
+	return m_materials.Add(Material(vShader, pShader, vCBuffer, pCBuffer));
+}
 
-	DrawWithMaterial(m_blitQuad, m_blitMaterial);
+void RenderManager::DestroyMeshResource(MeshHandle meshHandle)
+{
+	assert(m_recordingThreads == 0 && "Resources can't be destroyed while other threads are recording");
 
-	// Restor the original render targets
-	m_d3dDeviceContext->OMSetRenderTargets(1, &rt, ds);
+	// The mesh releases its own buffers
+	if (!m_meshes.Remove(meshHandle))
+	{
+		assert(!"Destroying a mesh that's already gone");
+		return;
+	}
+
+	if (m_immediate.mesh == meshHandle)
+		m_immediate.mesh = MeshHandle();
 }
 
-void RenderManager::RenderFullscreen(RHANDLE pShader, ID3D11RenderTargetView* dst)
+void RenderManager::DestroyVShaderResource(VSHandle shaderHandle)
 {
-	// Save the previous render targets
-	ID3D11RenderTargetView* rt;
-	ID3D11DepthStencilView* ds;
-	m_d3dDeviceContext->OMGetRenderTargets(1, &rt, &ds);
+	assert(m_recordingThreads == 0 && "Resources can't be destroyed while other threads are recording");
 
-	m_d3dDeviceContext->OMSetRenderTargets(1, dst == nullptr ? m_d3dRenderTargetView.GetAddressOf() : &dst, nullptr);
-	SetVertexShader(m_blitVS);
-	SetPixelShader(pShader);
+	GPUHANDLE shader;
+	if (!m_vertexShaders.Remove(shaderHandle, &shader))
+	{
+		assert(!"Destroying a vertex shader that's already gone");
+		return;
+	}
 
-	m_meshMap[m_blitQuad]->Draw(m_d3dDeviceContext.Get());
+	m_device->Release(shader);
+	DestroyPipelinesUsing(shaderHandle, PSHandle());
 
-	m_d3dDeviceContext->OMSetRenderTargets(1, &rt, ds);
+	if (m_immediate.vs == shaderHandle)
+	{
+		m_immediate.vs = VSHandle();
+		m_immediate.material = MaterialHandle();
+		m_immediate.pipeline = PipelineHandle();
+	}
 }
 
-void RenderManager::SetViewport(float width, float height, float topLeftX, float topLeftY, float minDepth, float maxDepth)
+void RenderManager::DestroyPShaderResource(PSHandle shaderHandle)
 {
-	m_viewport.TopLeftX = static_cast<FLOAT>(topLeftX);
-	m_viewport.TopLeftY = static_cast<FLOAT>(topLeftY);
-	m_viewport.Width = static_cast<FLOAT>(width);
-	m_viewport.Height = static_cast<FLOAT>(height);
-	m_viewport.MinDepth = static_cast<FLOAT>(minDepth);
-	m_viewport.MaxDepth = static_cast<FLOAT>(maxDepth);
+	assert(m_recordingThreads == 0 && "Resources can't be destroyed while other threads are recording");
 
-	m_d3dDeviceContext->RSSetViewports(1, &m_viewport);
-}
+	GPUHANDLE shader;
+	if (!m_pixelShaders.Remove(shaderHandle, &shader))
+	{
+		assert(!"Destroying a pixel shader that's already gone");
+		return;
+	}
 
-void RenderManager::Clear(const FLOAT clearColor[4], FLOAT clearDepth, UINT8 clearStencil)
-{
-	assert(m_d3dDeviceContext);
-	ID3D11RenderTargetView* rt = nullptr;
-	ID3D11DepthStencilView* dsv = nullptr;
-	m_d3dDeviceContext->OMGetRenderTargets(1, &rt, &dsv);
-	m_d3dDeviceContext->ClearRenderTargetView(rt, clearColor);
-	m_d3dDeviceContext->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, clearDepth, clearStencil);
+	m_device->Release(shader);
+	DestroyPipelinesUsing(VSHandle(), shaderHandle);
+
+	if (m_immediate.ps == shaderHandle)
+	{
+		m_immediate.ps = PSHandle();
+		m_immediate.material = MaterialHandle();
+		m_immediate.pipeline = PipelineHandle();
+	}
 }
 
-void RenderManager::Present()
+void RenderManager::DestroyCBResource(CBHandle cbHandle)
 {
-	if (WindowsManager::GetSingleton().GetVSync())
+	assert(m_recordingThreads == 0 && "Resources can't be destroyed while other threads are recording");
+
+	ConstantBuffer cb;
+	if (!m_constantBuffers.Remove(cbHandle, &cb))
 	{
-		m_d3dSwapChain->Present1(1, 0, &m_PresentParameters);
+		assert(!"Destroying a constant buffer that's already gone");
+		return;
 	}
-	else
+
+	m_device->Release(cb.buffer);
+
+	// The next buffer in this slot mustn't pick up where this one's constants were placed
+	unsigned int index = cbHandle.GetIndex();
+	if (index < m_immediate.placements.size())
+		m_immediate.placements[index].generation = 0;
+
+	if (m_immediate.vsConstants == cbHandle)
+	{
+		m_immediate.vsConstants = CBHandle();
+		m_immediate.vsConstantsDirty = false;
+		m_immediate.material = MaterialHandle();
+	}
+	if (m_immediate.psConstants == cbHandle)
 	{
-		m_d3dSwapChain->Present1(0, 0, &m_PresentParameters);
+		m_immediate.psConstants = CBHandle();
+		m_immediate.psConstantsDirty = false;
+		m_immediate.material = MaterialHandle();
 	}
 }
 
-// ---------------------------------------------------------------------------------------------------------------
-// Resource Creation and Management functions
-// ---------------------------------------------------------------------------------------------------------------
+void RenderManager::DestroyMaterial(MaterialHandle materialHandle)
+{
+	assert(m_recordingThreads == 0 && "Resources can't be destroyed while other threads are recording");
 
-// Aliases for readability
-typedef std::unordered_map<RHANDLE, std::unique_ptr<Mesh>> MeshMap;
-typedef std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11VertexShader>> VSMap;
-typedef std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11PixelShader>> PSMap;
-typedef std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11Buffer>> CBMap;
-typedef std::unordered_map<RHANDLE, std::unique_ptr<Material>> MaterialMap;
+	// The shaders and constant buffers are left alone, since other materials may be using them
+	if (!m_materials.Remove(materialHandle))
+	{
+		assert(!"Destroying a material that's already gone");
+		return;
+	}
 
-RHANDLE RenderManager::CreateMeshResource(std::unique_ptr<Mesh> mesh)
-{
-	m_meshMap.insert(MeshMap::value_type(++m_meshID, move(mesh)));
-	return m_meshID;
+	if (m_immediate.material == materialHandle)
+		m_immediate.material = MaterialHandle();
 }
 
-/*
-RHANDLE RenderManager::CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize)
+void RenderManager::SetMaterial(MaterialHandle materialHandle)
 {
-	HRESULT hr = 0;
-	RHANDLE handle = ++m_vsID;
-
-	hr = m_d3dDevice->CreateVertexShader(shaderBytecode, bytecodeSize, nullptr, &m_vShaderMap[handle]);
-	if (FAILED(hr))
+	ContextBindings& bindings = GetBindings();
+	if (bindings.material == materialHandle)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create Vertex Shader.", "Error", MB_OK | MB_ICONERROR);
-		return -1;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
+
+	const Material& material = m_materials.Get(materialHandle);
+	SetVertexShader(material.vsHandle);
+	SetPixelShader(material.psHandle);
+	if(material.vsCBHandle)
+		SetVSConstantBuffer(material.vsCBHandle);
+	if(material.psCBHandle)
+		SetPSConstantBuffer(material.psCBHandle);
 	
-	std::printf("Vertex Shader Null: %d \n", m_vShaderMap[handle].Get() == nullptr);
-	return handle;
+	bindings.material = materialHandle;
 }
-*/
 
-RHANDLE RenderManager::CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize, const D3D11_INPUT_ELEMENT_DESC* elementDesc, UINT elementCount )
+void RenderManager::SetMesh(MeshHandle meshHandle)
 {
-	HRESULT hr = 0;
-	RHANDLE handle = ++m_vsID;
+	ContextBindings& bindings = GetBindings();
+	if (bindings.mesh == meshHandle)
+	{
+		bindings.stats.bindsAvoided++;
+		return;
+	}
+
+	m_meshes.Get(meshHandle)->Bind(bindings.context);
+	bindings.stats.binds++;
 
-	hr = m_d3dDevice->CreateVertexShader(shaderBytecode, bytecodeSize, nullptr, &m_vShaderMap[handle]);
-	if (FAILED(hr))
+	bindings.mesh = meshHandle;
+}
+
+void RenderManager::SetVertexShader(VSHandle shaderHandle)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.vs == shaderHandle)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create Vertex Shader.", "Error", MB_OK | MB_ICONERROR);
-		return -1;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	hr = m_d3dDevice->CreateInputLayout(elementDesc, elementCount, shaderBytecode, bytecodeSize, &m_vsInputLayoutMap[handle]);
-	if (FAILED(hr))
+	// The device sets the input layout along with the shader
+	bindings.context->SetVertexShader(m_vertexShaders.Get(shaderHandle));
+	bindings.stats.binds++;
+
+	// Whatever material or pipeline this came from sets it again afterwards
+	bindings.vs = shaderHandle;
+	bindings.material = MaterialHandle();
+	bindings.pipeline = PipelineHandle();
+}
+
+
+void RenderManager::SetPixelShader(PSHandle shaderHandle)
+{
+	ContextBindings& bindings = GetBindings();
+	if (bindings.ps == shaderHandle)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create Vertex Shader Input Layout.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	return handle;
+	bindings.context->SetPixelShader(m_pixelShaders.Get(shaderHandle));
+	bindings.stats.binds++;
+
+	bindings.ps = shaderHandle;
+	bindings.material = MaterialHandle();
+	bindings.pipeline = PipelineHandle();
 }
 
-RHANDLE RenderManager::CreatePShaderResource(const void* shaderBytecode, size_t bytecodeSize)
+void RenderManager::SetVSConstantBuffer(CBHandle cbHandle)
 {
-	HRESULT hr = 0;
-	RHANDLE handle = ++m_psID;
+	if (!cbHandle)
+		return;
 
-	hr = m_d3dDevice->CreatePixelShader(shaderBytecode, bytecodeSize, nullptr, &m_pShaderMap[handle]);
-	if (FAILED(hr))
+	// Bound by the next draw, once it's known where its constants are
+	ContextBindings& bindings = GetBindings();
+	if (bindings.vsConstants == cbHandle)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create Pixel Shader.", "Error", MB_OK | MB_ICONERROR);
-		return -1;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
-	
-	return handle;
+
+	bindings.vsConstants = cbHandle;
+	bindings.vsConstantsDirty = true;
 }
 
-RHANDLE RenderManager::CreateCBResource(size_t bufferSize)
+void RenderManager::SetPSConstantBuffer(CBHandle cbHandle)
 {
-	HRESULT hr = 0;
-	RHANDLE handle = ++m_cbID;
-	D3D11_BUFFER_DESC constantBufferDesc;
-	ZeroMemory(&constantBufferDesc, sizeof(D3D11_BUFFER_DESC));
+	if (!cbHandle)
+		return;
 
-	constantBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	constantBufferDesc.ByteWidth = bufferSize;
-	constantBufferDesc.CPUAccessFlags = 0;
-	constantBufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	
-	hr = m_d3dDevice->CreateBuffer(&constantBufferDesc, nullptr, &m_cBufferMap[handle]);
-	if (FAILED(hr))
+	ContextBindings& bindings = GetBindings();
+	if (bindings.psConstants == cbHandle)
 	{
-		MessageBoxA(WindowsManager::GetSingleton().GetWindowHandle(),
-			"Failed to create Constant Buffer.", "Error", MB_OK | MB_ICONERROR);
-		return false;
+		bindings.stats.bindsAvoided++;
+		return;
 	}
 
-	return handle;
+	bindings.psConstants = cbHandle;
+	bindings.psConstantsDirty = true;
 }
 
-RHANDLE RenderManager::CreateMaterial(RHANDLE vShader, RHANDLE pShader, RHANDLE vCBuffer, RHANDLE pCBuffer)
+void RenderManager::UpdateConstantBuffer(CBHandle cbHandle, const void* cbData)
 {
-	assert(vShader > 0 && vShader <= m_vsID);
-	assert(pShader > 0 && vShader <= m_psID);
-	//assert(vCBuffer > 0 && vCBuffer <= m_cbID);
-	//assert(pCBuffer > 0 && pCBuffer <= m_cbID);
+	ContextBindings& bindings = GetBindings();
+	ConstantBuffer& cb = m_constantBuffers.Get(cbHandle);
 
-	RHANDLE handle = ++m_matID;
-	std::unique_ptr<Material> temp(new Material(vShader, pShader, vCBuffer, pCBuffer));
-	m_materialMap.insert(MaterialMap::value_type(handle, move(temp)));
+	if (&bindings == &m_immediate)
+	{
+		assert(m_recordingThreads == 0 && "Constant buffers can't be updated on the main thread while other threads are recording");
+		memcpy(cb.contents.data(), cbData, cb.size);
 
-	return handle;
+		// Without the ring every update on the main thread goes into the buffer, the way it always has
+		if (!m_constantRing.IsActive())
+		{
+			bindings.context->UpdateBuffer(cb.buffer, cbData);
+			return;
+		}
+	}
+
+	PlaceConstants(bindings, cbHandle, cb, cbData);
+
+	if (bindings.vsConstants == cbHandle)
+		bindings.vsConstantsDirty = true;
+	if (bindings.psConstants == cbHandle)
+		bindings.psConstantsDirty = true;
 }
 
-void RenderManager::SetMaterial(RHANDLE materialHandle)
+void RenderManager::PlaceConstants(ContextBindings& bindings, CBHandle cbHandle, const ConstantBuffer& cb, const void* data)
 {
-	if (m_curMat == materialHandle)
-		return;
+	unsigned int index = cbHandle.GetIndex();
+	if (bindings.placements.size() <= index)
+		bindings.placements.resize(m_constantBuffers.Capacity());
 
-	assert(materialHandle > 0 && materialHandle <= m_matID);
+	ConstantPlacement& placement = bindings.placements[index];
+	bool inBufferAlready = placement.generation == bindings.generation && placement.offset == CONSTANTS_IN_BUFFER;
+	placement.generation = bindings.generation;
 
-	Material* material = m_materialMap[materialHandle].get();
-	SetVertexShader(material->vsHandle);
-	SetPixelShader(material->psHandle);
-	if(material->vsCBHandle != 0)
-		SetVSConstantBuffer(material->vsCBHandle);
-	if(material->psCBHandle != 0)
-		SetPSConstantBuffer(material->psCBHandle);
-	
-	m_curMat = materialHandle;
+	unsigned int offset;
+	void* constants = m_constantRing.IsActive() ? m_constantRing.Allocate(cb.size, offset) : nullptr;
+	if (constants)
+	{
+		memcpy(constants, data, cb.size);
+		placement.offset = offset;
+	}
+	else
+	{
+		// No ring, or it's full for this frame, so it's back to updating the buffer itself. A list has that undone
+		// once it's been executed.
+		bindings.context->UpdateBuffer(cb.buffer, data);
+		placement.offset = CONSTANTS_IN_BUFFER;
+		if (&bindings != &m_immediate && !inBufferAlready)
+			bindings.bufferUpdates.push_back(cbHandle);
+	}
 }
 
-void RenderManager::SetVertexShader(RHANDLE shaderHandle)
+void RenderManager::CommitConstants(ContextBindings& bindings)
 {
-	if (m_curVS == shaderHandle)
-		return;
+	for (int stage = 0; stage < 2; stage++)
+	{
+		bool pixelShader = stage == 1;
+		bool& dirty = pixelShader ? bindings.psConstantsDirty : bindings.vsConstantsDirty;
+		if (!dirty)
+			continue;
+
+		CBHandle cbHandle = pixelShader ? bindings.psConstants : bindings.vsConstants;
+		const ConstantBuffer& cb = m_constantBuffers.Get(cbHandle);
+		GPUHANDLE buffer = cb.buffer;
+		unsigned int offset = 0, size = 0;
+
+		// The device's buffers already hold what the main thread last put in when there's no ring, but a list can't count
+		// on that, since another list may have written to them first
+		if (m_constantRing.IsActive() || &bindings != &m_immediate)
+		{
+			// Nothing's been placed for it yet this frame (or this list), so it starts from the main thread's copy
+			unsigned int index = cbHandle.GetIndex();
+			if (index >= bindings.placements.size() || bindings.placements[index].generation != bindings.generation)
+				PlaceConstants(bindings, cbHandle, cb, cb.contents.data());
 
-	assert(shaderHandle > 0 && shaderHandle <= m_vsID);
+			const ConstantPlacement& placement = bindings.placements[index];
+			if (placement.offset != CONSTANTS_IN_BUFFER)
+			{
+				buffer = m_constantRing.GetBuffer();
+				offset = placement.offset;
+				size = ConstantRing::GetAllocationSize(cb.size);
+			}
+		}
 
-	m_d3dDeviceContext->VSSetShader(m_vShaderMap[shaderHandle].Get(), nullptr, 0);
-	m_d3dDeviceContext->IASetInputLayout(m_vsInputLayoutMap[shaderHandle].Get());
+		if (pixelShader)
+			bindings.context->SetPSConstantBuffer(0, buffer, offset, size);
+		else
+			bindings.context->SetVSConstantBuffer(0, buffer, offset, size);
+		bindings.stats.binds++;
+		dirty = false;
+	}
 
-	m_curVS = shaderHandle;
+	// The device draws straight away, so anything it's about to read has to be in the buffer already. Lists get
+	// theirs uploaded when they're executed.
+	if (&bindings == &m_immediate && m_constantRing.IsActive())
+	{
+		assert(m_recordingThreads == 0 && "The main thread can't draw while other threads are recording");
+		m_constantRing.Upload();
+	}
 }
 
-
-void RenderManager::SetPixelShader(RHANDLE shaderHandle)
+void RenderManager::DrawWithMaterial(MeshHandle meshHandle, MaterialHandle materialHandle)
 {
-	if (m_curPS == shaderHandle)
-		return;
+	SetMaterial(materialHandle);
+	DrawMesh(meshHandle);
+}
 
-	assert(shaderHandle > 0 && shaderHandle <= m_psID);
+void RenderManager::DrawInstancedWithMaterial(MeshHandle meshHandle, MaterialHandle materialHandle, GPUHANDLE instanceBuffer, unsigned int instanceStride,
+	unsigned int instanceCount, unsigned int startInstance)
+{
+	SetMaterial(materialHandle);
+	DrawMeshInstanced(meshHandle, instanceBuffer, instanceStride, instanceCount, startInstance);
+}
 
-	m_d3dDeviceContext->PSSetShader(m_pShaderMap[shaderHandle].Get(), nullptr, 0);
-	
-	m_curPS = shaderHandle;
+void RenderManager::DrawMesh(MeshHandle meshHandle)
+{
+	ContextBindings& bindings = GetBindings();
+	SetMesh(meshHandle);
+	CommitConstants(bindings);
+	m_meshes.Get(meshHandle)->DrawBound(bindings.context);
 }
 
-void RenderManager::SetVSConstantBuffer(RHANDLE cbHandle)
+void RenderManager::DrawMeshInstanced(MeshHandle meshHandle, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance)
 {
-	//assert(cbHandle > 0 && cbHandle <= m_cbID);
-	if (cbHandle == 0 || cbHandle > m_cbID)
-		return;
+	ContextBindings& bindings = GetBindings();
+	SetMesh(meshHandle);
+	CommitConstants(bindings);
+	m_meshes.Get(meshHandle)->DrawBoundInstanced(bindings.context, instanceBuffer, instanceStride, instanceCount, startInstance);
+}
 
-	m_d3dDeviceContext->VSSetConstantBuffers(0, 1, m_cBufferMap[cbHandle].GetAddressOf());
+Material& RenderManager::GetMaterial(MaterialHandle materialHandle)
+{
+	return m_materials.Get(materialHandle);
 }
 
-void RenderManager::SetPSConstantBuffer(RHANDLE cbHandle)
+uint64_t RenderManager::GetPipelineKey(const PipelineState& desc)
 {
-	//assert(cbHandle > 0 && cbHandle <= m_cbID);
-	if (cbHandle == 0 || cbHandle > m_cbID)
-		return;
+	static_assert(2 * SLOT_HANDLE_INDEX_BITS + 24 <= 64, "The shader slots and states don't fit in a pipeline key");
 
-	m_d3dDeviceContext->PSSetConstantBuffers(0, 1, m_cBufferMap[cbHandle].GetAddressOf());
+	return
+		(uint64_t)desc.vsHandle.GetIndex() << (SLOT_HANDLE_INDEX_BITS + 24) |
+		(uint64_t)desc.psHandle.GetIndex() << 24 |
+		(uint64_t)desc.rasterizer << 16 |
+		(uint64_t)desc.depthStencil << 8 |
+		(uint64_t)desc.blend;
 }
 
-void RenderManager::UpdateConstantBuffer(RHANDLE cbHandle, const void* cbData)
+PipelineHandle RenderManager::CreatePipelineState(const PipelineState& desc)
 {
-	assert(cbHandle > 0 && cbHandle <= m_cbID);
+	assert(m_vertexShaders.IsValid(desc.vsHandle));
+	assert(m_pixelShaders.IsValid(desc.psHandle));
 
-	m_d3dDeviceContext->UpdateSubresource(m_cBufferMap[cbHandle].Get(), 0, nullptr, cbData, 0, 0);
+	uint64_t key = GetPipelineKey(desc);
+	auto existing = m_pipelineLookup.find(key);
+	if (existing != m_pipelineLookup.end())
+		return existing->second;
+
+	PipelineHandle handle = m_pipelines.Add(desc);
+	m_pipelineLookup[key] = handle;
+	return handle;
 }
 
-void RenderManager::DrawWithMaterial(RHANDLE meshHandle, RHANDLE materialHandle)
+void RenderManager::DestroyPipelinesUsing(VSHandle vs, PSHandle ps)
 {
-	assert(meshHandle > 0 && meshHandle <= m_meshID);
-	assert(materialHandle > 0 && materialHandle <= m_matID);
-
-	SetMaterial(materialHandle);
+	m_pipelines.ForEach([&](PipelineHandle handle, PipelineState& pipeline)
+	{
+		if (pipeline.vsHandle != vs && pipeline.psHandle != ps)
+			return;
 
-	// Draw Mesh
-	// ToDo: Break mesh drawing into two parts: Setting Resources and Calling "DrawIndexed"
-	m_meshMap[meshHandle]->Draw(m_d3dDeviceContext.Get());
+		m_pipelineLookup.erase(GetPipelineKey(pipeline));
+		if (m_immediate.pipeline == handle)
+			m_immediate.pipeline = PipelineHandle();
+		m_pipelines.Remove(handle);
+	});
 }
 
-Material& RenderManager::GetMaterial(RHANDLE materialHandle)
+void RenderManager::SetPipelineState(PipelineHandle pipelineHandle, unsigned int stencilRef)
 {
-	assert(materialHandle > 0 && materialHandle <= m_matID);
+	ContextBindings& bindings = GetBindings();
+	if (bindings.pipeline == pipelineHandle && bindings.stencilRef == stencilRef)
+	{
+		bindings.stats.pipelineChangesAvoided++;
+		return;
+	}
+
+	// Each of these only goes to the device if it's different
+	const PipelineState& pipeline = m_pipelines.Get(pipelineHandle);
+	SetVertexShader(pipeline.vsHandle);
+	SetPixelShader(pipeline.psHandle);
+	SetRasterizerState(pipeline.rasterizer);
+	SetDepthStencilState(pipeline.depthStencil, stencilRef);
+	SetBlendState(pipeline.blend);
 
-	return *m_materialMap[materialHandle];
+	bindings.pipeline = pipelineHandle;
+	bindings.stats.pipelineChanges++;
 }
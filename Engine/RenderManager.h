@@ -1,9 +1,14 @@
 #pragma once
 #include "Singleton.h"
-#include "DirectXIncludes.h"
+#include "RenderDevice.h"
 #include "Mesh.h"
 #include "Transform.h"
 #include "Camera.h"
+#include "ConstantRing.h"
+#include "SlotArray.h"
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
 #include <unordered_map>
 
 // Enums for easy reference while creating/setting preconfigured states for 
@@ -54,150 +59,353 @@ enum SAMPLER_STATE
 	SAMPLER_STATE_COUNT
 };
 
-// For keeping track of references to created resources.
-// The typedef just helps me clarify how functions and
-// and values are meant to be used.
-typedef unsigned short RHANDLE;
+// For keeping track of references to created resources. Each kind of resource has its own handle
+// type, so a mesh can't be passed where a material is wanted, and a default constructed handle
+// means "none".
+struct VertexShaderTag;
+struct PixelShaderTag;
+struct ConstantBufferTag;
+struct Material;
+struct PipelineState;
+
+typedef Handle<Mesh> MeshHandle;
+typedef Handle<VertexShaderTag> VSHandle;
+typedef Handle<PixelShaderTag> PSHandle;
+typedef Handle<ConstantBufferTag> CBHandle;
+typedef Handle<Material> MaterialHandle;
+typedef Handle<PipelineState> PipelineHandle;
 
 // A simple struct to tie together a vertex shader and pixel shader meant to be used together.
 // Also includes space for constant buffers if any are needed.
 struct Material
 {
-	RHANDLE vsHandle;
-	RHANDLE psHandle;
-	RHANDLE vsCBHandle;
-	RHANDLE psCBHandle;
+	VSHandle vsHandle;
+	PSHandle psHandle;
+	CBHandle vsCBHandle;
+	CBHandle psCBHandle;
 
 	Material()
-		: vsHandle(0)
-		, psHandle(0)
-		, vsCBHandle(0)
-		, psCBHandle(0)
 	{}
 
-	Material(RHANDLE vs, RHANDLE ps, RHANDLE vcb = 0, RHANDLE pcb = 0)
+	Material(VSHandle vs, PSHandle ps, CBHandle vcb = CBHandle(), CBHandle pcb = CBHandle())
 		: vsHandle(vs)
 		, psHandle(ps)
 		, vsCBHandle(vcb)
 		, psCBHandle(pcb)
 	{}
 };
- 
+
+// The shaders and fixed function state a draw needs, bound all at once with SetPipelineState. The input layout comes
+// with the vertex shader. The stencil reference isn't part of it, since it tends to change without anything else
+// changing.
+struct PipelineState
+{
+	VSHandle vsHandle;
+	PSHandle psHandle;
+	RASTERIZER_STATE rasterizer;
+	DEPTH_STENCIL_STATE depthStencil;
+	BLEND_STATE blend;
+
+	PipelineState()
+		: rasterizer(CULL_BACK)
+		, depthStencil(READ_WRITE)
+		, blend(SOLID)
+	{}
+
+	PipelineState(VSHandle vs, PSHandle ps, RASTERIZER_STATE rasterizer, DEPTH_STENCIL_STATE depthStencil, BLEND_STATE blend)
+		: vsHandle(vs)
+		, psHandle(ps)
+		, rasterizer(rasterizer)
+		, depthStencil(depthStencil)
+		, blend(blend)
+	{}
+};
+
+// How many texture and sampler slots the RenderManager keeps track of. Slots past these are always passed on.
+#define RENDER_MANAGER_TEXTURE_SLOTS 8
+#define RENDER_MANAGER_SAMPLER_SLOTS 8
+
+// What the RenderManager's state cache did over a frame. Binds are the ones passed on to the device, avoided binds the
+// ones that asked for what was already bound. Pipeline changes are counted separately, as well as in the binds they
+// turn into.
+struct StateCacheStats
+{
+	unsigned int binds;
+	unsigned int bindsAvoided;
+	unsigned int pipelineChanges;
+	unsigned int pipelineChangesAvoided;
+};
+
 class RenderManager : public Singleton<RenderManager>
 {
 private:
 
-	// The current viewport we are using in the rasterizer stage.
-	D3D11_VIEWPORT m_viewport;
+	// Everything goes through the device. It's declared first so it outlives the meshes and
+	// shaders below, which give their handles back to it when they're destroyed.
+	std::unique_ptr<RenderDevice> m_device;
+
+	// Per draw constants come out of here when the device can bind them with offsets. Declared after the device so
+	// it's gone before the device is.
+	ConstantRing m_constantRing;
 
-	// Incrementing unique ID values for each type of resource tracked by the RenderManager.
-	RHANDLE m_meshID, m_vsID, m_psID, m_cbID, m_matID;
+	// The current viewport we are using in the rasterizer stage.
+	Viewport m_viewport;
 
 	// Tracking variables for settable resources. These are set whenever a resources is used
 	// and are polled whenever a request to set another resource is received to see if we are
-	// aready using it and, therefore, do no need to do any switching.
-	RHANDLE m_curMesh, m_curVS, m_curPS, m_curMat;
-
-	// Maps associating generated resources with their respective resource handles.
-	std::unordered_map<RHANDLE, std::unique_ptr<Mesh>> m_meshMap;
-	std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11VertexShader>> m_vShaderMap;
-	std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11PixelShader>> m_pShaderMap;
-	std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11Buffer>> m_cBufferMap;
-	std::unordered_map<RHANDLE, std::unique_ptr<Material>> m_materialMap;
-	std::unordered_map<RHANDLE, Microsoft::WRL::ComPtr<ID3D11InputLayout>> m_vsInputLayoutMap; // RHANDLE is same as corresponding vShader
-
-	// Direct3D device and swap chain.
-	Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
-	Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dDeviceContext;
-	Microsoft::WRL::ComPtr<IDXGISwapChain1> m_d3dSwapChain;
-
-	// ToDo: Allow users to create and set RenderTargetViews, DepthStencilViews, and DepthStencilBuffers
-
-	// Render target view for the back buffer of the swap chain.
-	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_d3dRenderTargetView;
-	// Depth/stencil view for use as a depth buffer.
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> m_d3dDepthStencilView;
-	// A texture to associate to the depth stencil view.
-	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_d3dDepthStencilBuffer;
+	// aready using it and, therefore, do no need to do any switching. The targets are kept so
+	// Blit and RenderFullscreen can put them back afterwards.
+	//
+	// There's a set for the device and one per thread recording a command list, since each of
+	// those has its own things bound. Everything starts out unbound, which after ClearState is
+	// what's really there, except the fixed function states, which start out as COUNT (not
+	// one of ours). A texture slot is UNKNOWN_TEXTURE when D3D11 may have unbound it behind
+	// our back, for being a render target as well.
+	//
+	// Constant buffers are only bound when something's drawn, since with the ring where they get
+	// bound depends on the last update. Each set remembers where in the ring its updates went
+	// (indexed by constant buffer slot), and those are only good for as long as the generation
+	// they were placed in: the frame for the device, the recording for a command list.
+	//
+	// Without the ring, or once it's full, a command list has to write to the constant buffer
+	// itself, which every list after it would see too. So lists always write their own copy
+	// before they draw with one, and remember which they wrote to (see m_listBufferUpdates).
+	struct ConstantPlacement
+	{
+		unsigned int generation;
+		unsigned int offset;
+
+		ConstantPlacement()
+			: generation(0)
+			, offset(0)
+		{}
+	};
+
+	struct ContextBindings
+	{
+		RenderContext* context;
+		MeshHandle mesh;
+		VSHandle vs;
+		PSHandle ps;
+		MaterialHandle material;
+		GPUHANDLE renderTarget, depthStencil;
+		CBHandle vsConstants, psConstants;
+		bool vsConstantsDirty, psConstantsDirty;
+		unsigned int generation;
+		std::vector<ConstantPlacement> placements;
+		std::vector<CBHandle> bufferUpdates;
+
+		// The pipeline is none as soon as anything in it is set on its own
+		PipelineHandle pipeline;
+		RASTERIZER_STATE rasterizer;
+		DEPTH_STENCIL_STATE depthStencilState;
+		unsigned int stencilRef;
+		BLEND_STATE blend;
+		GPUHANDLE textures[RENDER_MANAGER_TEXTURE_SLOTS];
+		SAMPLER_STATE samplers[RENDER_MANAGER_SAMPLER_SLOTS];
+
+		StateCacheStats stats;
+
+		ContextBindings();
+
+		// Forgets everything bound, but not where constants were placed or the stats
+		void Reset(RenderContext* newContext);
+	};
+
+	ContextBindings m_immediate;
+	static thread_local ContextBindings s_recording;
+
+	// The command list this thread is recording into, or the device if it isn't recording
+	ContextBindings& GetBindings();
+
+	// A constant buffer of the material's own, for when the ring can't be used, and a copy of what
+	// the main thread last put in it. Command lists start from that copy.
+	struct ConstantBuffer
+	{
+		GPUHANDLE buffer;
+		unsigned int size;
+		std::vector<unsigned char> contents;
+	};
+
+	// The pipelines, and the same again keyed by everything in them so asking twice gives the same one.
+	// The key has the shaders' slots rather than their handles, which is fine since destroying a
+	// shader destroys the pipelines that use it.
+	SlotArray<PipelineState> m_pipelines;
+	std::unordered_map<uint64_t, PipelineHandle> m_pipelineLookup;
+
+	static uint64_t GetPipelineKey(const PipelineState& desc);
+	void DestroyPipelinesUsing(VSHandle vs, PSHandle ps);
+
+	// Stats from the device's bindings and the lists finished so far this frame. Lists add theirs in
+	// EndRecording, from whichever thread recorded them.
+	StateCacheStats m_stateStats;
+	StateCacheStats m_lastStateStats;
+	StateCacheStats m_totalStateStats;
+	std::mutex m_stateStatsLock;
+
+	static void AddStateStats(StateCacheStats& total, const StateCacheStats& stats);
+
+	// How many threads are recording right now. The main thread can't change the copies above
+	// while any of them are reading them.
+	std::atomic<int> m_recordingThreads;
+
+	// Constant buffers that command lists wrote to directly, added in EndRecording. Once a list
+	// has been executed, the ones it wrote get the main thread's copy back, so its updates end
+	// with it.
+	struct ListBufferUpdate
+	{
+		const RenderCommandList* list;
+		CBHandle cbHandle;
+	};
+	std::vector<ListBufferUpdate> m_listBufferUpdates;
+	std::mutex m_listBufferUpdatesLock;
+
+	// Puts data somewhere this set of bindings can bind it: the ring if there's room, the
+	// constant buffer itself if not
+	void PlaceConstants(ContextBindings& bindings, CBHandle cbHandle, const ConstantBuffer& cb, const void* data);
+
+	// Binds whichever constant buffers have changed since the last draw
+	void CommitConstants(ContextBindings& bindings);
+
+	// The resources themselves, looked up by handle. Materials are small enough to keep by value.
+	SlotArray<std::unique_ptr<Mesh>, Mesh> m_meshes;
+	SlotArray<GPUHANDLE, VertexShaderTag> m_vertexShaders;
+	SlotArray<GPUHANDLE, PixelShaderTag> m_pixelShaders;
+	SlotArray<ConstantBuffer, ConstantBufferTag> m_constantBuffers;
+	SlotArray<Material> m_materials;
 
 	// Arrays of some simple pre-configured state objects for various stages of the rendering pipeline
-	Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_rasterizerStates[RASTERIZER_STATE_COUNT];
-	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> m_depthStencilStates[DEPTH_STENCIL_STATE_COUNT];
-	Microsoft::WRL::ComPtr<ID3D11BlendState> m_blendStates[BLEND_STATE_COUNT];
-	Microsoft::WRL::ComPtr<ID3D11SamplerState> m_samplerStates[SAMPLER_STATE_COUNT];
-
-	// Present parameters used by the IDXGISwapChain1::Present1 method
-	DXGI_PRESENT_PARAMETERS m_PresentParameters;
+	GPUHANDLE m_rasterizerStates[RASTERIZER_STATE_COUNT];
+	GPUHANDLE m_depthStencilStates[DEPTH_STENCIL_STATE_COUNT];
+	GPUHANDLE m_blendStates[BLEND_STATE_COUNT];
+	GPUHANDLE m_samplerStates[SAMPLER_STATE_COUNT];
 
 	// A material and geometry for blitting to the screen.
 	// I imagine compute shaders may be able to be used to accomplish this more efficiently? I guess I will find out later on.
-	RHANDLE m_blitMaterial;
-	RHANDLE m_blitQuad;
-	RHANDLE m_blitVS; // This is retained for use with the RenderFullscreen function.
+	MaterialHandle m_blitMaterial;
+	MeshHandle m_blitQuad;
+	VSHandle m_blitVS; // This is retained for use with the RenderFullscreen function.
 
 	bool Initialize();
 	bool InitStates();
-	bool ResizeSwapChain(int width, int height);
 
 	// Helper functions for creating pre-configured rendering pipeline states
-	bool CreateRasterizerState(D3D11_CULL_MODE cullMode, D3D11_FILL_MODE fillMode, ID3D11RasterizerState** pResult);
-	bool CreateDepthStencilState(bool enable, bool writeEnable, bool stencilEnable, bool stencilWriteEnable, D3D11_COMPARISON_FUNC stencilFunc, ID3D11DepthStencilState** pResult);
-	bool CreateBlendState(D3D11_BLEND srcBlend, D3D11_BLEND destBlend, bool colorWriteEnable, ID3D11BlendState** pResult);
-	bool CreateSamplerState(D3D11_FILTER filter, D3D11_TEXTURE_ADDRESS_MODE addressMode, ID3D11SamplerState** pResult);
+	bool CreateRasterizerState(CULL_MODE cullMode, FILL_MODE fillMode, GPUHANDLE* pResult);
+	bool CreateDepthStencilState(bool enable, bool writeEnable, bool stencilEnable, bool stencilWriteEnable, COMPARISON_FUNC stencilFunc, GPUHANDLE* pResult);
+	bool CreateBlendState(BLEND_FACTOR srcBlend, BLEND_FACTOR destBlend, bool colorWriteEnable, GPUHANDLE* pResult);
+	bool CreateSamplerState(TEXTURE_FILTER filter, TEXTURE_ADDRESS addressMode, GPUHANDLE* pResult);
 
 public:
-	RenderManager();
+	// The RenderManager takes ownership of the device. GameEngine picks which one.
+	RenderManager(RenderDevice* device);
 	~RenderManager();
 
-	ID3D11Device* GetDevice() const;
-	ID3D11DeviceContext* GetDeviceContext() const;
-	ID3D11RenderTargetView** GetBackBufferRT() const;
-	ID3D11DepthStencilView** GetDepthStencil() const;
+	RenderDevice* GetDevice() const;
+	GPUHANDLE GetBackBuffer() const;
+	GPUHANDLE GetBackBufferDepth() const;
 
-	// Binds the default back buffer render target view and depth stencil view
+	// Binds the default back buffer and its depth stencil buffer
 	void ResetRenderTarget();
 
-	// Resource creation functions
-	RHANDLE CreateMeshResource(std::unique_ptr<Mesh> meshPtr);
-	//RHANDLE CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize);
-	RHANDLE CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize, const D3D11_INPUT_ELEMENT_DESC* elementDesc, UINT elementCount);
+	// Binds the given textures as the render target and depth stencil buffer. Either one can be 0.
+	void SetRenderTarget(GPUHANDLE renderTarget, GPUHANDLE depthStencil);
+	void ClearRenderTarget(GPUHANDLE renderTarget, const float clearColor[4]);
+	void ClearDepthStencil(GPUHANDLE depthStencil, unsigned int clearFlags, float clearDepth = 1.0f, unsigned char clearStencil = 0);
+
+	// Binds a texture to a pixel shader slot. Pass 0 to unbind whatever is there, which has to happen before
+	// a texture that was being read gets used as a render target again.
+	void SetPSTexture(unsigned int slot, GPUHANDLE texture);
+
+	// Resource creation functions. These give back a null handle if the device couldn't create the resource.
+	MeshHandle CreateMeshResource(std::unique_ptr<Mesh> meshPtr);
+	VSHandle CreateVShaderResource(const void* shaderBytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount);
 	// ToDo: Figure out a good way to tie sampler states and texture resources to pixel shaders.
 	// This can probably be accomplished through separate function calls that set these values for now?
-	RHANDLE CreatePShaderResource(const void* shaderBytecode, size_t bytecodeSize);
-	RHANDLE CreateCBResource(size_t bufferSize);
-	RHANDLE CreateMaterial(RHANDLE vShader, RHANDLE pShader, RHANDLE vCBuffer = 0, RHANDLE pCBuffer = 0);
+	PSHandle CreatePShaderResource(const void* shaderBytecode, size_t bytecodeSize);
+	CBHandle CreateCBResource(size_t bufferSize);
+	MaterialHandle CreateMaterial(VSHandle vShader, PSHandle pShader, CBHandle vCBuffer = CBHandle(), CBHandle pCBuffer = CBHandle());
+
+	// Gives back the handle of an identical pipeline state if there already is one. Main thread only, like the rest.
+	PipelineHandle CreatePipelineState(const PipelineState& desc);
+
+	// Resource destruction functions. The slot goes to the next resource created, and the old handle is stale (which
+	// asserts if it's used). Main thread only, while nothing is recording, and nothing waiting to be executed can still
+	// use the resource. Materials using a destroyed shader or constant buffer have to be destroyed too; pipelines using
+	// a destroyed shader go with it.
+	void DestroyMeshResource(MeshHandle meshHandle);
+	void DestroyVShaderResource(VSHandle shaderHandle);
+	void DestroyPShaderResource(PSHandle shaderHandle);
+	void DestroyCBResource(CBHandle cbHandle);
+	void DestroyMaterial(MaterialHandle materialHandle);
 
 	// Resource management functions
-	void SetMaterial(RHANDLE materialHandle);
-	void SetVertexShader(RHANDLE shaderHandle);
-	void SetPixelShader(RHANDLE shaderHandle);
-	void SetVSConstantBuffer(RHANDLE cbHandle);
-	void SetPSConstantBuffer(RHANDLE cbHandle);
-	void UpdateConstantBuffer(RHANDLE cbHandle, const void* cbData);
-	void DrawWithMaterial(RHANDLE meshHandle, RHANDLE materialHandle);
-	Material& GetMaterial(RHANDLE materialHandle);
+	void SetMaterial(MaterialHandle materialHandle);
+	void SetMesh(MeshHandle meshHandle);
+	void SetVertexShader(VSHandle shaderHandle);
+	void SetPixelShader(PSHandle shaderHandle);
+	void SetVSConstantBuffer(CBHandle cbHandle);
+	void SetPSConstantBuffer(CBHandle cbHandle);
+	// The draws after this see cbData, the ones before keep what they had. An update made while recording only lasts
+	// until the end of that list; lists start out with whatever the main thread last put in.
+	void UpdateConstantBuffer(CBHandle cbHandle, const void* cbData);
+	void DrawWithMaterial(MeshHandle meshHandle, MaterialHandle materialHandle);
+	// Same again for instanceCount copies of the mesh, each reading its own stride worth of instanceBuffer
+	void DrawInstancedWithMaterial(MeshHandle meshHandle, MaterialHandle materialHandle, GPUHANDLE instanceBuffer, unsigned int instanceStride,
+		unsigned int instanceCount, unsigned int startInstance = 0);
+
+	// Draw with whatever material is set already. The mesh's buffers are only bound if a different mesh was drawn last.
+	void DrawMesh(MeshHandle meshHandle);
+	void DrawMeshInstanced(MeshHandle meshHandle, GPUHANDLE instanceBuffer, unsigned int instanceStride, unsigned int instanceCount, unsigned int startInstance = 0);
+	// Only good until the next material is created
+	Material& GetMaterial(MaterialHandle materialHandle);
+
+	// Binds the pipeline's shaders and states, or does nothing at all if it's the pipeline that's bound already. Anything
+	// set on its own in between means it isn't any more.
+	void SetPipelineState(PipelineHandle pipelineHandle, unsigned int stencilRef = 0U);
 
 	void SetRasterizerState(RASTERIZER_STATE state);
-	void SetDepthStencilState(DEPTH_STENCIL_STATE state, UINT depthStencilWriteValue = 0U);
+	void SetDepthStencilState(DEPTH_STENCIL_STATE state, unsigned int depthStencilWriteValue = 0U);
 	void SetBlendState(BLEND_STATE state);
-	void SetSamplerState(SAMPLER_STATE state, UINT startSlot = 0U, UINT numSamplers = 1U);
+	void SetSamplerState(SAMPLER_STATE state, unsigned int startSlot = 0U, unsigned int numSamplers = 1U);
 
-	// Blits the given source texture to the specified destination texture. If the destination is null, the contents of src will be drawn to 
+	// Blits the given source texture to the specified destination texture. If the destination is 0, the contents of src will be drawn to 
 	// the back buffer.
-	void Blit(ID3D11ShaderResourceView* src, ID3D11RenderTargetView* dst, SAMPLER_STATE samplerState = SAMPLER_STATE::POINT_CLAMP, bool useDepth = false);
+	void Blit(GPUHANDLE src, GPUHANDLE dst = 0, SAMPLER_STATE samplerState = SAMPLER_STATE::POINT_CLAMP, bool useDepth = false);
 
-	// TODO: Implement this function. It will accept a pixel shader and use it to render a full-screen quad. Use the blit vertex shader as the vertex shader.
-	// if no render target view is specified, will render to the back buffer. Must update constant buffer manually before calling for now.
-	void RenderFullscreen(RHANDLE pShader, ID3D11RenderTargetView* dst = nullptr);
+	// Uses the given pixel shader to render a full-screen quad, with the blit vertex shader as the vertex shader.
+	// if no render target is specified, will render to the back buffer. Must update constant buffer manually before calling for now.
+	void RenderFullscreen(PSHandle pShader, GPUHANDLE dst = 0);
 
 	// Set the current viewport used by the rasterizer stage. Only really needs to be called when
 	// resizing the window or doing something special like rendering split-screen. I will expand
 	// this functionality if I ever have need.
 	void SetViewport(float width, float height, float topLeftX = 0.0f, float topLeftY = 0.0f, float minDepth = 0.0f, float maxDepth = 1.0f);
 
-	// Clear the contents of the back buffer, depth buffer, and stencil buffer.
+	// Clear the contents of the bound render target, depth buffer, and stencil buffer.
 	// This function is usually called before anything is rendered to the screen.
-	void Clear(const FLOAT clearColor[4], FLOAT clearDepth, UINT8 clearStencil);
+	void Clear(const float clearColor[4], float clearDepth, unsigned char clearStencil);
+
+	// Sends everything drawn on this thread into the list instead of to the device, until EndRecording, which closes
+	// the list. Any number of threads can record at once, each into its own list, as long as they only draw: creating
+	// resources and setting the viewport stay on the main thread. A list starts with just the viewport set, so
+	// targets, states and materials have to be set again in every list.
+	void BeginRecording(RenderCommandList& list);
+	void EndRecording();
+
+	// Plays back a list that's been recorded and closed, on the main thread, once nothing is recording any more. Lists are drawn in the order they're
+	// executed in, whatever order they were recorded in. Afterwards the viewport and render targets are as they
+	// were, but everything else has to be set again.
+	void ExecuteCommandList(RenderCommandList& list);
+
+	// Rolls the device and the constant ring over to a new frame. Call it at the start of every frame.
+	void BeginFrame();
+
+	// What the state cache did over the last complete frame, and over every frame up to and including it
+	const StateCacheStats& GetStateCacheStats() const;
+	const StateCacheStats& GetTotalStateCacheStats() const;
+
+	// What went into the constant ring. It's only used on devices that can bind part of a buffer.
+	const ConstantRing& GetConstantRing() const;
 
 	// Swap the contents of the back buffer to the front.
 	// This function is usually called after everything has been rendered.
@@ -35,7 +35,7 @@ public:
 	static T& GetSingleton()
 	{
 		assert(msSingleton);
-		return msSingleton*;
+		return *msSingleton;
 	}
 
 	static T* GetSingletonPtr()
@@ -0,0 +1,145 @@
+#pragma once
+#include <assert.h>
+#include <utility>
+#include <vector>
+
+// Handles are laid out like THANDLE: the low 20 bits index the slot, the high 12 bits hold the generation of the slot.
+// Generations start at 1, so 0 is never a valid handle and a default constructed one means "none".
+#define SLOT_HANDLE_INDEX_BITS 20
+#define SLOT_HANDLE_INDEX_MASK ((1U << SLOT_HANDLE_INDEX_BITS) - 1)
+#define SLOT_HANDLE_GENERATION_MASK ((1U << (32 - SLOT_HANDLE_INDEX_BITS)) - 1)
+
+// A handle to something in a SlotArray. The tag is only there to keep handles to different kinds of things from
+// being mixed up, so it doesn't have to be a complete type (or a real one).
+template <typename Tag>
+struct Handle
+{
+	unsigned int value;
+
+	Handle()
+		: value(0)
+	{}
+
+	explicit Handle(unsigned int value)
+		: value(value)
+	{}
+
+	unsigned int GetIndex() const { return value & SLOT_HANDLE_INDEX_MASK; }
+	unsigned int GetGeneration() const { return value >> SLOT_HANDLE_INDEX_BITS; }
+
+	explicit operator bool() const { return value != 0; }
+	bool operator==(const Handle& other) const { return value == other.value; }
+	bool operator!=(const Handle& other) const { return value != other.value; }
+};
+
+// Things stored in a dense array and looked up by handle, which is just an index plus a check in debug builds.
+// Removing something frees its slot for the next Add, with the slot's generation bumped so handles to what was there
+// before are stale. Looking up a stale handle asserts; IsValid can be used to check first.
+//
+// T has to be default constructible, since that's what a free slot holds. Not thread safe, although lookups on any
+// number of threads are fine as long as nothing is added or removed at the same time.
+template <typename T, typename Tag = T>
+class SlotArray
+{
+public:
+	typedef Handle<Tag> HandleType;
+
+private:
+	std::vector<T> m_values;
+	std::vector<unsigned short> m_generation;
+	std::vector<unsigned char> m_live;
+	std::vector<unsigned int> m_free;
+	unsigned int m_count;
+
+public:
+	SlotArray()
+		: m_count(0)
+	{}
+
+	HandleType Add(T value)
+	{
+		unsigned int index;
+		if (!m_free.empty())
+		{
+			index = m_free.back();
+			m_free.pop_back();
+		}
+		else
+		{
+			index = (unsigned int)m_values.size();
+			assert(index <= SLOT_HANDLE_INDEX_MASK && "Out of slots");
+
+			m_values.emplace_back();
+			m_generation.push_back(1);
+			m_live.push_back(0);
+		}
+
+		m_values[index] = std::move(value);
+		m_live[index] = 1;
+		m_count++;
+		return HandleType(((unsigned int)m_generation[index] << SLOT_HANDLE_INDEX_BITS) | index);
+	}
+
+	// Gives back what was in the slot. Does nothing but return false if the handle is stale.
+	bool Remove(HandleType handle, T* removed = nullptr)
+	{
+		if (!IsValid(handle))
+			return false;
+
+		unsigned int index = handle.GetIndex();
+		if (removed)
+			*removed = std::move(m_values[index]);
+		m_values[index] = T();
+
+		m_generation[index] = (unsigned short)((m_generation[index] % SLOT_HANDLE_GENERATION_MASK) + 1);
+		m_live[index] = 0;
+		m_free.push_back(index);
+		m_count--;
+		return true;
+	}
+
+	bool IsValid(HandleType handle) const
+	{
+		unsigned int index = handle.GetIndex();
+		return index < m_values.size() && m_live[index] && m_generation[index] == handle.GetGeneration();
+	}
+
+	T& Get(HandleType handle)
+	{
+		assert(IsValid(handle) && "Stale or null handle");
+		return m_values[handle.GetIndex()];
+	}
+
+	const T& Get(HandleType handle) const
+	{
+		assert(IsValid(handle) && "Stale or null handle");
+		return m_values[handle.GetIndex()];
+	}
+
+	// Calls f(handle, value) for everything in the array, in slot order
+	template <typename F>
+	void ForEach(F f)
+	{
+		for (unsigned int i = 0; i < (unsigned int)m_values.size(); i++)
+		{
+			if (m_live[i])
+				f(HandleType(((unsigned int)m_generation[i] << SLOT_HANDLE_INDEX_BITS) | i), m_values[i]);
+		}
+	}
+
+	void Clear()
+	{
+		ForEach([this](HandleType handle, T&) { Remove(handle); });
+	}
+
+	unsigned int Count() const
+	{
+		return m_count;
+	}
+
+	// One past the highest index handed out so far, for anything kept in arrays alongside this one
+	unsigned int Capacity() const
+	{
+		return (unsigned int)m_values.size();
+	}
+};
@@ -0,0 +1,624 @@
+#include "SoftwareRasterizer.h"
+#include "JobSystem.h"
+#include <math.h>
+#include <string.h>
+
+// A triangle clipped against all six planes can come out with up to nine corners
+#define MAX_CLIP_VERTICES 9
+#define MAX_VERTEX_FLOATS (4 + SOFTWARE_MAX_VARYINGS)
+#define CLIP_PLANE_COUNT 6
+
+// Edge values are kept in 64 bits per block and handed to the lanes in 32. Clamping to this first can't change a
+// sign, since the most a lane adds on top is three pixels' worth of an edge's step.
+#define EDGE_CLAMP (1LL << 30)
+
+// ----------------------------------------------------------------------------------
+// Helper Functions
+// ----------------------------------------------------------------------------------
+
+// Which lane of a 4x2 block is which pixel
+static const int32_t s_laneX[SIMD_WIDTH] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+static const int32_t s_laneY[SIMD_WIDTH] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+
+// Distance of a clip space vertex inside each clip plane: near, far, then the guard band's left, right, bottom and top.
+// Negative is outside.
+static float ClipDistance(const float* v, int plane, float guardX, float guardY)
+{
+	switch (plane)
+	{
+	case 0:		return v[2];
+	case 1:		return v[3] - v[2];
+	case 2:		return guardX * v[3] + v[0];
+	case 3:		return guardX * v[3] - v[0];
+	case 4:		return guardY * v[3] + v[1];
+	default:	return guardY * v[3] - v[1];
+	}
+}
+
+static unsigned int ClipCode(const float* v, float guardX, float guardY)
+{
+	unsigned int code = 0;
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		if (ClipDistance(v, plane, guardX, guardY) < 0.0f)
+			code |= 1 << plane;
+	}
+
+	return code;
+}
+
+static bool StencilCompare(COMPARISON_FUNC func, unsigned char ref, unsigned char stored)
+{
+	switch (func)
+	{
+	case COMPARISON_FUNC::NEVER:			return false;
+	case COMPARISON_FUNC::LESS:				return ref < stored;
+	case COMPARISON_FUNC::EQUAL:			return ref == stored;
+	case COMPARISON_FUNC::LESS_EQUAL:		return ref <= stored;
+	case COMPARISON_FUNC::GREATER:			return ref > stored;
+	case COMPARISON_FUNC::NOT_EQUAL:		return ref != stored;
+	case COMPARISON_FUNC::GREATER_EQUAL:	return ref >= stored;
+	default:								return true;
+	}
+}
+
+static SIMDFloat BlendFactor(BLEND_FACTOR factor, const SIMDFloat& srcAlpha)
+{
+	switch (factor)
+	{
+	case BLEND_FACTOR::ZERO:			return SIMDFloat(0.0f);
+	case BLEND_FACTOR::ONE:				return SIMDFloat(1.0f);
+	case BLEND_FACTOR::SRC_ALPHA:		return srcAlpha;
+	default:							return SIMDFloat(1.0f) - srcAlpha;
+	}
+}
+
+// Reads the 4x2 block at (x, y) into lanes. Only lanes in mask are read, so a block hanging over the edge of the target
+// doesn't read past it. The rest are left as they were.
+template <typename T>
+static void LoadBlock(const T* pixels, unsigned int width, int x, int y, unsigned int mask, T out[SIMD_WIDTH])
+{
+	const T* row = pixels + (size_t)y * width + x;
+	if (mask == 0xFF)
+	{
+		memcpy(out, row, 4 * sizeof(T));
+		memcpy(out + 4, row + width, 4 * sizeof(T));
+		return;
+	}
+
+	for (int lane = 0; lane < SIMD_WIDTH; lane++)
+	{
+		if (mask & (1 << lane))
+			out[lane] = row[s_laneY[lane] * width + s_laneX[lane]];
+	}
+}
+
+template <typename T>
+static void StoreBlock(T* pixels, unsigned int width, int x, int y, unsigned int mask, const T in[SIMD_WIDTH])
+{
+	T* row = pixels + (size_t)y * width + x;
+	if (mask == 0xFF)
+	{
+		memcpy(row, in, 4 * sizeof(T));
+		memcpy(row + width, in + 4, 4 * sizeof(T));
+		return;
+	}
+
+	for (int lane = 0; lane < SIMD_WIDTH; lane++)
+	{
+		if (mask & (1 << lane))
+			row[s_laneY[lane] * width + s_laneX[lane]] = in[lane];
+	}
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+SoftwareRasterizer::SoftwareRasterizer()
+	: m_colorTarget(nullptr)
+	, m_depthTarget(nullptr)
+	, m_width(0)
+	, m_height(0)
+	, m_tilesX(0)
+	, m_tilesY(0)
+{
+}
+
+void SoftwareRasterizer::SetTargets(SoftwareTexture* colorTarget, SoftwareTexture* depthTarget)
+{
+	Flush();
+
+	m_colorTarget = colorTarget;
+	m_depthTarget = depthTarget;
+
+	const SoftwareTexture* target = colorTarget ? colorTarget : depthTarget;
+	m_width = target ? target->desc.width : 0;
+	m_height = target ? target->desc.height : 0;
+	m_tilesX = (m_width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+	m_tilesY = (m_height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+
+	// Bins are only ever added, so their capacity sticks around for the next time a target this big comes along
+	if (m_bins.size() < m_tilesX * m_tilesY)
+		m_bins.resize(m_tilesX * m_tilesY);
+}
+
+size_t SoftwareRasterizer::StoreConstants(const void* data, size_t size)
+{
+	size_t offset = (m_constants.size() + 15) & ~(size_t)15;
+	m_constants.resize(offset + size);
+	memcpy(&m_constants[offset], data, size);
+	return offset;
+}
+
+void SoftwareRasterizer::BeginDraw(const SoftwareDrawState& draw)
+{
+	assert(draw.varyingCount <= SOFTWARE_MAX_VARYINGS);
+	m_draws.push_back(draw);
+}
+
+void SoftwareRasterizer::DrawTriangle(const float* v0, const float* v1, const float* v2)
+{
+	assert(!m_draws.empty() && "DrawTriangle needs a BeginDraw first");
+	const SoftwareDrawState& draw = m_draws.back();
+
+	// The guard band in clip space units
+	float guardX = 1.0f + 2.0f * SOFTWARE_GUARD_BAND / draw.viewport.width;
+	float guardY = 1.0f + 2.0f * SOFTWARE_GUARD_BAND / draw.viewport.height;
+
+	unsigned int code0 = ClipCode(v0, guardX, guardY);
+	unsigned int code1 = ClipCode(v1, guardX, guardY);
+	unsigned int code2 = ClipCode(v2, guardX, guardY);
+
+	// All on the wrong side of one plane, or all inside every one of them
+	if (code0 & code1 & code2)
+		return;
+
+	if ((code0 | code1 | code2) == 0)
+	{
+		SetupTriangle(v0, v1, v2);
+		return;
+	}
+
+	// Otherwise clip it one plane at a time (only against the planes something is outside of) and fan out what's left
+	unsigned int floatCount = 4 + draw.varyingCount;
+	float polygons[2][MAX_CLIP_VERTICES][MAX_VERTEX_FLOATS];
+	memcpy(polygons[0][0], v0, floatCount * sizeof(float));
+	memcpy(polygons[0][1], v1, floatCount * sizeof(float));
+	memcpy(polygons[0][2], v2, floatCount * sizeof(float));
+	int count = 3;
+	int current = 0;
+
+	unsigned int planes = code0 | code1 | code2;
+	for (int plane = 0; plane < CLIP_PLANE_COUNT; plane++)
+	{
+		if (!(planes & (1 << plane)))
+			continue;
+
+		float (*in)[MAX_VERTEX_FLOATS] = polygons[current];
+		float (*out)[MAX_VERTEX_FLOATS] = polygons[current ^ 1];
+		int outCount = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			const float* a = in[i];
+			const float* b = in[(i + 1) % count];
+			float da = ClipDistance(a, plane, guardX, guardY);
+			float db = ClipDistance(b, plane, guardX, guardY);
+
+			if (da >= 0.0f)
+				memcpy(out[outCount++], a, floatCount * sizeof(float));
+
+			if ((da >= 0.0f) != (db >= 0.0f))
+			{
+				float t = da / (da - db);
+				for (unsigned int f = 0; f < floatCount; f++)
+					out[outCount][f] = a[f] + (b[f] - a[f]) * t;
+				outCount++;
+			}
+		}
+
+		count = outCount;
+		current ^= 1;
+		if (count < 3)
+			return;
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+		SetupTriangle(polygons[current][0], polygons[current][i], polygons[current][i + 1]);
+}
+
+void SoftwareRasterizer::SetupTriangle(const float* v0, const float* v1, const float* v2)
+{
+	const SoftwareDrawState& draw = m_draws.back();
+	const Viewport& viewport = draw.viewport;
+	const float* vertices[3] = { v0, v1, v2 };
+
+	// Perspective divide and viewport transform, then snap to the subpixel grid
+	float screenZ[3], invW[3];
+	int x[3], y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const float* v = vertices[i];
+		if (!(v[3] > 0.0f))
+			return;
+
+		invW[i] = 1.0f / v[3];
+		float screenX = viewport.topLeftX + (v[0] * invW[i] + 1.0f) * 0.5f * viewport.width;
+		float screenY = viewport.topLeftY + (1.0f - v[1] * invW[i]) * 0.5f * viewport.height;
+		screenZ[i] = viewport.minDepth + v[2] * invW[i] * (viewport.maxDepth - viewport.minDepth);
+
+		x[i] = (int)lrintf(screenX * SOFTWARE_SUBPIXEL_SCALE);
+		y[i] = (int)lrintf(screenY * SOFTWARE_SUBPIXEL_SCALE);
+	}
+
+	// Positive area is clockwise on screen, which is what D3D calls the front
+	long long area = (long long)(x[1] - x[0]) * (y[2] - y[0]) - (long long)(y[1] - y[0]) * (x[2] - x[0]);
+	if (area == 0)
+		return;
+
+	bool front = area > 0;
+	if ((draw.cullMode == CULL_MODE::BACK && !front) || (draw.cullMode == CULL_MODE::FRONT && front))
+		return;
+
+	// Edge functions want clockwise, so flip back faces that made it this far
+	int order[3] = { 0, 1, 2 };
+	if (!front)
+	{
+		order[1] = 2;
+		order[2] = 1;
+	}
+
+	Triangle triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		triangle.x[i] = x[order[i]];
+		triangle.y[i] = y[order[i]];
+	}
+
+	// Pixels whose centres could be inside, then only the ones in the viewport and the target
+	int minX = triangle.x[0] < triangle.x[1] ? triangle.x[0] : triangle.x[1];
+	int maxX = triangle.x[0] > triangle.x[1] ? triangle.x[0] : triangle.x[1];
+	int minY = triangle.y[0] < triangle.y[1] ? triangle.y[0] : triangle.y[1];
+	int maxY = triangle.y[0] > triangle.y[1] ? triangle.y[0] : triangle.y[1];
+	minX = triangle.x[2] < minX ? triangle.x[2] : minX;
+	maxX = triangle.x[2] > maxX ? triangle.x[2] : maxX;
+	minY = triangle.y[2] < minY ? triangle.y[2] : minY;
+	maxY = triangle.y[2] > maxY ? triangle.y[2] : maxY;
+
+	const int halfPixel = SOFTWARE_SUBPIXEL_SCALE / 2;
+	triangle.minX = (minX - halfPixel + SOFTWARE_SUBPIXEL_SCALE - 1) >> SOFTWARE_SUBPIXEL_BITS;
+	triangle.maxX = (maxX - halfPixel) >> SOFTWARE_SUBPIXEL_BITS;
+	triangle.minY = (minY - halfPixel + SOFTWARE_SUBPIXEL_SCALE - 1) >> SOFTWARE_SUBPIXEL_BITS;
+	triangle.maxY = (maxY - halfPixel) >> SOFTWARE_SUBPIXEL_BITS;
+
+	int viewportMinX = (int)ceilf(viewport.topLeftX - 0.5f);
+	int viewportMaxX = (int)ceilf(viewport.topLeftX + viewport.width - 0.5f) - 1;
+	int viewportMinY = (int)ceilf(viewport.topLeftY - 0.5f);
+	int viewportMaxY = (int)ceilf(viewport.topLeftY + viewport.height - 0.5f) - 1;
+	viewportMinX = viewportMinX > 0 ? viewportMinX : 0;
+	viewportMinY = viewportMinY > 0 ? viewportMinY : 0;
+	viewportMaxX = viewportMaxX < (int)m_width - 1 ? viewportMaxX : (int)m_width - 1;
+	viewportMaxY = viewportMaxY < (int)m_height - 1 ? viewportMaxY : (int)m_height - 1;
+
+	triangle.minX = triangle.minX > viewportMinX ? triangle.minX : viewportMinX;
+	triangle.minY = triangle.minY > viewportMinY ? triangle.minY : viewportMinY;
+	triangle.maxX = triangle.maxX < viewportMaxX ? triangle.maxX : viewportMaxX;
+	triangle.maxY = triangle.maxY < viewportMaxY ? triangle.maxY : viewportMaxY;
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return;
+
+	// Make room before anything is added, since rasterizing what's binned so far throws away the triangles and planes
+	if (m_triangles.size() >= SOFTWARE_MAX_BINNED_TRIANGLES)
+		RasterizeBinned();
+
+	// Planes for depth, 1/w, and every varying over w, all from the snapped positions so they agree with the edges
+	float px[3], py[3];
+	for (int i = 0; i < 3; i++)
+	{
+		px[i] = (float)triangle.x[i] / SOFTWARE_SUBPIXEL_SCALE;
+		py[i] = (float)triangle.y[i] / SOFTWARE_SUBPIXEL_SCALE;
+	}
+
+	float ax = px[1] - px[0], ay = py[1] - py[0];
+	float bx = px[2] - px[0], by = py[2] - py[0];
+	float invDet = 1.0f / (ax * by - ay * bx);
+
+	triangle.originX = px[0];
+	triangle.originY = py[0];
+	triangle.draw = (unsigned int)m_draws.size() - 1;
+	triangle.planes = (unsigned int)m_planes.size();
+
+	unsigned int planeCount = 2 + draw.varyingCount;
+	for (unsigned int p = 0; p < planeCount; p++)
+	{
+		float values[3];
+		for (int i = 0; i < 3; i++)
+		{
+			int v = order[i];
+			if (p == 0)
+				values[i] = screenZ[v];
+			else if (p == 1)
+				values[i] = invW[v];
+			else
+				values[i] = vertices[v][4 + p - 2] * invW[v];
+		}
+
+		float d1 = values[1] - values[0];
+		float d2 = values[2] - values[0];
+
+		Plane plane;
+		plane.a = values[0];
+		plane.dx = (d1 * by - d2 * ay) * invDet;
+		plane.dy = (d2 * ax - d1 * bx) * invDet;
+		m_planes.push_back(plane);
+	}
+
+	unsigned int index = (unsigned int)m_triangles.size();
+	m_triangles.push_back(triangle);
+
+	for (int tileY = triangle.minY / SOFTWARE_TILE_SIZE; tileY <= triangle.maxY / SOFTWARE_TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / SOFTWARE_TILE_SIZE; tileX <= triangle.maxX / SOFTWARE_TILE_SIZE; tileX++)
+			m_bins[tileY * m_tilesX + tileX].push_back(index);
+	}
+}
+
+void SoftwareRasterizer::RasterizeTileJob(void* data, unsigned int index)
+{
+	SoftwareRasterizer* rasterizer = (SoftwareRasterizer*)data;
+	rasterizer->RasterizeTile(rasterizer->m_activeTiles[index]);
+}
+
+void SoftwareRasterizer::RasterizeTile(unsigned int tile)
+{
+	int tileMinX = (int)(tile % m_tilesX) * SOFTWARE_TILE_SIZE;
+	int tileMinY = (int)(tile / m_tilesX) * SOFTWARE_TILE_SIZE;
+	int tileMaxX = tileMinX + SOFTWARE_TILE_SIZE - 1;
+	int tileMaxY = tileMinY + SOFTWARE_TILE_SIZE - 1;
+
+	SIMDInt laneX = SIMDInt::Load(s_laneX);
+	SIMDInt laneY = SIMDInt::Load(s_laneY);
+
+	for (unsigned int index : m_bins[tile])
+	{
+		const Triangle& triangle = m_triangles[index];
+
+		int minX = triangle.minX > tileMinX ? triangle.minX : tileMinX;
+		int minY = triangle.minY > tileMinY ? triangle.minY : tileMinY;
+		int maxX = triangle.maxX < tileMaxX ? triangle.maxX : tileMaxX;
+		int maxY = triangle.maxY < tileMaxY ? triangle.maxY : tileMaxY;
+
+		// Blocks sit on a grid of 4x2, which tiles are lined up with
+		int startX = minX & ~3;
+		int startY = minY & ~1;
+
+		// E(p) = (p.y - a.y) * dx - (p.x - a.x) * dy for each edge a->b, positive inside. Shared edges belong to
+		// whichever triangle has them as a top or left edge, which the -1 bias takes care of for the others.
+		long long rowEdges[3], stepX[3], stepY[3];
+		SIMDInt laneEdges[3];
+		for (int e = 0; e < 3; e++)
+		{
+			int a = e;
+			int b = e == 2 ? 0 : e + 1;
+			int dx = triangle.x[b] - triangle.x[a];
+			int dy = triangle.y[b] - triangle.y[a];
+			bool topLeft = dy < 0 || (dy == 0 && dx > 0);
+
+			long long sampleX = (long long)startX * SOFTWARE_SUBPIXEL_SCALE + SOFTWARE_SUBPIXEL_SCALE / 2;
+			long long sampleY = (long long)startY * SOFTWARE_SUBPIXEL_SCALE + SOFTWARE_SUBPIXEL_SCALE / 2;
+			rowEdges[e] = (sampleY - triangle.y[a]) * dx - (sampleX - triangle.x[a]) * dy + (topLeft ? 0 : -1);
+			stepX[e] = -(long long)dy * SOFTWARE_SUBPIXEL_SCALE * 4;
+			stepY[e] = (long long)dx * SOFTWARE_SUBPIXEL_SCALE * 2;
+
+			int32_t offsets[SIMD_WIDTH];
+			for (int lane = 0; lane < SIMD_WIDTH; lane++)
+				offsets[lane] = (s_laneY[lane] * dx - s_laneX[lane] * dy) * SOFTWARE_SUBPIXEL_SCALE;
+			laneEdges[e] = SIMDInt::Load(offsets);
+		}
+
+		const SoftwareDrawState& draw = m_draws[triangle.draw];
+		const SoftwareShaderResources& resources = m_resources[triangle.draw];
+		SIMDInt minXMinusOne(minX - 1), maxXPlusOne(maxX + 1);
+		SIMDInt minYMinusOne(minY - 1), maxYPlusOne(maxY + 1);
+
+		for (int blockY = startY; blockY <= maxY; blockY += 2)
+		{
+			long long edges[3] = { rowEdges[0], rowEdges[1], rowEdges[2] };
+			SIMDInt pixelY = SIMDInt(blockY) + laneY;
+			SIMDInt rowMask = And(pixelY > minYMinusOne, maxYPlusOne > pixelY);
+
+			for (int blockX = startX; blockX <= maxX; blockX += 4)
+			{
+				SIMDInt pixelX = SIMDInt(blockX) + laneX;
+				SIMDInt inside = And(rowMask, And(pixelX > minXMinusOne, maxXPlusOne > pixelX));
+
+				for (int e = 0; e < 3; e++)
+				{
+					long long edge = edges[e] < -EDGE_CLAMP ? -EDGE_CLAMP : (edges[e] > EDGE_CLAMP ? EDGE_CLAMP : edges[e]);
+					SIMDInt laneEdge = SIMDInt((int32_t)edge) + laneEdges[e];
+					inside = And(inside, laneEdge > SIMDInt(-1));
+					edges[e] += stepX[e];
+				}
+
+				unsigned int mask = MoveMask(AsFloat(inside));
+				if (mask)
+					ShadeBlock(triangle, draw, resources, blockX, blockY, mask);
+			}
+
+			for (int e = 0; e < 3; e++)
+				rowEdges[e] += stepY[e];
+		}
+	}
+}
+
+void SoftwareRasterizer::ShadeBlock(const Triangle& triangle, const SoftwareDrawState& draw, const SoftwareShaderResources& resources, int blockX, int blockY, unsigned int mask)
+{
+	const Plane* planes = &m_planes[triangle.planes];
+
+	// Pixel centres relative to the planes' origin
+	SIMDFloat x = ToFloat(SIMDInt(blockX) + SIMDInt::Load(s_laneX)) + SIMDFloat(0.5f);
+	SIMDFloat y = ToFloat(SIMDInt(blockY) + SIMDInt::Load(s_laneY)) + SIMDFloat(0.5f);
+	SIMDFloat relativeX = x - SIMDFloat(triangle.originX);
+	SIMDFloat relativeY = y - SIMDFloat(triangle.originY);
+
+	// Depth gets clamped to the viewport's range, like D3D does after interpolating
+	SIMDFloat depth = SIMDFloat(planes[0].a) + SIMDFloat(planes[0].dx) * relativeX + SIMDFloat(planes[0].dy) * relativeY;
+	depth = Min(Max(depth, SIMDFloat(draw.viewport.minDepth)), SIMDFloat(draw.viewport.maxDepth));
+
+	// Early depth and stencil. Kernels can't discard or write depth, so doing these before shading changes nothing
+	// except how much gets shaded.
+	if (m_depthTarget)
+	{
+		const DepthStencilDesc& depthStencil = draw.depthStencil;
+		float storedDepth[SIMD_WIDTH] = {};
+		float newDepth[SIMD_WIDTH];
+		depth.Store(newDepth);
+
+		if (depthStencil.depthEnable)
+		{
+			LoadBlock(m_depthTarget->depth.data(), m_width, blockX, blockY, mask, storedDepth);
+			mask &= MoveMask(depth < SIMDFloat::Load(storedDepth));
+		}
+
+		if (depthStencil.stencilEnable && !m_depthTarget->stencil.empty() && mask)
+		{
+			unsigned char stored[SIMD_WIDTH] = {};
+			LoadBlock(m_depthTarget->stencil.data(), m_width, blockX, blockY, mask, stored);
+			for (int lane = 0; lane < SIMD_WIDTH; lane++)
+			{
+				if ((mask & (1 << lane)) && !StencilCompare(depthStencil.stencilFunc, draw.stencilRef, stored[lane]))
+					mask &= ~(1 << lane);
+			}
+
+			// Only pixels that passed both tests replace the stencil value, failing either one keeps it
+			if (depthStencil.stencilWriteEnable && mask)
+			{
+				unsigned char ref[SIMD_WIDTH];
+				memset(ref, draw.stencilRef, sizeof(ref));
+				StoreBlock(m_depthTarget->stencil.data(), m_width, blockX, blockY, mask, ref);
+			}
+		}
+
+		if (depthStencil.depthEnable && depthStencil.depthWriteEnable && mask)
+			StoreBlock(m_depthTarget->depth.data(), m_width, blockX, blockY, mask, newDepth);
+	}
+
+	if (!mask || !m_colorTarget || !draw.blend.colorWriteEnable)
+		return;
+
+	// Perspective correct varyings: interpolate v/w and 1/w, then divide
+	SoftwarePixelBatch batch;
+	SIMDFloat invW = SIMDFloat(planes[1].a) + SIMDFloat(planes[1].dx) * relativeX + SIMDFloat(planes[1].dy) * relativeY;
+	SIMDFloat w = SIMDFloat(1.0f) / invW;
+	x.Store(batch.position[0]);
+	y.Store(batch.position[1]);
+	depth.Store(batch.position[2]);
+	w.Store(batch.position[3]);
+
+	for (unsigned int v = 0; v < draw.varyingCount; v++)
+	{
+		const Plane& plane = planes[2 + v];
+		SIMDFloat value = SIMDFloat(plane.a) + SIMDFloat(plane.dx) * relativeX + SIMDFloat(plane.dy) * relativeY;
+		(value * w).Store(batch.varyings[v]);
+	}
+
+	batch.coverage = mask;
+	SIMDFloat color[4];
+	if (draw.pixelFunction)
+	{
+		draw.pixelFunction(resources, batch);
+		for (int c = 0; c < 4; c++)
+			color[c] = Saturate(SIMDFloat::Load(batch.color[c]));
+	}
+	else
+	{
+		// No kernel for this shader, so make it obvious
+		color[0] = SIMDFloat(1.0f);
+		color[1] = SIMDFloat(0.0f);
+		color[2] = SIMDFloat(1.0f);
+		color[3] = SIMDFloat(1.0f);
+	}
+
+	// Same switch D3D11RenderDevice uses to decide whether a blend state blends at all
+	const BlendDesc& blend = draw.blend;
+	if (blend.srcBlend != BLEND_FACTOR::ONE || blend.destBlend != BLEND_FACTOR::ZERO)
+	{
+		uint32_t stored[SIMD_WIDTH] = {};
+		LoadBlock(m_colorTarget->color.data(), m_width, blockX, blockY, mask, stored);
+		SIMDInt storedColor = SIMDInt::Load((const int32_t*)stored);
+
+		SIMDFloat srcFactor = BlendFactor(blend.srcBlend, color[3]);
+		SIMDFloat destFactor = BlendFactor(blend.destBlend, color[3]);
+		for (int c = 0; c < 4; c++)
+		{
+			SIMDFloat dest = ToFloat(And(storedColor >> (c * 8), SIMDInt(0xFF))) * SIMDFloat(1.0f / 255.0f);
+			color[c] = Saturate(color[c] * srcFactor + dest * destFactor);
+		}
+	}
+
+	SIMDInt packed(0);
+	for (int c = 0; c < 4; c++)
+		packed = Or(packed, ToIntTruncate(color[c] * SIMDFloat(255.0f) + SIMDFloat(0.5f)) << (c * 8));
+
+	uint32_t pixels[SIMD_WIDTH];
+	packed.Store((int32_t*)pixels);
+	StoreBlock(m_colorTarget->color.data(), m_width, blockX, blockY, mask, pixels);
+}
+
+void SoftwareRasterizer::RasterizeBinned()
+{
+	if (m_triangles.empty())
+		return;
+
+	// The constant buffer copies have stopped moving around now, so the kernels can have pointers to them
+	m_resources.resize(m_draws.size());
+	for (size_t i = 0; i < m_draws.size(); i++)
+	{
+		const SoftwareDrawState& draw = m_draws[i];
+		SoftwareShaderResources& resources = m_resources[i];
+		for (int slot = 0; slot < SOFTWARE_CONSTANT_BUFFER_SLOTS; slot++)
+		{
+			size_t offset = draw.constantBufferOffsets[slot];
+			resources.constantBuffers[slot] = offset == SOFTWARE_NO_CONSTANTS ? (const void*)g_SoftwareUnboundConstants : (const void*)&m_constants[offset];
+		}
+		memcpy(resources.textures, draw.textures, sizeof(resources.textures));
+		memcpy(resources.samplers, draw.samplers, sizeof(resources.samplers));
+	}
+
+	m_activeTiles.clear();
+	for (unsigned int tile = 0; tile < m_tilesX * m_tilesY; tile++)
+	{
+		if (!m_bins[tile].empty())
+			m_activeTiles.push_back(tile);
+	}
+
+	JobSystem* jobSystem = JobSystem::GetSingletonPtr();
+	if (jobSystem)
+	{
+		jobSystem->ParallelFor((unsigned int)m_activeTiles.size(), RasterizeTileJob, this);
+	}
+	else
+	{
+		for (unsigned int i = 0; i < m_activeTiles.size(); i++)
+			RasterizeTileJob(this, i);
+	}
+
+	for (unsigned int tile : m_activeTiles)
+		m_bins[tile].clear();
+
+	m_triangles.clear();
+	m_planes.clear();
+}
+
+void SoftwareRasterizer::Flush()
+{
+	RasterizeBinned();
+	m_draws.clear();
+	m_constants.clear();
+}
+
+bool SoftwareRasterizer::HasPendingWork() const
+{
+	return !m_triangles.empty();
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "SoftwareShader.h"
+
+// Triangles are binned into square tiles of this many pixels, and each tile is rasterized by one job
+#define SOFTWARE_TILE_SIZE 64
+
+// Vertices are snapped to 1/16th of a pixel, like D3D11 does
+#define SOFTWARE_SUBPIXEL_BITS 4
+#define SOFTWARE_SUBPIXEL_SCALE (1 << SOFTWARE_SUBPIXEL_BITS)
+
+// How far past the viewport a triangle can reach before it gets clipped in x and y. Triangles that poke out a bit are
+// just rasterized, which is both quicker and keeps the fixed point coordinates small enough for 32 bit edge steps.
+#define SOFTWARE_GUARD_BAND 2048.0f
+
+// Binned triangles are flushed at this many even if nothing else asked for it, so a huge frame can't run away with memory
+#define SOFTWARE_MAX_BINNED_TRIANGLES (64 * 1024)
+
+// Everything the pixel stage needs to know about the draw a triangle came from, captured when the draw was issued
+struct SoftwareDrawState
+{
+	SoftwarePixelFunction pixelFunction;	// Null draws magenta
+	unsigned int varyingCount;
+
+	// Constant buffers are copied at draw time. These are offsets of the copies, or SOFTWARE_NO_CONSTANTS.
+	size_t constantBufferOffsets[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	const SoftwareTexture* textures[SOFTWARE_TEXTURE_SLOTS];
+	SamplerDesc samplers[SOFTWARE_SAMPLER_SLOTS];
+
+	DepthStencilDesc depthStencil;
+	unsigned char stencilRef;
+	BlendDesc blend;
+	CULL_MODE cullMode;
+	Viewport viewport;
+};
+
+#define SOFTWARE_NO_CONSTANTS ((size_t)-1)
+
+// Turns clip space triangles into pixels in a color and/or depth target.
+//
+// Nothing is drawn straight away. DrawTriangle clips the triangle, sets it up and drops it into the bin of every tile
+// it touches, and Flush then rasterizes all the tiles in parallel on the JobSystem. Each tile goes through its triangles
+// in the order they were drawn, so the results are the same as drawing them one by one, whatever the thread count.
+//
+// Within a tile, triangles are walked a 4x2 block of pixels at a time, which is one SIMD_WIDTH batch. Edge functions
+// are integer (so there are no cracks or double hits between triangles, with D3D's top-left rule for shared edges),
+// the depth and stencil tests are done before shading, and the pixel kernel only runs for blocks where something passed.
+//
+// Anything that changes what a tile would see (new targets, clears, resizing) has to Flush first.
+class SoftwareRasterizer
+{
+private:
+	struct Triangle
+	{
+		int x[3], y[3];						// Subpixel positions
+		int minX, minY, maxX, maxY;			// Pixels that can be touched, inclusive, already clipped to the viewport
+		float originX, originY;				// Where the planes are relative to (the first vertex)
+		unsigned int draw;
+		unsigned int planes;				// Index of the first plane in m_planes
+	};
+
+	// value = a + dx * (x - originX) + dy * (y - originY), at pixel centres. Every triangle has one for depth, one for 1/w
+	// and one per varying (premultiplied by 1/w, for perspective correct interpolation).
+	struct Plane
+	{
+		float a, dx, dy;
+	};
+
+	SoftwareTexture* m_colorTarget;
+	SoftwareTexture* m_depthTarget;
+	unsigned int m_width;
+	unsigned int m_height;
+	unsigned int m_tilesX;
+	unsigned int m_tilesY;
+
+	std::vector<SoftwareDrawState> m_draws;
+	std::vector<char> m_constants;
+	std::vector<Triangle> m_triangles;
+	std::vector<Plane> m_planes;
+	std::vector<std::vector<unsigned int>> m_bins;
+	std::vector<unsigned int> m_activeTiles;
+
+	// Per draw kernel resources with the constant buffer offsets turned into pointers, filled in by Flush
+	std::vector<SoftwareShaderResources> m_resources;
+
+	void SetupTriangle(const float* v0, const float* v1, const float* v2);
+	void RasterizeBinned();
+	void RasterizeTile(unsigned int tile);
+	void ShadeBlock(const Triangle& triangle, const SoftwareDrawState& draw, const SoftwareShaderResources& resources, int blockX, int blockY, unsigned int mask);
+
+	static void RasterizeTileJob(void* data, unsigned int index);
+
+public:
+	SoftwareRasterizer();
+
+	// Flushes, then draws into these from now on. Either can be null, but if both are set they have to be the same size.
+	void SetTargets(SoftwareTexture* colorTarget, SoftwareTexture* depthTarget);
+
+	// Copies a constant buffer for the draws about to be added, and returns where to for SoftwareDrawState
+	size_t StoreConstants(const void* data, size_t size);
+
+	// Every triangle from here on belongs to this draw, until the next BeginDraw
+	void BeginDraw(const SoftwareDrawState& draw);
+
+	// Each vertex is a clip space position followed by (at least) the draw's varyings
+	void DrawTriangle(const float* v0, const float* v1, const float* v2);
+
+	void Flush();
+	bool HasPendingWork() const;
+};
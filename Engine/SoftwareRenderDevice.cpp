@@ -0,0 +1,1058 @@
+#include "SoftwareRenderDevice.h"
+#include <algorithm>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+// Stop printing errors after this many. They're still counted.
+#define SOFTWARE_DEVICE_MAX_REPORTS 64
+
+// ----------------------------------------------------------------------------------
+// Helper Functions
+// ----------------------------------------------------------------------------------
+
+// The D3D11 defaults, for when no state object is bound
+static RasterizerDesc DefaultRasterizerDesc()
+{
+	RasterizerDesc desc = { CULL_MODE::BACK, FILL_MODE::SOLID };
+	return desc;
+}
+
+static DepthStencilDesc DefaultDepthStencilDesc()
+{
+	DepthStencilDesc desc = { true, true, false, false, COMPARISON_FUNC::ALWAYS };
+	return desc;
+}
+
+static BlendDesc DefaultBlendDesc()
+{
+	BlendDesc desc = { BLEND_FACTOR::ONE, BLEND_FACTOR::ZERO, true };
+	return desc;
+}
+
+static SamplerDesc DefaultSamplerDesc()
+{
+	SamplerDesc desc = { TEXTURE_FILTER::LINEAR, TEXTURE_ADDRESS::CLAMP };
+	return desc;
+}
+
+static bool IsVertexFormat(GPU_FORMAT format)
+{
+	return format == GPU_FORMAT::R32_FLOAT || format == GPU_FORMAT::R32G32_FLOAT || format == GPU_FORMAT::R32G32B32_FLOAT ||
+		format == GPU_FORMAT::R32G32B32A32_FLOAT || format == GPU_FORMAT::R8G8B8A8_UNORM;
+}
+
+// One attribute, with whatever components the format doesn't have filled in from (0, 0, 0, 1)
+static void FetchAttribute(const char* data, GPU_FORMAT format, float out[4])
+{
+	out[0] = 0.0f;
+	out[1] = 0.0f;
+	out[2] = 0.0f;
+	out[3] = 1.0f;
+
+	if (format == GPU_FORMAT::R8G8B8A8_UNORM)
+	{
+		for (int c = 0; c < 4; c++)
+			out[c] = (float)(unsigned char)data[c] * (1.0f / 255.0f);
+		return;
+	}
+
+	memcpy(out, data, GetFormatSize(format));
+}
+
+static uint32_t PackColor(const float color[4])
+{
+	uint32_t packed = 0;
+	for (int c = 0; c < 4; c++)
+	{
+		float value = color[c] < 0.0f ? 0.0f : (color[c] > 1.0f ? 1.0f : color[c]);
+		packed |= (uint32_t)(value * 255.0f + 0.5f) << (c * 8);
+	}
+
+	return packed;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+
+SoftwareRenderDevice::SoftwareRenderDevice(unsigned int width, unsigned int height)
+	: m_vertexShader(0)
+	, m_pixelShader(0)
+	, m_indexBuffer(0)
+	, m_indexFormat(GPU_FORMAT::UNKNOWN)
+	, m_rasterizerState(DefaultRasterizerDesc())
+	, m_depthStencilState(DefaultDepthStencilDesc())
+	, m_stencilRef(0)
+	, m_blendState(DefaultBlendDesc())
+	, m_colorTarget(0)
+	, m_depthTarget(0)
+	, m_presentCount(0)
+	, m_reportedErrors(0)
+{
+	ClearState();
+
+	RegisterEngineSoftwareShaders();
+
+	// Same formats as the D3D11 swap chain
+	TextureDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.format = GPU_FORMAT::R8G8B8A8_UNORM;
+	desc.bindFlags = BIND_RENDER_TARGET;
+	m_backBuffer = CreateTexture(desc);
+
+	desc.format = GPU_FORMAT::D24_UNORM_S8_UINT;
+	desc.bindFlags = BIND_DEPTH_STENCIL;
+	m_backBufferDepth = CreateTexture(desc);
+}
+
+SoftwareRenderDevice::~SoftwareRenderDevice()
+{
+	// Nothing binned can outlive the textures it draws into
+	m_rasterizer.SetTargets(nullptr, nullptr);
+}
+
+const char* SoftwareRenderDevice::GetName() const
+{
+	return "Software";
+}
+
+void SoftwareRenderDevice::ReportError(const char* format, ...)
+{
+	m_frameStats.validationErrors++;
+
+	if (m_reportedErrors++ >= SOFTWARE_DEVICE_MAX_REPORTS)
+		return;
+
+	printf("SoftwareRenderDevice: ");
+	va_list args;
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf(" \n");
+
+	if (m_reportedErrors == SOFTWARE_DEVICE_MAX_REPORTS)
+		printf("SoftwareRenderDevice: That's %u errors, the rest won't be printed \n", SOFTWARE_DEVICE_MAX_REPORTS);
+}
+
+SoftwareTexture* SoftwareRenderDevice::GetTexture(GPUHANDLE handle)
+{
+	std::unique_ptr<SoftwareTexture>* texture = m_textures.Get(handle);
+	return texture ? texture->get() : nullptr;
+}
+
+bool SoftwareRenderDevice::AllocateTexture(SoftwareTexture& texture)
+{
+	size_t texels = (size_t)texture.desc.width * texture.desc.height;
+	texture.color.clear();
+	texture.depth.clear();
+	texture.stencil.clear();
+
+	if (IsDepthFormat(texture.desc.format))
+	{
+		texture.depth.resize(texels, 0.0f);
+		if (HasStencil(texture.desc.format))
+			texture.stencil.resize(texels, 0);
+		return true;
+	}
+
+	if (texture.desc.format != GPU_FORMAT::R8G8B8A8_UNORM)
+	{
+		ReportError("CreateTexture: color textures have to be R8G8B8A8_UNORM here");
+		return false;
+	}
+
+	texture.color.resize(texels, 0);
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Resource Creation
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE SoftwareRenderDevice::CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool)
+{
+	if (byteWidth == 0)
+	{
+		ReportError("CreateBuffer was asked for an empty buffer");
+		return 0;
+	}
+
+	Buffer buffer;
+	buffer.type = type;
+	buffer.data.resize(byteWidth, 0);
+	if (initialData)
+	{
+		memcpy(buffer.data.data(), initialData, byteWidth);
+		m_frameStats.bytesUploaded += byteWidth;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_buffers.Add(std::move(buffer));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount)
+{
+	const SoftwareVertexShader* kernel = FindSoftwareVertexShader(bytecode, bytecodeSize);
+	if (!kernel)
+	{
+		ReportError("CreateVertexShader: no software kernel has been registered for this shader");
+		return 0;
+	}
+
+	// Find each of the kernel's inputs in the layout, the way CreateInputLayout matches it against the shader signature
+	VertexShader shader;
+	shader.kernel = kernel;
+	for (unsigned int i = 0; i < kernel->inputCount; i++)
+	{
+		const SoftwareVertexInput& input = kernel->inputs[i];
+		const VertexElement* element = nullptr;
+		for (unsigned int j = 0; j < elementCount && !element; j++)
+		{
+			if (strcmp(elements[j].semantic, input.semantic) == 0 && elements[j].semanticIndex == input.semanticIndex)
+				element = &elements[j];
+		}
+
+		if (!element)
+		{
+			ReportError("CreateVertexShader: the shader reads %s%u, which isn't in the vertex layout", input.semantic, input.semanticIndex);
+			return 0;
+		}
+
+		if (!IsVertexFormat(element->format))
+		{
+			ReportError("CreateVertexShader: %s%u has a format vertices can't be read in here", input.semantic, input.semanticIndex);
+			return 0;
+		}
+
+		if (element->inputSlot >= SOFTWARE_VERTEX_BUFFER_SLOTS)
+		{
+			ReportError("CreateVertexShader: %s%u is in slot %u, there are only %u", input.semantic, input.semanticIndex,
+				element->inputSlot, SOFTWARE_VERTEX_BUFFER_SLOTS);
+			return 0;
+		}
+
+		shader.inputs[i].slot = element->inputSlot;
+		shader.inputs[i].offset = element->offset;
+		shader.inputs[i].format = element->format;
+		shader.inputs[i].perInstance = element->perInstance;
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_vertexShaders.Add(std::move(shader));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreatePixelShader(const void* bytecode, size_t bytecodeSize)
+{
+	if (!bytecode || bytecodeSize < 4 || memcmp(bytecode, "DXBC", 4) != 0)
+	{
+		ReportError("CreatePixelShader was given something that isn't compiled shader bytecode");
+		return 0;
+	}
+
+	PixelShader shader;
+	shader.kernel = FindSoftwarePixelShader(bytecode, bytecodeSize);
+	if (!shader.kernel)
+	{
+		// Not an error, the game still runs. It just can't be drawn properly.
+		printf("SoftwareRenderDevice: no software kernel has been registered for a pixel shader, it will draw magenta \n");
+	}
+
+	m_frameStats.resourcesCreated++;
+	return m_pixelShaders.Add(std::move(shader));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateTexture(const TextureDesc& desc)
+{
+	if (desc.width == 0 || desc.height == 0 || desc.format == GPU_FORMAT::UNKNOWN)
+	{
+		ReportError("CreateTexture was asked for a %ux%u texture with no format", desc.width, desc.height);
+		return 0;
+	}
+
+	std::unique_ptr<SoftwareTexture> texture(new SoftwareTexture());
+	texture->desc = desc;
+	if (!AllocateTexture(*texture))
+		return 0;
+
+	m_frameStats.resourcesCreated++;
+	return m_textures.Add(std::move(texture));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateRasterizerState(const RasterizerDesc& desc)
+{
+	m_frameStats.resourcesCreated++;
+	return m_rasterizerStates.Add(RasterizerDesc(desc));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateDepthStencilState(const DepthStencilDesc& desc)
+{
+	m_frameStats.resourcesCreated++;
+	return m_depthStencilStates.Add(DepthStencilDesc(desc));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateBlendState(const BlendDesc& desc)
+{
+	m_frameStats.resourcesCreated++;
+	return m_blendStates.Add(BlendDesc(desc));
+}
+
+GPUHANDLE SoftwareRenderDevice::CreateSamplerState(const SamplerDesc& desc)
+{
+	m_frameStats.resourcesCreated++;
+	return m_samplerStates.Add(SamplerDesc(desc));
+}
+
+void SoftwareRenderDevice::Release(GPUHANDLE handle)
+{
+	if (handle == m_backBuffer || handle == m_backBufferDepth)
+	{
+		ReportError("Release: the back buffers belong to the device");
+		return;
+	}
+
+	bool released;
+	switch (GetGPUHandleKind(handle))
+	{
+	case GPU_RESOURCE::BUFFER:				released = m_buffers.Remove(handle); break;
+	case GPU_RESOURCE::VERTEX_SHADER:		released = m_vertexShaders.Remove(handle); break;
+	case GPU_RESOURCE::PIXEL_SHADER:		released = m_pixelShaders.Remove(handle); break;
+	case GPU_RESOURCE::RASTERIZER_STATE:	released = m_rasterizerStates.Remove(handle); break;
+	case GPU_RESOURCE::DEPTH_STENCIL_STATE:	released = m_depthStencilStates.Remove(handle); break;
+	case GPU_RESOURCE::BLEND_STATE:			released = m_blendStates.Remove(handle); break;
+	case GPU_RESOURCE::SAMPLER_STATE:		released = m_samplerStates.Remove(handle); break;
+	case GPU_RESOURCE::TEXTURE:
+		// Binned draws could still be reading it or drawing into it
+		m_rasterizer.Flush();
+		if (handle == m_colorTarget || handle == m_depthTarget)
+			SetRenderTarget(handle == m_colorTarget ? 0 : m_colorTarget, handle == m_depthTarget ? 0 : m_depthTarget);
+		for (GPUHANDLE& texture : m_psTextures)
+		{
+			if (texture == handle)
+				texture = 0;
+		}
+		released = m_textures.Remove(handle);
+		break;
+	default:
+		released = false;
+		break;
+	}
+
+	if (!released)
+	{
+		ReportError("Release was given 0x%08X, which isn't a live resource", handle);
+		return;
+	}
+
+	// Buffers and shaders are only looked at while a draw is being issued, so forgetting them is enough
+	GPUHANDLE* bindings[] = { &m_vertexShader, &m_pixelShader, &m_indexBuffer };
+	for (GPUHANDLE* binding : bindings)
+	{
+		if (*binding == handle)
+			*binding = 0;
+	}
+
+	for (int i = 0; i < SOFTWARE_VERTEX_BUFFER_SLOTS; i++)
+	{
+		if (m_vertexBuffers[i] == handle) m_vertexBuffers[i] = 0;
+	}
+
+	for (int i = 0; i < SOFTWARE_CONSTANT_BUFFER_SLOTS; i++)
+	{
+		if (m_vsConstantBuffers[i] == handle) m_vsConstantBuffers[i] = 0;
+		if (m_psConstantBuffers[i] == handle) m_psConstantBuffers[i] = 0;
+	}
+}
+
+unsigned int SoftwareRenderDevice::GetBufferSize(GPUHANDLE buffer) const
+{
+	const Buffer* item = m_buffers.Get(buffer);
+	return item ? (unsigned int)item->data.size() : 0;
+}
+
+void SoftwareRenderDevice::UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount)
+{
+	Buffer* target = m_buffers.Get(buffer);
+	if (!target || !data || byteCount > target->data.size())
+	{
+		ReportError("UpdateBuffer needs a live buffer and some data that fits in it");
+		return;
+	}
+
+	if (byteCount != 0 && byteCount != target->data.size() && target->type == BUFFER_TYPE::CONSTANT)
+	{
+		ReportError("UpdateBuffer: constant buffers have to be updated whole");
+		return;
+	}
+
+	// Draws already binned took a copy of any constants they use and shaded their vertices, so this can't change them
+	size_t size = byteCount != 0 ? byteCount : target->data.size();
+	memcpy(target->data.data(), data, size);
+	m_frameStats.bytesUploaded += size;
+}
+
+void SoftwareRenderDevice::UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount)
+{
+	Buffer* target = m_buffers.Get(buffer);
+	if (!target || !data || offset > target->data.size() || byteCount > target->data.size() - offset)
+	{
+		ReportError("UpdateBufferRange needs a live buffer and some data that fits in it");
+		return;
+	}
+
+	// Same as UpdateBuffer, nothing the draws so far read can change. There's never a GPU to wait for.
+	memcpy(target->data.data() + offset, data, byteCount);
+	m_frameStats.bytesUploaded += byteCount;
+}
+
+bool SoftwareRenderDevice::SupportsConstantBufferOffsets() const
+{
+	return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Pipeline State
+// ---------------------------------------------------------------------------------------------------------------
+
+void SoftwareRenderDevice::SetVertexShader(GPUHANDLE shader)
+{
+	m_frameStats.stateChanges++;
+	m_vertexShader = shader;
+}
+
+void SoftwareRenderDevice::SetPixelShader(GPUHANDLE shader)
+{
+	m_frameStats.stateChanges++;
+	m_pixelShader = shader;
+}
+
+void SoftwareRenderDevice::SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset)
+{
+	if (slot >= SOFTWARE_VERTEX_BUFFER_SLOTS)
+	{
+		ReportError("SetVertexBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	m_frameStats.stateChanges++;
+	m_vertexBuffers[slot] = buffer;
+	m_vertexStrides[slot] = stride;
+	m_vertexOffsets[slot] = offset;
+}
+
+void SoftwareRenderDevice::SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format)
+{
+	if (buffer != 0 && format != GPU_FORMAT::R16_UINT && format != GPU_FORMAT::R32_UINT)
+		ReportError("SetIndexBuffer: indices have to be R16_UINT or R32_UINT");
+
+	m_frameStats.stateChanges++;
+	m_indexBuffer = buffer;
+	m_indexFormat = format;
+}
+
+void SoftwareRenderDevice::SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	if (slot >= SOFTWARE_CONSTANT_BUFFER_SLOTS)
+	{
+		ReportError("SetVSConstantBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	if (!CheckConstantRange(buffer, offset, byteCount, "SetVSConstantBuffer"))
+		buffer = 0;
+
+	m_frameStats.stateChanges++;
+	m_vsConstantBuffers[slot] = buffer;
+	m_vsConstantOffsets[slot] = offset;
+	m_vsConstantSizes[slot] = byteCount;
+}
+
+void SoftwareRenderDevice::SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset, unsigned int byteCount)
+{
+	if (slot >= SOFTWARE_CONSTANT_BUFFER_SLOTS)
+	{
+		ReportError("SetPSConstantBuffer: there's no slot %u", slot);
+		return;
+	}
+
+	if (!CheckConstantRange(buffer, offset, byteCount, "SetPSConstantBuffer"))
+		buffer = 0;
+
+	m_frameStats.stateChanges++;
+	m_psConstantBuffers[slot] = buffer;
+	m_psConstantOffsets[slot] = offset;
+	m_psConstantSizes[slot] = byteCount;
+}
+
+void SoftwareRenderDevice::SetPSTexture(unsigned int slot, GPUHANDLE texture)
+{
+	if (slot >= SOFTWARE_TEXTURE_SLOTS)
+	{
+		ReportError("SetPSTexture: there's no slot %u", slot);
+		return;
+	}
+
+	// Like D3D11, something can't be read from while it's being drawn to
+	if (texture != 0 && (texture == m_colorTarget || texture == m_depthTarget))
+		texture = 0;
+
+	m_frameStats.stateChanges++;
+	m_psTextures[slot] = texture;
+}
+
+void SoftwareRenderDevice::SetPSSampler(unsigned int slot, GPUHANDLE sampler)
+{
+	if (slot >= SOFTWARE_SAMPLER_SLOTS)
+	{
+		ReportError("SetPSSampler: there's no slot %u", slot);
+		return;
+	}
+
+	const SamplerDesc* desc = m_samplerStates.Get(sampler);
+	m_frameStats.stateChanges++;
+	m_psSamplers[slot] = desc ? *desc : DefaultSamplerDesc();
+}
+
+void SoftwareRenderDevice::SetRasterizerState(GPUHANDLE state)
+{
+	const RasterizerDesc* desc = m_rasterizerStates.Get(state);
+	m_frameStats.stateChanges++;
+	m_rasterizerState = desc ? *desc : DefaultRasterizerDesc();
+}
+
+void SoftwareRenderDevice::SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef)
+{
+	const DepthStencilDesc* desc = m_depthStencilStates.Get(state);
+	m_frameStats.stateChanges++;
+	m_depthStencilState = desc ? *desc : DefaultDepthStencilDesc();
+	m_stencilRef = (unsigned char)stencilRef;
+}
+
+void SoftwareRenderDevice::SetBlendState(GPUHANDLE state)
+{
+	const BlendDesc* desc = m_blendStates.Get(state);
+	m_frameStats.stateChanges++;
+	m_blendState = desc ? *desc : DefaultBlendDesc();
+}
+
+void SoftwareRenderDevice::SetViewport(const Viewport& viewport)
+{
+	m_frameStats.stateChanges++;
+	m_viewport = viewport;
+}
+
+void SoftwareRenderDevice::SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil)
+{
+	SoftwareTexture* color = GetTexture(colorTarget);
+	SoftwareTexture* depth = GetTexture(depthStencil);
+
+	if ((colorTarget != 0 && (!color || color->color.empty())) || (depthStencil != 0 && (!depth || depth->depth.empty())))
+	{
+		ReportError("SetRenderTarget needs a live color texture and a live depth texture (or 0 for either)");
+		color = nullptr;
+		depth = nullptr;
+		colorTarget = 0;
+		depthStencil = 0;
+	}
+
+	if (color && depth && (color->desc.width != depth->desc.width || color->desc.height != depth->desc.height))
+	{
+		ReportError("SetRenderTarget: the %ux%u render target and %ux%u depth buffer aren't the same size",
+			color->desc.width, color->desc.height, depth->desc.width, depth->desc.height);
+		depth = nullptr;
+		depthStencil = 0;
+	}
+
+	// Whatever's about to be drawn to stops being readable, as on D3D11
+	for (GPUHANDLE& texture : m_psTextures)
+	{
+		if (texture != 0 && (texture == colorTarget || texture == depthStencil))
+			texture = 0;
+	}
+
+	m_frameStats.stateChanges++;
+	if (colorTarget != m_colorTarget || depthStencil != m_depthTarget)
+		m_rasterizer.SetTargets(color, depth);
+
+	m_colorTarget = colorTarget;
+	m_depthTarget = depthStencil;
+}
+
+void SoftwareRenderDevice::ClearState()
+{
+	// Draws already binned keep the state they were drawn with, so only the targets need telling
+	if (m_colorTarget != 0 || m_depthTarget != 0)
+		m_rasterizer.SetTargets(nullptr, nullptr);
+
+	m_vertexShader = 0;
+	m_pixelShader = 0;
+	m_indexBuffer = 0;
+	m_indexFormat = GPU_FORMAT::UNKNOWN;
+	m_rasterizerState = DefaultRasterizerDesc();
+	m_depthStencilState = DefaultDepthStencilDesc();
+	m_stencilRef = 0;
+	m_blendState = DefaultBlendDesc();
+	m_colorTarget = 0;
+	m_depthTarget = 0;
+
+	memset(m_vertexBuffers, 0, sizeof(m_vertexBuffers));
+	memset(m_vertexStrides, 0, sizeof(m_vertexStrides));
+	memset(m_vertexOffsets, 0, sizeof(m_vertexOffsets));
+	memset(m_vsConstantBuffers, 0, sizeof(m_vsConstantBuffers));
+	memset(m_psConstantBuffers, 0, sizeof(m_psConstantBuffers));
+	memset(m_vsConstantOffsets, 0, sizeof(m_vsConstantOffsets));
+	memset(m_psConstantOffsets, 0, sizeof(m_psConstantOffsets));
+	memset(m_vsConstantSizes, 0, sizeof(m_vsConstantSizes));
+	memset(m_psConstantSizes, 0, sizeof(m_psConstantSizes));
+	memset(m_psTextures, 0, sizeof(m_psTextures));
+	memset(&m_viewport, 0, sizeof(m_viewport));
+	for (SamplerDesc& sampler : m_psSamplers)
+		sampler = DefaultSamplerDesc();
+}
+
+void SoftwareRenderDevice::ClearRenderTarget(GPUHANDLE target, const float color[4])
+{
+	SoftwareTexture* texture = GetTexture(target);
+	if (!texture || texture->color.empty())
+	{
+		ReportError("ClearRenderTarget needs a live color texture");
+		return;
+	}
+
+	// Anything binned for it (or reading it) has to land before the clear does
+	m_rasterizer.Flush();
+	std::fill(texture->color.begin(), texture->color.end(), PackColor(color));
+}
+
+void SoftwareRenderDevice::ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil)
+{
+	SoftwareTexture* texture = GetTexture(target);
+	if (!texture || texture->depth.empty())
+	{
+		ReportError("ClearDepthStencil needs a live depth texture");
+		return;
+	}
+
+	m_rasterizer.Flush();
+	if (clearFlags & CLEAR_DEPTH)
+		std::fill(texture->depth.begin(), texture->depth.end(), depth);
+	if (clearFlags & CLEAR_STENCIL)
+		std::fill(texture->stencil.begin(), texture->stencil.end(), stencil);
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Drawing
+// ---------------------------------------------------------------------------------------------------------------
+
+bool SoftwareRenderDevice::CheckConstantRange(GPUHANDLE buffer, unsigned int offset, unsigned int byteCount, const char* call)
+{
+	const Buffer* constants = m_buffers.Get(buffer);
+	if (!constants)
+		return true;
+
+	size_t size = byteCount != 0 ? byteCount : constants->data.size() - offset;
+	if (constants->type != BUFFER_TYPE::CONSTANT || offset % CONSTANT_BUFFER_OFFSET_ALIGNMENT != 0 || byteCount % CONSTANT_BUFFER_OFFSET_ALIGNMENT != 0 ||
+		offset >= constants->data.size() || size > constants->data.size() - offset || size > SOFTWARE_CONSTANT_BUFFER_MAX_SIZE)
+	{
+		ReportError("%s: %u bytes at %u of that buffer can't be bound as constants", call, byteCount, offset);
+		return false;
+	}
+
+	return true;
+}
+
+bool SoftwareRenderDevice::CheckVertexBuffers(const VertexShader& shader, unsigned int first, unsigned int count, unsigned int firstInstance, unsigned int instanceCount, const char* call)
+{
+	const SoftwareVertexShader* kernel = shader.kernel;
+	for (unsigned int i = 0; i < kernel->inputCount; i++)
+	{
+		const VertexInput& input = shader.inputs[i];
+		const Buffer* buffer = m_buffers.Get(m_vertexBuffers[input.slot]);
+		if (!buffer)
+		{
+			ReportError("%s: nothing bound to vertex buffer slot %u", call, input.slot);
+			return false;
+		}
+
+		unsigned int stride = m_vertexStrides[input.slot];
+		if (input.offset + GetFormatSize(input.format) > stride)
+		{
+			ReportError("%s: the stride of %u in slot %u is too small for the vertex layout", call, stride, input.slot);
+			return false;
+		}
+
+		// An empty range doesn't read anything, so it's never out of bounds
+		unsigned int start = input.perInstance ? firstInstance : first;
+		unsigned int end = start + (input.perInstance ? instanceCount : count);
+		if (end > start && m_vertexOffsets[input.slot] + (unsigned long long)end * stride > buffer->data.size())
+		{
+			ReportError("%s: %s %u to %u run past the end of the buffer in slot %u", call,
+				input.perInstance ? "instances" : "vertices", start, end, input.slot);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SoftwareRenderDevice::ShadeVertices(const VertexShader& shader, unsigned int first, unsigned int count, unsigned int instance)
+{
+	const SoftwareVertexShader* kernel = shader.kernel;
+
+	SoftwareShaderResources resources;
+	memset(&resources, 0, sizeof(resources));
+	for (int slot = 0; slot < SOFTWARE_CONSTANT_BUFFER_SLOTS; slot++)
+	{
+		const Buffer* buffer = m_buffers.Get(m_vsConstantBuffers[slot]);
+		resources.constantBuffers[slot] = buffer ? (const void*)(buffer->data.data() + m_vsConstantOffsets[slot]) : (const void*)g_SoftwareUnboundConstants;
+	}
+
+	const char* streams[SOFTWARE_VERTEX_BUFFER_SLOTS];
+	for (int slot = 0; slot < SOFTWARE_VERTEX_BUFFER_SLOTS; slot++)
+	{
+		const Buffer* buffer = m_buffers.Get(m_vertexBuffers[slot]);
+		streams[slot] = buffer ? buffer->data.data() + m_vertexOffsets[slot] : nullptr;
+	}
+
+	unsigned int floatsPerVertex = 4 + kernel->varyingCount;
+	m_shadedVertices.resize((size_t)count * floatsPerVertex);
+
+	SoftwareVertexBatch batch;
+
+	// Per instance inputs don't change from batch to batch, so they're filled in once
+	for (unsigned int i = 0; i < kernel->inputCount; i++)
+	{
+		const VertexInput& input = shader.inputs[i];
+		if (!input.perInstance)
+			continue;
+
+		float attribute[4];
+		FetchAttribute(streams[input.slot] + (size_t)instance * m_vertexStrides[input.slot] + input.offset, input.format, attribute);
+		for (int c = 0; c < 4; c++)
+		{
+			for (int lane = 0; lane < SIMD_WIDTH; lane++)
+				batch.inputs[i][c][lane] = attribute[c];
+		}
+	}
+
+	for (unsigned int base = 0; base < count; base += SIMD_WIDTH)
+	{
+		unsigned int batchCount = count - base < SIMD_WIDTH ? count - base : SIMD_WIDTH;
+
+		// A short last batch just repeats its last vertex in the spare lanes
+		for (unsigned int lane = 0; lane < SIMD_WIDTH; lane++)
+		{
+			unsigned int vertex = first + base + (lane < batchCount ? lane : batchCount - 1);
+			for (unsigned int i = 0; i < kernel->inputCount; i++)
+			{
+				const VertexInput& input = shader.inputs[i];
+				if (input.perInstance)
+					continue;
+
+				float attribute[4];
+				FetchAttribute(streams[input.slot] + (size_t)vertex * m_vertexStrides[input.slot] + input.offset, input.format, attribute);
+				for (int c = 0; c < 4; c++)
+					batch.inputs[i][c][lane] = attribute[c];
+			}
+		}
+
+		kernel->function(resources, batch);
+
+		for (unsigned int lane = 0; lane < batchCount; lane++)
+		{
+			float* out = &m_shadedVertices[(size_t)(base + lane) * floatsPerVertex];
+			for (int c = 0; c < 4; c++)
+				out[c] = batch.position[c][lane];
+			for (unsigned int v = 0; v < kernel->varyingCount; v++)
+				out[4 + v] = batch.varyings[v][lane];
+		}
+	}
+}
+
+bool SoftwareRenderDevice::ReadIndices(unsigned int indexCount, unsigned int startIndex, int baseVertex, const char* call)
+{
+	const Buffer* indexBuffer = m_buffers.Get(m_indexBuffer);
+	unsigned int indexSize = GetFormatSize(m_indexFormat);
+	if (!indexBuffer || indexSize == 0)
+	{
+		ReportError("%s with no index buffer bound", call);
+		return false;
+	}
+
+	if (((unsigned long long)startIndex + indexCount) * indexSize > indexBuffer->data.size())
+	{
+		ReportError("%s: indices %u to %u run past the end of the index buffer", call, startIndex, startIndex + indexCount);
+		return false;
+	}
+
+	m_indices.resize(indexCount);
+	const char* indices = indexBuffer->data.data() + (size_t)startIndex * indexSize;
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		unsigned int index;
+		if (indexSize == 2)
+		{
+			unsigned short shortIndex;
+			memcpy(&shortIndex, indices + i * 2, 2);
+			index = shortIndex;
+		}
+		else
+		{
+			memcpy(&index, indices + i * 4, 4);
+		}
+
+		long long vertex = (long long)index + baseVertex;
+		if (vertex < 0)
+		{
+			ReportError("%s: index %u with base vertex %d is before the start of the vertex buffer", call, index, baseVertex);
+			return false;
+		}
+
+		m_indices[i] = (unsigned int)vertex;
+	}
+
+	return true;
+}
+
+void SoftwareRenderDevice::DrawIndices(unsigned int firstInstance, unsigned int instanceCount, const char* call)
+{
+	const VertexShader* vertexShader = m_vertexShaders.Get(m_vertexShader);
+	if (!vertexShader)
+	{
+		ReportError("%s needs a live vertex shader bound", call);
+		return;
+	}
+
+	if (m_colorTarget == 0 && m_depthTarget == 0)
+	{
+		ReportError("%s with no render target or depth/stencil buffer bound", call);
+		return;
+	}
+
+	if (m_viewport.width <= 0.0f || m_viewport.height <= 0.0f)
+	{
+		ReportError("%s with no viewport set", call);
+		return;
+	}
+
+	// No pixel shader at all just draws depth and stencil. One without a kernel draws magenta.
+	const PixelShader* pixelShader = m_pixelShaders.Get(m_pixelShader);
+	const SoftwarePixelShader* pixelKernel = pixelShader ? pixelShader->kernel : nullptr;
+	if (pixelKernel && pixelKernel->varyingCount > vertexShader->kernel->varyingCount)
+	{
+		ReportError("%s: the pixel shader reads %u varyings but the vertex shader only writes %u", call,
+			pixelKernel->varyingCount, vertexShader->kernel->varyingCount);
+		return;
+	}
+
+	if (m_indices.empty() || instanceCount == 0)
+		return;
+
+	// Shade every vertex in the range the indices cover, once per instance
+	unsigned int first = m_indices[0];
+	unsigned int last = m_indices[0];
+	for (unsigned int index : m_indices)
+	{
+		first = index < first ? index : first;
+		last = index > last ? index : last;
+	}
+
+	if (!CheckVertexBuffers(*vertexShader, first, last - first + 1, firstInstance, instanceCount, call))
+		return;
+
+	SoftwareDrawState draw;
+	draw.pixelFunction = pixelKernel ? pixelKernel->function : nullptr;
+	draw.varyingCount = pixelKernel ? pixelKernel->varyingCount : 0;
+	for (int slot = 0; slot < SOFTWARE_CONSTANT_BUFFER_SLOTS; slot++)
+	{
+		// Only the part that's bound is copied, which matters when it's a small piece of a big buffer
+		const Buffer* buffer = pixelKernel ? m_buffers.Get(m_psConstantBuffers[slot]) : nullptr;
+		unsigned int offset = m_psConstantOffsets[slot];
+		size_t size = m_psConstantSizes[slot] != 0 ? m_psConstantSizes[slot] : (buffer ? buffer->data.size() - offset : 0);
+		draw.constantBufferOffsets[slot] = buffer ? m_rasterizer.StoreConstants(buffer->data.data() + offset, size) : SOFTWARE_NO_CONSTANTS;
+	}
+	for (int slot = 0; slot < SOFTWARE_TEXTURE_SLOTS; slot++)
+		draw.textures[slot] = GetTexture(m_psTextures[slot]);
+	memcpy(draw.samplers, m_psSamplers, sizeof(draw.samplers));
+	draw.depthStencil = m_depthStencilState;
+	draw.stencilRef = m_stencilRef;
+	draw.blend = m_blendState;
+	draw.blend.colorWriteEnable = m_blendState.colorWriteEnable && pixelShader != nullptr;
+	draw.cullMode = m_rasterizerState.cullMode;
+	draw.viewport = m_viewport;
+	m_rasterizer.BeginDraw(draw);
+
+	// Triangles are set up as they're handed over, so the shaded vertices can be reused by the next instance
+	unsigned int floatsPerVertex = 4 + vertexShader->kernel->varyingCount;
+	for (unsigned int instance = firstInstance; instance < firstInstance + instanceCount; instance++)
+	{
+		ShadeVertices(*vertexShader, first, last - first + 1, instance);
+
+		const float* shaded = m_shadedVertices.data();
+		for (size_t i = 0; i + 2 < m_indices.size(); i += 3)
+		{
+			m_rasterizer.DrawTriangle(
+				shaded + (size_t)(m_indices[i] - first) * floatsPerVertex,
+				shaded + (size_t)(m_indices[i + 1] - first) * floatsPerVertex,
+				shaded + (size_t)(m_indices[i + 2] - first) * floatsPerVertex);
+		}
+	}
+}
+
+void SoftwareRenderDevice::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	m_indices.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+		m_indices[i] = startVertex + i;
+
+	DrawIndices(0, 1, "Draw");
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += vertexCount / 3;
+}
+
+void SoftwareRenderDevice::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	if (!ReadIndices(indexCount, startIndex, baseVertex, "DrawIndexed"))
+		return;
+
+	DrawIndices(0, 1, "DrawIndexed");
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += indexCount / 3;
+}
+
+void SoftwareRenderDevice::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	if (!ReadIndices(indexCount, startIndex, baseVertex, "DrawIndexedInstanced"))
+		return;
+
+	DrawIndices(startInstance, instanceCount, "DrawIndexedInstanced");
+
+	m_frameStats.draws++;
+	m_frameStats.triangles += (unsigned long long)(indexCount / 3) * instanceCount;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Swap Chain
+// ---------------------------------------------------------------------------------------------------------------
+
+GPUHANDLE SoftwareRenderDevice::GetBackBuffer() const
+{
+	return m_backBuffer;
+}
+
+GPUHANDLE SoftwareRenderDevice::GetBackBufferDepth() const
+{
+	return m_backBufferDepth;
+}
+
+unsigned int SoftwareRenderDevice::GetBackBufferWidth() const
+{
+	return (*m_textures.Get(m_backBuffer))->desc.width;
+}
+
+unsigned int SoftwareRenderDevice::GetBackBufferHeight() const
+{
+	return (*m_textures.Get(m_backBuffer))->desc.height;
+}
+
+bool SoftwareRenderDevice::Resize(unsigned int width, unsigned int height)
+{
+	// Don't allow for 0 size swap chain buffers.
+	if (width == 0) width = 1;
+	if (height == 0) height = 1;
+
+	m_rasterizer.Flush();
+
+	SoftwareTexture* buffers[] = { GetTexture(m_backBuffer), GetTexture(m_backBufferDepth) };
+	for (SoftwareTexture* buffer : buffers)
+	{
+		buffer->desc.width = width;
+		buffer->desc.height = height;
+		AllocateTexture(*buffer);
+	}
+
+	// The rasterizer sized its tiles for the old buffers
+	if (m_colorTarget == m_backBuffer || m_depthTarget == m_backBufferDepth)
+		m_rasterizer.SetTargets(GetTexture(m_colorTarget), GetTexture(m_depthTarget));
+
+	return true;
+}
+
+void SoftwareRenderDevice::Present()
+{
+	m_rasterizer.Flush();
+	m_presentCount++;
+}
+
+unsigned int SoftwareRenderDevice::GetPresentCount() const
+{
+	return m_presentCount;
+}
+
+const SoftwareTexture* SoftwareRenderDevice::ReadTexture(GPUHANDLE texture)
+{
+	m_rasterizer.Flush();
+	return GetTexture(texture);
+}
+
+bool SoftwareRenderDevice::SaveImage(GPUHANDLE texture, const char* path)
+{
+	const SoftwareTexture* source = ReadTexture(texture);
+	if (!source)
+	{
+		ReportError("SaveImage was given 0x%08X, which isn't a live texture", texture);
+		return false;
+	}
+
+	FILE* file = fopen(path, "wb");
+	if (!file)
+	{
+		printf("Couldn't open %s for writing \n", path);
+		return false;
+	}
+
+	// Uncompressed true color, 32 bits with 8 of them alpha, first row at the top
+	unsigned int width = source->desc.width;
+	unsigned int height = source->desc.height;
+	unsigned char header[18] = {};
+	header[2] = 2;
+	header[12] = (unsigned char)(width & 0xFF);
+	header[13] = (unsigned char)(width >> 8);
+	header[14] = (unsigned char)(height & 0xFF);
+	header[15] = (unsigned char)(height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	fwrite(header, 1, sizeof(header), file);
+
+	std::vector<unsigned char> row(width * 4);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		for (unsigned int x = 0; x < width; x++)
+		{
+			size_t index = (size_t)y * width + x;
+			unsigned char* pixel = &row[x * 4];
+			if (!source->depth.empty())
+			{
+				unsigned char grey = (unsigned char)(source->depth[index] * 255.0f + 0.5f);
+				pixel[0] = pixel[1] = pixel[2] = grey;
+				pixel[3] = 255;
+			}
+			else
+			{
+				uint32_t color = source->color[index];
+				pixel[0] = (unsigned char)(color >> 16);		// TGA wants BGRA
+				pixel[1] = (unsigned char)(color >> 8);
+				pixel[2] = (unsigned char)color;
+				pixel[3] = (unsigned char)(color >> 24);
+			}
+		}
+
+		fwrite(row.data(), 1, row.size(), file);
+	}
+
+	fclose(file);
+	return true;
+}
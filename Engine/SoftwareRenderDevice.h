@@ -0,0 +1,174 @@
+#pragma once
+#include "RenderDevice.h"
+#include "SoftwareRasterizer.h"
+#include <memory>
+
+// A RenderDevice that draws on the CPU, for real frames on machines without a GPU: headless benchmarks that include the
+// cost of shading, and images to compare against known good ones.
+//
+// It can't run shader bytecode, so it runs C++ kernels registered for that bytecode instead (see SoftwareShader.h).
+// A vertex shader without one can't be created. A pixel shader without one draws magenta, with a warning when it's
+// created, so a missing kernel shows up in the picture rather than stopping the game.
+//
+// Drawing follows the D3D11 rules for the states RenderManager::InitStates creates: clipping, culling, the top-left fill
+// rule, the depth and stencil tests and operations, alpha blending and color write masks. Color targets are always
+// stored as R8G8B8A8 and depth as floats. Wireframe fill draws solid and multisampling is ignored.
+//
+// Draws are vertex shaded straight away and their triangles binned, and the pixels are done all at once on the
+// JobSystem whenever something needs them: switching targets, clears, Present, or reading a texture back. Problems are
+// printed and counted as validation errors, like the null device does, but only the ones that would break drawing.
+class SoftwareRenderDevice : public RenderDevice
+{
+private:
+	struct Buffer
+	{
+		BUFFER_TYPE type;
+		std::vector<char> data;
+	};
+
+	// Where each of the kernel's inputs comes from, resolved against the input layout up front
+	struct VertexInput
+	{
+		unsigned int slot;
+		unsigned int offset;
+		GPU_FORMAT format;
+		bool perInstance;
+	};
+
+	struct VertexShader
+	{
+		const SoftwareVertexShader* kernel;
+		VertexInput inputs[SOFTWARE_MAX_VERTEX_INPUTS];
+	};
+
+	struct PixelShader
+	{
+		const SoftwarePixelShader* kernel;		// Null when there isn't one
+	};
+
+	GPUResourceTable<Buffer, GPU_RESOURCE::BUFFER> m_buffers;
+	GPUResourceTable<VertexShader, GPU_RESOURCE::VERTEX_SHADER> m_vertexShaders;
+	GPUResourceTable<PixelShader, GPU_RESOURCE::PIXEL_SHADER> m_pixelShaders;
+	GPUResourceTable<std::unique_ptr<SoftwareTexture>, GPU_RESOURCE::TEXTURE> m_textures;	// Boxed, so pending draws can point at them
+	GPUResourceTable<RasterizerDesc, GPU_RESOURCE::RASTERIZER_STATE> m_rasterizerStates;
+	GPUResourceTable<DepthStencilDesc, GPU_RESOURCE::DEPTH_STENCIL_STATE> m_depthStencilStates;
+	GPUResourceTable<BlendDesc, GPU_RESOURCE::BLEND_STATE> m_blendStates;
+	GPUResourceTable<SamplerDesc, GPU_RESOURCE::SAMPLER_STATE> m_samplerStates;
+
+	GPUHANDLE m_backBuffer;
+	GPUHANDLE m_backBufferDepth;
+
+	// Bound state. State objects are copied when they're set, and 0 means the D3D11 default.
+	GPUHANDLE m_vertexShader;
+	GPUHANDLE m_pixelShader;
+	GPUHANDLE m_vertexBuffers[SOFTWARE_VERTEX_BUFFER_SLOTS];
+	unsigned int m_vertexStrides[SOFTWARE_VERTEX_BUFFER_SLOTS];
+	unsigned int m_vertexOffsets[SOFTWARE_VERTEX_BUFFER_SLOTS];
+	GPUHANDLE m_indexBuffer;
+	GPU_FORMAT m_indexFormat;
+	GPUHANDLE m_vsConstantBuffers[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	GPUHANDLE m_psConstantBuffers[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_vsConstantOffsets[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_psConstantOffsets[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_vsConstantSizes[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	unsigned int m_psConstantSizes[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	GPUHANDLE m_psTextures[SOFTWARE_TEXTURE_SLOTS];
+	SamplerDesc m_psSamplers[SOFTWARE_SAMPLER_SLOTS];
+	RasterizerDesc m_rasterizerState;
+	DepthStencilDesc m_depthStencilState;
+	unsigned char m_stencilRef;
+	BlendDesc m_blendState;
+	Viewport m_viewport;
+	GPUHANDLE m_colorTarget;
+	GPUHANDLE m_depthTarget;
+
+	SoftwareRasterizer m_rasterizer;
+
+	// Shaded vertices of the current draw: clip space position then varyings, for each vertex in the range it uses.
+	// Kept between draws so it only ever grows.
+	std::vector<float> m_shadedVertices;
+	std::vector<unsigned int> m_indices;
+
+	unsigned int m_presentCount;
+	unsigned int m_reportedErrors;
+
+	void ReportError(const char* format, ...);
+	SoftwareTexture* GetTexture(GPUHANDLE handle);
+	bool AllocateTexture(SoftwareTexture& texture);
+
+	// False if the vertex buffers the shader reads from don't hold vertices [first, first + count) and instances
+	// [firstInstance, firstInstance + instanceCount)
+	bool CheckVertexBuffers(const VertexShader& shader, unsigned int first, unsigned int count, unsigned int firstInstance, unsigned int instanceCount, const char* call);
+
+	// False if the part of a constant buffer being bound isn't one a shader could see. Kernels read the bound part
+	// straight out of the buffer, so this is what keeps them inside it.
+	bool CheckConstantRange(GPUHANDLE buffer, unsigned int offset, unsigned int byteCount, const char* call);
+
+	// Shades vertices [first, first + count) of one instance into m_shadedVertices
+	void ShadeVertices(const VertexShader& shader, unsigned int first, unsigned int count, unsigned int instance);
+
+	// Fills m_indices from the index buffer. False if the range doesn't fit in it.
+	bool ReadIndices(unsigned int indexCount, unsigned int startIndex, int baseVertex, const char* call);
+
+	// Everything the draw calls have in common, once m_indices holds the vertex of every corner
+	void DrawIndices(unsigned int firstInstance, unsigned int instanceCount, const char* call);
+
+public:
+	SoftwareRenderDevice(unsigned int width, unsigned int height);
+	~SoftwareRenderDevice();
+
+	const char* GetName() const override;
+
+	GPUHANDLE CreateBuffer(BUFFER_TYPE type, unsigned int byteWidth, const void* initialData, bool dynamic = false) override;
+	GPUHANDLE CreateVertexShader(const void* bytecode, size_t bytecodeSize, const VertexElement* elements, unsigned int elementCount) override;
+	GPUHANDLE CreatePixelShader(const void* bytecode, size_t bytecodeSize) override;
+	GPUHANDLE CreateTexture(const TextureDesc& desc) override;
+	GPUHANDLE CreateRasterizerState(const RasterizerDesc& desc) override;
+	GPUHANDLE CreateDepthStencilState(const DepthStencilDesc& desc) override;
+	GPUHANDLE CreateBlendState(const BlendDesc& desc) override;
+	GPUHANDLE CreateSamplerState(const SamplerDesc& desc) override;
+	void Release(GPUHANDLE handle) override;
+	unsigned int GetBufferSize(GPUHANDLE buffer) const override;
+
+	void UpdateBuffer(GPUHANDLE buffer, const void* data, unsigned int byteCount = 0) override;
+	void UpdateBufferRange(GPUHANDLE buffer, unsigned int offset, const void* data, unsigned int byteCount) override;
+	bool SupportsConstantBufferOffsets() const override;
+
+	void SetVertexShader(GPUHANDLE shader) override;
+	void SetPixelShader(GPUHANDLE shader) override;
+	void SetVertexBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int stride, unsigned int offset = 0) override;
+	void SetIndexBuffer(GPUHANDLE buffer, GPU_FORMAT format) override;
+	void SetVSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSConstantBuffer(unsigned int slot, GPUHANDLE buffer, unsigned int offset = 0, unsigned int byteCount = 0) override;
+	void SetPSTexture(unsigned int slot, GPUHANDLE texture) override;
+	void SetPSSampler(unsigned int slot, GPUHANDLE sampler) override;
+	void SetRasterizerState(GPUHANDLE state) override;
+	void SetDepthStencilState(GPUHANDLE state, unsigned int stencilRef) override;
+	void SetBlendState(GPUHANDLE state) override;
+	void SetViewport(const Viewport& viewport) override;
+	void SetRenderTarget(GPUHANDLE colorTarget, GPUHANDLE depthStencil) override;
+	void ClearState() override;
+
+	void ClearRenderTarget(GPUHANDLE target, const float color[4]) override;
+	void ClearDepthStencil(GPUHANDLE target, unsigned int clearFlags, float depth, unsigned char stencil) override;
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex) override;
+	void DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) override;
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) override;
+
+	GPUHANDLE GetBackBuffer() const override;
+	GPUHANDLE GetBackBufferDepth() const override;
+	unsigned int GetBackBufferWidth() const override;
+	unsigned int GetBackBufferHeight() const override;
+	bool Resize(unsigned int width, unsigned int height) override;
+	void Present() override;
+
+	unsigned int GetPresentCount() const;
+
+	// Finishes anything still binned and hands over the texture's pixels, for comparing against a reference.
+	// Null if the handle isn't a live texture.
+	const SoftwareTexture* ReadTexture(GPUHANDLE texture);
+
+	// Writes a texture out as an uncompressed 32 bit TGA. Depth textures come out as greyscale, with 0 black.
+	bool SaveImage(GPUHANDLE texture, const char* path);
+};
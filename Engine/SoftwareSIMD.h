@@ -0,0 +1,336 @@
+#pragma once
+#include "EngineMath.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Eight floats or ints processed together, for the software renderer's rasterizer and shader kernels. It's written for
+// AVX2 (with -mavx2 or /arch:AVX2), falls back to a pair of SSE registers on any other x86 build, and to plain loops
+// everywhere else. Which one gets used follows EngineMath, so it's the same choice the math library made.
+//
+// Comparisons return masks with every bit of a lane set or clear, which is what Select, And and MoveMask expect.
+#define SIMD_WIDTH 8
+
+#if defined(__AVX2__) && defined(_XM_SSE_INTRINSICS_)
+#define SOFTWARE_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(_XM_SSE_INTRINSICS_)
+#define SOFTWARE_SIMD_SSE
+#include <emmintrin.h>
+#else
+#define SOFTWARE_SIMD_SCALAR
+#endif
+
+struct SIMDInt;
+
+struct SIMDFloat
+{
+#if defined(SOFTWARE_SIMD_AVX2)
+	__m256 v;
+#elif defined(SOFTWARE_SIMD_SSE)
+	__m128 lo, hi;
+#else
+	float f[SIMD_WIDTH];
+#endif
+
+	SIMDFloat() {}
+	SIMDFloat(float value);
+
+	static SIMDFloat Load(const float* values);
+	void Store(float* values) const;
+};
+
+struct SIMDInt
+{
+#if defined(SOFTWARE_SIMD_AVX2)
+	__m256i v;
+#elif defined(SOFTWARE_SIMD_SSE)
+	__m128i lo, hi;
+#else
+	int32_t i[SIMD_WIDTH];
+#endif
+
+	SIMDInt() {}
+	SIMDInt(int32_t value);
+
+	static SIMDInt Load(const int32_t* values);
+	void Store(int32_t* values) const;
+};
+
+// ----------------------------------------------------------------------------------
+// AVX2
+// ----------------------------------------------------------------------------------
+#if defined(SOFTWARE_SIMD_AVX2)
+
+inline SIMDFloat::SIMDFloat(float value) : v(_mm256_set1_ps(value)) {}
+inline SIMDFloat SIMDFloat::Load(const float* values) { SIMDFloat r; r.v = _mm256_loadu_ps(values); return r; }
+inline void SIMDFloat::Store(float* values) const { _mm256_storeu_ps(values, v); }
+inline SIMDInt::SIMDInt(int32_t value) : v(_mm256_set1_epi32(value)) {}
+inline SIMDInt SIMDInt::Load(const int32_t* values) { SIMDInt r; r.v = _mm256_loadu_si256((const __m256i*)values); return r; }
+inline void SIMDInt::Store(int32_t* values) const { _mm256_storeu_si256((__m256i*)values, v); }
+
+#define SIMD_FLOAT_OP(name, op) inline SIMDFloat name(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = op(a.v, b.v); return r; }
+#define SIMD_INT_OP(name, op) inline SIMDInt name(const SIMDInt& a, const SIMDInt& b) { SIMDInt r; r.v = op(a.v, b.v); return r; }
+
+SIMD_FLOAT_OP(operator+, _mm256_add_ps)
+SIMD_FLOAT_OP(operator-, _mm256_sub_ps)
+SIMD_FLOAT_OP(operator*, _mm256_mul_ps)
+SIMD_FLOAT_OP(operator/, _mm256_div_ps)
+SIMD_FLOAT_OP(Min, _mm256_min_ps)
+SIMD_FLOAT_OP(Max, _mm256_max_ps)
+SIMD_FLOAT_OP(And, _mm256_and_ps)
+SIMD_FLOAT_OP(Or, _mm256_or_ps)
+SIMD_FLOAT_OP(AndNot, _mm256_andnot_ps)	// ~a & b
+
+inline SIMDFloat operator<(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); return r; }
+inline SIMDFloat operator<=(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); return r; }
+inline SIMDFloat operator>(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); return r; }
+inline SIMDFloat operator>=(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); return r; }
+
+// mask ? a : b
+inline SIMDFloat Select(const SIMDFloat& mask, const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.v = _mm256_blendv_ps(b.v, a.v, mask.v); return r; }
+inline SIMDFloat Sqrt(const SIMDFloat& a) { SIMDFloat r; r.v = _mm256_sqrt_ps(a.v); return r; }
+inline SIMDFloat Floor(const SIMDFloat& a) { SIMDFloat r; r.v = _mm256_floor_ps(a.v); return r; }
+inline unsigned int MoveMask(const SIMDFloat& mask) { return (unsigned int)_mm256_movemask_ps(mask.v); }
+
+SIMD_INT_OP(operator+, _mm256_add_epi32)
+SIMD_INT_OP(operator-, _mm256_sub_epi32)
+SIMD_INT_OP(operator>, _mm256_cmpgt_epi32)
+SIMD_INT_OP(And, _mm256_and_si256)
+SIMD_INT_OP(Min, _mm256_min_epi32)
+SIMD_INT_OP(Max, _mm256_max_epi32)
+
+inline SIMDInt operator<<(const SIMDInt& a, int bits) { SIMDInt r; r.v = _mm256_slli_epi32(a.v, bits); return r; }
+inline SIMDInt operator>>(const SIMDInt& a, int bits) { SIMDInt r; r.v = _mm256_srli_epi32(a.v, bits); return r; }
+inline SIMDInt Or(const SIMDInt& a, const SIMDInt& b) { SIMDInt r; r.v = _mm256_or_si256(a.v, b.v); return r; }
+
+inline SIMDFloat ToFloat(const SIMDInt& a) { SIMDFloat r; r.v = _mm256_cvtepi32_ps(a.v); return r; }
+inline SIMDInt ToIntRound(const SIMDFloat& a) { SIMDInt r; r.v = _mm256_cvtps_epi32(a.v); return r; }
+inline SIMDInt ToIntTruncate(const SIMDFloat& a) { SIMDInt r; r.v = _mm256_cvttps_epi32(a.v); return r; }
+inline SIMDFloat AsFloat(const SIMDInt& a) { SIMDFloat r; r.v = _mm256_castsi256_ps(a.v); return r; }
+inline SIMDInt AsInt(const SIMDFloat& a) { SIMDInt r; r.v = _mm256_castps_si256(a.v); return r; }
+
+#undef SIMD_FLOAT_OP
+#undef SIMD_INT_OP
+
+// ----------------------------------------------------------------------------------
+// SSE2, two registers per value
+// ----------------------------------------------------------------------------------
+#elif defined(SOFTWARE_SIMD_SSE)
+
+inline SIMDFloat::SIMDFloat(float value) : lo(_mm_set1_ps(value)), hi(_mm_set1_ps(value)) {}
+inline SIMDFloat SIMDFloat::Load(const float* values) { SIMDFloat r; r.lo = _mm_loadu_ps(values); r.hi = _mm_loadu_ps(values + 4); return r; }
+inline void SIMDFloat::Store(float* values) const { _mm_storeu_ps(values, lo); _mm_storeu_ps(values + 4, hi); }
+inline SIMDInt::SIMDInt(int32_t value) : lo(_mm_set1_epi32(value)), hi(_mm_set1_epi32(value)) {}
+inline SIMDInt SIMDInt::Load(const int32_t* values) { SIMDInt r; r.lo = _mm_loadu_si128((const __m128i*)values); r.hi = _mm_loadu_si128((const __m128i*)(values + 4)); return r; }
+inline void SIMDInt::Store(int32_t* values) const { _mm_storeu_si128((__m128i*)values, lo); _mm_storeu_si128((__m128i*)(values + 4), hi); }
+
+#define SIMD_FLOAT_OP(name, op) inline SIMDFloat name(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; r.lo = op(a.lo, b.lo); r.hi = op(a.hi, b.hi); return r; }
+#define SIMD_INT_OP(name, op) inline SIMDInt name(const SIMDInt& a, const SIMDInt& b) { SIMDInt r; r.lo = op(a.lo, b.lo); r.hi = op(a.hi, b.hi); return r; }
+
+SIMD_FLOAT_OP(operator+, _mm_add_ps)
+SIMD_FLOAT_OP(operator-, _mm_sub_ps)
+SIMD_FLOAT_OP(operator*, _mm_mul_ps)
+SIMD_FLOAT_OP(operator/, _mm_div_ps)
+SIMD_FLOAT_OP(Min, _mm_min_ps)
+SIMD_FLOAT_OP(Max, _mm_max_ps)
+SIMD_FLOAT_OP(And, _mm_and_ps)
+SIMD_FLOAT_OP(Or, _mm_or_ps)
+SIMD_FLOAT_OP(AndNot, _mm_andnot_ps)	// ~a & b
+SIMD_FLOAT_OP(operator<, _mm_cmplt_ps)
+SIMD_FLOAT_OP(operator<=, _mm_cmple_ps)
+SIMD_FLOAT_OP(operator>, _mm_cmpgt_ps)
+SIMD_FLOAT_OP(operator>=, _mm_cmpge_ps)
+
+// mask ? a : b
+inline SIMDFloat Select(const SIMDFloat& mask, const SIMDFloat& a, const SIMDFloat& b) { return Or(And(mask, a), AndNot(mask, b)); }
+
+inline SIMDFloat Sqrt(const SIMDFloat& a) { SIMDFloat r; r.lo = _mm_sqrt_ps(a.lo); r.hi = _mm_sqrt_ps(a.hi); return r; }
+inline unsigned int MoveMask(const SIMDFloat& mask) { return (unsigned int)(_mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4)); }
+
+SIMD_INT_OP(operator+, _mm_add_epi32)
+SIMD_INT_OP(operator-, _mm_sub_epi32)
+SIMD_INT_OP(operator>, _mm_cmpgt_epi32)
+SIMD_INT_OP(And, _mm_and_si128)
+SIMD_INT_OP(Or, _mm_or_si128)
+
+// SSE2 has no 32 bit min/max, so these go through a compare
+inline SIMDInt Min(const SIMDInt& a, const SIMDInt& b) { SIMDInt m = a > b; SIMDInt r; r.lo = _mm_or_si128(_mm_and_si128(m.lo, b.lo), _mm_andnot_si128(m.lo, a.lo)); r.hi = _mm_or_si128(_mm_and_si128(m.hi, b.hi), _mm_andnot_si128(m.hi, a.hi)); return r; }
+inline SIMDInt Max(const SIMDInt& a, const SIMDInt& b) { SIMDInt m = a > b; SIMDInt r; r.lo = _mm_or_si128(_mm_and_si128(m.lo, a.lo), _mm_andnot_si128(m.lo, b.lo)); r.hi = _mm_or_si128(_mm_and_si128(m.hi, a.hi), _mm_andnot_si128(m.hi, b.hi)); return r; }
+
+inline SIMDInt operator<<(const SIMDInt& a, int bits) { SIMDInt r; r.lo = _mm_slli_epi32(a.lo, bits); r.hi = _mm_slli_epi32(a.hi, bits); return r; }
+inline SIMDInt operator>>(const SIMDInt& a, int bits) { SIMDInt r; r.lo = _mm_srli_epi32(a.lo, bits); r.hi = _mm_srli_epi32(a.hi, bits); return r; }
+
+inline SIMDFloat ToFloat(const SIMDInt& a) { SIMDFloat r; r.lo = _mm_cvtepi32_ps(a.lo); r.hi = _mm_cvtepi32_ps(a.hi); return r; }
+inline SIMDInt ToIntRound(const SIMDFloat& a) { SIMDInt r; r.lo = _mm_cvtps_epi32(a.lo); r.hi = _mm_cvtps_epi32(a.hi); return r; }
+inline SIMDInt ToIntTruncate(const SIMDFloat& a) { SIMDInt r; r.lo = _mm_cvttps_epi32(a.lo); r.hi = _mm_cvttps_epi32(a.hi); return r; }
+inline SIMDFloat AsFloat(const SIMDInt& a) { SIMDFloat r; r.lo = _mm_castsi128_ps(a.lo); r.hi = _mm_castsi128_ps(a.hi); return r; }
+inline SIMDInt AsInt(const SIMDFloat& a) { SIMDInt r; r.lo = _mm_castps_si128(a.lo); r.hi = _mm_castps_si128(a.hi); return r; }
+
+// Truncate and step down wherever that rounded up. Only good for values that fit in an int, which is all the
+// rasterizer and the shaders ever floor.
+inline SIMDFloat Floor(const SIMDFloat& a)
+{
+	SIMDFloat t = ToFloat(ToIntTruncate(a));
+	return t - And(t > a, SIMDFloat(1.0f));
+}
+
+#undef SIMD_FLOAT_OP
+#undef SIMD_INT_OP
+
+// ----------------------------------------------------------------------------------
+// Plain loops
+// ----------------------------------------------------------------------------------
+#else
+
+inline SIMDFloat::SIMDFloat(float value) { for (int n = 0; n < SIMD_WIDTH; n++) f[n] = value; }
+inline SIMDFloat SIMDFloat::Load(const float* values) { SIMDFloat r; memcpy(r.f, values, sizeof(r.f)); return r; }
+inline void SIMDFloat::Store(float* values) const { memcpy(values, f, sizeof(f)); }
+inline SIMDInt::SIMDInt(int32_t value) { for (int n = 0; n < SIMD_WIDTH; n++) i[n] = value; }
+inline SIMDInt SIMDInt::Load(const int32_t* values) { SIMDInt r; memcpy(r.i, values, sizeof(r.i)); return r; }
+inline void SIMDInt::Store(int32_t* values) const { memcpy(values, i, sizeof(i)); }
+
+inline uint32_t SIMDBits(float value) { uint32_t bits; memcpy(&bits, &value, 4); return bits; }
+inline float SIMDFromBits(uint32_t bits) { float value; memcpy(&value, &bits, 4); return value; }
+
+#define SIMD_FLOAT_OP(name, expr) inline SIMDFloat name(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) { float x = a.f[n], y = b.f[n]; r.f[n] = (expr); } return r; }
+#define SIMD_FLOAT_CMP(name, cmp) inline SIMDFloat name(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) r.f[n] = SIMDFromBits(a.f[n] cmp b.f[n] ? 0xFFFFFFFF : 0); return r; }
+#define SIMD_FLOAT_BITS(name, expr) inline SIMDFloat name(const SIMDFloat& a, const SIMDFloat& b) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) { uint32_t x = SIMDBits(a.f[n]), y = SIMDBits(b.f[n]); r.f[n] = SIMDFromBits(expr); } return r; }
+#define SIMD_INT_OP(name, expr) inline SIMDInt name(const SIMDInt& a, const SIMDInt& b) { SIMDInt r; for (int n = 0; n < SIMD_WIDTH; n++) { int32_t x = a.i[n], y = b.i[n]; r.i[n] = (expr); } return r; }
+
+SIMD_FLOAT_OP(operator+, x + y)
+SIMD_FLOAT_OP(operator-, x - y)
+SIMD_FLOAT_OP(operator*, x * y)
+SIMD_FLOAT_OP(operator/, x / y)
+SIMD_FLOAT_OP(Min, x < y ? x : y)
+SIMD_FLOAT_OP(Max, x > y ? x : y)
+SIMD_FLOAT_BITS(And, x & y)
+SIMD_FLOAT_BITS(Or, x | y)
+SIMD_FLOAT_BITS(AndNot, ~x & y)
+SIMD_FLOAT_CMP(operator<, <)
+SIMD_FLOAT_CMP(operator<=, <=)
+SIMD_FLOAT_CMP(operator>, >)
+SIMD_FLOAT_CMP(operator>=, >=)
+
+inline SIMDFloat Select(const SIMDFloat& mask, const SIMDFloat& a, const SIMDFloat& b) { return Or(And(mask, a), AndNot(mask, b)); }
+inline SIMDFloat Sqrt(const SIMDFloat& a) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) r.f[n] = sqrtf(a.f[n]); return r; }
+inline SIMDFloat Floor(const SIMDFloat& a) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) r.f[n] = floorf(a.f[n]); return r; }
+inline unsigned int MoveMask(const SIMDFloat& mask) { unsigned int bits = 0; for (int n = 0; n < SIMD_WIDTH; n++) bits |= (SIMDBits(mask.f[n]) >> 31) << n; return bits; }
+
+SIMD_INT_OP(operator+, (int32_t)((uint32_t)x + (uint32_t)y))
+SIMD_INT_OP(operator-, (int32_t)((uint32_t)x - (uint32_t)y))
+SIMD_INT_OP(operator>, x > y ? -1 : 0)
+SIMD_INT_OP(And, x & y)
+SIMD_INT_OP(Or, x | y)
+SIMD_INT_OP(Min, x < y ? x : y)
+SIMD_INT_OP(Max, x > y ? x : y)
+
+inline SIMDInt operator<<(const SIMDInt& a, int bits) { SIMDInt r; for (int n = 0; n < SIMD_WIDTH; n++) r.i[n] = (int32_t)((uint32_t)a.i[n] << bits); return r; }
+inline SIMDInt operator>>(const SIMDInt& a, int bits) { SIMDInt r; for (int n = 0; n < SIMD_WIDTH; n++) r.i[n] = (int32_t)((uint32_t)a.i[n] >> bits); return r; }
+
+inline SIMDFloat ToFloat(const SIMDInt& a) { SIMDFloat r; for (int n = 0; n < SIMD_WIDTH; n++) r.f[n] = (float)a.i[n]; return r; }
+inline SIMDInt ToIntRound(const SIMDFloat& a) { SIMDInt r; for (int n = 0; n < SIMD_WIDTH; n++) r.i[n] = (int32_t)lrintf(a.f[n]); return r; }
+inline SIMDInt ToIntTruncate(const SIMDFloat& a) { SIMDInt r; for (int n = 0; n < SIMD_WIDTH; n++) r.i[n] = (int32_t)a.f[n]; return r; }
+inline SIMDFloat AsFloat(const SIMDInt& a) { SIMDFloat r; memcpy(r.f, a.i, sizeof(r.f)); return r; }
+inline SIMDInt AsInt(const SIMDFloat& a) { SIMDInt r; memcpy(r.i, a.f, sizeof(r.i)); return r; }
+
+#undef SIMD_FLOAT_OP
+#undef SIMD_FLOAT_CMP
+#undef SIMD_FLOAT_BITS
+#undef SIMD_INT_OP
+
+#endif
+
+// ----------------------------------------------------------------------------------
+// Built on the above, so the same for every backend
+// ----------------------------------------------------------------------------------
+
+inline SIMDFloat operator-(const SIMDFloat& a) { return SIMDFloat(0.0f) - a; }
+inline SIMDFloat& operator+=(SIMDFloat& a, const SIMDFloat& b) { return a = a + b; }
+inline SIMDFloat& operator-=(SIMDFloat& a, const SIMDFloat& b) { return a = a - b; }
+inline SIMDFloat& operator*=(SIMDFloat& a, const SIMDFloat& b) { return a = a * b; }
+inline SIMDInt& operator+=(SIMDInt& a, const SIMDInt& b) { return a = a + b; }
+
+inline SIMDFloat Abs(const SIMDFloat& a) { return AndNot(SIMDFloat(-0.0f), a); }
+inline SIMDFloat Saturate(const SIMDFloat& a) { return Min(Max(a, SIMDFloat(0.0f)), SIMDFloat(1.0f)); }
+inline SIMDFloat MultiplyAdd(const SIMDFloat& a, const SIMDFloat& b, const SIMDFloat& c) { return a * b + c; }
+
+// 0, 1, 2 ... 7
+inline SIMDInt LaneIndices()
+{
+	const int32_t indices[SIMD_WIDTH] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+	return SIMDInt::Load(indices);
+}
+
+// A mask with lane n set wherever bit n of bits is
+inline SIMDFloat MaskFromBits(unsigned int bits)
+{
+	const int32_t laneBits[SIMD_WIDTH] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+	SIMDInt set = And(SIMDInt((int32_t)bits), SIMDInt::Load(laneBits));
+	return AsFloat(set > SIMDInt(0));
+}
+
+// ----------------------------------------------------------------------------------
+// HLSL intrinsics, for the shader kernels
+// ----------------------------------------------------------------------------------
+
+// These follow HLSL rather than the C library, so fmod keeps the sign of x and frac is never negative. Exp and Sin are polynomial approximations, good to about 1e-6 over the ranges the
+// shaders use, which is as close as GPUs get themselves.
+
+inline SIMDFloat Truncate(const SIMDFloat& a) { return ToFloat(ToIntTruncate(a)); }
+inline SIMDFloat Frac(const SIMDFloat& a) { return a - Floor(a); }
+inline SIMDFloat Fmod(const SIMDFloat& a, const SIMDFloat& b) { return a - b * Truncate(a / b); }
+inline SIMDFloat Lerp(const SIMDFloat& a, const SIMDFloat& b, const SIMDFloat& t) { return a + (b - a) * t; }
+
+inline SIMDFloat Smoothstep(float edge0, float edge1, const SIMDFloat& x)
+{
+	SIMDFloat t = Saturate((x - SIMDFloat(edge0)) * SIMDFloat(1.0f / (edge1 - edge0)));
+	return t * t * (SIMDFloat(3.0f) - SIMDFloat(2.0f) * t);
+}
+
+// 2^x, by splitting x into a whole power of two (built straight into the exponent bits) and 2^fraction, with the
+// fraction in [-0.5, 0.5] where the series converges fast. Anything below 2^-126 comes out as 0.
+inline SIMDFloat Exp2(const SIMDFloat& a)
+{
+	SIMDFloat x = Min(Max(a, SIMDFloat(-127.0f)), SIMDFloat(127.0f));
+	SIMDFloat whole = Floor(x + SIMDFloat(0.5f));
+	SIMDFloat f = x - whole;
+
+	SIMDFloat p(1.5403530393381609e-4f);
+	p = MultiplyAdd(p, f, SIMDFloat(1.3333558146428443e-3f));
+	p = MultiplyAdd(p, f, SIMDFloat(9.6181291076284772e-3f));
+	p = MultiplyAdd(p, f, SIMDFloat(5.5504108664821580e-2f));
+	p = MultiplyAdd(p, f, SIMDFloat(2.4022650695910071e-1f));
+	p = MultiplyAdd(p, f, SIMDFloat(6.9314718055994531e-1f));
+	p = MultiplyAdd(p, f, SIMDFloat(1.0f));
+
+	SIMDFloat scale = AsFloat((ToIntTruncate(whole) + SIMDInt(127)) << 23);
+	return AndNot(x < SIMDFloat(-126.0f), p * scale);
+}
+
+inline SIMDFloat Exp(const SIMDFloat& a)
+{
+	return Exp2(a * SIMDFloat(1.44269504088896341f));
+}
+
+// Brought down to [-pi, pi] with 2pi split in three so big arguments don't lose their low bits, then folded onto
+// [-pi/2, pi/2] for the polynomial
+inline SIMDFloat Sin(const SIMDFloat& a)
+{
+	SIMDFloat k = ToFloat(ToIntRound(a * SIMDFloat(0.159154943091895336f)));
+	SIMDFloat x = a - k * SIMDFloat(6.28125f);
+	x = x - k * SIMDFloat(1.9353071795864769253e-3f);
+
+	SIMDFloat halfPi(1.57079632679489662f);
+	SIMDFloat pi(3.14159265358979324f);
+	x = Select(x > halfPi, pi - x, x);
+	x = Select(x < -halfPi, -pi - x, x);
+
+	SIMDFloat x2 = x * x;
+	SIMDFloat p(-2.5052108385441720e-8f);
+	p = MultiplyAdd(p, x2, SIMDFloat(2.7557319223985891e-6f));
+	p = MultiplyAdd(p, x2, SIMDFloat(-1.9841269841269841e-4f));
+	p = MultiplyAdd(p, x2, SIMDFloat(8.3333333333333333e-3f));
+	p = MultiplyAdd(p, x2, SIMDFloat(-1.6666666666666667e-1f));
+	return x + x * x2 * p;
+}
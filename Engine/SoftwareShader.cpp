@@ -0,0 +1,202 @@
+#include "SoftwareShader.h"
+#include <assert.h>
+#include <deque>
+#include <string.h>
+
+// fxc's bytecode starts with "DXBC" and then a 16 byte checksum of everything after it
+#define DXBC_CHECKSUM_OFFSET 4
+#define DXBC_CHECKSUM_SIZE 16
+
+struct RegisteredVertexShader
+{
+	unsigned char checksum[DXBC_CHECKSUM_SIZE];
+	SoftwareVertexShader shader;
+};
+
+struct RegisteredPixelShader
+{
+	unsigned char checksum[DXBC_CHECKSUM_SIZE];
+	SoftwarePixelShader shader;
+};
+
+const float g_SoftwareUnboundConstants[SOFTWARE_CONSTANT_BUFFER_MAX_SIZE / sizeof(float)] = {};
+
+// Devices hang on to pointers into these, so they have to stay put as more kernels are registered
+static std::deque<RegisteredVertexShader> s_vertexShaders;
+static std::deque<RegisteredPixelShader> s_pixelShaders;
+
+// ----------------------------------------------------------------------------------
+// Registry
+// ----------------------------------------------------------------------------------
+
+static const unsigned char* GetChecksum(const void* bytecode, size_t bytecodeSize)
+{
+	const unsigned char* bytes = (const unsigned char*)bytecode;
+	if (!bytes || bytecodeSize < DXBC_CHECKSUM_OFFSET + DXBC_CHECKSUM_SIZE || memcmp(bytes, "DXBC", 4) != 0)
+		return nullptr;
+
+	return bytes + DXBC_CHECKSUM_OFFSET;
+}
+
+template <typename Registered>
+static Registered* FindRegistered(std::deque<Registered>& registered, const unsigned char* checksum)
+{
+	for (Registered& item : registered)
+	{
+		if (memcmp(item.checksum, checksum, DXBC_CHECKSUM_SIZE) == 0)
+			return &item;
+	}
+
+	return nullptr;
+}
+
+void RegisterSoftwareVertexShader(const void* bytecode, size_t bytecodeSize, const SoftwareVertexShader& shader)
+{
+	const unsigned char* checksum = GetChecksum(bytecode, bytecodeSize);
+	assert(checksum && "Software kernels can only be registered for DXBC bytecode");
+	assert(shader.inputCount <= SOFTWARE_MAX_VERTEX_INPUTS && shader.varyingCount <= SOFTWARE_MAX_VARYINGS);
+
+	RegisteredVertexShader* existing = FindRegistered(s_vertexShaders, checksum);
+	if (existing)
+	{
+		existing->shader = shader;
+		return;
+	}
+
+	RegisteredVertexShader item;
+	memcpy(item.checksum, checksum, DXBC_CHECKSUM_SIZE);
+	item.shader = shader;
+	s_vertexShaders.push_back(item);
+}
+
+void RegisterSoftwarePixelShader(const void* bytecode, size_t bytecodeSize, const SoftwarePixelShader& shader)
+{
+	const unsigned char* checksum = GetChecksum(bytecode, bytecodeSize);
+	assert(checksum && "Software kernels can only be registered for DXBC bytecode");
+	assert(shader.varyingCount <= SOFTWARE_MAX_VARYINGS);
+
+	RegisteredPixelShader* existing = FindRegistered(s_pixelShaders, checksum);
+	if (existing)
+	{
+		existing->shader = shader;
+		return;
+	}
+
+	RegisteredPixelShader item;
+	memcpy(item.checksum, checksum, DXBC_CHECKSUM_SIZE);
+	item.shader = shader;
+	s_pixelShaders.push_back(item);
+}
+
+const SoftwareVertexShader* FindSoftwareVertexShader(const void* bytecode, size_t bytecodeSize)
+{
+	const unsigned char* checksum = GetChecksum(bytecode, bytecodeSize);
+	if (!checksum)
+		return nullptr;
+
+	RegisteredVertexShader* item = FindRegistered(s_vertexShaders, checksum);
+	return item ? &item->shader : nullptr;
+}
+
+const SoftwarePixelShader* FindSoftwarePixelShader(const void* bytecode, size_t bytecodeSize)
+{
+	const unsigned char* checksum = GetChecksum(bytecode, bytecodeSize);
+	if (!checksum)
+		return nullptr;
+
+	RegisteredPixelShader* item = FindRegistered(s_pixelShaders, checksum);
+	return item ? &item->shader : nullptr;
+}
+
+// ----------------------------------------------------------------------------------
+// Sampling
+// ----------------------------------------------------------------------------------
+
+// Texel coordinates from (floored) texture coordinates. Wrapping is done in floats since there's no integer divide.
+static SIMDFloat AddressTexels(const SIMDFloat& coord, float size, TEXTURE_ADDRESS mode)
+{
+	SIMDFloat wrapped = coord;
+	if (mode == TEXTURE_ADDRESS::WRAP)
+		wrapped = coord - Floor(coord * SIMDFloat(1.0f / size)) * SIMDFloat(size);
+
+	// Clamping also catches a wrap that rounded up to exactly size
+	return Min(Max(wrapped, SIMDFloat(0.0f)), SIMDFloat(size - 1.0f));
+}
+
+// Gathering is the one part that has to go a lane at a time. Everything either side of it is done eight wide.
+static void FetchTexels(const SoftwareTexture* texture, const SIMDFloat& x, const SIMDFloat& y, SIMDFloat out[4])
+{
+	int32_t xs[SIMD_WIDTH], ys[SIMD_WIDTH];
+	ToIntTruncate(x).Store(xs);
+	ToIntTruncate(y).Store(ys);
+
+	size_t width = texture->desc.width;
+	if (!texture->depth.empty())
+	{
+		float depth[SIMD_WIDTH];
+		for (int lane = 0; lane < SIMD_WIDTH; lane++)
+			depth[lane] = texture->depth[(size_t)ys[lane] * width + xs[lane]];
+
+		out[0] = SIMDFloat::Load(depth);
+		out[1] = SIMDFloat(0.0f);
+		out[2] = SIMDFloat(0.0f);
+		out[3] = SIMDFloat(1.0f);
+		return;
+	}
+
+	int32_t texels[SIMD_WIDTH];
+	for (int lane = 0; lane < SIMD_WIDTH; lane++)
+		texels[lane] = (int32_t)texture->color[(size_t)ys[lane] * width + xs[lane]];
+
+	SIMDInt packed = SIMDInt::Load(texels);
+	SIMDInt byteMask(0xFF);
+	SIMDFloat scale(1.0f / 255.0f);
+	out[0] = ToFloat(And(packed, byteMask)) * scale;
+	out[1] = ToFloat(And(packed >> 8, byteMask)) * scale;
+	out[2] = ToFloat(And(packed >> 16, byteMask)) * scale;
+	out[3] = ToFloat(packed >> 24) * scale;
+}
+
+void SampleTexture(const SoftwareTexture* texture, const SamplerDesc& sampler, const SIMDFloat& u, const SIMDFloat& v, SIMDFloat out[4])
+{
+	if (!texture || (texture->color.empty() && texture->depth.empty()))
+	{
+		out[0] = out[1] = out[2] = out[3] = SIMDFloat(0.0f);
+		return;
+	}
+
+	float width = (float)texture->desc.width;
+	float height = (float)texture->desc.height;
+
+	// Texel centres are at half coordinates, so the texel a point sample lands in is floor(u * width).
+	// Lanes outside the triangle can hand in anything, NaN included. Max turns NaN into the limit, which keeps it and
+	// anything huge from overflowing the int conversions.
+	SIMDFloat x = Min(Max(u * SIMDFloat(width), SIMDFloat(-1e7f)), SIMDFloat(1e7f));
+	SIMDFloat y = Min(Max(v * SIMDFloat(height), SIMDFloat(-1e7f)), SIMDFloat(1e7f));
+
+	if (sampler.filter == TEXTURE_FILTER::POINT)
+	{
+		FetchTexels(texture, AddressTexels(Floor(x), width, sampler.addressMode), AddressTexels(Floor(y), height, sampler.addressMode), out);
+		return;
+	}
+
+	x -= SIMDFloat(0.5f);
+	y -= SIMDFloat(0.5f);
+	SIMDFloat fx = Floor(x);
+	SIMDFloat fy = Floor(y);
+	SIMDFloat wx = x - fx;
+	SIMDFloat wy = y - fy;
+	SIMDFloat x0 = AddressTexels(fx, width, sampler.addressMode);
+	SIMDFloat x1 = AddressTexels(fx + SIMDFloat(1.0f), width, sampler.addressMode);
+	SIMDFloat y0 = AddressTexels(fy, height, sampler.addressMode);
+	SIMDFloat y1 = AddressTexels(fy + SIMDFloat(1.0f), height, sampler.addressMode);
+
+	SIMDFloat t00[4], t10[4], t01[4], t11[4];
+	FetchTexels(texture, x0, y0, t00);
+	FetchTexels(texture, x1, y0, t10);
+	FetchTexels(texture, x0, y1, t01);
+	FetchTexels(texture, x1, y1, t11);
+
+	for (int c = 0; c < 4; c++)
+		out[c] = Lerp(Lerp(t00[c], t10[c], wx), Lerp(t01[c], t11[c], wx), wy);
+}
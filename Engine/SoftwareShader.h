@@ -0,0 +1,134 @@
+#pragma once
+#include "RenderDevice.h"
+#include "SoftwareSIMD.h"
+#include <stdint.h>
+#include <vector>
+
+// Limits of the software device. The constant buffer slot count is the same as D3D11's, the rest is plenty for
+// anything the engine and the game draw.
+#define SOFTWARE_CONSTANT_BUFFER_SLOTS 14
+#define SOFTWARE_TEXTURE_SLOTS 8
+#define SOFTWARE_SAMPLER_SLOTS 8
+#define SOFTWARE_VERTEX_BUFFER_SLOTS 4
+#define SOFTWARE_MAX_VERTEX_INPUTS 16
+#define SOFTWARE_MAX_VARYINGS 16
+
+// What unbound constant buffer slots read from. D3D11 gives zeros there too.
+#define SOFTWARE_CONSTANT_BUFFER_MAX_SIZE (4096 * 16)
+extern const float g_SoftwareUnboundConstants[SOFTWARE_CONSTANT_BUFFER_MAX_SIZE / sizeof(float)];
+
+// A texture as the software device stores it. Color textures are R8G8B8A8 (red in the low byte), depth textures keep
+// their depth as floats whatever the format says, plus a byte of stencil if the format has one. Rows are tightly packed.
+struct SoftwareTexture
+{
+	TextureDesc desc;
+	std::vector<uint32_t> color;
+	std::vector<float> depth;
+	std::vector<uint8_t> stencil;
+};
+
+// Everything a shader kernel can read besides its inputs. Constant buffer contents are copies taken when the draw was
+// issued, so updating a buffer between draws behaves the way it does on a GPU.
+struct SoftwareShaderResources
+{
+	const void* constantBuffers[SOFTWARE_CONSTANT_BUFFER_SLOTS];
+	const SoftwareTexture* textures[SOFTWARE_TEXTURE_SLOTS];
+	SamplerDesc samplers[SOFTWARE_SAMPLER_SLOTS];
+};
+
+// Texture.Sample() for eight texels at once. Filtering is point or bilinear (anisotropic counts as bilinear) from the
+// top mip, since that's the only one the device keeps. Depth textures come back as (depth, 0, 0, 1), and sampling
+// nothing gives zeros, both as on D3D11.
+void SampleTexture(const SoftwareTexture* texture, const SamplerDesc& sampler, const SIMDFloat& u, const SIMDFloat& v, SIMDFloat out[4]);
+
+// ----------------------------------------------------------------------------------
+// Kernels
+// ----------------------------------------------------------------------------------
+
+// The software device can't run DXBC, so every shader it's asked to draw with needs a C++ stand in. Kernels work on
+// SIMD_WIDTH vertices or pixels at a time, with every value stored a lane per float (value[component][lane]).
+//
+// Varyings are what the vertex shader passes on to the pixel shader, as a flat list of floats in the order the members
+// of the HLSL output struct are declared (SV_Position is separate and not counted). The pixel kernel that goes with a
+// vertex kernel has to expect them in the same order, which is what the HLSL input structs do anyway.
+
+// Vertex attributes come in as four components each, in the order the kernel listed its inputs, with missing
+// components filled in from (0, 0, 0, 1) like the input assembler does. Per instance attributes are the same in every
+// lane, since a batch never spans two instances.
+struct SoftwareVertexBatch
+{
+	float inputs[SOFTWARE_MAX_VERTEX_INPUTS][4][SIMD_WIDTH];
+	float position[4][SIMD_WIDTH];				// SV_Position, in clip space
+	float varyings[SOFTWARE_MAX_VARYINGS][SIMD_WIDTH];
+};
+
+// A 4x2 block of pixels. Lanes outside the triangle are still filled in (with whatever the interpolation came up with)
+// and have their bit clear in coverage. Their output is thrown away, so a kernel can shade all of them.
+struct SoftwarePixelBatch
+{
+	float position[4][SIMD_WIDTH];				// SV_Position: pixel centre, depth and w
+	float varyings[SOFTWARE_MAX_VARYINGS][SIMD_WIDTH];
+	unsigned int coverage;
+	float color[4][SIMD_WIDTH];					// SV_Target
+};
+
+typedef void(*SoftwareVertexFunction)(const SoftwareShaderResources& resources, SoftwareVertexBatch& batch);
+typedef void(*SoftwarePixelFunction)(const SoftwareShaderResources& resources, SoftwarePixelBatch& batch);
+
+struct SoftwareVertexInput
+{
+	const char* semantic;
+	unsigned int semanticIndex;
+};
+
+struct SoftwareVertexShader
+{
+	SoftwareVertexFunction function;
+	SoftwareVertexInput inputs[SOFTWARE_MAX_VERTEX_INPUTS];
+	unsigned int inputCount;
+	unsigned int varyingCount;
+};
+
+struct SoftwarePixelShader
+{
+	SoftwarePixelFunction function;
+	unsigned int varyingCount;		// How many of the vertex kernel's varyings it reads
+};
+
+// mul(M, float4(x, y, z, translate ? 1 : 0)) for a matrix in a constant buffer, writing the first `components` of the
+// result. The CPU side uploads XMMATRIXs as they are, which HLSL reads as the transpose, so it's v * M here.
+inline void TransformVector(const float* m, const SIMDFloat& x, const SIMDFloat& y, const SIMDFloat& z, bool translate, int components, float out[][SIMD_WIDTH])
+{
+	for (int c = 0; c < components; c++)
+	{
+		SIMDFloat result = MultiplyAdd(x, SIMDFloat(m[c]), MultiplyAdd(y, SIMDFloat(m[4 + c]), z * SIMDFloat(m[8 + c])));
+		if (translate)
+			result += SIMDFloat(m[12 + c]);
+		result.Store(out[c]);
+	}
+}
+
+// normalize() on three components. A zero vector gives NaN, same as HLSL.
+inline void Normalize(SIMDFloat& x, SIMDFloat& y, SIMDFloat& z)
+{
+	SIMDFloat length = Sqrt(x * x + y * y + z * z);
+	x = x / length;
+	y = y / length;
+	z = z / length;
+}
+
+// Kernels are looked up by the checksum fxc writes into the DXBC header, so they have to be registered with the very
+// same bytecode the game creates its shaders from. Registering the same bytecode again replaces the kernel.
+// Not thread safe: do it at startup, before creating shaders.
+void RegisterSoftwareVertexShader(const void* bytecode, size_t bytecodeSize, const SoftwareVertexShader& shader);
+void RegisterSoftwarePixelShader(const void* bytecode, size_t bytecodeSize, const SoftwarePixelShader& shader);
+
+// Null when nothing has been registered for that bytecode
+const SoftwareVertexShader* FindSoftwareVertexShader(const void* bytecode, size_t bytecodeSize);
+const SoftwarePixelShader* FindSoftwarePixelShader(const void* bytecode, size_t bytecodeSize);
+
+// The engine's own shaders: the blit pair and the simple/unlit pair in the Engine folder
+void RegisterEngineSoftwareShaders();
+
+// The engine's SimpleVertexShader kernel, for anything that compiles its own copy of that HLSL
+extern const SoftwareVertexShader g_SoftwareSimpleVertexShader;
@@ -8,83 +8,70 @@ const XMVECTOR Transform::WORLD_AXES::RIGHT		= XMVectorSet(1.0f, 0.0f, 0.0f, 0.0
 const XMVECTOR Transform::WORLD_AXES::FORWARD	= XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
 
 Transform::Transform()
-	: m_parent(nullptr)
-	, m_dirtyFlags(INT_MAX)
 {
-	pData = (AlignedData*)_aligned_malloc(sizeof(AlignedData), 16);
-	if (pData == NULL)
-	{
-		MessageBoxA(nullptr, "The data is NULL?!", "Error", MB_OK | MB_ICONERROR);
-	}
-	pData->m_translation = XMVectorZero();
-	pData->m_rotation = XMQuaternionIdentity();
-	pData->m_scale = XMVectorSet(1.0f, 1.0f, 1.0f, 1.0f);
+	m_handle = TransformSystem::GetSingleton().Create(this);
+	m_index = TransformSystem::GetSingleton().GetIndex(m_handle);
 }
 
 Transform::~Transform()
 {
-	_aligned_free(pData);
+	TransformSystem::GetSingleton().Destroy(m_handle);
 }
 
 // ------------------------------------------------------------------------------------------------------------------------------
 // Public Member Functions
 // ------------------------------------------------------------------------------------------------------------------------------
 
+THANDLE Transform::GetHandle() const
+{
+	return m_handle;
+}
+
 // Child/Parent Management
 //-----------------------------------------------------------------------------------------
 void Transform::SetParent(Transform* other)
 {
+	TransformSystem& ts = TransformSystem::GetSingleton();
+
 	// Why would anyone attempt this?
-	if (!m_parent && !other)
+	if (ts.m_parent[m_index] == TRANSFORM_NONE && !other)
 		return;
 
-	if (m_parent)
-	{
-		m_parent->RemoveChild(this);
-	}
-
-	m_parent = other;
-
-	if (other)
-	{
-		other->AddChild(this);
-	}
-
-	SetAllDirtyRecursive();
+	// This bumps the local version, so the world matrix gets rebuilt against the new parent
+	ts.SetParent(m_index, other ? other->m_index : TRANSFORM_NONE);
 }
 
 Transform* Transform::GetParent() const
 {
-	return m_parent;
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	unsigned int parent = ts.m_parent[m_index];
+
+	return parent != TRANSFORM_NONE ? ts.m_owner[parent] : nullptr;
 }
 
 void Transform::AddChild(Transform* child)
 {
-	m_children.push_back(child);
+	if (child->GetParent() != this)
+		child->SetParent(this);
 }
 
 void Transform::RemoveChild(Transform* child)
 {
-	m_children.remove(child);
+	if (child->GetParent() == this)
+		child->SetParent(nullptr);
 }
 
 bool Transform::HasChild(Transform* child) const
 {
-	for (Transform* c: m_children)
-	{
-		if (c == child)
-			return true;
-	}
-
-	return false;
+	return child->GetParent() == this;
 }
 
 // Position/Translation
 //-----------------------------------------------------------------------------------------
 void XM_CALLCONV Transform::SetPosition(FXMVECTOR position)
 {
-	pData->m_translation = position;
-	SetWorldDirtyRecursive();
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_translation[m_index], position);
+	MarkChanged();
 }
 
 void Transform::SetPosition(float x, float y, float z)
@@ -94,28 +81,31 @@ void Transform::SetPosition(float x, float y, float z)
 
 XMVECTOR Transform::GetPosition() const
 {
-	return pData->m_translation;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_translation[m_index]);
 }
 
 void XM_CALLCONV Transform::Translate(FXMVECTOR translation, Space space)
 {
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	XMVECTOR position = XMLoadFloat4A(&ts.m_translation[m_index]);
+
 	switch (space)
 	{
 		case Space::LocalSpace:
 		{
-			pData->m_translation += XMVector3Rotate(translation, pData->m_rotation);
+			position += XMVector3Rotate(translation, XMLoadFloat4A(&ts.m_rotation[m_index]));
 		}
 		break;
 		case Space::WorldSpace:
 		{
-			pData->m_translation += translation;
+			position += translation;
 		}
 		break;
 	}
 
-	pData->m_translation = XMVectorSetW(pData->m_translation, 1.0f);
+	XMStoreFloat4A(&ts.m_translation[m_index], XMVectorSetW(position, 1.0f));
 
-	SetWorldDirtyRecursive();
+	MarkChanged();
 }
 
 // Rotation
@@ -123,27 +113,28 @@ void XM_CALLCONV Transform::Translate(FXMVECTOR translation, Space space)
 
 void XM_CALLCONV Transform::SetRotation(DirectX::FXMVECTOR quaternion)
 {
-	pData->m_rotation = quaternion;
-	SetAllDirtyRecursive();
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_rotation[m_index], quaternion);
+	MarkChanged();
 }
 
 XMVECTOR Transform::GetRotation() const
 {
-	return pData->m_rotation;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_rotation[m_index]);
 }
 
 void XM_CALLCONV Transform::Rotate(DirectX::FXMVECTOR quaternion)
 {
-	pData->m_rotation = XMQuaternionMultiply(pData->m_rotation, quaternion);
-	SetAllDirtyRecursive();
+	XMFLOAT4A& rotation = TransformSystem::GetSingleton().m_rotation[m_index];
+	XMStoreFloat4A(&rotation, XMQuaternionMultiply(XMLoadFloat4A(&rotation), quaternion));
+	MarkChanged();
 }
 
 // Scaling
 //-----------------------------------------------------------------------------------------
 void XM_CALLCONV Transform::SetScale(DirectX::FXMVECTOR scale)
 {
-	pData->m_scale = scale;
-	SetWorldDirtyRecursive();
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_scale[m_index], scale);
+	MarkChanged();
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -153,63 +144,75 @@ void Transform::SetScale(float x, float y, float z)
 
 DirectX::XMVECTOR Transform::GetScale() const
 {
-	return pData->m_scale;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_scale[m_index]);
 }
 
 void XM_CALLCONV Transform::Scale(DirectX::FXMVECTOR scale)
 {
-	pData->m_scale += scale;
-	SetWorldDirtyRecursive();
+	XMFLOAT4A& current = TransformSystem::GetSingleton().m_scale[m_index];
+	XMStoreFloat4A(&current, XMLoadFloat4A(&current) + scale);
+	MarkChanged();
 }
 
 // World Tansform Values
 //-----------------------------------------------------------------------------------------
 XMVECTOR Transform::GetWorldPosition() const
 {
-	if (!m_parent)
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	Transform* parent = GetParent();
+	if (!parent)
 	{
-		return pData->m_translation;
+		return XMLoadFloat4A(&ts.m_translation[m_index]);
 	}
 
-	if(IsDirty(WORLD_POS))
+	Refresh();
+	if(!IsCached(WORLD_POS))
 	{
-		pData->m_translationWorld = m_parent->GetWorldPosition() + XMVector3Rotate(pData->m_translation, m_parent->GetRotation());
-		SetDirtyFlag(WORLD_POS, false);
+		XMVECTOR offset = XMVector3Rotate(XMLoadFloat4A(&ts.m_translation[m_index]), parent->GetRotation());
+		XMStoreFloat4A(&ts.m_translationWorld[m_index], parent->GetWorldPosition() + offset);
+		SetCached(WORLD_POS);
 	}
-	
-	return pData->m_translationWorld;
+
+	return XMLoadFloat4A(&ts.m_translationWorld[m_index]);
 }
 
 XMVECTOR Transform::GetWorldRotation() const
 {
-	if (!m_parent)
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	Transform* parent = GetParent();
+	if (!parent)
 	{
-		return pData->m_rotation;
+		return XMLoadFloat4A(&ts.m_rotation[m_index]);
 	}
 
-	if(IsDirty(WORLD_ROT))
+	Refresh();
+	if(!IsCached(WORLD_ROT))
 	{
-		pData->m_rotationWorld = XMQuaternionMultiply(m_parent->GetRotation(), pData->m_rotation);
-		SetDirtyFlag(WORLD_ROT, false);
+		XMVECTOR rotation = XMQuaternionMultiply(parent->GetRotation(), XMLoadFloat4A(&ts.m_rotation[m_index]));
+		XMStoreFloat4A(&ts.m_rotationWorld[m_index], rotation);
+		SetCached(WORLD_ROT);
 	}
 
-	return pData->m_rotationWorld;
+	return XMLoadFloat4A(&ts.m_rotationWorld[m_index]);
 }
 
 XMVECTOR Transform::GetWorldScale() const
 {
-	if (!m_parent)
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	Transform* parent = GetParent();
+	if (!parent)
 	{
-		return pData->m_scale;
+		return XMLoadFloat4A(&ts.m_scale[m_index]);
 	}
 
-	if(IsDirty(WORLD_SCALE))
+	Refresh();
+	if(!IsCached(WORLD_SCALE))
 	{
-		pData->m_scaleWorld = m_parent->GetWorldScale() * pData->m_scale;
-		SetDirtyFlag(WORLD_SCALE, false);
+		XMStoreFloat4A(&ts.m_scaleWorld[m_index], parent->GetWorldScale() * XMLoadFloat4A(&ts.m_scale[m_index]));
+		SetCached(WORLD_SCALE);
 	}
 
-	return pData->m_scaleWorld;
+	return XMLoadFloat4A(&ts.m_scaleWorld[m_index]);
 }
 
 // Utility
@@ -218,145 +221,175 @@ XMVECTOR Transform::GetWorldScale() const
 // ToDo: Modify this function to work properly with a parent transform
 void XM_CALLCONV Transform::LookAt(DirectX::FXMVECTOR target, DirectX::FXMVECTOR up)
 {
-	// I am taking the inverse here because it appears that the XMMatrixLookAt functions return a view
-	// matrix suitable for use by a camera (i.e. the inverse of the matrix we want). So to get the matrix
-	// we need in order to transform an object to look at the given spot, we need to take the inverse of 
-	// the matrix we recieve from the function call.
-	pData->m_worldMatrix = XMMatrixInverse(nullptr, XMMatrixLookAtLH(pData->m_translation, target, up));
-	pData->m_rotation = XMQuaternionRotationMatrix(pData->m_worldMatrix);
+	TransformSystem& ts = TransformSystem::GetSingleton();
+
+	// The XMMatrixLookAt functions return a view matrix suitable for use by a camera (i.e. the inverse of
+	// the matrix we want). Only the rotation is kept, and the inverse of a rotation is just its transpose,
+	// so there's no need to invert the whole thing. The world matrix is rebuilt from it like any other change.
+	XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat4A(&ts.m_translation[m_index]), target, up);
+	XMStoreFloat4A(&ts.m_rotation[m_index], XMQuaternionRotationMatrix(XMMatrixTranspose(view)));
 
-	SetAllDirtyRecursive();
-	SetDirtyFlag(WORLD_MATRIX, false);
+	MarkChanged();
 }
 
 XMVECTOR Transform::Up() const
 {
-	if (IsDirty(WORLD_MATRIX)) UpdateWorldMatrix();
-	if (IsDirty(UP)) UpdateUp();
+	Refresh();
+	if (!IsCached(UP)) UpdateUp();
 
-	return pData->m_upVector;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_upVector[m_index]);
 }
 
 XMVECTOR Transform::Right() const
 {
-	if (IsDirty(WORLD_MATRIX)) UpdateWorldMatrix();
-	if (IsDirty(RIGHT)) UpdateRight();
+	Refresh();
+	if (!IsCached(RIGHT)) UpdateRight();
 
-	return pData->m_rightVector;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_rightVector[m_index]);
 }
 
 XMVECTOR Transform::Forward() const
 {
-	if (IsDirty(WORLD_MATRIX)) UpdateWorldMatrix();
-	if (IsDirty(FORWARD)) UpdateForward();
+	Refresh();
+	if (!IsCached(FORWARD)) UpdateForward();
 
-	return pData->m_forwardVector;
+	return XMLoadFloat4A(&TransformSystem::GetSingleton().m_forwardVector[m_index]);
 }
 
 XMMATRIX Transform::GetWorldMatrix() const
 {
-	if(IsDirty(WORLD_MATRIX))
-	{
-		UpdateWorldMatrix();
-	}
+	Refresh();
 
-	return pData->m_worldMatrix;
+	return TransformSystem::GetSingleton().m_worldMatrix[m_index];
 }
 
 XMMATRIX Transform::GetInverseWorldMatrix() const
 {
-	if(IsDirty(INVERSE_WORLD))
+	Refresh();
+	if(!IsCached(INVERSE_WORLD))
 	{
 		UpdateInverseWorldMatrix();
 	}
 
-	return pData->m_inverseWorldMatrix;
+	return TransformSystem::GetSingleton().m_inverseWorldMatrix[m_index];
 }
 
-// ------------------------------------------------------------------------------------------------------------------------------
-// Private Member Functions
-// ------------------------------------------------------------------------------------------------------------------------------
-
-// For when the thing rotated and everything needs to be recalculated
-void Transform::SetAllDirtyRecursive(bool value) const
+XMMATRIX Transform::GetInverseTransposeWorldMatrix() const
 {
-	m_dirtyFlags = value ? INT_MAX : 0;
-
-	for (Transform* child : m_children)
+	Refresh();
+	if(!IsCached(INVERSE_TRANSPOSE_WORLD))
 	{
-		child->SetAllDirtyRecursive(value);
+		UpdateInverseTransposeWorldMatrix();
 	}
+
+	return TransformSystem::GetSingleton().m_inverseTransposeWorldMatrix[m_index];
 }
 
-// For when no rotation has taken place
-void Transform::SetWorldDirtyRecursive(bool value) const
+unsigned int Transform::GetWorldVersion() const
 {
-	if(value)
-		m_dirtyFlags |= (WORLD_MATRIX | INVERSE_WORLD | WORLD_POS | WORLD_SCALE);
-	else
-		m_dirtyFlags &= ~(WORLD_MATRIX | INVERSE_WORLD | WORLD_POS | WORLD_SCALE);
+	Refresh();
 
-	for (Transform* child : m_children)
-	{
-		child->SetWorldDirtyRecursive(value);
-	}
+	return TransformSystem::GetSingleton().m_worldVersion[m_index];
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Private Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+void Transform::MarkChanged()
+{
+	TransformSystem::GetSingleton().m_localVersion[m_index]++;
 }
 
-void Transform::SetDirtyFlag(DIRTY_FLAG flag, bool value) const
+void Transform::Refresh() const
 {
-	if (value) 
-		m_dirtyFlags |= flag;
-	else 
-		m_dirtyFlags &= ~flag;
+	TransformSystem::GetSingleton().Refresh(m_index);
 }
 
-bool Transform::IsDirty(DIRTY_FLAG flag) const
+bool Transform::IsCached(CACHED_VALUE value) const
 {
-	return (m_dirtyFlags & flag) != 0;
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	return ts.m_cacheVersion[m_index] == ts.m_worldVersion[m_index] && (ts.m_cachedFlags[m_index] & value) != 0;
 }
 
-void Transform::UpdateWorldMatrix() const
+void Transform::SetCached(CACHED_VALUE value) const
 {
-	XMMATRIX translation = XMMatrixTranslationFromVector(pData->m_translation); //XMMatrixTranslationFromVector(-pData->m_translation);
-	XMMATRIX rotation = XMMatrixRotationQuaternion(pData->m_rotation); //XMMatrixTranspose(XMMatrixRotationQuaternion(pData->m_rotation));
-	XMMATRIX scaling = XMMatrixScalingFromVector(pData->m_scale);
+	TransformSystem& ts = TransformSystem::GetSingleton();
 
-	pData->m_worldMatrix = scaling * rotation * translation;
-	
-	if (m_parent)
+	// First value cached against a new world version, so everything from the old one is gone
+	if (ts.m_cacheVersion[m_index] != ts.m_worldVersion[m_index])
 	{
-		pData->m_worldMatrix = pData->m_worldMatrix * m_parent->GetWorldMatrix();
+		ts.m_cacheVersion[m_index] = ts.m_worldVersion[m_index];
+		ts.m_cachedFlags[m_index] = 0;
 	}
 
-	SetDirtyFlag(WORLD_MATRIX, false);
-	SetDirtyFlag(INVERSE_WORLD, true);
+	ts.m_cachedFlags[m_index] |= value;
 }
 
+// The world matrix is always built out of scales, rotations and translations, so there's no need for a general 4x4
+// inverse. Callers have already called Refresh, so the world matrix is current.
 void Transform::UpdateInverseWorldMatrix() const
 {
-	if(IsDirty(WORLD_MATRIX))
+	TransformSystem& ts = TransformSystem::GetSingleton();
+	XMMATRIX& inverse = ts.m_inverseWorldMatrix[m_index];
+
+	if (ts.m_uniformScale[m_index])
 	{
-		UpdateWorldMatrix();
+		// The upper 3x3 is a rotation times a scale s, so its inverse is its transpose divided by s squared
+		const XMMATRIX& world = ts.m_worldMatrix[m_index];
+		XMMATRIX upper = world;
+		upper.r[3] = g_XMIdentityR3;
+		inverse = XMMatrixTranspose(upper);
+
+		XMVECTOR inverseScaleSq = XMVectorReciprocal(XMVector3Dot(world.r[0], world.r[0]));
+		inverse.r[0] = XMVectorMultiply(inverse.r[0], inverseScaleSq);
+		inverse.r[1] = XMVectorMultiply(inverse.r[1], inverseScaleSq);
+		inverse.r[2] = XMVectorMultiply(inverse.r[2], inverseScaleSq);
+		inverse.r[3] = XMVectorSetW(XMVectorNegate(XMVector3TransformNormal(world.r[3], inverse)), 1.0f);
+	}
+	else
+	{
+		// Undo this transform's own translation, rotation and scale in reverse order: the transposed rotation with
+		// each column divided by the matching scale
+		XMMATRIX local = XMMatrixTranspose(XMMatrixRotationQuaternion(XMLoadFloat4A(&ts.m_rotation[m_index])));
+		XMVECTOR inverseScale = XMVectorSetW(XMVectorReciprocal(XMLoadFloat4A(&ts.m_scale[m_index])), 0.0f);
+		local.r[0] = XMVectorMultiply(local.r[0], inverseScale);
+		local.r[1] = XMVectorMultiply(local.r[1], inverseScale);
+		local.r[2] = XMVectorMultiply(local.r[2], inverseScale);
+		XMVECTOR translation = XMLoadFloat4A(&ts.m_translation[m_index]);
+		local.r[3] = XMVectorSetW(XMVectorNegate(XMVector3TransformNormal(translation, local)), 1.0f);
+
+		// Then whatever the parents did, which they cache themselves
+		Transform* parent = GetParent();
+		inverse = parent ? XMMatrixMultiply(parent->GetInverseWorldMatrix(), local) : local;
 	}
 
-	pData->m_inverseWorldMatrix = XMMatrixInverse(nullptr, pData->m_worldMatrix);
-	SetDirtyFlag(INVERSE_WORLD, false);
+	SetCached(INVERSE_WORLD);
+}
+
+void Transform::UpdateInverseTransposeWorldMatrix() const
+{
+	TransformSystem::GetSingleton().m_inverseTransposeWorldMatrix[m_index] = XMMatrixTranspose(GetInverseWorldMatrix());
+	SetCached(INVERSE_TRANSPOSE_WORLD);
 }
 
 void Transform::UpdateUp() const
 {
-	pData->m_upVector = XMVector3Rotate(WORLD_AXES::UP, GetWorldRotation());
-	SetDirtyFlag(UP, false);
+	XMVECTOR axis = XMVector3Rotate(WORLD_AXES::UP, GetWorldRotation());
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_upVector[m_index], axis);
+	SetCached(UP);
 }
 
 void Transform::UpdateRight() const
 {
-	pData->m_rightVector = XMVector3Rotate(WORLD_AXES::RIGHT, GetWorldRotation());
-	SetDirtyFlag(RIGHT, false);
+	XMVECTOR axis = XMVector3Rotate(WORLD_AXES::RIGHT, GetWorldRotation());
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_rightVector[m_index], axis);
+	SetCached(RIGHT);
 }
 
 void Transform::UpdateForward() const
 {
-	pData->m_forwardVector = XMVector3Rotate(WORLD_AXES::FORWARD, GetWorldRotation());
-	SetDirtyFlag(FORWARD, false);
+	XMVECTOR axis = XMVector3Rotate(WORLD_AXES::FORWARD, GetWorldRotation());
+	XMStoreFloat4A(&TransformSystem::GetSingleton().m_forwardVector[m_index], axis);
+	SetCached(FORWARD);
 }
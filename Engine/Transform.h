@@ -1,70 +1,44 @@
 #pragma once
-#include "DirectXIncludes.h"
-#include <list>
+#include "EngineMath.h"
+#include "TransformSystem.h"
 
 class Transform
 {
+	friend class TransformSystem;
+
 private:
-	// The parent coordinate space of this transform
-	Transform* m_parent;
-
-	// A list of transforms childed to this transform's coordinate space.
-	// I tried to think of other ways to ensure that all child transforms 
-	// could be notified when a parent transform changes so that they can 
-	// update their respective world matrices, but this seems like the 
-	// simplest and lowest-impact solution.
-	std::list<Transform*> m_children;
-
-	// This data must be aligned otherwise the SSE intrinsics fail and throw exceptions.
-	__declspec(align(16)) struct AlignedData
+	// All of the data for this transform lives in the TransformSystem. These just say where.
+	THANDLE m_handle;
+	unsigned int m_index;
+
+	// Values worked out from the world matrix only when they're asked for. The bits say which ones have been
+	// calculated for the current world version (see TransformSystem), so a newer world matrix invalidates all of
+	// them at once without anybody having to clear them.
+	enum CACHED_VALUE
 	{
-		// Local/World-space position.
-		DirectX::XMVECTOR m_translation;
-		DirectX::XMVECTOR m_translationWorld;
-
-		// Quaternion representing the local/world-space rotation.
-		DirectX::XMVECTOR m_rotation;
-		DirectX::XMVECTOR m_rotationWorld;
-
-		// Local/World-space scale.
-		DirectX::XMVECTOR m_scale;
-		DirectX::XMVECTOR m_scaleWorld;
-
-		// Vectors representing the up, right, and forward vectors of this transform's
-		// local coordinate space.
-		DirectX::XMVECTOR m_upVector, m_rightVector, m_forwardVector;
-
-		// Matrices for transforming objects into and out of this transform's local coordinate space
-		DirectX::XMMATRIX m_worldMatrix, m_inverseWorldMatrix;
+		INVERSE_WORLD	= 0x01,
+		UP				= 0x02,
+		RIGHT			= 0x04,
+		FORWARD			= 0x08,
+		WORLD_POS		= 0x10,
+		WORLD_ROT		= 0x20,
+		WORLD_SCALE		= 0x40,
+		INVERSE_TRANSPOSE_WORLD = 0x80
 	};
-	AlignedData* pData;
 
-	// Flags to keep track of which properties have changed and need to be recalculated before 
-	// being polled.
-	enum DIRTY_FLAG
-	{
-		WORLD_MATRIX	= 0x01,
-		INVERSE_WORLD	= 0x02,
-		UP				= 0x04,
-		RIGHT			= 0x08,
-		FORWARD			= 0x10,
-		WORLD_POS		= 0x20,
-		WORLD_ROT		= 0x40,
-		WORLD_SCALE		= 0x80
-	};
+	// Every change to the local values goes through here. It's O(1): children notice on their next read because
+	// the world version they were built from is out of date.
+	void MarkChanged();
 
-	// Keeps track of which dirty flags are set
-	mutable unsigned int m_dirtyFlags;
+	// Brings the world matrix up to date if this transform or any of its parents changed since it was last built
+	void Refresh() const;
 
-	// Functions for setting and polling dirty flags
-	void SetAllDirtyRecursive(bool value = true) const;	// Sets this transform's flags as well as those of its children
-	void SetWorldDirtyRecursive(bool value = true) const; // Sets this transform's flags as well as those of its children
-	void SetDirtyFlag(DIRTY_FLAG flag, bool value = true) const;
-	bool IsDirty(DIRTY_FLAG flag) const;
+	bool IsCached(CACHED_VALUE value) const;
+	void SetCached(CACHED_VALUE value) const;
 
 	// Functions for updating members that require more than just setting a value
-	void UpdateWorldMatrix() const;
 	void UpdateInverseWorldMatrix() const;
+	void UpdateInverseTransposeWorldMatrix() const;
 	void UpdateUp() const;
 	void UpdateRight() const;
 	void UpdateForward() const;
@@ -73,7 +47,7 @@ public:
 
 	// I felt it might be useful to have some statically available world axes instead of having to call 
 	// XMVectorSet each time I need them.
-	__declspec(align(16)) struct WORLD_AXES
+	struct alignas(16) WORLD_AXES
 	{
 		static const DirectX::XMVECTOR UP;
 		static const DirectX::XMVECTOR RIGHT;
@@ -91,6 +65,12 @@ public:
 	Transform();
 	~Transform();
 
+	// A transform owns its slot in the TransformSystem, so it can't be copied
+	Transform(const Transform&) = delete;
+	Transform& operator=(const Transform&) = delete;
+
+	THANDLE GetHandle() const;
+
 	// Child/Parent Management Functions
 	void SetParent(Transform* other);
 	Transform* GetParent() const;
@@ -132,5 +112,12 @@ public:
 	DirectX::XMVECTOR Forward() const;
 	DirectX::XMMATRIX GetWorldMatrix() const;
 	DirectX::XMMATRIX GetInverseWorldMatrix() const;
+
+	// The transpose of the inverse world matrix, for transforming normals
+	DirectX::XMMATRIX GetInverseTransposeWorldMatrix() const;
+
+	// Changes every time the world matrix is rebuilt, so anything that caches values worked out from it (like the
+	// camera's view-projection matrix) can tell when it's out of date
+	unsigned int GetWorldVersion() const;
 };
 
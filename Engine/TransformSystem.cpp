@@ -0,0 +1,429 @@
+#include "TransformSystem.h"
+#include "Transform.h"
+#include "AllocationTracker.h"
+
+using namespace DirectX;
+
+// ----------------------------------------------------------------------------------
+// Singleton Stuff
+// ----------------------------------------------------------------------------------
+template<> TransformSystem* Singleton<TransformSystem>::msSingleton = 0;
+TransformSystem& TransformSystem::GetSingleton(void)
+{
+	assert(msSingleton);
+	return *msSingleton;
+}
+
+TransformSystem* TransformSystem::GetSingletonPtr(void)
+{
+	return msSingleton;
+}
+
+// ----------------------------------------------------------------------------------
+// Implementation
+// ----------------------------------------------------------------------------------
+TransformSystem::TransformSystem(unsigned int initialCapacity)
+	: m_freeHead(TRANSFORM_NONE)
+	, m_count(0)
+	, m_orderDirty(false)
+{
+	m_translation.reserve(initialCapacity);
+	m_rotation.reserve(initialCapacity);
+	m_scale.reserve(initialCapacity);
+	m_localMatrix.reserve(initialCapacity);
+	m_worldMatrix.reserve(initialCapacity);
+	m_inverseWorldMatrix.reserve(initialCapacity);
+	m_inverseTransposeWorldMatrix.reserve(initialCapacity);
+	m_translationWorld.reserve(initialCapacity);
+	m_rotationWorld.reserve(initialCapacity);
+	m_scaleWorld.reserve(initialCapacity);
+	m_upVector.reserve(initialCapacity);
+	m_rightVector.reserve(initialCapacity);
+	m_forwardVector.reserve(initialCapacity);
+	m_localVersion.reserve(initialCapacity);
+	m_localMatrixVersion.reserve(initialCapacity);
+	m_worldVersion.reserve(initialCapacity);
+	m_builtLocalVersion.reserve(initialCapacity);
+	m_builtParentVersion.reserve(initialCapacity);
+	m_uniformScale.reserve(initialCapacity);
+	m_cacheVersion.reserve(initialCapacity);
+	m_cachedFlags.reserve(initialCapacity);
+	m_parent.reserve(initialCapacity);
+	m_firstChild.reserve(initialCapacity);
+	m_nextSibling.reserve(initialCapacity);
+	m_prevSibling.reserve(initialCapacity);
+	m_owner.reserve(initialCapacity);
+	m_generation.reserve(initialCapacity);
+	m_order.reserve(initialCapacity);
+	m_orderStack.reserve(initialCapacity);
+	m_batch.reserve(initialCapacity);
+}
+
+TransformSystem::~TransformSystem()
+{
+	// Every Transform should be gone by now, since they free their slots when they die
+	assert(m_count == 0);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Private Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+unsigned int TransformSystem::AddSlot()
+{
+	AllocationScope allocScope(ALLOC_TAG::TRANSFORM);
+
+	unsigned int index = (unsigned int)m_owner.size();
+	assert(index <= THANDLE_INDEX_MASK && "Out of transform handles");
+
+	const XMFLOAT4A zero(0.0f, 0.0f, 0.0f, 0.0f);
+	const XMFLOAT4A identity(0.0f, 0.0f, 0.0f, 1.0f);
+	const XMFLOAT4A one(1.0f, 1.0f, 1.0f, 1.0f);
+
+	m_translation.push_back(zero);
+	m_rotation.push_back(identity);
+	m_scale.push_back(one);
+	m_localMatrix.push_back(XMMatrixIdentity());
+	m_worldMatrix.push_back(XMMatrixIdentity());
+	m_inverseWorldMatrix.push_back(XMMatrixIdentity());
+	m_inverseTransposeWorldMatrix.push_back(XMMatrixIdentity());
+	m_translationWorld.push_back(zero);
+	m_rotationWorld.push_back(identity);
+	m_scaleWorld.push_back(one);
+	m_upVector.push_back(zero);
+	m_rightVector.push_back(zero);
+	m_forwardVector.push_back(zero);
+	m_localVersion.push_back(0);
+	m_localMatrixVersion.push_back(0);
+	m_worldVersion.push_back(0);
+	m_builtLocalVersion.push_back(0);
+	m_builtParentVersion.push_back(0);
+	m_uniformScale.push_back(1);
+	m_cacheVersion.push_back(0);
+	m_cachedFlags.push_back(0);
+	m_parent.push_back(TRANSFORM_NONE);
+	m_firstChild.push_back(TRANSFORM_NONE);
+	m_nextSibling.push_back(TRANSFORM_NONE);
+	m_prevSibling.push_back(TRANSFORM_NONE);
+	m_owner.push_back(nullptr);
+	m_generation.push_back(1);
+
+	return index;
+}
+
+void TransformSystem::Link(unsigned int child, unsigned int parent)
+{
+	m_parent[child] = parent;
+	m_prevSibling[child] = TRANSFORM_NONE;
+	m_nextSibling[child] = m_firstChild[parent];
+
+	if (m_firstChild[parent] != TRANSFORM_NONE)
+		m_prevSibling[m_firstChild[parent]] = child;
+
+	m_firstChild[parent] = child;
+}
+
+void TransformSystem::Unlink(unsigned int child)
+{
+	unsigned int parent = m_parent[child];
+	if (parent == TRANSFORM_NONE)
+		return;
+
+	unsigned int prev = m_prevSibling[child];
+	unsigned int next = m_nextSibling[child];
+
+	if (prev != TRANSFORM_NONE)
+		m_nextSibling[prev] = next;
+	else
+		m_firstChild[parent] = next;
+
+	if (next != TRANSFORM_NONE)
+		m_prevSibling[next] = prev;
+
+	m_parent[child] = TRANSFORM_NONE;
+	m_prevSibling[child] = TRANSFORM_NONE;
+	m_nextSibling[child] = TRANSFORM_NONE;
+}
+
+// Walks the hierarchy depth first from every root, which puts parents ahead of their children
+void TransformSystem::RebuildOrder()
+{
+	AllocationScope allocScope(ALLOC_TAG::TRANSFORM);
+
+	m_order.clear();
+
+	for (unsigned int root = 0; root < m_owner.size(); root++)
+	{
+		if (!m_owner[root] || m_parent[root] != TRANSFORM_NONE)
+			continue;
+
+		m_orderStack.push_back(root);
+		while (!m_orderStack.empty())
+		{
+			unsigned int index = m_orderStack.back();
+			m_orderStack.pop_back();
+			m_order.push_back(index);
+
+			for (unsigned int child = m_firstChild[index]; child != TRANSFORM_NONE; child = m_nextSibling[child])
+				m_orderStack.push_back(child);
+		}
+	}
+
+	m_orderDirty = false;
+}
+
+bool TransformSystem::IsStale(unsigned int index) const
+{
+	unsigned int parent = m_parent[index];
+	unsigned int parentVersion = parent != TRANSFORM_NONE ? m_worldVersion[parent] : 0;
+
+	return m_builtLocalVersion[index] != m_localVersion[index] || m_builtParentVersion[index] != parentVersion;
+}
+
+void TransformSystem::BuildLocalMatrix(unsigned int index)
+{
+	m_localMatrix[index] = XMMatrixScalingFromVector(XMLoadFloat4A(&m_scale[index])) *
+						   XMMatrixRotationQuaternion(XMLoadFloat4A(&m_rotation[index])) *
+						   XMMatrixTranslationFromVector(XMLoadFloat4A(&m_translation[index]));
+
+	m_localMatrixVersion[index] = m_localVersion[index];
+}
+
+// Same result as BuildLocalMatrix for four transforms at once. The four rotations and scales get transposed so each
+// register holds one component of all four, the matrix entries are worked out that way, and then they're transposed
+// back into rows.
+void TransformSystem::BuildLocalMatrices4(const unsigned int* indices)
+{
+#if defined(_XM_SSE_INTRINSICS_)
+	__m128 qx = XMLoadFloat4A(&m_rotation[indices[0]]);
+	__m128 qy = XMLoadFloat4A(&m_rotation[indices[1]]);
+	__m128 qz = XMLoadFloat4A(&m_rotation[indices[2]]);
+	__m128 qw = XMLoadFloat4A(&m_rotation[indices[3]]);
+	_MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+	__m128 sx = XMLoadFloat4A(&m_scale[indices[0]]);
+	__m128 sy = XMLoadFloat4A(&m_scale[indices[1]]);
+	__m128 sz = XMLoadFloat4A(&m_scale[indices[2]]);
+	__m128 sw = XMLoadFloat4A(&m_scale[indices[3]]);
+	_MM_TRANSPOSE4_PS(sx, sy, sz, sw);
+
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	__m128 x2 = _mm_mul_ps(qx, two);
+	__m128 y2 = _mm_mul_ps(qy, two);
+	__m128 z2 = _mm_mul_ps(qz, two);
+
+	__m128 xx = _mm_mul_ps(qx, x2);
+	__m128 yy = _mm_mul_ps(qy, y2);
+	__m128 zz = _mm_mul_ps(qz, z2);
+	__m128 xy = _mm_mul_ps(qx, y2);
+	__m128 xz = _mm_mul_ps(qx, z2);
+	__m128 yz = _mm_mul_ps(qy, z2);
+	__m128 wx = _mm_mul_ps(qw, x2);
+	__m128 wy = _mm_mul_ps(qw, y2);
+	__m128 wz = _mm_mul_ps(qw, z2);
+
+	// Rows of the rotation matrix, each row scaled by the matching scale component
+	__m128 r00 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+	__m128 r01 = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+	__m128 r02 = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+	__m128 r10 = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+	__m128 r11 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+	__m128 r12 = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+	__m128 r20 = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+	__m128 r21 = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+	__m128 r22 = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+
+	__m128 zero0 = _mm_setzero_ps();
+	__m128 zero1 = _mm_setzero_ps();
+	__m128 zero2 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r00, r01, r02, zero0);
+	_MM_TRANSPOSE4_PS(r10, r11, r12, zero1);
+	_MM_TRANSPOSE4_PS(r20, r21, r22, zero2);
+
+	__m128 row0[4] = { r00, r01, r02, zero0 };
+	__m128 row1[4] = { r10, r11, r12, zero1 };
+	__m128 row2[4] = { r20, r21, r22, zero2 };
+
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int index = indices[i];
+
+		XMMATRIX& local = m_localMatrix[index];
+		local.r[0] = row0[i];
+		local.r[1] = row1[i];
+		local.r[2] = row2[i];
+		local.r[3] = XMVectorSelect(g_XMIdentityR3, XMLoadFloat4A(&m_translation[index]), g_XMSelect1110);
+
+		m_localMatrixVersion[index] = m_localVersion[index];
+	}
+#else
+	for (int i = 0; i < 4; i++)
+		BuildLocalMatrix(indices[i]);
+#endif
+}
+
+// Assumes the parent's world matrix is already current
+void TransformSystem::BuildWorldMatrix(unsigned int index)
+{
+	if (m_localMatrixVersion[index] != m_localVersion[index])
+		BuildLocalMatrix(index);
+
+	XMVECTOR scale = XMLoadFloat4A(&m_scale[index]);
+	bool uniformScale = XMVectorGetX(scale) == XMVectorGetY(scale) && XMVectorGetX(scale) == XMVectorGetZ(scale);
+
+	unsigned int parent = m_parent[index];
+	if (parent != TRANSFORM_NONE)
+	{
+		m_worldMatrix[index] = XMMatrixMultiply(m_localMatrix[index], m_worldMatrix[parent]);
+		m_builtParentVersion[index] = m_worldVersion[parent];
+		m_uniformScale[index] = uniformScale && m_uniformScale[parent];
+	}
+	else
+	{
+		m_worldMatrix[index] = m_localMatrix[index];
+		m_builtParentVersion[index] = 0;
+		m_uniformScale[index] = uniformScale;
+	}
+
+	m_builtLocalVersion[index] = m_localVersion[index];
+	m_worldVersion[index]++;
+}
+
+void TransformSystem::Refresh(unsigned int index)
+{
+	unsigned int parent = m_parent[index];
+	if (parent != TRANSFORM_NONE)
+		Refresh(parent);
+
+	if (IsStale(index))
+		BuildWorldMatrix(index);
+}
+
+// ------------------------------------------------------------------------------------------------------------------------------
+// Public Member Functions
+// ------------------------------------------------------------------------------------------------------------------------------
+
+THANDLE TransformSystem::Create(Transform* owner)
+{
+	unsigned int index;
+	if (m_freeHead != TRANSFORM_NONE)
+	{
+		index = m_freeHead;
+		m_freeHead = m_nextSibling[index];
+	}
+	else
+	{
+		index = AddSlot();
+	}
+
+	m_translation[index] = XMFLOAT4A(0.0f, 0.0f, 0.0f, 0.0f);
+	m_rotation[index] = XMFLOAT4A(0.0f, 0.0f, 0.0f, 1.0f);
+	m_scale[index] = XMFLOAT4A(1.0f, 1.0f, 1.0f, 1.0f);
+	// Whatever the slot held before, a new local version makes the world matrix stale
+	m_localVersion[index]++;
+	m_cachedFlags[index] = 0;
+	m_parent[index] = TRANSFORM_NONE;
+	m_firstChild[index] = TRANSFORM_NONE;
+	m_nextSibling[index] = TRANSFORM_NONE;
+	m_prevSibling[index] = TRANSFORM_NONE;
+	m_owner[index] = owner;
+
+	m_count++;
+	m_orderDirty = true;
+
+	return ((THANDLE)m_generation[index] << THANDLE_INDEX_BITS) | index;
+}
+
+void TransformSystem::Destroy(THANDLE handle)
+{
+	assert(IsValid(handle));
+	unsigned int index = GetIndex(handle);
+
+	// Orphan the children. They keep their local values, which now mean world values.
+	unsigned int child = m_firstChild[index];
+	while (child != TRANSFORM_NONE)
+	{
+		unsigned int next = m_nextSibling[child];
+		m_parent[child] = TRANSFORM_NONE;
+		m_prevSibling[child] = TRANSFORM_NONE;
+		m_nextSibling[child] = TRANSFORM_NONE;
+		m_localVersion[child]++;
+		child = next;
+	}
+	m_firstChild[index] = TRANSFORM_NONE;
+
+	Unlink(index);
+
+	m_owner[index] = nullptr;
+	m_generation[index] = (m_generation[index] % THANDLE_GENERATION_MASK) + 1;
+	m_nextSibling[index] = m_freeHead;
+	m_freeHead = index;
+
+	m_count--;
+	m_orderDirty = true;
+}
+
+void TransformSystem::SetParent(unsigned int index, unsigned int parent)
+{
+	if (m_parent[index] == parent)
+		return;
+
+	Unlink(index);
+	if (parent != TRANSFORM_NONE)
+		Link(index, parent);
+
+	m_localVersion[index]++;
+	m_orderDirty = true;
+}
+
+bool TransformSystem::IsValid(THANDLE handle) const
+{
+	unsigned int index = handle & THANDLE_INDEX_MASK;
+	return index < m_owner.size() && m_owner[index] && m_generation[index] == (handle >> THANDLE_INDEX_BITS);
+}
+
+unsigned int TransformSystem::GetIndex(THANDLE handle) const
+{
+	return handle & THANDLE_INDEX_MASK;
+}
+
+Transform* TransformSystem::Get(THANDLE handle) const
+{
+	return IsValid(handle) ? m_owner[GetIndex(handle)] : nullptr;
+}
+
+void TransformSystem::UpdateAll()
+{
+	AllocationScope allocScope(ALLOC_TAG::TRANSFORM);
+
+	if (m_orderDirty)
+		RebuildOrder();
+
+	// Local matrices don't depend on anything else, so all the ones that changed can be rebuilt in batches first
+	m_batch.clear();
+	for (unsigned int index : m_order)
+	{
+		if (m_localMatrixVersion[index] != m_localVersion[index])
+			m_batch.push_back(index);
+	}
+
+	unsigned int batched = (unsigned int)m_batch.size() & ~3U;
+	for (unsigned int i = 0; i < batched; i += 4)
+		BuildLocalMatrices4(&m_batch[i]);
+	for (unsigned int i = batched; i < m_batch.size(); i++)
+		BuildLocalMatrix(m_batch[i]);
+
+	// Parents come first, so by the time a child is reached its parent's world matrix (and version) is already current
+	for (unsigned int index : m_order)
+	{
+		if (IsStale(index))
+			BuildWorldMatrix(index);
+	}
+}
+
+unsigned int TransformSystem::Count() const
+{
+	return m_count;
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "Singleton.h"
+#include "EngineMath.h"
+#include "AlignedAllocator.h"
+#include <vector>
+
+class Transform;
+
+// Handles are 32 bits: the low 20 bits index the transform arrays, the high 12 bits hold the generation of the slot.
+// Generations start at 1, so 0 is never a valid handle.
+typedef unsigned int THANDLE;
+#define INVALID_THANDLE 0U
+#define THANDLE_INDEX_BITS 20
+#define THANDLE_INDEX_MASK ((1U << THANDLE_INDEX_BITS) - 1)
+#define THANDLE_GENERATION_MASK ((1U << (32 - THANDLE_INDEX_BITS)) - 1)
+
+// Marks "no transform" in the parent/child/sibling arrays
+#define TRANSFORM_NONE 0xFFFFFFFF
+
+// Owns the data of every Transform. Instead of each Transform allocating its own aligned block and keeping a list of
+// its children, everything lives here in parallel arrays (one entry per transform) so a whole scene's transforms
+// sit in a handful of contiguous allocations. Transform is just a handle into these arrays with the same API it
+// always had.
+//
+// Children are kept as an intrusive linked list through the sibling arrays, and m_order lists every transform with
+// parents ahead of their children so world matrices can be brought up to date front to back in one pass.
+class TransformSystem : public Singleton<TransformSystem>
+{
+	friend class Transform;
+
+private:
+	template <typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T, 16>>;
+
+	// Vectors are kept as XMFLOAT4A and loaded and stored where they're used. An XMVECTOR can be an intrinsic type whose
+	// alignment attribute gets dropped as a template argument, where XMFLOAT4A is a plain struct that keeps it.
+
+	// Local position, rotation (quaternion), and scale
+	AlignedVector<DirectX::XMFLOAT4A> m_translation;
+	AlignedVector<DirectX::XMFLOAT4A> m_rotation;
+	AlignedVector<DirectX::XMFLOAT4A> m_scale;
+
+	// Scale * rotation * translation, kept around so a world matrix that only went stale because its parent moved
+	// doesn't have to rebuild it
+	AlignedVector<DirectX::XMMATRIX> m_localMatrix;
+
+	// Values derived from the local values and the parent, recalculated lazily
+	AlignedVector<DirectX::XMMATRIX> m_worldMatrix;
+	AlignedVector<DirectX::XMMATRIX> m_inverseWorldMatrix;
+	AlignedVector<DirectX::XMMATRIX> m_inverseTransposeWorldMatrix;
+	AlignedVector<DirectX::XMFLOAT4A> m_translationWorld;
+	AlignedVector<DirectX::XMFLOAT4A> m_rotationWorld;
+	AlignedVector<DirectX::XMFLOAT4A> m_scaleWorld;
+	AlignedVector<DirectX::XMFLOAT4A> m_upVector;
+	AlignedVector<DirectX::XMFLOAT4A> m_rightVector;
+	AlignedVector<DirectX::XMFLOAT4A> m_forwardVector;
+
+	// Change tracking. Instead of pushing dirty flags down the hierarchy on every write, each transform bumps its own
+	// local version when it changes, and its world version whenever its world matrix is rebuilt. A world matrix
+	// remembers which local version and which parent world version it was built from, so it is stale exactly when
+	// either of those has moved on. Writes are O(1) and nothing is traversed until somebody reads.
+	std::vector<unsigned int> m_localVersion;
+	std::vector<unsigned int> m_localMatrixVersion;
+	std::vector<unsigned int> m_worldVersion;
+	std::vector<unsigned int> m_builtLocalVersion;
+	std::vector<unsigned int> m_builtParentVersion;
+
+	// Set when this transform and every one above it has the same scale on all three axes, which makes the upper 3x3
+	// of the world matrix a rotation times a single scale factor. Worked out along with the world matrix.
+	std::vector<unsigned char> m_uniformScale;
+
+	// The other cached values (inverse, world position, up, etc.) are valid for a single world version. m_cachedFlags
+	// holds a Transform::CACHED_VALUE bit for each one that has been calculated for m_cacheVersion.
+	std::vector<unsigned int> m_cacheVersion;
+	std::vector<unsigned int> m_cachedFlags;
+
+	// Hierarchy
+	std::vector<unsigned int> m_parent;
+	std::vector<unsigned int> m_firstChild;
+	std::vector<unsigned int> m_nextSibling;
+	std::vector<unsigned int> m_prevSibling;
+
+	// Bookkeeping for the slots themselves. Free slots are chained through m_nextSibling.
+	std::vector<Transform*> m_owner;
+	std::vector<unsigned short> m_generation;
+	unsigned int m_freeHead;
+	unsigned int m_count;
+
+	// Every live transform, parents before children. Rebuilt lazily whenever the hierarchy changes.
+	std::vector<unsigned int> m_order;
+	std::vector<unsigned int> m_orderStack;
+	bool m_orderDirty;
+
+	// Scratch list of transforms whose local matrix UpdateAll needs to rebuild
+	std::vector<unsigned int> m_batch;
+
+	unsigned int AddSlot();
+	void Link(unsigned int child, unsigned int parent);
+	void Unlink(unsigned int child);
+	void RebuildOrder();
+
+	bool IsStale(unsigned int index) const;
+	void BuildLocalMatrix(unsigned int index);
+	void BuildLocalMatrices4(const unsigned int* indices);
+	void BuildWorldMatrix(unsigned int index);
+
+	// Brings the world matrix of a single transform (and its ancestors) up to date
+	void Refresh(unsigned int index);
+
+public:
+	explicit TransformSystem(unsigned int initialCapacity = 1024);
+	~TransformSystem();
+
+	// Claims a slot for a Transform and resets it to the identity
+	THANDLE Create(Transform* owner);
+
+	// Frees the slot. Children of the transform are left without a parent.
+	void Destroy(THANDLE handle);
+
+	// Moves a transform (and its children) under a new parent, or makes it a root if parent is TRANSFORM_NONE
+	void SetParent(unsigned int index, unsigned int parent);
+
+	bool IsValid(THANDLE handle) const;
+	unsigned int GetIndex(THANDLE handle) const;
+	Transform* Get(THANDLE handle) const;
+
+	// Brings every world matrix up to date. Meant to be called once a frame after the game has moved things and before
+	// anything is rendered, so the reads during rendering find everything current. Local matrices are rebuilt four at
+	// a time, then world matrices in one pass over the hierarchy order.
+	void UpdateAll();
+
+	unsigned int Count() const;
+
+	static TransformSystem& GetSingleton(void);
+	static TransformSystem* GetSingletonPtr(void);
+};
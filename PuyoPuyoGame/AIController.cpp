@@ -1,9 +1,17 @@
 #include "PuyoPuyoGamePCH.h"
 #include "AIController.h"
+#include "LuaProfiler.h"
+#include "PuyoGame.h"
 
 
 AIController::AIController()
+	: m_luaState(nullptr)
+	, m_profiler(nullptr)
+	, m_instanceID(0)
+	, m_hasUnit(false)
 {
+	m_nextMove.x = (int)PUYO_SPAWN_X;
+	m_nextMove.orientation = ORIENT_UP;
 }
 
 
@@ -11,21 +19,109 @@ AIController::~AIController()
 {
 }
 
-void AIController::Initialize(int id)
+// ***************************************************************
+// PRIVATE FUNCTIONS
+// ***************************************************************
+
+void AIController::DetermineMove(const UnitState& unit)
+{
+	const PuyoInstance* instance = PuyoGame::GetSingleton().GetInstance((uint8_t)m_instanceID);
+
+	PuyoBoard board;
+	board.Load(instance->GetGrid());
+	m_planner.Analyze(board, unit);
+
+	// Without a script the unit just drops where it spawned
+	m_nextMove.x = unit.x;
+	m_nextMove.orientation = unit.orientation;
+
+	lua_getglobal(m_luaState, "DetermineMove");
+	if (!lua_isfunction(m_luaState, -1))
+	{
+		lua_pop(m_luaState, 1);
+	}
+	else
+	{
+		lua_pushinteger(m_luaState, m_instanceID);
+		if (lua_pcall(m_luaState, 1, 2, 0) == 0)
+		{
+			m_nextMove.x = (int)lua_tointeger(m_luaState, -2);
+			m_nextMove.orientation = (int)lua_tointeger(m_luaState, -1);
+			lua_pop(m_luaState, 2);
+		}
+		else
+		{
+			printf("AI %d: %s\n", m_instanceID, lua_tostring(m_luaState, -1));
+			lua_pop(m_luaState, 1);
+		}
+	}
+
+	if (!m_planner.SetTarget(m_nextMove))
+	{
+		printf("AI %d: placement (%d, %d) can't be reached\n", m_instanceID, m_nextMove.x, m_nextMove.orientation);
+	}
+}
+
+void AIController::DetermineInput(const UnitState& unit)
+{
+	bool fall = false;
+	switch (m_planner.NextInput(unit, fall))
+	{
+		case INPUT_LEFT:	m_controlFlags[MOVE_LEFT] = true; break;
+		case INPUT_RIGHT:	m_controlFlags[MOVE_RIGHT] = true; break;
+		case INPUT_FLIP:	m_controlFlags[FLIP] = true; break;
+		default: break;
+	}
+
+	m_controlFlags[FALL] = fall;
+}
+
+// ***************************************************************
+// PUBLIC FUNCTIONS
+// ***************************************************************
+
+void AIController::Initialize(int id, bool profile)
 {
 	m_instanceID = id;
+	m_hasUnit = false;
+	m_planner.ClearPlan();
 
 	// Initialize the LUA instance, register functions, etc.
 	m_luaState = lua_open();
+
+	// Send lua's memory through the allocation tracker so it shows up under its own tag
+	lua_setallocf(m_luaState, AllocationTracker::LuaAlloc, nullptr);
 	luaL_openlibs(m_luaState);
+
+	if (profile)
+	{
+		m_profiler = new LuaProfiler();
+		m_profiler->Attach(m_luaState);
+	}
+
+	RegisterAIBridge(m_luaState, m_profiler);
 }
 
 void AIController::Cleanup()
 {
+	if (m_profiler)
+	{
+		m_profiler->PrintReport();
+
+		char path[32];
+		snprintf(path, sizeof(path), "AIProfile%d.folded", m_instanceID);
+		m_profiler->WriteFoldedStacks(path);
+
+		m_profiler->Detach();
+	}
+
 	// Shut down the LUA instance and stuff...
 	lua_close(m_luaState);
-}
+	m_luaState = nullptr;
 
+	delete m_profiler;
+	m_profiler = nullptr;
+}
 
 bool AIController::MoveLeft() const
 {
@@ -49,11 +145,32 @@ bool AIController::Fall() const
 
 void AIController::Update(double dt)
 {
+	AllocationScope allocScope(ALLOC_TAG::AI);
+
 	ClearControlFlags();
 
-	// Ask AI to calculate a move location
-	// (Push ID to stack, call AI update, pull results off the stack)
-	
-	// Ask AI to tell us what button to press using move location
-	// (Push destination/orientation and elapsed time since last move to stack, call AI move, pull result off the stack)
+	if (m_profiler)
+		m_profiler->BeginDecision();
+
+	int unit[5];
+	bool hasUnit = PuyoGame::GetSingleton().GetInstance((uint8_t)m_instanceID)->GetCurrentUnit(unit);
+
+	if (hasUnit)
+	{
+		UnitState state;
+		state.x = unit[0];
+		state.row = unit[1];
+		state.orientation = unit[2];
+
+		// Ask AI to calculate a move location once per unit
+		if (!m_hasUnit)
+			DetermineMove(state);
+
+		// The planner already knows the way, so this is just the next press
+		DetermineInput(state);
+	}
+	m_hasUnit = hasUnit;
+
+	if (m_profiler)
+		m_profiler->EndDecision();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "PuyoController.h"
 #include "LuaAIBridge.h"
+#include "InputPlanner.h"
 #include <lua.hpp>
 
 class AIController : public PuyoController
@@ -9,6 +10,7 @@ private:
 
 	// TODO: Add lua instance and other stuff
 	lua_State* m_luaState;
+	LuaProfiler* m_profiler; // Only created when profiling is requested
 
 	enum CONTROL_FLAGS
 	{
@@ -27,12 +29,14 @@ private:
 			m_controlFlags[i] = false;
 	}
 
-	// TODO: Add new functions for calling the LUA AI functions
-	int m_nextMove[3]; // This is where the next move will be laid out (x, y, orientation)... Or I could just use the LUA stack... We will see when I get there.
+	// The placement picked for the current unit, and the planner that steers the unit there one press per frame
+	Placement m_nextMove;
+	InputPlanner m_planner;
+	bool m_hasUnit; // Whether a unit was under control last frame. A new unit means a new move.
 
-	// IDEA: There is probably no need to actually make this two steps in the C++ code. I can probably do the whole update in LUA and just return which buttons are down.
-	void DetermineMove();
-	void DetermineInput();
+	// Asks the lua AI where the unit should go (DetermineMove(instanceID) -> x, orientation) and plans the inputs
+	void DetermineMove(const UnitState& unit);
+	void DetermineInput(const UnitState& unit);
 
 public:
 	AIController();
@@ -44,8 +48,11 @@ public:
 	bool Fall() const final;
 
 	// TODO: Add difficulty parameter to initialize
-	void Initialize(int id);
+	// If profile is true, lua time, bridge calls, allocations and GC are measured per decision and reported in Cleanup.
+	void Initialize(int id, bool profile = false);
 	void Cleanup();
+
+	// Should run before the PuyoInstance it controls updates, so the inputs apply on the same frame
 	void Update(double dt);
 };
 
@@ -0,0 +1,403 @@
+#pragma once
+#include "ObjectPool.h"
+#include "AlignedAllocator.h"
+#include <atomic>
+#include <mutex>
+
+// Upper bounds for ConcurrentObjectPool. Up to POOL_MAX_THREADS threads at a time get a cache of their own in every
+// pool, and blocks are tracked in a fixed array so readers never see it reallocate.
+#define POOL_MAX_THREADS 64
+#define POOL_MAX_BLOCKS 1024
+#define POOL_CACHE_SIZE 32
+
+// A thread's number for finding its cache in a pool. A thread takes the lowest number nobody else has the first time
+// it asks and gives it back when it exits, so the next thread to take it carries on with the caches (and the free
+// slots in them) the last one left behind. Threads past the first POOL_MAX_THREADS alive at once get
+// POOL_MAX_THREADS, which means no cache.
+class PoolThreadSlot
+{
+private:
+	unsigned int m_index;
+
+	static std::atomic<bool>* GetTaken()
+	{
+		static std::atomic<bool> s_taken[POOL_MAX_THREADS];
+		return s_taken;
+	}
+
+public:
+	PoolThreadSlot()
+		: m_index(POOL_MAX_THREADS)
+	{
+		std::atomic<bool>* taken = GetTaken();
+		for (unsigned int i = 0; i < POOL_MAX_THREADS; i++)
+		{
+			bool expected = false;
+			if (!taken[i].load(std::memory_order_relaxed) && taken[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+			{
+				m_index = i;
+				break;
+			}
+		}
+	}
+
+	~PoolThreadSlot()
+	{
+		// Release so whoever takes the number next sees everything this thread left in its caches
+		if (m_index < POOL_MAX_THREADS)
+			GetTaken()[m_index].store(false, std::memory_order_release);
+	}
+
+	unsigned int GetIndex() const { return m_index; }
+
+	PoolThreadSlot(const PoolThreadSlot&) = delete;
+	PoolThreadSlot& operator=(const PoolThreadSlot&) = delete;
+};
+
+inline unsigned int PoolThreadIndex()
+{
+	static thread_local PoolThreadSlot t_slot;
+	return t_slot.GetIndex();
+}
+
+// A thread safe counterpart to ObjectPool with the same interface and the same handles.
+//
+// Each thread allocates from and frees into its own cache of free slots, so the common case doesn't touch anything
+// shared. A thread without a cache (see PoolThreadSlot) goes straight to the global list instead. Caches refill from (and spill half of themselves back into) a global free list, which is a lock-free stack
+// whose head carries a tag that changes on every pop, so a slot that gets popped and pushed back between another
+// thread's read and compare-exchange can't corrupt it. Slots are never returned to the system, which is what makes
+// reading a stale next pointer harmless. The only lock is taken while adding a block.
+//
+// ForEach is not safe to call while other threads are allocating or freeing.
+template <typename T>
+class ConcurrentObjectPool
+{
+private:
+	struct Slot
+	{
+		// The object has to come first so a T* can be turned back into its slot
+		typename std::aligned_storage<sizeof(T), __alignof(T)>::type storage;
+		unsigned int index;
+		std::atomic<unsigned int> nextFree;
+		std::atomic<unsigned int> state; // generation << 1 | alive
+	};
+
+	// Padded out to a cache line so threads don't fight over each other's caches
+	struct alignas(64) ThreadCache
+	{
+		unsigned int slots[POOL_CACHE_SIZE];
+		unsigned int count;
+
+		// How many more objects this thread has allocated than freed. Only the thread itself writes it, so keeping
+		// count doesn't need a read-modify-write on a shared counter.
+		std::atomic<int> liveCount;
+	};
+
+	static const unsigned int k_noSlot = 0xFFFFFFFF;
+
+	unsigned int m_blockSize;
+	std::atomic<Slot*> m_blocks[POOL_MAX_BLOCKS];
+	std::atomic<unsigned int> m_blockCount;
+	std::mutex m_growLock;
+
+	// Low 32 bits: index of the first free slot. High 32 bits: tag, bumped on every pop.
+	std::atomic<unsigned long long> m_freeHead;
+	std::atomic<int> m_uncachedLiveCount; // The same for all the threads without a cache
+
+	// Allocated on its own rather than inline, so the pool (and whatever holds it) doesn't need over-aligned new,
+	// which only turns up in C++17
+	ThreadCache* m_caches;
+
+	void CountLive(unsigned int threadIndex, int change)
+	{
+		if (threadIndex < POOL_MAX_THREADS)
+		{
+			std::atomic<int>& liveCount = m_caches[threadIndex].liveCount;
+			liveCount.store(liveCount.load(std::memory_order_relaxed) + change, std::memory_order_relaxed);
+		}
+		else
+			m_uncachedLiveCount.fetch_add(change, std::memory_order_relaxed);
+	}
+
+	Slot& GetSlot(unsigned int index) const
+	{
+		return m_blocks[index / m_blockSize].load(std::memory_order_acquire)[index % m_blockSize];
+	}
+
+	static Slot* ToSlot(const T* object)
+	{
+		return reinterpret_cast<Slot*>(const_cast<T*>(object));
+	}
+
+	// Pushes a chain of slots, already linked first -> ... -> last, onto the global list
+	void PushChain(unsigned int first, unsigned int last)
+	{
+		Slot& tail = GetSlot(last);
+		unsigned long long head = m_freeHead.load(std::memory_order_relaxed);
+		unsigned long long next;
+		do
+		{
+			tail.nextFree.store((unsigned int)head, std::memory_order_relaxed);
+			next = (head & 0xFFFFFFFF00000000ULL) | first;
+		} while (!m_freeHead.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	unsigned int Pop()
+	{
+		unsigned long long head = m_freeHead.load(std::memory_order_acquire);
+		unsigned long long next;
+		do
+		{
+			unsigned int index = (unsigned int)head;
+			if (index == k_noSlot)
+				return k_noSlot;
+
+			unsigned long long tag = (head >> 32) + 1;
+			next = (tag << 32) | GetSlot(index).nextFree.load(std::memory_order_relaxed);
+		} while (!m_freeHead.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire));
+
+		return (unsigned int)head;
+	}
+
+	// Returns false if there's no room for another block or it couldn't be allocated. The pool is left as it was.
+	bool Grow()
+	{
+		std::lock_guard<std::mutex> lock(m_growLock);
+
+		// Somebody else may have grown the pool (or freed plenty) while we waited
+		if ((unsigned int)m_freeHead.load(std::memory_order_acquire) != k_noSlot)
+			return true;
+
+		unsigned int blockIndex = m_blockCount.load(std::memory_order_relaxed);
+		assert(blockIndex < POOL_MAX_BLOCKS && "ConcurrentObjectPool ran out of blocks");
+		if (blockIndex >= POOL_MAX_BLOCKS)
+			return false;
+
+		unsigned int first = blockIndex * m_blockSize;
+		assert(first + m_blockSize - 1 <= PHANDLE_INDEX_MASK && "ConcurrentObjectPool ran out of handle bits");
+
+		Slot* block = reinterpret_cast<Slot*>(malloc(m_blockSize * sizeof(Slot)));
+		if (!block)
+		{
+			assert(!"ConcurrentObjectPool couldn't allocate another block");
+			return false;
+		}
+
+		for (unsigned int i = 0; i < m_blockSize; i++)
+		{
+			Slot* slot = new(&block[i]) Slot;
+			slot->index = first + i;
+			slot->state.store(1 << 1, std::memory_order_relaxed);
+			slot->nextFree.store(i + 1 < m_blockSize ? first + i + 1 : k_noSlot, std::memory_order_relaxed);
+		}
+
+		// Publish the block before any of its slots can be found through the free list or a handle
+		m_blocks[blockIndex].store(block, std::memory_order_release);
+		m_blockCount.store(blockIndex + 1, std::memory_order_release);
+
+		PushChain(first, first + m_blockSize - 1);
+		return true;
+	}
+
+public:
+	// blockSize is how many objects the pool starts with, and how many more it makes room for whenever it runs out
+	explicit ConcurrentObjectPool(unsigned int blockSize)
+		: m_blockSize(blockSize)
+		, m_blockCount(0)
+		, m_freeHead(k_noSlot)
+		, m_uncachedLiveCount(0)
+		, m_caches(reinterpret_cast<ThreadCache*>(AlignedMalloc(POOL_MAX_THREADS * sizeof(ThreadCache), alignof(ThreadCache))))
+	{
+		assert(blockSize > 0);
+		assert(m_caches);
+
+		for (unsigned int i = 0; i < POOL_MAX_BLOCKS; i++)
+			m_blocks[i].store(nullptr, std::memory_order_relaxed);
+		for (unsigned int i = 0; i < POOL_MAX_THREADS; i++)
+		{
+			new (&m_caches[i]) ThreadCache();
+			m_caches[i].count = 0;
+			m_caches[i].liveCount.store(0, std::memory_order_relaxed);
+		}
+
+		Grow();
+	}
+
+	~ConcurrentObjectPool()
+	{
+		ForEach([](T* object) { object->~T(); });
+
+		unsigned int blockCount = m_blockCount.load();
+		for (unsigned int i = 0; i < blockCount; i++)
+			free(m_blocks[i].load());
+
+		for (unsigned int i = 0; i < POOL_MAX_THREADS; i++)
+			m_caches[i].~ThreadCache();
+		AlignedFree(m_caches);
+	}
+
+	ConcurrentObjectPool(const ConcurrentObjectPool&) = delete;
+	ConcurrentObjectPool& operator=(const ConcurrentObjectPool&) = delete;
+
+	// If every slot is taken, another block is added. Returns nullptr only if that block couldn't be allocated.
+	T* AllocObject(PHANDLE* handle = nullptr)
+	{
+		unsigned int threadIndex = PoolThreadIndex();
+		unsigned int index;
+		if (threadIndex < POOL_MAX_THREADS)
+		{
+			ThreadCache& cache = m_caches[threadIndex];
+
+			// Refill half the cache at a time, so a thread that alternates between allocating and freeing doesn't
+			// bounce slots to and from the global list
+			while (cache.count < POOL_CACHE_SIZE / 2)
+			{
+				unsigned int popped = Pop();
+				if (popped == k_noSlot)
+				{
+					if (cache.count > 0)
+						break;
+
+					if (!Grow())
+						return nullptr;
+					continue;
+				}
+
+				cache.slots[cache.count++] = popped;
+			}
+
+			index = cache.slots[--cache.count];
+		}
+		else
+		{
+			while ((index = Pop()) == k_noSlot)
+			{
+				if (!Grow())
+					return nullptr;
+			}
+		}
+
+		Slot& slot = GetSlot(index);
+		unsigned int generation = slot.state.load(std::memory_order_relaxed) >> 1;
+		CountLive(threadIndex, 1);
+
+		T* object = new(&slot.storage)T();
+
+		// Only mark it alive once it's constructed, so Get on another thread never sees a half built object
+		slot.state.store((generation << 1) | 1, std::memory_order_release);
+
+		if (handle)
+			*handle = ((PHANDLE)generation << PHANDLE_INDEX_BITS) | slot.index;
+
+		return object;
+	}
+
+	void FreeObject(T* object)
+	{
+		assert(IsAlive(object) && "Object freed twice or not from this pool");
+
+		Slot* slot = ToSlot(object);
+		unsigned int generation = slot->state.load(std::memory_order_relaxed) >> 1;
+		generation = (generation % PHANDLE_GENERATION_MASK) + 1;
+		slot->state.store(generation << 1, std::memory_order_release);
+
+		// Call the object's destructor before pushing it back into the list.
+		object->~T();
+
+		unsigned int threadIndex = PoolThreadIndex();
+		CountLive(threadIndex, -1);
+		if (threadIndex >= POOL_MAX_THREADS)
+		{
+			PushChain(slot->index, slot->index);
+			return;
+		}
+
+		ThreadCache& cache = m_caches[threadIndex];
+		if (cache.count == POOL_CACHE_SIZE)
+		{
+			// Hand the older half back to everyone else as one chain
+			unsigned int half = POOL_CACHE_SIZE / 2;
+			for (unsigned int i = 0; i + 1 < half; i++)
+				GetSlot(cache.slots[i]).nextFree.store(cache.slots[i + 1], std::memory_order_relaxed);
+
+			PushChain(cache.slots[0], cache.slots[half - 1]);
+
+			for (unsigned int i = half; i < POOL_CACHE_SIZE; i++)
+				cache.slots[i - half] = cache.slots[i];
+			cache.count -= half;
+		}
+
+		cache.slots[cache.count++] = slot->index;
+	}
+
+	// Returns the handle of a live object from this pool
+	PHANDLE GetHandle(const T* object) const
+	{
+		const Slot* slot = ToSlot(object);
+		unsigned int generation = slot->state.load(std::memory_order_acquire) >> 1;
+		return ((PHANDLE)generation << PHANDLE_INDEX_BITS) | slot->index;
+	}
+
+	// Returns the object the handle refers to, or nullptr if it has been freed. Another thread can still free it
+	// right after this returns, so handles shared between threads need some ownership agreement of their own.
+	T* Get(PHANDLE handle) const
+	{
+		unsigned int index = handle & PHANDLE_INDEX_MASK;
+		if (index >= Capacity())
+			return nullptr;
+
+		Slot& slot = GetSlot(index);
+		unsigned int state = slot.state.load(std::memory_order_acquire);
+		if (!(state & 1) || (state >> 1) != (handle >> PHANDLE_INDEX_BITS))
+			return nullptr;
+
+		return reinterpret_cast<T*>(&slot.storage);
+	}
+
+	bool IsValid(PHANDLE handle) const
+	{
+		return Get(handle) != nullptr;
+	}
+
+	// Checks that a raw pointer still points at a live object from this pool. Catches use after FreeObject.
+	bool IsAlive(const T* object) const
+	{
+		const Slot* slot = ToSlot(object);
+		unsigned int blockCount = m_blockCount.load(std::memory_order_acquire);
+		for (unsigned int i = 0; i < blockCount; i++)
+		{
+			const Slot* block = m_blocks[i].load(std::memory_order_acquire);
+			if (slot >= block && slot < block + m_blockSize)
+				return (slot->state.load(std::memory_order_acquire) & 1) != 0;
+		}
+
+		return false;
+	}
+
+	// Calls func(T*) for every live object, in slot order
+	template <typename F>
+	void ForEach(F func) const
+	{
+		unsigned int blockCount = m_blockCount.load(std::memory_order_acquire);
+		for (unsigned int b = 0; b < blockCount; b++)
+		{
+			Slot* block = m_blocks[b].load(std::memory_order_acquire);
+			for (unsigned int i = 0; i < m_blockSize; i++)
+			{
+				if (block[i].state.load(std::memory_order_relaxed) & 1)
+					func(reinterpret_cast<T*>(&block[i].storage));
+			}
+		}
+	}
+
+	// Only exact while no other thread is allocating or freeing
+	unsigned int Count() const
+	{
+		int count = m_uncachedLiveCount.load(std::memory_order_relaxed);
+		for (unsigned int i = 0; i < POOL_MAX_THREADS; i++)
+			count += m_caches[i].liveCount.load(std::memory_order_relaxed);
+
+		return (unsigned int)count;
+	}
+	unsigned int Capacity() const { return m_blockCount.load(std::memory_order_acquire) * m_blockSize; }
+};
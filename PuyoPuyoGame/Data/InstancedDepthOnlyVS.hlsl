@@ -0,0 +1,29 @@
+cbuffer PerFrame : register(b0)
+{
+	matrix ViewProjectionMatrix;
+}
+
+// Reads the same instance data as InstancedPuyoVS, but only needs the world matrix out of it
+struct AppData
+{
+	float3 Position : POSITION;
+	float3 World0   : WORLD0;
+	float3 World1   : WORLD1;
+	float3 World2   : WORLD2;
+	float3 World3   : WORLD3;
+};
+
+struct VertexShaderOutput
+{
+	float4 Position : SV_Position;
+};
+
+VertexShaderOutput main(AppData IN)
+{
+	VertexShaderOutput OUT;
+
+	float4x3 world = float4x3(IN.World0, IN.World1, IN.World2, IN.World3);
+	OUT.Position = mul(ViewProjectionMatrix, float4(mul(float4(IN.Position, 1.0f), world), 1.0f));
+
+	return OUT;
+}
\ No newline at end of file
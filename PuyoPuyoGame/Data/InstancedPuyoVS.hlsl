@@ -0,0 +1,44 @@
+cbuffer PerFrame : register(b0)
+{
+	matrix ViewProjectionMatrix;
+}
+
+// The mesh comes from slot 0 and each puyo's matrices from slot 1. World is the affine part of the world matrix, a row
+// per element, and NormalMatrix the upper 3x3 of its inverse transpose.
+struct AppData
+{
+	float3 Position       : POSITION;
+	float3 Normal         : NORMAL;
+	float2 TexCoord       : TEXCOORD;
+	float3 World0         : WORLD0;
+	float3 World1         : WORLD1;
+	float3 World2         : WORLD2;
+	float3 World3         : WORLD3;
+	float3 NormalMatrix0  : NORMALMATRIX0;
+	float3 NormalMatrix1  : NORMALMATRIX1;
+	float3 NormalMatrix2  : NORMALMATRIX2;
+};
+
+// Same outputs as SimpleVertexShader, so it goes with the same pixel shaders
+struct VertexShaderOutput
+{
+	float4 PositionWS   : TEXCOORD1;
+	float3 NormalWS     : TEXCOORD2;
+	float2 TexCoord     : TEXCOORD0;
+	float4 Position     : SV_Position;
+};
+
+VertexShaderOutput main(AppData IN)
+{
+	VertexShaderOutput OUT;
+
+	float4x3 world = float4x3(IN.World0, IN.World1, IN.World2, IN.World3);
+	float3x3 normalMatrix = float3x3(IN.NormalMatrix0, IN.NormalMatrix1, IN.NormalMatrix2);
+
+	OUT.PositionWS = float4(mul(float4(IN.Position, 1.0f), world), 1.0f);
+	OUT.Position = mul(ViewProjectionMatrix, OUT.PositionWS);
+	OUT.NormalWS = mul(IN.Normal, normalMatrix);
+	OUT.TexCoord = IN.TexCoord;
+
+	return OUT;
+}
\ No newline at end of file
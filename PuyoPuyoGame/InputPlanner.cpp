@@ -0,0 +1,309 @@
+#include "PuyoPuyoGamePCH.h"
+#include "InputPlanner.h"
+#include <string.h>
+
+// Offsets from the pivot to the hanging puyo for each UNIT_ORIENTATION
+static const int k_orientationX[UNIT_ORIENTATION_COUNT] = { 0, 1, 0, -1 };
+static const int k_orientationY[UNIT_ORIENTATION_COUNT] = { 1, 0, -1, 0 };
+
+InputPlanner::InputPlanner()
+	: m_planLength(0)
+	, m_planStep(0)
+	, m_hasPlan(false)
+{
+	m_searchStart.x = m_expected.x = (int)PUYO_SPAWN_X;
+	m_searchStart.row = m_expected.row = (int)PUYO_SPWAN_Y;
+	m_searchStart.orientation = m_expected.orientation = ORIENT_UP;
+	m_target.x = m_searchStart.x;
+	m_target.orientation = ORIENT_UP;
+
+	memset(m_parent, -1, sizeof(m_parent));
+	memset(m_placementState, -1, sizeof(m_placementState));
+}
+
+// ***************************************************************
+// PRIVATE FUNCTIONS
+// ***************************************************************
+
+int InputPlanner::StateIndex(int x, int row, int orientation)
+{
+	return (row * GRID_WIDTH + x) * UNIT_ORIENTATION_COUNT + orientation;
+}
+
+UnitState InputPlanner::StateFromIndex(int index)
+{
+	UnitState state;
+	state.orientation = index % UNIT_ORIENTATION_COUNT;
+	state.x = (index / UNIT_ORIENTATION_COUNT) % GRID_WIDTH;
+	state.row = index / (UNIT_ORIENTATION_COUNT * GRID_WIDTH);
+	return state;
+}
+
+// Same rules as PuyoGrid::CheckOpenSpace
+bool InputPlanner::IsOpen(int x, int y) const
+{
+	if (x < 0 || x >= GRID_WIDTH) return false;
+	if (y < 0 || y >= GRID_HEIGHT) return false;
+
+	return m_board.Get(x, y) == PUYO_COLOR::NONE;
+}
+
+bool InputPlanner::IsOpen(const UnitState& state) const
+{
+	return IsOpen(state.x, state.row) &&
+		IsOpen(state.x + k_orientationX[state.orientation], state.row + k_orientationY[state.orientation]);
+}
+
+bool InputPlanner::TryMove(const UnitState& from, PLANNER_INPUT input, UnitState& to) const
+{
+	to = from;
+	switch (input)
+	{
+		case INPUT_NONE:
+		{
+			to.row--;
+			return IsOpen(to);
+		}
+		case INPUT_LEFT:
+		{
+			to.x--;
+			return IsOpen(to);
+		}
+		case INPUT_RIGHT:
+		{
+			to.x++;
+			return IsOpen(to);
+		}
+		case INPUT_FLIP:
+		{
+			// Mirrors PuyoInstance::TryRotation: turn clockwise, kicking away from a wall or puyo if the hanging puyo
+			// only collides horizontally, otherwise keep turning until there is room.
+			int r = (from.orientation + 1) % UNIT_ORIENTATION_COUNT;
+			while (r != from.orientation && !IsOpen(from.x + k_orientationX[r], from.row + k_orientationY[r]))
+			{
+				if (k_orientationX[r] != 0 && IsOpen(from.x - k_orientationX[r], from.row - k_orientationY[r]))
+				{
+					to.x = from.x - k_orientationX[r];
+					to.row = from.row - k_orientationY[r];
+					to.orientation = r;
+					return true;
+				}
+
+				r = (r + 1) % UNIT_ORIENTATION_COUNT;
+			}
+
+			if (r == from.orientation)
+				return false;
+
+			to.orientation = r;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void InputPlanner::Search(const UnitState& start)
+{
+	static const PLANNER_INPUT k_inputs[] = { INPUT_LEFT, INPUT_RIGHT, INPUT_FLIP, INPUT_NONE };
+
+	m_searchStart = start;
+	memset(m_parent, -1, sizeof(m_parent));
+	memset(m_placementState, -1, sizeof(m_placementState));
+
+	short queue[PLANNER_STATE_COUNT];
+	int head = 0;
+	int tail = 0;
+
+	int startIndex = StateIndex(start.x, start.row, start.orientation);
+	m_parent[startIndex] = (short)startIndex;
+	m_parentInput[startIndex] = INPUT_NONE;
+	queue[tail++] = (short)startIndex;
+
+	while (head < tail)
+	{
+		int index = queue[head++];
+		UnitState state = StateFromIndex(index);
+
+		// Breadth first, so the first time a placement shows up is also the quickest way to get there
+		if (m_placementState[state.x][state.orientation] < 0)
+			m_placementState[state.x][state.orientation] = (short)index;
+
+		for (PLANNER_INPUT input : k_inputs)
+		{
+			UnitState next;
+			if (!TryMove(state, input, next))
+				continue;
+
+			int nextIndex = StateIndex(next.x, next.row, next.orientation);
+			if (m_parent[nextIndex] >= 0)
+				continue;
+
+			m_parent[nextIndex] = (short)index;
+			m_parentInput[nextIndex] = (unsigned char)input;
+			queue[tail++] = (short)nextIndex;
+		}
+	}
+}
+
+bool InputPlanner::BuildPlan(const Placement& target)
+{
+	m_target = target;
+	m_planLength = 0;
+	m_planStep = 0;
+	m_expected = m_searchStart;
+	m_hasPlan = false;
+
+	if (!IsReachable(target.x, target.orientation))
+		return false;
+
+	// Walk back from the target to the start, then flip the steps around
+	int index = m_placementState[target.x][target.orientation];
+	while (m_parent[index] != index)
+	{
+		m_plan[m_planLength].input = m_parentInput[index];
+		m_plan[m_planLength].row = (unsigned char)StateFromIndex(index).row;
+		m_planLength++;
+		index = m_parent[index];
+	}
+
+	for (int i = 0; i < m_planLength / 2; i++)
+	{
+		Step temp = m_plan[i];
+		m_plan[i] = m_plan[m_planLength - 1 - i];
+		m_plan[m_planLength - 1 - i] = temp;
+	}
+
+	m_hasPlan = true;
+	return true;
+}
+
+bool InputPlanner::Replan(const UnitState& current)
+{
+	Search(current);
+	return BuildPlan(m_target);
+}
+
+// ***************************************************************
+// PUBLIC FUNCTIONS
+// ***************************************************************
+
+void InputPlanner::Analyze(const PuyoBoard& board, const UnitState& start)
+{
+	m_board = board;
+	ClearPlan();
+	Search(start);
+}
+
+bool InputPlanner::IsReachable(int x, int orientation) const
+{
+	if (x < 0 || x >= GRID_WIDTH) return false;
+	if (orientation < 0 || orientation >= UNIT_ORIENTATION_COUNT) return false;
+
+	return m_placementState[x][orientation] >= 0;
+}
+
+int InputPlanner::GetReachablePlacements(Placement placements[MAX_PLACEMENTS]) const
+{
+	int count = 0;
+	for (int o = 0; o < UNIT_ORIENTATION_COUNT; o++)
+	{
+		for (int x = 0; x < GRID_WIDTH; x++)
+		{
+			if (m_placementState[x][o] < 0)
+				continue;
+
+			placements[count].x = x;
+			placements[count].orientation = o;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+bool InputPlanner::SetTarget(const Placement& target)
+{
+	return BuildPlan(target);
+}
+
+PLANNER_INPUT InputPlanner::NextInput(const UnitState& current, bool& fall)
+{
+	fall = false;
+
+	// Nowhere to go, so get it over with
+	if (!m_hasPlan)
+	{
+		fall = true;
+		return INPUT_NONE;
+	}
+
+	bool replanned = false;
+	while (m_planStep < m_planLength)
+	{
+		const Step& step = m_plan[m_planStep];
+
+		// Pressing too late is as bad as pressing the wrong thing. Either way, start over from where we actually are.
+		bool offPlan = current.x != m_expected.x || current.orientation != m_expected.orientation;
+		bool tooLow = step.input != INPUT_NONE && current.row < step.row;
+		if (offPlan || tooLow)
+		{
+			if (replanned || !Replan(current))
+			{
+				m_hasPlan = false;
+				fall = true;
+				return INPUT_NONE;
+			}
+
+			replanned = true;
+			continue;
+		}
+
+		// Gravity steps don't need a press, just time
+		if (step.input == INPUT_NONE)
+		{
+			if (current.row > step.row)
+				return INPUT_NONE;
+
+			m_expected.row = step.row;
+			m_planStep++;
+			continue;
+		}
+
+		UnitState next;
+		UnitState from = m_expected;
+		from.row = current.row;
+		if (!TryMove(from, (PLANNER_INPUT)step.input, next))
+			next = from;
+
+		m_expected = next;
+		m_planStep++;
+		return (PLANNER_INPUT)step.input;
+	}
+
+	// Out of steps. If the last press took, all that's left is to drop.
+	if (current.x == m_target.x && current.orientation == m_target.orientation)
+	{
+		fall = true;
+		return INPUT_NONE;
+	}
+
+	if (!replanned && Replan(current) && m_planLength > 0)
+		return NextInput(current, fall);
+
+	m_hasPlan = false;
+	fall = true;
+	return INPUT_NONE;
+}
+
+void InputPlanner::ClearPlan()
+{
+	m_planLength = 0;
+	m_planStep = 0;
+	m_hasPlan = false;
+}
+
+bool InputPlanner::HasPlan() const
+{
+	return m_hasPlan;
+}
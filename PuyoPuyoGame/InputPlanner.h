@@ -0,0 +1,91 @@
+#pragma once
+#include "PuyoBoard.h"
+
+// The presses a controller can make. PuyoInstance only acts on one of them per frame.
+enum PLANNER_INPUT
+{
+	INPUT_NONE,		// Wait for gravity to move the unit down a row
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_FLIP
+};
+
+// The state of a unit under player control. x and row are the grid cell of the pivot puyo.
+struct UnitState
+{
+	int x;
+	int row;
+	int orientation;
+};
+
+#define PLANNER_STATE_COUNT (GRID_WIDTH * GRID_HEIGHT * UNIT_ORIENTATION_COUNT)
+
+// Turns a target placement into the presses that get the current unit there.
+//
+// Every (column, row, orientation) a unit can occupy is a node in a graph. Left, right and flip are edges within a row
+// (flip follows the exact wall kick rules of PuyoInstance::TryRotation) and gravity is an edge to the row below. A
+// breadth first search from the unit's current state finds the shortest way to every reachable state at once, so
+// one search per unit answers both "can I get there?" for every placement and "how?" for the one that gets picked.
+// The chosen path is then fed to the controller one input per frame.
+class InputPlanner
+{
+private:
+	struct Step
+	{
+		unsigned char input;	// PLANNER_INPUT
+		unsigned char row;		// The row the unit must still be at for a press to be valid, or the row gravity takes it to
+	};
+
+	PuyoBoard m_board;
+
+	// Search results, indexed by StateIndex
+	short m_parent[PLANNER_STATE_COUNT];
+	unsigned char m_parentInput[PLANNER_STATE_COUNT];
+
+	// Closest reached state for each placement, or -1 if it can't be reached
+	short m_placementState[GRID_WIDTH][UNIT_ORIENTATION_COUNT];
+
+	Step m_plan[PLANNER_STATE_COUNT];
+	int m_planLength;
+	int m_planStep;
+	UnitState m_searchStart;
+	UnitState m_expected; // Where the unit should be before the next step runs
+	Placement m_target;
+	bool m_hasPlan;
+
+	static int StateIndex(int x, int row, int orientation);
+	static UnitState StateFromIndex(int index);
+
+	bool IsOpen(int x, int y) const;
+	bool IsOpen(const UnitState& state) const;
+	bool TryMove(const UnitState& from, PLANNER_INPUT input, UnitState& to) const;
+
+	void Search(const UnitState& start);
+	bool BuildPlan(const Placement& target);
+	bool Replan(const UnitState& current);
+
+public:
+	InputPlanner();
+
+	// Searches every state reachable by the unit on the given board. Must be called once per unit before the
+	// queries below. Does not pick a target.
+	void Analyze(const PuyoBoard& board, const UnitState& start);
+
+	// Valid after Analyze. Returns true if the unit can be steered into the given placement.
+	bool IsReachable(int x, int orientation) const;
+
+	// Fills placements with every placement the unit can reach. Returns the number written.
+	int GetReachablePlacements(Placement placements[MAX_PLACEMENTS]) const;
+
+	// Plans the shortest route to the target placement. Returns false if the placement can't be reached, in which
+	// case there is no plan and NextInput will just drop the unit where it is.
+	bool SetTarget(const Placement& target);
+
+	// Returns the input to send this frame given where the unit actually is. If the unit didn't end up where the
+	// plan said it would (a press was dropped, it fell past a row too early, etc.) the plan is rebuilt from there.
+	// fall is set once there is nothing left to do but drop.
+	PLANNER_INPUT NextInput(const UnitState& current, bool& fall);
+
+	void ClearPlan();
+	bool HasPlan() const;
+};
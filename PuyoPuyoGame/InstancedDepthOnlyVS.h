@@ -0,0 +1,261 @@
+#if 0
+//
+// Assembled from Data\InstancedDepthOnlyVS.hlsl. Building Debug|Win32 regenerates it with fxc.
+//
+//
+// Buffer Definitions: 
+//
+// cbuffer PerFrame
+// {
+//
+//   float4x4 ViewProjectionMatrix;     // Offset:    0 Size:    64
+//
+// }
+//
+//
+// Resource Bindings:
+//
+// Name                                 Type  Format         Dim Slot Elements
+// ------------------------------ ---------- ------- ----------- ---- --------
+// PerFrame                          cbuffer      NA          NA    0        1
+//
+//
+//
+// Input signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// POSITION                 0   xyz         0     NONE   float   xyz 
+// WORLD                    0   xyz         1     NONE   float   xyz 
+// WORLD                    1   xyz         2     NONE   float   xyz 
+// WORLD                    2   xyz         3     NONE   float   xyz 
+// WORLD                    3   xyz         4     NONE   float   xyz 
+//
+//
+// Output signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// SV_Position              0   xyzw        0      POS   float   xyzw
+//
+vs_4_0
+dcl_constantbuffer cb0[4], immediateIndexed
+dcl_input v0.xyz
+dcl_input v1.xyz
+dcl_input v2.xyz
+dcl_input v3.xyz
+dcl_input v4.xyz
+dcl_output_siv o0.xyzw, position
+dcl_temps 3
+mul r0.xyz, v0.xxxx, v1.xyzx
+mul r1.xyz, v0.yyyy, v2.xyzx
+add r0.xyz, r0.xyzx, r1.xyzx
+mul r1.xyz, v0.zzzz, v3.xyzx
+add r0.xyz, r0.xyzx, r1.xyzx
+add r0.xyz, r0.xyzx, v4.xyzx
+mov r0.w, l(1.000000)
+mul r1.xyzw, r0.xxxx, cb0[0].xyzw
+mul r2.xyzw, r0.yyyy, cb0[1].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mul r2.xyzw, r0.zzzz, cb0[2].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mul r2.xyzw, r0.wwww, cb0[3].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mov o0.xyzw, r1.xyzw
+ret 
+// Approximately 16 instruction slots used
+#endif
+
+const BYTE g_InstancedDepthOnlyVS[] =
+{
+     68,  88,  66,  67,  58, 180, 
+     78, 148, 165, 204,  13,  32, 
+     86,   2, 138,  45,  56, 220, 
+    238,  27,   1,   0,   0,   0, 
+    116,   4,   0,   0,   5,   0, 
+      0,   0,  52,   0,   0,   0, 
+     16,   1,   0,   0, 168,   1, 
+      0,   0, 220,   1,   0,   0, 
+    248,   3,   0,   0,  82,  68, 
+     69,  70, 212,   0,   0,   0, 
+      1,   0,   0,   0,  72,   0, 
+      0,   0,   1,   0,   0,   0, 
+     28,   0,   0,   0,   0,   4, 
+    254, 255,   4,   1,   0,   0, 
+    160,   0,   0,   0,  60,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   1,   0, 
+      0,   0,   1,   0,   0,   0, 
+     80, 101, 114,  70, 114,  97, 
+    109, 101,   0, 171, 171, 171, 
+     60,   0,   0,   0,   1,   0, 
+      0,   0,  96,   0,   0,   0, 
+     64,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+    120,   0,   0,   0,   0,   0, 
+      0,   0,  64,   0,   0,   0, 
+      2,   0,   0,   0, 144,   0, 
+      0,   0,   0,   0,   0,   0, 
+     86, 105, 101, 119,  80, 114, 
+    111, 106, 101,  99, 116, 105, 
+    111, 110,  77,  97, 116, 114, 
+    105, 120,   0, 171, 171, 171, 
+      3,   0,   3,   0,   4,   0, 
+      4,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,  77, 105, 
+     99, 114, 111, 115, 111, 102, 
+    116,  32,  40,  82,  41,  32, 
+     72,  76,  83,  76,  32,  83, 
+    104,  97, 100, 101, 114,  32, 
+     67, 111, 109, 112, 105, 108, 
+    101, 114,  32,  54,  46,  51, 
+     46,  57,  54,  48,  48,  46, 
+     49,  54,  51,  56,  52,   0, 
+    171, 171,  73,  83,  71,  78, 
+    144,   0,   0,   0,   5,   0, 
+      0,   0,   8,   0,   0,   0, 
+    128,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   0,   0, 
+      0,   0,   7,   7,   0,   0, 
+    137,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   1,   0, 
+      0,   0,   7,   7,   0,   0, 
+    137,   0,   0,   0,   1,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   2,   0, 
+      0,   0,   7,   7,   0,   0, 
+    137,   0,   0,   0,   2,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   3,   0, 
+      0,   0,   7,   7,   0,   0, 
+    137,   0,   0,   0,   3,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   4,   0, 
+      0,   0,   7,   7,   0,   0, 
+     80,  79,  83,  73,  84,  73, 
+     79,  78,   0,  87,  79,  82, 
+     76,  68,   0, 171,  79,  83, 
+     71,  78,  44,   0,   0,   0, 
+      1,   0,   0,   0,   8,   0, 
+      0,   0,  32,   0,   0,   0, 
+      0,   0,   0,   0,   1,   0, 
+      0,   0,   3,   0,   0,   0, 
+      0,   0,   0,   0,  15,   0, 
+      0,   0,  83,  86,  95,  80, 
+    111, 115, 105, 116, 105, 111, 
+    110,   0,  83,  72,  68,  82, 
+     20,   2,   0,   0,  64,   0, 
+      1,   0, 133,   0,   0,   0, 
+     89,   0,   0,   4,  70, 142, 
+     32,   0,   0,   0,   0,   0, 
+      4,   0,   0,   0,  95,   0, 
+      0,   3, 114,  16,  16,   0, 
+      0,   0,   0,   0,  95,   0, 
+      0,   3, 114,  16,  16,   0, 
+      1,   0,   0,   0,  95,   0, 
+      0,   3, 114,  16,  16,   0, 
+      2,   0,   0,   0,  95,   0, 
+      0,   3, 114,  16,  16,   0, 
+      3,   0,   0,   0,  95,   0, 
+      0,   3, 114,  16,  16,   0, 
+      4,   0,   0,   0, 103,   0, 
+      0,   4, 242,  32,  16,   0, 
+      0,   0,   0,   0,   1,   0, 
+      0,   0, 104,   0,   0,   2, 
+      3,   0,   0,   0,  56,   0, 
+      0,   7, 114,   0,  16,   0, 
+      0,   0,   0,   0,   6,  16, 
+     16,   0,   0,   0,   0,   0, 
+     70,  18,  16,   0,   1,   0, 
+      0,   0,  56,   0,   0,   7, 
+    114,   0,  16,   0,   1,   0, 
+      0,   0,  86,  21,  16,   0, 
+      0,   0,   0,   0,  70,  18, 
+     16,   0,   2,   0,   0,   0, 
+      0,   0,   0,   7, 114,   0, 
+     16,   0,   0,   0,   0,   0, 
+     70,   2,  16,   0,   0,   0, 
+      0,   0,  70,   2,  16,   0, 
+      1,   0,   0,   0,  56,   0, 
+      0,   7, 114,   0,  16,   0, 
+      1,   0,   0,   0, 166,  26, 
+     16,   0,   0,   0,   0,   0, 
+     70,  18,  16,   0,   3,   0, 
+      0,   0,   0,   0,   0,   7, 
+    114,   0,  16,   0,   0,   0, 
+      0,   0,  70,   2,  16,   0, 
+      0,   0,   0,   0,  70,   2, 
+     16,   0,   1,   0,   0,   0, 
+      0,   0,   0,   7, 114,   0, 
+     16,   0,   0,   0,   0,   0, 
+     70,   2,  16,   0,   0,   0, 
+      0,   0,  70,  18,  16,   0, 
+      4,   0,   0,   0,  54,   0, 
+      0,   5, 130,   0,  16,   0, 
+      0,   0,   0,   0,   1,  64, 
+      0,   0,   0,   0, 128,  63, 
+     56,   0,   0,   8, 242,   0, 
+     16,   0,   1,   0,   0,   0, 
+      6,   0,  16,   0,   0,   0, 
+      0,   0,  70, 142,  32,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,  56,   0,   0,   8, 
+    242,   0,  16,   0,   2,   0, 
+      0,   0,  86,   5,  16,   0, 
+      0,   0,   0,   0,  70, 142, 
+     32,   0,   0,   0,   0,   0, 
+      1,   0,   0,   0,   0,   0, 
+      0,   7, 242,   0,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   1,   0,   0,   0, 
+     70,  14,  16,   0,   2,   0, 
+      0,   0,  56,   0,   0,   8, 
+    242,   0,  16,   0,   2,   0, 
+      0,   0, 166,  10,  16,   0, 
+      0,   0,   0,   0,  70, 142, 
+     32,   0,   0,   0,   0,   0, 
+      2,   0,   0,   0,   0,   0, 
+      0,   7, 242,   0,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   1,   0,   0,   0, 
+     70,  14,  16,   0,   2,   0, 
+      0,   0,  56,   0,   0,   8, 
+    242,   0,  16,   0,   2,   0, 
+      0,   0, 246,  15,  16,   0, 
+      0,   0,   0,   0,  70, 142, 
+     32,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   0,   0, 
+      0,   7, 242,   0,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   1,   0,   0,   0, 
+     70,  14,  16,   0,   2,   0, 
+      0,   0,  54,   0,   0,   5, 
+    242,  32,  16,   0,   0,   0, 
+      0,   0,  70,  14,  16,   0, 
+      1,   0,   0,   0,  62,   0, 
+      0,   1,  83,  84,  65,  84, 
+    116,   0,   0,   0,  16,   0, 
+      0,   0,   3,   0,   0,   0, 
+      0,   0,   0,   0,   6,   0, 
+      0,   0,  13,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   1,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   2,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0
+};
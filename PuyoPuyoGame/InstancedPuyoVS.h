@@ -0,0 +1,373 @@
+#if 0
+//
+// Assembled from Data\InstancedPuyoVS.hlsl. Building Debug|Win32 regenerates it with fxc.
+//
+//
+// Buffer Definitions: 
+//
+// cbuffer PerFrame
+// {
+//
+//   float4x4 ViewProjectionMatrix;     // Offset:    0 Size:    64
+//
+// }
+//
+//
+// Resource Bindings:
+//
+// Name                                 Type  Format         Dim Slot Elements
+// ------------------------------ ---------- ------- ----------- ---- --------
+// PerFrame                          cbuffer      NA          NA    0        1
+//
+//
+//
+// Input signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// POSITION                 0   xyz         0     NONE   float   xyz 
+// NORMAL                   0   xyz         1     NONE   float   xyz 
+// TEXCOORD                 0   xy          2     NONE   float   xy  
+// WORLD                    0   xyz         3     NONE   float   xyz 
+// WORLD                    1   xyz         4     NONE   float   xyz 
+// WORLD                    2   xyz         5     NONE   float   xyz 
+// WORLD                    3   xyz         6     NONE   float   xyz 
+// NORMALMATRIX             0   xyz         7     NONE   float   xyz 
+// NORMALMATRIX             1   xyz         8     NONE   float   xyz 
+// NORMALMATRIX             2   xyz         9     NONE   float   xyz 
+//
+//
+// Output signature:
+//
+// Name                 Index   Mask Register SysValue  Format   Used
+// -------------------- ----- ------ -------- -------- ------- ------
+// TEXCOORD                 1   xyzw        0     NONE   float   xyzw
+// TEXCOORD                 2   xyz         1     NONE   float   xyz 
+// TEXCOORD                 0   xy          2     NONE   float   xy  
+// SV_Position              0   xyzw        3      POS   float   xyzw
+//
+vs_4_0
+dcl_constantbuffer cb0[4], immediateIndexed
+dcl_input v0.xyz
+dcl_input v1.xyz
+dcl_input v2.xy
+dcl_input v3.xyz
+dcl_input v4.xyz
+dcl_input v5.xyz
+dcl_input v6.xyz
+dcl_input v7.xyz
+dcl_input v8.xyz
+dcl_input v9.xyz
+dcl_output o0.xyzw
+dcl_output o1.xyz
+dcl_output o2.xy
+dcl_output_siv o3.xyzw, position
+dcl_temps 4
+mul r0.xyz, v0.xxxx, v3.xyzx
+mul r1.xyz, v0.yyyy, v4.xyzx
+add r0.xyz, r0.xyzx, r1.xyzx
+mul r1.xyz, v0.zzzz, v5.xyzx
+add r0.xyz, r0.xyzx, r1.xyzx
+add r0.xyz, r0.xyzx, v6.xyzx
+mov r0.w, l(1.000000)
+mul r1.xyzw, r0.xxxx, cb0[0].xyzw
+mul r2.xyzw, r0.yyyy, cb0[1].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mul r2.xyzw, r0.zzzz, cb0[2].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mul r2.xyzw, r0.wwww, cb0[3].xyzw
+add r1.xyzw, r1.xyzw, r2.xyzw
+mul r2.xyz, v1.xxxx, v7.xyzx
+mul r3.xyz, v1.yyyy, v8.xyzx
+add r2.xyz, r2.xyzx, r3.xyzx
+mul r3.xyz, v1.zzzz, v9.xyzx
+add r2.xyz, r2.xyzx, r3.xyzx
+mov o0.xyzw, r0.xyzw
+mov o3.xyzw, r1.xyzw
+mov o1.xyz, r2.xyzx
+mov o2.xy, v2.xyxx
+ret 
+// Approximately 24 instruction slots used
+#endif
+
+const BYTE g_InstancedPuyoVS[] =
+{
+     68,  88,  66,  67, 177,  35, 
+     86,  90, 249, 138,  17, 142, 
+    203, 222,  39,  23, 135, 182, 
+    136,  89,   1,   0,   0,   0, 
+    132,   6,   0,   0,   5,   0, 
+      0,   0,  52,   0,   0,   0, 
+     16,   1,   0,   0,  60,   2, 
+      0,   0, 196,   2,   0,   0, 
+      8,   6,   0,   0,  82,  68, 
+     69,  70, 212,   0,   0,   0, 
+      1,   0,   0,   0,  72,   0, 
+      0,   0,   1,   0,   0,   0, 
+     28,   0,   0,   0,   0,   4, 
+    254, 255,   4,   1,   0,   0, 
+    160,   0,   0,   0,  60,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   1,   0, 
+      0,   0,   1,   0,   0,   0, 
+     80, 101, 114,  70, 114,  97, 
+    109, 101,   0, 171, 171, 171, 
+     60,   0,   0,   0,   1,   0, 
+      0,   0,  96,   0,   0,   0, 
+     64,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+    120,   0,   0,   0,   0,   0, 
+      0,   0,  64,   0,   0,   0, 
+      2,   0,   0,   0, 144,   0, 
+      0,   0,   0,   0,   0,   0, 
+     86, 105, 101, 119,  80, 114, 
+    111, 106, 101,  99, 116, 105, 
+    111, 110,  77,  97, 116, 114, 
+    105, 120,   0, 171, 171, 171, 
+      3,   0,   3,   0,   4,   0, 
+      4,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,  77, 105, 
+     99, 114, 111, 115, 111, 102, 
+    116,  32,  40,  82,  41,  32, 
+     72,  76,  83,  76,  32,  83, 
+    104,  97, 100, 101, 114,  32, 
+     67, 111, 109, 112, 105, 108, 
+    101, 114,  32,  54,  46,  51, 
+     46,  57,  54,  48,  48,  46, 
+     49,  54,  51,  56,  52,   0, 
+    171, 171,  73,  83,  71,  78, 
+     36,   1,   0,   0,  10,   0, 
+      0,   0,   8,   0,   0,   0, 
+    248,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   0,   0, 
+      0,   0,   7,   7,   0,   0, 
+      1,   1,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   1,   0, 
+      0,   0,   7,   7,   0,   0, 
+      8,   1,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   2,   0, 
+      0,   0,   3,   3,   0,   0, 
+     17,   1,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   3,   0, 
+      0,   0,   7,   7,   0,   0, 
+     17,   1,   0,   0,   1,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   4,   0, 
+      0,   0,   7,   7,   0,   0, 
+     17,   1,   0,   0,   2,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   5,   0, 
+      0,   0,   7,   7,   0,   0, 
+     17,   1,   0,   0,   3,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   6,   0, 
+      0,   0,   7,   7,   0,   0, 
+     23,   1,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   7,   0, 
+      0,   0,   7,   7,   0,   0, 
+     23,   1,   0,   0,   1,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   8,   0, 
+      0,   0,   7,   7,   0,   0, 
+     23,   1,   0,   0,   2,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   9,   0, 
+      0,   0,   7,   7,   0,   0, 
+     80,  79,  83,  73,  84,  73, 
+     79,  78,   0,  78,  79,  82, 
+     77,  65,  76,   0,  84,  69, 
+     88,  67,  79,  79,  82,  68, 
+      0,  87,  79,  82,  76,  68, 
+      0,  78,  79,  82,  77,  65, 
+     76,  77,  65,  84,  82,  73, 
+     88,   0,  79,  83,  71,  78, 
+    128,   0,   0,   0,   4,   0, 
+      0,   0,   8,   0,   0,   0, 
+    104,   0,   0,   0,   1,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   0,   0, 
+      0,   0,  15,   0,   0,   0, 
+    104,   0,   0,   0,   2,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   1,   0, 
+      0,   0,   7,   8,   0,   0, 
+    104,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      3,   0,   0,   0,   2,   0, 
+      0,   0,   3,  12,   0,   0, 
+    113,   0,   0,   0,   0,   0, 
+      0,   0,   1,   0,   0,   0, 
+      3,   0,   0,   0,   3,   0, 
+      0,   0,  15,   0,   0,   0, 
+     84,  69,  88,  67,  79,  79, 
+     82,  68,   0,  83,  86,  95, 
+     80, 111, 115, 105, 116, 105, 
+    111, 110,   0, 171, 171, 171, 
+     83,  72,  68,  82,  60,   3, 
+      0,   0,  64,   0,   1,   0, 
+    207,   0,   0,   0,  89,   0, 
+      0,   4,  70, 142,  32,   0, 
+      0,   0,   0,   0,   4,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   0,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   1,   0, 
+      0,   0,  95,   0,   0,   3, 
+     50,  16,  16,   0,   2,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   3,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   4,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   5,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   6,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   7,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   8,   0, 
+      0,   0,  95,   0,   0,   3, 
+    114,  16,  16,   0,   9,   0, 
+      0,   0, 101,   0,   0,   3, 
+    242,  32,  16,   0,   0,   0, 
+      0,   0, 101,   0,   0,   3, 
+    114,  32,  16,   0,   1,   0, 
+      0,   0, 101,   0,   0,   3, 
+     50,  32,  16,   0,   2,   0, 
+      0,   0, 103,   0,   0,   4, 
+    242,  32,  16,   0,   3,   0, 
+      0,   0,   1,   0,   0,   0, 
+    104,   0,   0,   2,   4,   0, 
+      0,   0,  56,   0,   0,   7, 
+    114,   0,  16,   0,   0,   0, 
+      0,   0,   6,  16,  16,   0, 
+      0,   0,   0,   0,  70,  18, 
+     16,   0,   3,   0,   0,   0, 
+     56,   0,   0,   7, 114,   0, 
+     16,   0,   1,   0,   0,   0, 
+     86,  21,  16,   0,   0,   0, 
+      0,   0,  70,  18,  16,   0, 
+      4,   0,   0,   0,   0,   0, 
+      0,   7, 114,   0,  16,   0, 
+      0,   0,   0,   0,  70,   2, 
+     16,   0,   0,   0,   0,   0, 
+     70,   2,  16,   0,   1,   0, 
+      0,   0,  56,   0,   0,   7, 
+    114,   0,  16,   0,   1,   0, 
+      0,   0, 166,  26,  16,   0, 
+      0,   0,   0,   0,  70,  18, 
+     16,   0,   5,   0,   0,   0, 
+      0,   0,   0,   7, 114,   0, 
+     16,   0,   0,   0,   0,   0, 
+     70,   2,  16,   0,   0,   0, 
+      0,   0,  70,   2,  16,   0, 
+      1,   0,   0,   0,   0,   0, 
+      0,   7, 114,   0,  16,   0, 
+      0,   0,   0,   0,  70,   2, 
+     16,   0,   0,   0,   0,   0, 
+     70,  18,  16,   0,   6,   0, 
+      0,   0,  54,   0,   0,   5, 
+    130,   0,  16,   0,   0,   0, 
+      0,   0,   1,  64,   0,   0, 
+      0,   0, 128,  63,  56,   0, 
+      0,   8, 242,   0,  16,   0, 
+      1,   0,   0,   0,   6,   0, 
+     16,   0,   0,   0,   0,   0, 
+     70, 142,  32,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+     56,   0,   0,   8, 242,   0, 
+     16,   0,   2,   0,   0,   0, 
+     86,   5,  16,   0,   0,   0, 
+      0,   0,  70, 142,  32,   0, 
+      0,   0,   0,   0,   1,   0, 
+      0,   0,   0,   0,   0,   7, 
+    242,   0,  16,   0,   1,   0, 
+      0,   0,  70,  14,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   2,   0,   0,   0, 
+     56,   0,   0,   8, 242,   0, 
+     16,   0,   2,   0,   0,   0, 
+    166,  10,  16,   0,   0,   0, 
+      0,   0,  70, 142,  32,   0, 
+      0,   0,   0,   0,   2,   0, 
+      0,   0,   0,   0,   0,   7, 
+    242,   0,  16,   0,   1,   0, 
+      0,   0,  70,  14,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   2,   0,   0,   0, 
+     56,   0,   0,   8, 242,   0, 
+     16,   0,   2,   0,   0,   0, 
+    246,  15,  16,   0,   0,   0, 
+      0,   0,  70, 142,  32,   0, 
+      0,   0,   0,   0,   3,   0, 
+      0,   0,   0,   0,   0,   7, 
+    242,   0,  16,   0,   1,   0, 
+      0,   0,  70,  14,  16,   0, 
+      1,   0,   0,   0,  70,  14, 
+     16,   0,   2,   0,   0,   0, 
+     56,   0,   0,   7, 114,   0, 
+     16,   0,   2,   0,   0,   0, 
+      6,  16,  16,   0,   1,   0, 
+      0,   0,  70,  18,  16,   0, 
+      7,   0,   0,   0,  56,   0, 
+      0,   7, 114,   0,  16,   0, 
+      3,   0,   0,   0,  86,  21, 
+     16,   0,   1,   0,   0,   0, 
+     70,  18,  16,   0,   8,   0, 
+      0,   0,   0,   0,   0,   7, 
+    114,   0,  16,   0,   2,   0, 
+      0,   0,  70,   2,  16,   0, 
+      2,   0,   0,   0,  70,   2, 
+     16,   0,   3,   0,   0,   0, 
+     56,   0,   0,   7, 114,   0, 
+     16,   0,   3,   0,   0,   0, 
+    166,  26,  16,   0,   1,   0, 
+      0,   0,  70,  18,  16,   0, 
+      9,   0,   0,   0,   0,   0, 
+      0,   7, 114,   0,  16,   0, 
+      2,   0,   0,   0,  70,   2, 
+     16,   0,   2,   0,   0,   0, 
+     70,   2,  16,   0,   3,   0, 
+      0,   0,  54,   0,   0,   5, 
+    242,  32,  16,   0,   0,   0, 
+      0,   0,  70,  14,  16,   0, 
+      0,   0,   0,   0,  54,   0, 
+      0,   5, 242,  32,  16,   0, 
+      3,   0,   0,   0,  70,  14, 
+     16,   0,   1,   0,   0,   0, 
+     54,   0,   0,   5, 114,  32, 
+     16,   0,   1,   0,   0,   0, 
+     70,   2,  16,   0,   2,   0, 
+      0,   0,  54,   0,   0,   5, 
+     50,  32,  16,   0,   2,   0, 
+      0,   0,  70,  16,  16,   0, 
+      2,   0,   0,   0,  62,   0, 
+      0,   1,  83,  84,  65,  84, 
+    116,   0,   0,   0,  24,   0, 
+      0,   0,   4,   0,   0,   0, 
+      0,   0,   0,   0,  14,   0, 
+      0,   0,  18,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   1,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   5,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0, 
+      0,   0,   0,   0,   0,   0
+};
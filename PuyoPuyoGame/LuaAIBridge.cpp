@@ -1,14 +1,300 @@
 #include "PuyoPuyoGamePCH.h"
 #include "LuaAIBridge.h"
+#include "PuyoBoard.h"
+#include "InputPlanner.h"
+#include "PuyoGame.h"
+#include "LuaProfiler.h"
+#include <new>
 
-// TODO: Start implementing those functions!!
+// Name of the registry metatable that tags board userdata
+static const char* k_boardMetatable = "PuyoBoard";
+
+// ***************************************************************
+// HELPERS
+// ***************************************************************
+
+static PuyoBoard* CheckBoard(lua_State* L, int index)
+{
+	return static_cast<PuyoBoard*>(luaL_checkudata(L, index, k_boardMetatable));
+}
+
+// Boards are plain data, so they can live directly inside the userdata block and need no __gc.
+static PuyoBoard* PushBoard(lua_State* L)
+{
+	PuyoBoard* board = new(lua_newuserdata(L, sizeof(PuyoBoard))) PuyoBoard();
+	luaL_getmetatable(L, k_boardMetatable);
+	lua_setmetatable(L, -2);
+	return board;
+}
+
+static const PuyoInstance* CheckInstance(lua_State* L, int index)
+{
+	int id = luaL_checkint(L, index);
+	luaL_argcheck(L, id == 0 || id == 1, index, "instance ID must be 0 or 1");
+
+	return PuyoGame::GetSingleton().GetInstance((uint8_t)id);
+}
+
+static PUYO_COLOR CheckColor(lua_State* L, int index)
+{
+	int color = luaL_checkint(L, index);
+	luaL_argcheck(L, color >= 0 && color < PUYO_COLOR_COUNT, index, "invalid puyo color");
+
+	return (PUYO_COLOR)color;
+}
+
+static void SetField(lua_State* L, const char* name, int value)
+{
+	lua_pushinteger(L, value);
+	lua_setfield(L, -2, name);
+}
+
+static void PushPlacements(lua_State* L, const Placement* placements, int count)
+{
+	lua_createtable(L, count, 0);
+	for (int i = 0; i < count; i++)
+	{
+		lua_createtable(L, 0, 2);
+		SetField(L, "x", placements[i].x);
+		SetField(L, "orientation", placements[i].orientation);
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+// ***************************************************************
+// BRIDGE FUNCTIONS
+// ***************************************************************
 
 int GetCurrentUnit(lua_State* L)
 {
+	const PuyoInstance* instance = CheckInstance(L, 1);
+
+	int unit[5];
+	if (!instance->GetCurrentUnit(unit))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	for (int i = 0; i < 5; i++)
+		lua_pushinteger(L, unit[i]);
 
+	return 5;
 }
 
 int GetPuyoAt(lua_State* L)
 {
+	PuyoBoard* board = CheckBoard(L, 1);
+	PUYO_COLOR color = board->Get(luaL_checkint(L, 2), luaL_checkint(L, 3));
+
+	if (color == PUYO_COLOR::NONE)
+		lua_pushnil(L);
+	else
+		lua_pushinteger(L, color);
+
+	return 1;
+}
+
+int GetBoard(lua_State* L)
+{
+	const PuyoInstance* instance = CheckInstance(L, 1);
+	PushBoard(L)->Load(instance->GetGrid());
+	return 1;
+}
+
+int CopyBoard(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+	*PushBoard(L) = *board;
+	return 1;
+}
+
+int GetPlacements(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+
+	Placement placements[MAX_PLACEMENTS];
+	int count = board->EnumeratePlacements(placements);
+
+	PushPlacements(L, placements, count);
+	return 1;
+}
+
+int GetReachablePlacements(lua_State* L)
+{
+	const PuyoInstance* instance = CheckInstance(L, 1);
+
+	int unit[5];
+	if (!instance->GetCurrentUnit(unit))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	PuyoBoard board;
+	board.Load(instance->GetGrid());
+
+	UnitState start;
+	start.x = unit[0];
+	start.row = unit[1];
+	start.orientation = unit[2];
+
+	InputPlanner planner;
+	planner.Analyze(board, start);
+
+	Placement placements[MAX_PLACEMENTS];
+	int count = planner.GetReachablePlacements(placements);
+
+	PushPlacements(L, placements, count);
+	return 1;
+}
+
+int SimulatePlacement(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+	int x = luaL_checkint(L, 2);
+	int orientation = luaL_checkint(L, 3);
+	PUYO_COLOR pivot = CheckColor(L, 4);
+	PUYO_COLOR hanging = CheckColor(L, 5);
+
+	if (!board->CanPlace(x, orientation))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	PuyoBoard* result = PushBoard(L);
+	*result = *board;
+	result->Place(x, orientation, pivot, hanging);
+
+	int cleared = 0;
+	lua_pushinteger(L, result->ResolveChains(&cleared));
+	lua_pushinteger(L, cleared);
+	return 3;
+}
+
+int PlaceUnit(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+	int x = luaL_checkint(L, 2);
+	int orientation = luaL_checkint(L, 3);
+	PUYO_COLOR pivot = CheckColor(L, 4);
+	PUYO_COLOR hanging = CheckColor(L, 5);
+
+	if (!board->Place(x, orientation, pivot, hanging))
+	{
+		lua_pushnil(L);
+		return 1;
+	}
+
+	int cleared = 0;
+	lua_pushinteger(L, board->ResolveChains(&cleared));
+	lua_pushinteger(L, cleared);
+	return 2;
+}
+
+int ResolveChains(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+
+	int cleared = 0;
+	lua_pushinteger(L, board->ResolveChains(&cleared));
+	lua_pushinteger(L, cleared);
+	return 2;
+}
 
-}
\ No newline at end of file
+int GetBoardFeatures(lua_State* L)
+{
+	PuyoBoard* board = CheckBoard(L, 1);
+
+	BoardFeatures features;
+	board->ExtractFeatures(features);
+
+	lua_createtable(L, 0, 8);
+
+	lua_createtable(L, GRID_WIDTH, 0);
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		lua_pushinteger(L, features.heights[i]);
+		lua_rawseti(L, -2, i + 1);
+	}
+	lua_setfield(L, -2, "heights");
+
+	// groups[n] in Lua is the number of groups of size n
+	lua_createtable(L, MIN_COMBO_SIZE - 1, 0);
+	for (int i = 1; i < MIN_COMBO_SIZE; i++)
+	{
+		lua_pushinteger(L, features.groups[i]);
+		lua_rawseti(L, -2, i);
+	}
+	lua_setfield(L, -2, "groups");
+
+	SetField(L, "maxHeight", features.maxHeight);
+	SetField(L, "spawnHeight", features.spawnHeight);
+	SetField(L, "bumpiness", features.bumpiness);
+	SetField(L, "puyoCount", features.puyoCount);
+	SetField(L, "connections", features.connections);
+	SetField(L, "potentialChain", features.potentialChain);
+
+	return 1;
+}
+
+// ***************************************************************
+// REGISTRATION
+// ***************************************************************
+
+static const luaL_Reg k_bridgeFunctions[] =
+{
+	{ "GetCurrentUnit",		GetCurrentUnit },
+	{ "GetPuyoAt",			GetPuyoAt },
+	{ "GetBoard",			GetBoard },
+	{ "CopyBoard",			CopyBoard },
+	{ "GetPlacements",		GetPlacements },
+	{ "GetReachablePlacements",	GetReachablePlacements },
+	{ "SimulatePlacement",	SimulatePlacement },
+	{ "PlaceUnit",			PlaceUnit },
+	{ "ResolveChains",		ResolveChains },
+	{ "GetBoardFeatures",	GetBoardFeatures },
+	{ nullptr, nullptr }
+};
+
+static const luaL_Reg k_boardMethods[] =
+{
+	{ "Get",		GetPuyoAt },
+	{ "Copy",		CopyBoard },
+	{ "Placements",	GetPlacements },
+	{ "Simulate",	SimulatePlacement },
+	{ "Place",		PlaceUnit },
+	{ "Resolve",	ResolveChains },
+	{ "Features",	GetBoardFeatures },
+	{ nullptr, nullptr }
+};
+
+// Pushes either the raw function or, when profiling, a closure that times it
+static void PushBridgeFunction(lua_State* L, const luaL_Reg* reg, LuaProfiler* profiler)
+{
+	if (profiler)
+		profiler->PushBridgeFunction(L, reg->name, reg->func);
+	else
+		lua_pushcfunction(L, reg->func);
+}
+
+void RegisterAIBridge(lua_State* L, LuaProfiler* profiler)
+{
+	// Board metatable, with __index pointing at the method table
+	luaL_newmetatable(L, k_boardMetatable);
+	lua_newtable(L);
+	for (const luaL_Reg* reg = k_boardMethods; reg->name; reg++)
+	{
+		PushBridgeFunction(L, reg, profiler);
+		lua_setfield(L, -2, reg->name);
+	}
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	for (const luaL_Reg* reg = k_bridgeFunctions; reg->name; reg++)
+	{
+		PushBridgeFunction(L, reg, profiler);
+		lua_setglobal(L, reg->name);
+	}
+}
@@ -1,13 +1,50 @@
 #pragma once
 
+class LuaProfiler;
+
+// Registers every bridge function below as a global in the given lua state, along with the metatable used
+// for board userdata. Boards also expose the board functions as methods (e.g. board:Simulate(x, o, c1, c2)).
+// All grid coordinates are zero-based to match the C++ side.
+// If a profiler is given, every function is wrapped so its calls are counted and timed.
+void RegisterAIBridge(lua_State* L, LuaProfiler* profiler = nullptr);
+
 // get current position, orientation, and colors of puyo unit
+// Lua: x, y, orientation, pivotColor, hangingColor = GetCurrentUnit(instanceID) -- nil if no unit is in play
 int GetCurrentUnit(lua_State* L);
 
 // get puyo color at position x, y
+// Lua: color = GetPuyoAt(board, x, y) -- nil if the cell is empty
 int GetPuyoAt(lua_State* L);
 
+// Lua: board = GetBoard(instanceID) -- a snapshot of the instance's grid
+int GetBoard(lua_State* L);
+
+// Lua: copy = CopyBoard(board)
+int CopyBoard(lua_State* L);
+
+// Lua: placements = GetPlacements(board) -- array of { x = column, orientation = 0..3 }
+int GetPlacements(lua_State* L);
+
+// Exact version of GetPlacements for the unit currently in play, following the same movement and wall kick rules
+// the AI's inputs go through. Placements that GetPlacements reports but the unit can't actually get to are left out.
+// Lua: placements = GetReachablePlacements(instanceID) -- nil if no unit is in play
+int GetReachablePlacements(lua_State* L);
+
+// Drops a unit on a copy of the board and resolves the resulting chain. The original board is left untouched.
+// Lua: newBoard, chain, cleared = SimulatePlacement(board, x, orientation, pivotColor, hangingColor) -- nil if invalid
+int SimulatePlacement(lua_State* L);
+
+// Same as SimulatePlacement, but modifies the board in place.
+// Lua: chain, cleared = PlaceUnit(board, x, orientation, pivotColor, hangingColor) -- nil if invalid
+int PlaceUnit(lua_State* L);
+
+// Lua: chain, cleared = ResolveChains(board)
+int ResolveChains(lua_State* L);
+
+// Lua: features = GetBoardFeatures(board) -- see BoardFeatures for the fields
+int GetBoardFeatures(lua_State* L);
+
 // IDEA: Add functions for querying the other player's field or manipulating your queue to be exactly what you want it to be to enable literal cheating AI's.
 
 // IDEA: Break the LUA AI stuff into multiple scripts! Make one all the common boilerplate stuff (moving the unit, utility functions to locate obstructions, etc.)
 //		 then make separate files for each AI's particular strategy
-
@@ -0,0 +1,322 @@
+#include "PuyoPuyoGamePCH.h"
+#include "LuaProfiler.h"
+#include <algorithm>
+
+LuaProfiler::LuaProfiler(int sampleInterval)
+	: m_luaState(nullptr)
+	, m_prevAlloc(nullptr)
+	, m_prevAllocUD(nullptr)
+	, m_sampleInterval(sampleInterval)
+	, m_frequency(GameTimer::ReadFrequency())
+	, m_lastSample(0)
+	, m_decisionStart(0)
+	, m_inDecision(false)
+	, m_decisionBytes(0)
+	, m_decisionBridgeCalls(0)
+{
+}
+
+LuaProfiler::~LuaProfiler()
+{
+	// Detaching is left to the owner, since the state may already have been closed by the time we get here.
+}
+
+// ***************************************************************
+// PRIVATE FUNCTIONS
+// ***************************************************************
+
+void LuaProfiler::Hook(lua_State* L, lua_Debug* ar)
+{
+	LuaProfiler* profiler = FromState(L);
+	if (profiler && ar->event == LUA_HOOKCOUNT)
+	{
+		profiler->RecordSample(L);
+	}
+}
+
+void* LuaProfiler::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	LuaProfiler* profiler = static_cast<LuaProfiler*>(ud);
+
+	// Lua 5.1 passes osize = 0 for new blocks, so growth covers both fresh allocations and reallocs.
+	if (nsize > osize)
+		profiler->m_decisionBytes += nsize - osize;
+
+	return profiler->m_prevAlloc(profiler->m_prevAllocUD, ptr, osize, nsize);
+}
+
+int LuaProfiler::ProfiledBridgeCall(lua_State* L)
+{
+	LuaProfiler* profiler = static_cast<LuaProfiler*>(lua_touserdata(L, lua_upvalueindex(1)));
+	lua_CFunction func = lua_tocfunction(L, lua_upvalueindex(2));
+	size_t index = (size_t)lua_tointeger(L, lua_upvalueindex(3));
+
+	// Charge whatever the script did since the last sample to the calling stack before the native clock starts
+	int64_t start = profiler->Now();
+	profiler->CaptureStack(L, 1);
+	if (profiler->m_inDecision)
+		profiler->ChargeStack(profiler->ToSeconds(start - profiler->m_lastSample));
+
+	int results = func(L);
+
+	int64_t end = profiler->Now();
+	double seconds = profiler->ToSeconds(end - start);
+
+	BridgeStats& stats = profiler->m_bridgeStats[index];
+	stats.calls++;
+	stats.time += seconds;
+	profiler->m_decisionBridgeCalls++;
+
+	if (profiler->m_inDecision)
+	{
+		profiler->m_stackScratch.push_back(std::string("[bridge] ") + stats.name);
+		profiler->ChargeStack(seconds);
+	}
+	profiler->m_lastSample = end;
+
+	return results;
+}
+
+LuaProfiler* LuaProfiler::FromState(lua_State* L)
+{
+	void* ud = nullptr;
+	if (lua_getallocf(L, &ud) != Alloc)
+		return nullptr;
+
+	return static_cast<LuaProfiler*>(ud);
+}
+
+int64_t LuaProfiler::Now() const
+{
+	return GameTimer::ReadCounter();
+}
+
+double LuaProfiler::ToSeconds(int64_t ticks) const
+{
+	return static_cast<double>(ticks) / static_cast<double>(m_frequency);
+}
+
+void LuaProfiler::CaptureStack(lua_State* L, int firstLevel)
+{
+	m_stackScratch.clear();
+
+	lua_Debug ar;
+	char label[256];
+	for (int level = firstLevel; lua_getstack(L, level, &ar); level++)
+	{
+		lua_getinfo(L, "Sn", &ar);
+
+		if (*ar.what == 'm')
+			snprintf(label, sizeof(label), "main chunk (%s)", ar.short_src);
+		else if (*ar.what == 'C')
+			snprintf(label, sizeof(label), "%s [C]", ar.name ? ar.name : "?");
+		else
+			snprintf(label, sizeof(label), "%s (%s:%d)", ar.name ? ar.name : "anonymous", ar.short_src, ar.linedefined);
+
+		m_stackScratch.push_back(label);
+	}
+
+	std::reverse(m_stackScratch.begin(), m_stackScratch.end());
+}
+
+void LuaProfiler::RecordSample(lua_State* L)
+{
+	int64_t now = Now();
+	double seconds = ToSeconds(now - m_lastSample);
+	m_lastSample = now;
+
+	if (!m_inDecision)
+		return;
+
+	CaptureStack(L);
+	ChargeStack(seconds);
+}
+
+void LuaProfiler::ChargeStack(double seconds)
+{
+	if (m_stackScratch.empty())
+		m_stackScratch.push_back("[unsampled]");
+
+	std::string folded;
+	for (size_t i = 0; i < m_stackScratch.size(); i++)
+	{
+		const std::string& frame = m_stackScratch[i];
+		if (i > 0)
+			folded += ';';
+		folded += frame;
+
+		// Recursive functions appear more than once, but should only be charged once toward total time
+		bool seen = false;
+		for (size_t j = 0; j < i && !seen; j++)
+			seen = m_stackScratch[j] == frame;
+
+		FunctionStats& stats = m_functions[frame];
+		if (!seen)
+			stats.totalTime += seconds;
+
+		if (i == m_stackScratch.size() - 1)
+		{
+			stats.selfTime += seconds;
+			stats.samples++;
+		}
+	}
+
+	m_foldedStacks[folded] += seconds;
+}
+
+// ***************************************************************
+// PUBLIC FUNCTIONS
+// ***************************************************************
+
+void LuaProfiler::Attach(lua_State* L)
+{
+	assert(!m_luaState);
+
+	m_luaState = L;
+	m_prevAlloc = lua_getallocf(L, &m_prevAllocUD);
+	lua_setallocf(L, Alloc, this);
+	lua_sethook(L, Hook, LUA_MASKCOUNT, m_sampleInterval);
+
+	// The collector only runs from EndDecision while we are attached so its cost can be measured
+	lua_gc(L, LUA_GCSTOP, 0);
+}
+
+void LuaProfiler::Detach()
+{
+	if (!m_luaState)
+		return;
+
+	lua_sethook(m_luaState, nullptr, 0, 0);
+	lua_setallocf(m_luaState, m_prevAlloc, m_prevAllocUD);
+	lua_gc(m_luaState, LUA_GCRESTART, 0);
+	m_luaState = nullptr;
+}
+
+void LuaProfiler::PushBridgeFunction(lua_State* L, const char* name, lua_CFunction func)
+{
+	size_t index = 0;
+	while (index < m_bridgeStats.size() && m_bridgeStats[index].func != func)
+		index++;
+
+	if (index == m_bridgeStats.size())
+	{
+		BridgeStats stats;
+		stats.func = func;
+		stats.name = name;
+		m_bridgeStats.push_back(stats);
+	}
+
+	lua_pushlightuserdata(L, this);
+	lua_pushcfunction(L, func);
+	lua_pushinteger(L, (lua_Integer)index);
+	lua_pushcclosure(L, ProfiledBridgeCall, 3);
+}
+
+void LuaProfiler::BeginDecision()
+{
+	m_decisionStart = m_lastSample = Now();
+	m_decisionBytes = 0;
+	m_decisionBridgeCalls = 0;
+	m_inDecision = true;
+}
+
+void LuaProfiler::EndDecision()
+{
+	assert(m_inDecision);
+
+	// Whatever ran after the last sample can't be attributed to a function anymore
+	int64_t end = Now();
+	m_stackScratch.clear();
+	ChargeStack(ToSeconds(end - m_lastSample));
+
+	// Collect roughly as much garbage as this decision produced, then stop the collector again
+	if (m_luaState)
+	{
+		lua_gc(m_luaState, LUA_GCSTEP, (int)(m_decisionBytes / 1024) + 1);
+		lua_gc(m_luaState, LUA_GCSTOP, 0);
+	}
+
+	int64_t gcEnd = Now();
+	double gcTime = ToSeconds(gcEnd - end);
+	m_stackScratch.clear();
+	m_stackScratch.push_back("[gc]");
+	ChargeStack(gcTime);
+
+	double decisionTime = ToSeconds(gcEnd - m_decisionStart);
+	m_decisions.count++;
+	m_decisions.totalTime += decisionTime;
+	m_decisions.maxTime = max(m_decisions.maxTime, decisionTime);
+	m_decisions.gcTime += gcTime;
+	m_decisions.bytesAllocated += m_decisionBytes;
+	m_decisions.bridgeCalls += m_decisionBridgeCalls;
+
+	m_lastSample = gcEnd;
+	m_inDecision = false;
+}
+
+void LuaProfiler::PrintReport(FILE* file) const
+{
+	typedef std::pair<std::string, FunctionStats> FunctionEntry;
+	std::vector<FunctionEntry> functions(m_functions.begin(), m_functions.end());
+	std::sort(functions.begin(), functions.end(), [](const FunctionEntry& a, const FunctionEntry& b)
+	{
+		return a.second.selfTime > b.second.selfTime;
+	});
+
+	fprintf(file, "---- Lua AI Profile ---------------------------------------------\n");
+	fprintf(file, "%12s %12s %8s  %s\n", "self (ms)", "total (ms)", "samples", "function");
+	for (const FunctionEntry& entry : functions)
+	{
+		fprintf(file, "%12.3f %12.3f %8u  %s\n", entry.second.selfTime * 1000.0, entry.second.totalTime * 1000.0, entry.second.samples, entry.first.c_str());
+	}
+
+	fprintf(file, "\n%12s %12s %12s  %s\n", "calls", "total (ms)", "avg (us)", "bridge function");
+	for (const BridgeStats& stats : m_bridgeStats)
+	{
+		double average = stats.calls > 0 ? stats.time / stats.calls : 0.0;
+		fprintf(file, "%12u %12.3f %12.3f  %s\n", stats.calls, stats.time * 1000.0, average * 1000000.0, stats.name);
+	}
+
+	if (m_decisions.count > 0)
+	{
+		double count = (double)m_decisions.count;
+		fprintf(file, "\ndecisions: %u, avg %.3f ms, max %.3f ms, gc avg %.3f ms, %.0f bytes/decision, %.1f bridge calls/decision\n",
+			m_decisions.count,
+			m_decisions.totalTime * 1000.0 / count,
+			m_decisions.maxTime * 1000.0,
+			m_decisions.gcTime * 1000.0 / count,
+			m_decisions.bytesAllocated / count,
+			m_decisions.bridgeCalls / count);
+	}
+	fprintf(file, "-----------------------------------------------------------------\n");
+}
+
+bool LuaProfiler::WriteFoldedStacks(const char* path) const
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	// Flame graph tools want integer weights, so stacks are written in microseconds
+	for (const auto& entry : m_foldedStacks)
+	{
+		long long micros = (long long)(entry.second * 1000000.0 + 0.5);
+		if (micros > 0)
+			fprintf(file, "%s %lld\n", entry.first.c_str(), micros);
+	}
+
+	fclose(file);
+	return true;
+}
+
+void LuaProfiler::Reset()
+{
+	m_functions.clear();
+	m_foldedStacks.clear();
+	m_decisions = DecisionStats();
+	for (BridgeStats& stats : m_bridgeStats)
+	{
+		stats.calls = 0;
+		stats.time = 0.0;
+	}
+}
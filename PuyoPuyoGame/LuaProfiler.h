@@ -0,0 +1,108 @@
+#pragma once
+#include <lua.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// An opt-in profiler for the lua states owned by AIControllers. It combines three sources of data:
+//  - A count hook (lua_sethook) that samples the lua call stack every few VM instructions. The time elapsed
+//    since the previous sample is charged to the sampled stack, which gives self/total time per function.
+//  - Timers wrapped around every bridge call (see RegisterAIBridge), so native work shows up separately.
+//  - An allocator shim that counts bytes allocated by the state. While profiling, the incremental collector
+//    is stopped and stepped explicitly at the end of every decision so garbage collection can be timed too.
+//
+// Everything is accumulated per "decision" (one AIController::Update) and can be exported in the folded
+// stack format understood by flamegraph.pl and speedscope.
+class LuaProfiler
+{
+private:
+	struct FunctionStats
+	{
+		double selfTime = 0.0;
+		double totalTime = 0.0;
+		unsigned int samples = 0;
+	};
+
+	struct BridgeStats
+	{
+		lua_CFunction func = nullptr;
+		const char* name = nullptr;
+		unsigned int calls = 0;
+		double time = 0.0;
+	};
+
+	struct DecisionStats
+	{
+		unsigned int count = 0;
+		double totalTime = 0.0;
+		double maxTime = 0.0;
+		double gcTime = 0.0;
+		size_t bytesAllocated = 0;
+		unsigned int bridgeCalls = 0;
+	};
+
+	lua_State* m_luaState;
+	lua_Alloc m_prevAlloc;
+	void* m_prevAllocUD;
+	int m_sampleInterval;
+
+	int64_t m_frequency;
+	int64_t m_lastSample;
+	int64_t m_decisionStart;
+	bool m_inDecision;
+
+	// Counters for the decision that is currently running
+	size_t m_decisionBytes;
+	unsigned int m_decisionBridgeCalls;
+
+	DecisionStats m_decisions;
+	std::unordered_map<std::string, FunctionStats> m_functions;
+	std::unordered_map<std::string, double> m_foldedStacks;
+	std::vector<BridgeStats> m_bridgeStats;
+
+	// Scratch space reused while walking the stack
+	std::vector<std::string> m_stackScratch;
+
+	static void Hook(lua_State* L, lua_Debug* ar);
+	static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+	static int ProfiledBridgeCall(lua_State* L);
+	static LuaProfiler* FromState(lua_State* L);
+
+	int64_t Now() const;
+	double ToSeconds(int64_t ticks) const;
+
+	// Walks the lua stack into m_stackScratch, outermost frame first, skipping frames below firstLevel
+	void CaptureStack(lua_State* L, int firstLevel = 0);
+	void RecordSample(lua_State* L);
+
+	// Charges time to the stack currently held in m_stackScratch
+	void ChargeStack(double seconds);
+
+public:
+	// sampleInterval is the number of VM instructions between samples
+	explicit LuaProfiler(int sampleInterval = 1000);
+	~LuaProfiler();
+
+	// Installs the hook and allocator shim. The profiler must outlive the state or be detached first.
+	void Attach(lua_State* L);
+	void Detach();
+
+	// Pushes a closure that calls func and charges its cost to a bridge entry. Registering the same function
+	// more than once (e.g. as a global and as a board method) shares the entry, named after the first registration.
+	void PushBridgeFunction(lua_State* L, const char* name, lua_CFunction func);
+
+	// Bracket one AI decision. EndDecision also runs (and times) the garbage collector.
+	void BeginDecision();
+	void EndDecision();
+
+	// Prints per-function, per-bridge-call, and per-decision statistics
+	void PrintReport(FILE* file = stdout) const;
+
+	// Writes "frame;frame;frame microseconds" lines for flame graph tools. Returns false if the file
+	// could not be opened.
+	bool WriteFoldedStacks(const char* path) const;
+
+	void Reset();
+};
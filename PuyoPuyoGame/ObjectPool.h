@@ -1,59 +1,187 @@
 #pragma once
 #include <stdlib.h>
+#include <assert.h>
 #include <new>
+#include <type_traits>
+#include <vector>
+
+// Handles are 32 bits: the low 20 bits index a slot in the pool, the high 12 bits hold the generation of the slot at the
+// time the object was allocated. Freeing an object bumps the generation, so handles to it stop resolving.
+// Generations start at 1, so 0 is never a valid handle.
+typedef unsigned int PHANDLE;
+#define INVALID_PHANDLE 0U
+#define PHANDLE_INDEX_BITS 20
+#define PHANDLE_INDEX_MASK ((1U << PHANDLE_INDEX_BITS) - 1)
+#define PHANDLE_GENERATION_MASK ((1U << (32 - PHANDLE_INDEX_BITS)) - 1)
 
 template <typename T>
 class ObjectPool
 {
 private:
-	unsigned int m_poolSize;
-	T* m_poolStart;
-	T* m_poolTail;
+	struct Slot
+	{
+		// The object has to come first so a T* can be turned back into its slot
+		typename std::aligned_storage<sizeof(T), __alignof(T)>::type storage;
+		unsigned int index;
+		unsigned int nextFree;
+		unsigned short generation;
+		bool alive;
+	};
+
+	static const unsigned int k_noSlot = 0xFFFFFFFF;
 
-	void push_back(T* object)
+	unsigned int m_blockSize;
+	std::vector<Slot*> m_blocks; // Blocks are never moved or freed until the pool dies, so pointers stay valid
+	unsigned int m_freeHead;
+	unsigned int m_liveCount;
+
+	Slot& GetSlot(unsigned int index) const
 	{
-		*reinterpret_cast<T**>(object) = m_poolTail;
-		m_poolTail = object;
+		return m_blocks[index / m_blockSize][index % m_blockSize];
 	}
 
-public:
-	explicit ObjectPool(unsigned int poolSize)
-		: m_poolSize(poolSize)
+	static Slot* ToSlot(const T* object)
+	{
+		return reinterpret_cast<Slot*>(const_cast<T*>(object));
+	}
+
+	// Returns false if the block couldn't be allocated, in which case the pool is left as it was
+	bool Grow()
 	{
-		// Obtain a chunk of memory equal to the number of objects we were initialized to hold.
-		m_poolStart = reinterpret_cast<T*>(malloc(m_poolSize * sizeof(T)));
-		m_poolTail = nullptr;
+		unsigned int first = Capacity();
+		assert(first + m_blockSize - 1 <= PHANDLE_INDEX_MASK && "ObjectPool ran out of handle bits");
+
+		Slot* block = reinterpret_cast<Slot*>(malloc(m_blockSize * sizeof(Slot)));
+		if (!block)
+		{
+			assert(!"ObjectPool couldn't allocate another block");
+			return false;
+		}
+
+		m_blocks.push_back(block);
 
-		// Divide the memory chunk into object-sized pieces, each containing a reference to 
-		for (unsigned int i = 0; i < m_poolSize; i++)
+		// Thread the new slots onto the free list, in order so the first allocations come from the start of the block
+		for (unsigned int i = m_blockSize; i-- > 0;)
 		{
-			push_back(m_poolStart + i);
+			Slot& slot = block[i];
+			slot.index = first + i;
+			slot.generation = 1;
+			slot.alive = false;
+			slot.nextFree = m_freeHead;
+			m_freeHead = slot.index;
 		}
+
+		return true;
+	}
+
+public:
+	// blockSize is how many objects the pool starts with, and how many more it makes room for whenever it runs out
+	explicit ObjectPool(unsigned int blockSize)
+		: m_blockSize(blockSize)
+		, m_freeHead(k_noSlot)
+		, m_liveCount(0)
+	{
+		assert(blockSize > 0);
+		Grow();
 	}
 
 	~ObjectPool()
 	{
-		free(m_poolStart);
+		ForEach([](T* object) { object->~T(); });
+
+		for (Slot* block : m_blocks)
+			free(block);
 	}
 
-	T* AllocObject()
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	// If every slot is taken, another block is added. Returns nullptr only if that block couldn't be allocated.
+	T* AllocObject(PHANDLE* handle = nullptr)
 	{
-		// If we are out of available memory, just return a nullptr.
-		// This class is not built for dynamic expansion...
-		if (m_poolTail == m_poolStart)
+		if (m_freeHead == k_noSlot && !Grow())
 			return nullptr;
 
-		T* tail = m_poolTail;
-		m_poolTail = *reinterpret_cast<T**>(m_poolTail);
+		Slot& slot = GetSlot(m_freeHead);
+		m_freeHead = slot.nextFree;
+		slot.alive = true;
+		m_liveCount++;
+
+		if (handle)
+			*handle = GetHandle(reinterpret_cast<T*>(&slot.storage));
 
 		// Use placement new to initialize the object
-		return new(tail)T();
+		return new(&slot.storage)T();
 	}
 
 	void FreeObject(T* object)
 	{
+		assert(IsAlive(object) && "Object freed twice or not from this pool");
+
 		// Call the object's destructor before pushing it back into the list.
 		object->~T();
-		push_back(object);
+
+		Slot* slot = ToSlot(object);
+		slot->alive = false;
+		slot->generation = (slot->generation % PHANDLE_GENERATION_MASK) + 1;
+		slot->nextFree = m_freeHead;
+		m_freeHead = slot->index;
+		m_liveCount--;
 	}
-};
\ No newline at end of file
+
+	// Returns the handle of a live object from this pool
+	PHANDLE GetHandle(const T* object) const
+	{
+		const Slot* slot = ToSlot(object);
+		return ((PHANDLE)slot->generation << PHANDLE_INDEX_BITS) | slot->index;
+	}
+
+	// Returns the object the handle refers to, or nullptr if it has been freed since
+	T* Get(PHANDLE handle) const
+	{
+		unsigned int index = handle & PHANDLE_INDEX_MASK;
+		if (index >= Capacity())
+			return nullptr;
+
+		Slot& slot = GetSlot(index);
+		if (!slot.alive || slot.generation != (handle >> PHANDLE_INDEX_BITS))
+			return nullptr;
+
+		return reinterpret_cast<T*>(&slot.storage);
+	}
+
+	bool IsValid(PHANDLE handle) const
+	{
+		return Get(handle) != nullptr;
+	}
+
+	// Checks that a raw pointer still points at a live object from this pool. Catches use after FreeObject.
+	bool IsAlive(const T* object) const
+	{
+		const Slot* slot = ToSlot(object);
+		for (Slot* block : m_blocks)
+		{
+			if (slot >= block && slot < block + m_blockSize)
+				return slot->alive;
+		}
+
+		return false;
+	}
+
+	// Calls func(T*) for every live object, in slot order
+	template <typename F>
+	void ForEach(F func) const
+	{
+		for (Slot* block : m_blocks)
+		{
+			for (unsigned int i = 0; i < m_blockSize; i++)
+			{
+				if (block[i].alive)
+					func(reinterpret_cast<T*>(&block[i].storage));
+			}
+		}
+	}
+
+	unsigned int Count() const { return m_liveCount; }
+	unsigned int Capacity() const { return (unsigned int)m_blocks.size() * m_blockSize; }
+};
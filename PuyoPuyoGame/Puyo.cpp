@@ -4,6 +4,7 @@
 
 Puyo::Puyo()
 	: puyoColor(PUYO_COLOR::RED)
+	, renderIndex(PUYO_NO_RENDER_INDEX)
 {
 	//printf("Puyo Made!! \n");
 }
@@ -13,6 +13,8 @@ enum PUYO_COLOR
 	NONE
 };
 
+#define PUYO_NO_RENDER_INDEX 0xFFFFFFFF
+
 class Puyo
 {
 private:
@@ -25,6 +27,9 @@ public:
 	Transform transform;
 	PUYO_COLOR puyoColor;
 
+	// Position in its color's array in the PuyoRenderList. Only the render list should touch this.
+	unsigned int renderIndex;
+
 	void SetRandomColor();
 
 	// Getters and setters just in case I ever need to do anything else when checked is changed...
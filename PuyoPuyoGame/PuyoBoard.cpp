@@ -0,0 +1,332 @@
+#include "PuyoPuyoGamePCH.h"
+#include "PuyoBoard.h"
+#include "PuyoGrid.h"
+#include <string.h>
+#include <stdlib.h>
+
+// Offsets from the pivot to the hanging puyo for each UNIT_ORIENTATION
+static const int k_orientationX[UNIT_ORIENTATION_COUNT] = { 0, 1, 0, -1 };
+static const int k_orientationY[UNIT_ORIENTATION_COUNT] = { 1, 0, -1, 0 };
+
+static const int k_spawnX = (int)PUYO_SPAWN_X;
+static const int k_spawnY = (int)PUYO_SPWAN_Y;
+
+PuyoBoard::PuyoBoard()
+{
+	Clear();
+}
+
+// ***************************************************************
+// PRIVATE FUNCTIONS
+// ***************************************************************
+
+int PuyoBoard::FloodFill(int x, int y, bool visited[GRID_WIDTH][GRID_HEIGHT], int* group) const
+{
+	static const int dx[4] = { 1, -1, 0, 0 };
+	static const int dy[4] = { 0, 0, 1, -1 };
+
+	unsigned char color = m_cells[x][y];
+	int stack[GRID_WIDTH * GRID_HEIGHT];
+	int top = 0;
+	int size = 0;
+
+	visited[x][y] = true;
+	stack[top++] = x * GRID_HEIGHT + y;
+
+	while (top > 0)
+	{
+		int cell = stack[--top];
+		if (group)
+			group[size] = cell;
+		size++;
+
+		int cx = cell / GRID_HEIGHT;
+		int cy = cell % GRID_HEIGHT;
+		for (int i = 0; i < 4; i++)
+		{
+			int nx = cx + dx[i];
+			int ny = cy + dy[i];
+			if (nx < 0 || nx >= GRID_WIDTH || ny < 0 || ny >= GRID_HEIGHT)
+				continue;
+			if (visited[nx][ny] || m_cells[nx][ny] != color)
+				continue;
+
+			visited[nx][ny] = true;
+			stack[top++] = nx * GRID_HEIGHT + ny;
+		}
+	}
+
+	return size;
+}
+
+void PuyoBoard::Drop(int x, PUYO_COLOR color)
+{
+	m_cells[x][m_heights[x]++] = (unsigned char)color;
+}
+
+// ***************************************************************
+// PUBLIC FUNCTIONS
+// ***************************************************************
+
+void PuyoBoard::Load(const PuyoGrid& grid)
+{
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		m_heights[i] = 0;
+		for (int j = 0; j < GRID_HEIGHT; j++)
+		{
+			Puyo* p = grid.GetPuyoAt(i, j);
+			m_cells[i][j] = (unsigned char)(p ? p->puyoColor : PUYO_COLOR::NONE);
+
+			if (p)
+				m_heights[i] = j + 1;
+		}
+	}
+}
+
+void PuyoBoard::Clear()
+{
+	memset(m_cells, PUYO_COLOR::NONE, sizeof(m_cells));
+	memset(m_heights, 0, sizeof(m_heights));
+}
+
+PUYO_COLOR PuyoBoard::Get(int x, int y) const
+{
+	if (x < 0 || x >= GRID_WIDTH) return PUYO_COLOR::NONE;
+	if (y < 0 || y >= GRID_HEIGHT) return PUYO_COLOR::NONE;
+
+	return (PUYO_COLOR)m_cells[x][y];
+}
+
+void PuyoBoard::Set(int x, int y, PUYO_COLOR color)
+{
+	assert(x >= 0 && x < GRID_WIDTH);
+	assert(y >= 0 && y < GRID_HEIGHT);
+
+	m_cells[x][y] = (unsigned char)color;
+
+	// Keep the column height in sync. Setting a cell can leave a gap, but ApplyGravity takes care of that.
+	if (color != PUYO_COLOR::NONE && y >= m_heights[x])
+	{
+		m_heights[x] = y + 1;
+	}
+	else if (color == PUYO_COLOR::NONE && y == m_heights[x] - 1)
+	{
+		while (m_heights[x] > 0 && m_cells[x][m_heights[x] - 1] == PUYO_COLOR::NONE)
+			m_heights[x]--;
+	}
+}
+
+int PuyoBoard::GetHeight(int x) const
+{
+	if (x < 0 || x >= GRID_WIDTH) return GRID_HEIGHT;
+
+	return m_heights[x];
+}
+
+int PuyoBoard::EnumeratePlacements(Placement placements[MAX_PLACEMENTS]) const
+{
+	int count = 0;
+	for (int o = 0; o < UNIT_ORIENTATION_COUNT; o++)
+	{
+		for (int x = 0; x < GRID_WIDTH; x++)
+		{
+			if (!CanPlace(x, o))
+				continue;
+
+			placements[count].x = x;
+			placements[count].orientation = o;
+			count++;
+		}
+	}
+
+	return count;
+}
+
+bool PuyoBoard::CanPlace(int x, int orientation) const
+{
+	if (orientation < 0 || orientation >= UNIT_ORIENTATION_COUNT)
+		return false;
+
+	int hx = x + k_orientationX[orientation];
+	if (x < 0 || x >= GRID_WIDTH || hx < 0 || hx >= GRID_WIDTH)
+		return false;
+
+	// Both puyos need room to land
+	if (hx == x)
+	{
+		if (m_heights[x] + 2 > GRID_HEIGHT)
+			return false;
+	}
+	else if (m_heights[x] >= GRID_HEIGHT || m_heights[hx] >= GRID_HEIGHT)
+	{
+		return false;
+	}
+
+	// The unit has to be able to slide over from the spawn column at spawn height. This is a conservative
+	// approximation of the movement rules; it ignores units that could sneak under an overhang as they fall.
+	int minX = min(min(x, hx), k_spawnX);
+	int maxX = max(max(x, hx), k_spawnX);
+	for (int i = minX; i <= maxX; i++)
+	{
+		if (m_heights[i] > k_spawnY)
+			return false;
+	}
+
+	// A unit spawns hanging up, so the pivot's column needs a free cell below it to rotate the hanging puyo down
+	if (orientation == ORIENT_DOWN && m_heights[x] >= k_spawnY)
+		return false;
+
+	return true;
+}
+
+bool PuyoBoard::Place(int x, int orientation, PUYO_COLOR pivot, PUYO_COLOR hanging)
+{
+	if (!CanPlace(x, orientation))
+		return false;
+
+	switch (orientation)
+	{
+		case ORIENT_UP:
+		{
+			Drop(x, pivot);
+			Drop(x, hanging);
+			break;
+		}
+		case ORIENT_DOWN:
+		{
+			Drop(x, hanging);
+			Drop(x, pivot);
+			break;
+		}
+		default:
+		{
+			Drop(x, pivot);
+			Drop(x + k_orientationX[orientation], hanging);
+			break;
+		}
+	}
+
+	return true;
+}
+
+void PuyoBoard::ApplyGravity()
+{
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		int top = 0;
+		for (int j = 0; j < GRID_HEIGHT; j++)
+		{
+			if (m_cells[i][j] == PUYO_COLOR::NONE)
+				continue;
+
+			if (top != j)
+			{
+				m_cells[i][top] = m_cells[i][j];
+				m_cells[i][j] = PUYO_COLOR::NONE;
+			}
+			top++;
+		}
+
+		m_heights[i] = top;
+	}
+}
+
+int PuyoBoard::ClearGroups()
+{
+	bool visited[GRID_WIDTH][GRID_HEIGHT] = {};
+	int group[GRID_WIDTH * GRID_HEIGHT];
+	int cleared = 0;
+
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		for (int j = 0; j < m_heights[i]; j++)
+		{
+			if (visited[i][j] || m_cells[i][j] == PUYO_COLOR::NONE)
+				continue;
+
+			int size = FloodFill(i, j, visited, group);
+			if (size < MIN_COMBO_SIZE)
+				continue;
+
+			for (int k = 0; k < size; k++)
+			{
+				m_cells[group[k] / GRID_HEIGHT][group[k] % GRID_HEIGHT] = PUYO_COLOR::NONE;
+			}
+			cleared += size;
+		}
+	}
+
+	return cleared;
+}
+
+int PuyoBoard::ResolveChains(int* cleared)
+{
+	int chain = 0;
+	int total = 0;
+	int removed;
+
+	while ((removed = ClearGroups()) > 0)
+	{
+		chain++;
+		total += removed;
+		ApplyGravity();
+	}
+
+	if (cleared)
+		*cleared = total;
+
+	return chain;
+}
+
+void PuyoBoard::ExtractFeatures(BoardFeatures& features) const
+{
+	memset(&features, 0, sizeof(BoardFeatures));
+
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		features.heights[i] = m_heights[i];
+		features.maxHeight = max(features.maxHeight, (int)m_heights[i]);
+		features.puyoCount += m_heights[i];
+
+		if (i > 0)
+			features.bumpiness += abs(m_heights[i] - m_heights[i - 1]);
+	}
+	features.spawnHeight = m_heights[k_spawnX];
+
+	// Count adjacent pairs by only looking right and up from each cell so each pair is counted once
+	bool visited[GRID_WIDTH][GRID_HEIGHT] = {};
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		for (int j = 0; j < m_heights[i]; j++)
+		{
+			unsigned char c = m_cells[i][j];
+			if (c == PUYO_COLOR::NONE)
+				continue;
+
+			if (i + 1 < GRID_WIDTH && m_cells[i + 1][j] == c) features.connections++;
+			if (j + 1 < GRID_HEIGHT && m_cells[i][j + 1] == c) features.connections++;
+
+			if (!visited[i][j])
+			{
+				int size = FloodFill(i, j, visited, nullptr);
+				if (size < MIN_COMBO_SIZE)
+					features.groups[size]++;
+			}
+		}
+	}
+
+	// Try dropping every color into every column to see how big a chain the board is primed for
+	for (int i = 0; i < GRID_WIDTH; i++)
+	{
+		if (m_heights[i] >= GRID_HEIGHT)
+			continue;
+
+		for (int c = 0; c < USED_PUYO_COLORS; c++)
+		{
+			PuyoBoard trial = *this;
+			trial.Drop(i, (PUYO_COLOR)c);
+			features.potentialChain = max(features.potentialChain, trial.ResolveChains());
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "Puyo.h"
+#include "PuyoValues.h"
+
+class PuyoGrid;
+
+// Orientation of the hanging puyo relative to the pivot. These match the values reported by
+// PuyoInstance::GetCurrentUnit (0 = up, 1 = right, 2 = down, 3 = left).
+enum UNIT_ORIENTATION
+{
+	ORIENT_UP,
+	ORIENT_RIGHT,
+	ORIENT_DOWN,
+	ORIENT_LEFT,
+	UNIT_ORIENTATION_COUNT
+};
+
+// A column and orientation a unit can be dropped at. The x value is the column of the pivot puyo.
+struct Placement
+{
+	int x;
+	int orientation;
+};
+
+// The most placements a board can ever report (every column in every orientation).
+#define MAX_PLACEMENTS (GRID_WIDTH * UNIT_ORIENTATION_COUNT)
+
+// Summary values describing the shape of a board. Cheap to compute natively, painfully slow in Lua.
+struct BoardFeatures
+{
+	int heights[GRID_WIDTH];	// Number of puyos stacked in each column
+	int maxHeight;				// Tallest column
+	int spawnHeight;			// Height of the column units spawn in. Reaching the top of it ends the game.
+	int bumpiness;				// Sum of height differences between neighbouring columns
+	int puyoCount;				// Total number of puyos on the board
+	int connections;			// Number of orthogonally adjacent same-color pairs
+	int groups[MIN_COMBO_SIZE];	// groups[n] = number of connected same-color groups of size n (n < MIN_COMBO_SIZE)
+	int potentialChain;			// Longest chain that can be triggered by dropping a single puyo of any color into any column
+};
+
+// A compact copy of a puyo grid that stores colors instead of Puyo pointers. This is what the AI works on:
+// it can be copied for free, and placements, gravity, and chain resolution can be simulated on it without
+// touching the live game.
+class PuyoBoard
+{
+private:
+	unsigned char m_cells[GRID_WIDTH][GRID_HEIGHT];
+	unsigned char m_heights[GRID_WIDTH];
+
+	// Flood fills the group of same-colored puyos connected to (x, y), marking them in visited and writing
+	// their cells to group. Returns the size of the group.
+	int FloodFill(int x, int y, bool visited[GRID_WIDTH][GRID_HEIGHT], int* group) const;
+
+	void Drop(int x, PUYO_COLOR color);
+
+public:
+	PuyoBoard();
+
+	// Copies the colors of every puyo in the grid
+	void Load(const PuyoGrid& grid);
+	void Clear();
+
+	PUYO_COLOR Get(int x, int y) const;
+	void Set(int x, int y, PUYO_COLOR color);
+	int GetHeight(int x) const;
+
+	// Fills placements with every (column, orientation) a freshly spawned unit can reach and land in.
+	// Returns the number of placements written.
+	int EnumeratePlacements(Placement placements[MAX_PLACEMENTS]) const;
+
+	// Returns true if a unit can land at the given placement
+	bool CanPlace(int x, int orientation) const;
+
+	// Drops a unit at the given placement, letting each puyo fall as far as it can. Does not resolve chains.
+	// Returns false (and leaves the board untouched) if the placement is not valid.
+	bool Place(int x, int orientation, PUYO_COLOR pivot, PUYO_COLOR hanging);
+
+	// Makes every puyo fall until it rests on the floor or another puyo
+	void ApplyGravity();
+
+	// Removes every group of MIN_COMBO_SIZE or more connected puyos. Returns the number of puyos removed.
+	int ClearGroups();
+
+	// Alternates ClearGroups and ApplyGravity until the board is stable. Returns the length of the chain
+	// and optionally the total number of puyos that were cleared.
+	int ResolveChains(int* cleared = nullptr);
+
+	void ExtractFeatures(BoardFeatures& features) const;
+};
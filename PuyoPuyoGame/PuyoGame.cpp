@@ -2,12 +2,14 @@
 #include "PuyoGame.h"
 #include "PuyoValues.h"
 #include "XMExtensions.h"
+#include "PuyoSoftwareShaders.h"
 
 // Shader Includes
 #include "SimpleVertexShader.h"
 #include "UnlitPixelShader.h"
 #include "DepthOnlyPS.h"
-#include "DepthOnlyVS.h"
+#include "InstancedPuyoVS.h"
+#include "InstancedDepthOnlyVS.h"
 #include "SubsurfacePuyoPS.h"
 #include "GridBackgroundPS.h"
 #include "GridBackgroundVoronoiPS.h"
@@ -18,7 +20,7 @@ using namespace XMExtensions;
 
 // DEBUG
 
-//RHANDLE backgroundPS;
+//PSHandle backgroundPS;
 
 // Define array of puyo colors
 DirectX::XMFLOAT4 PuyoGame::ms_PuyoColors[PUYO_COLOR_COUNT] = {
@@ -38,14 +40,29 @@ struct PerObjectConstantBufferData
 	XMMATRIX WorldViewProjectionMatrix;
 };
 
-struct SingleColorConstantBufferData
+struct PerFrameConstantBufferData
 {
-	XMFLOAT4 PixelColor;
+	XMMATRIX ViewProjectionMatrix;
 };
 
-struct DepthOnlyVSBufferData
+// The instanced vertex shaders read each puyo's PuyoRenderData straight out of vertex buffer slot 1
+static const VertexElement k_instancedPuyoElements[] =
 {
-	XMMATRIX WorldViewProjectionMatrix;
+	{ "POSITION",		0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, position),			0, false },
+	{ "NORMAL",			0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(VertexPositionNormalTexture, normal),				0, false },
+	{ "TEXCOORD",		0, GPU_FORMAT::R32G32_FLOAT,	offsetof(VertexPositionNormalTexture, textureCoordinate),	0, false },
+	{ "WORLD",			0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, World) + 0,						1, true },
+	{ "WORLD",			1, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, World) + 12,						1, true },
+	{ "WORLD",			2, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, World) + 24,						1, true },
+	{ "WORLD",			3, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, World) + 36,						1, true },
+	{ "NORMALMATRIX",	0, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, NormalMatrix) + 0,				1, true },
+	{ "NORMALMATRIX",	1, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, NormalMatrix) + 12,				1, true },
+	{ "NORMALMATRIX",	2, GPU_FORMAT::R32G32B32_FLOAT, offsetof(PuyoRenderData, NormalMatrix) + 24,				1, true },
+};
+
+struct SingleColorConstantBufferData
+{
+	XMFLOAT4 PixelColor;
 };
 
 struct SubsurfacePuyoPSBufferData
@@ -84,11 +101,33 @@ PuyoGame* PuyoGame::GetSingletonPtr()
 // Implementation
 // ----------------------------------------------------------------------------------
 
-PuyoGame::PuyoGame()
-	: m_p1Controller(KEY::A, KEY::D, KEY::W, KEY::S)
-	, m_p2Controller(KEY::LEFT, KEY::RIGHT, KEY::UP, KEY::DOWN)
-	, m_p1Instance(false)
+// Inputs for scripted games, one character per frame (see ScriptedController). Each line moves a unit somewhere and then
+// holds fall long enough for it to land and settle, so the stacks spread out over the grid and combos happen now and
+// then.
+static const char* k_p1Script =
+	"..LL.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..R..F.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..L.L.L.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..F.F.R.R.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..L.F.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......";
+
+static const char* k_p2Script =
+	"..R.R.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..L.L.L.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..F.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..L.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......"
+	"..R.F.F.DDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDDD......";
+
+PuyoGame::PuyoGame(bool scripted)
+	: m_p1Instance(false)
 	, m_p2Instance(true)
+	, m_p1Controller(KEY::A, KEY::D, KEY::W, KEY::S)
+	, m_p2Controller(KEY::LEFT, KEY::RIGHT, KEY::UP, KEY::DOWN)
+	, m_p1Script(k_p1Script)
+	, m_p2Script(k_p2Script)
+	, m_scripted(scripted)
+	, m_puyoInstanceStarts()
 {
 	// Debug
 	m_p1Instance.transform.SetPosition(XMVectorSet(k_leftGridX, k_gridY, 0.0f, 1.0f));
@@ -96,18 +135,43 @@ PuyoGame::PuyoGame()
 
 	LoadAssets();
 
-	m_p1Instance.Initialize(&m_p1Controller);
-	m_p2Instance.Initialize(&m_p2Controller);
+	StartMatch();
 }
 
 PuyoGame::~PuyoGame()
 {
 	// Free all active puyos
-	for (Puyo* p : m_activePuyoList)
+	for (int i = 0; i < PUYO_COLOR_COUNT; i++)
+	{
+		for (Puyo* p : m_activePuyos.GetPuyos((PUYO_COLOR)i))
+			m_puyoPool.FreeObject(p);
+	}
+	m_activePuyos.Clear();
+}
+
+void PuyoGame::StartMatch()
+{
+	m_p1Script.Reset();
+	m_p2Script.Reset();
+
+	m_p1Instance.Initialize(m_scripted ? (PuyoController*)&m_p1Script : &m_p1Controller);
+	m_p2Instance.Initialize(m_scripted ? (PuyoController*)&m_p2Script : &m_p2Controller);
+}
+
+void PuyoGame::RestartMatch()
+{
+	m_p1Instance.Cleanup();
+	m_p2Instance.Cleanup();
+
+	// Every puyo on the grids, in the queues, and in the players' hands came from AllocPuyo, so they're all in here
+	for (int i = 0; i < PUYO_COLOR_COUNT; i++)
 	{
-		m_puyoPool.FreeObject(p);
+		const std::vector<Puyo*>& puyos = m_activePuyos.GetPuyos((PUYO_COLOR)i);
+		while (!puyos.empty())
+			FreePuyo(puyos.back());
 	}
-	m_activePuyoList.clear();
+
+	StartMatch();
 }
 
 void PuyoGame::LoadAssets()
@@ -121,62 +185,70 @@ void PuyoGame::LoadAssets()
 
 	// Load Basic Materials
 	//---------------------------------------------------------------
-	
+
+	// The software render device needs to know what to run in place of these shaders before they're created
+	RegisterPuyoSoftwareShaders();
+
 	// Basic Puyo Material
-	RHANDLE vs		= RenderManager::GetSingleton().CreateVShaderResource(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
-	RHANDLE ps		= RenderManager::GetSingleton().CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
-	RHANDLE vscb	= RenderManager::GetSingleton().CreateCBResource(sizeof(PerObjectConstantBufferData));
-	RHANDLE pscb	= RenderManager::GetSingleton().CreateCBResource(sizeof(SingleColorConstantBufferData));
-	m_puyoMesh		= RenderManager::GetSingleton().CreateMeshResource(Mesh::CreateSphere(RenderManager::GetSingleton().GetDeviceContext(), 1.0f, 10, false));
+	VSHandle vs		= RenderManager::GetSingleton().CreateVShaderResource(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+	PSHandle ps		= RenderManager::GetSingleton().CreatePShaderResource(g_UnlitPixelShader, sizeof(g_UnlitPixelShader));
+	CBHandle vscb	= RenderManager::GetSingleton().CreateCBResource(sizeof(PerObjectConstantBufferData));
+	CBHandle pscb	= RenderManager::GetSingleton().CreateCBResource(sizeof(SingleColorConstantBufferData));
+	m_puyoMesh		= RenderManager::GetSingleton().CreateMeshResource(Mesh::CreateSphere(RenderManager::GetSingleton().GetDevice(), 1.0f, 10, false));
 	m_puyoMaterial	= RenderManager::GetSingleton().CreateMaterial(vs, ps, vscb, pscb);
 
+	// Both puyo passes are drawn instanced, and share one constant buffer that only changes once a frame
+	const unsigned int instancedElementCount = sizeof(k_instancedPuyoElements) / sizeof(k_instancedPuyoElements[0]);
+	vscb = RenderManager::GetSingleton().CreateCBResource(sizeof(PerFrameConstantBufferData));
+	m_puyoInstances.Initialize(RenderManager::GetSingleton().GetDevice(), sizeof(PuyoRenderData), 256);
+
 	// Subsurface Material
+	vs						= RenderManager::GetSingleton().CreateVShaderResource(g_InstancedPuyoVS, sizeof(g_InstancedPuyoVS), k_instancedPuyoElements, instancedElementCount);
 	ps						= RenderManager::GetSingleton().CreatePShaderResource(g_SubsurfacePuyoPS, sizeof(g_SubsurfacePuyoPS));
 	pscb					= RenderManager::GetSingleton().CreateCBResource(sizeof(SubsurfacePuyoPSBufferData));
 	m_subsurfaceMaterial	= RenderManager::GetSingleton().CreateMaterial(vs, ps, vscb, pscb);
 
 	// Depth Only Material
-	vs					= RenderManager::GetSingleton().CreateVShaderResource(g_DepthOnlyVS, sizeof(g_DepthOnlyVS), VertexPositionNormalTexture::InputElements, VertexPositionNormalTexture::InputElementCount);
+	vs					= RenderManager::GetSingleton().CreateVShaderResource(g_InstancedDepthOnlyVS, sizeof(g_InstancedDepthOnlyVS), k_instancedPuyoElements, instancedElementCount);
 	ps					= RenderManager::GetSingleton().CreatePShaderResource(g_DepthOnlyPS, sizeof(g_DepthOnlyPS));
-	vscb				= RenderManager::GetSingleton().CreateCBResource(sizeof(DepthOnlyVSBufferData));
 	m_depthOnlyMaterial = RenderManager::GetSingleton().CreateMaterial(vs, ps, vscb);
 
-	
 	// ToDo: Load any textures/sprite fonts here
 	//---------------------------------------------------------------
+	RenderDevice* device = RenderManager::GetSingleton().GetDevice();
+	unsigned int width = device->GetBackBufferWidth();
+	unsigned int height = device->GetBackBufferHeight();
+
 	InitGridStencil();
-	m_backfaceDepth.Initialize(RenderManager::GetSingleton().GetDevice(), 800, 600, DXGI_FORMAT_D32_FLOAT, true, 1, 0);
 
 	// DEBUG
-	m_gridTexture.Initialize(RenderManager::GetSingleton().GetDevice(), 800, 600, DXGI_FORMAT_R8G8B8A8_UNORM);
+	m_gridTexture.Initialize(device, width, height, GPU_FORMAT::R8G8B8A8_UNORM);
 	pscb                 = RenderManager::GetSingleton().CreateCBResource(sizeof(VoronoiConstantBufferData));
-	RHANDLE backgroundPS = RenderManager::GetSingleton().CreatePShaderResource(g_GridBackgroundVoronoiPS, sizeof(g_GridBackgroundVoronoiPS));
+	PSHandle backgroundPS = RenderManager::GetSingleton().CreatePShaderResource(g_GridBackgroundVoronoiPS, sizeof(g_GridBackgroundVoronoiPS));
 	VoronoiConstantBufferData cbd;
 	cbd.Color = XMFLOAT3(0.9, 0.5, 0.3) * 0.6f;
 	cbd.Scale = 30.0f;
 	cbd.TileScale = 6.5f;
 	RenderManager::GetSingleton().UpdateConstantBuffer(pscb, &cbd);
 	RenderManager::GetSingleton().SetPSConstantBuffer(pscb);
-	RenderManager::GetSingleton().RenderFullscreen(backgroundPS, m_gridTexture.rtView);
+	RenderManager::GetSingleton().RenderFullscreen(backgroundPS, m_gridTexture.texture);
 
-	m_overlayTexture.Initialize(RenderManager::GetSingleton().GetDevice(), 800, 600, DXGI_FORMAT_R8G8B8A8_UNORM);
+	m_overlayTexture.Initialize(device, width, height, GPU_FORMAT::R8G8B8A8_UNORM);
 	cbd.Color = XMFLOAT3(0.9, 0.5, 0.3);
 	cbd.Scale = 15.0f;
 	cbd.TileScale = 9.0f;
 	RenderManager::GetSingleton().UpdateConstantBuffer(pscb, &cbd);
-	RenderManager::GetSingleton().RenderFullscreen(backgroundPS, m_overlayTexture.rtView);
+	RenderManager::GetSingleton().RenderFullscreen(backgroundPS, m_overlayTexture.texture);
 }
 
 void PuyoGame::InitGridStencil()
 {
-	ID3D11DeviceContext* context = RenderManager::GetSingleton().GetDeviceContext();
-
-	m_gridStencil.Initialize(RenderManager::GetSingleton().GetDevice(), 800, 600, DXGI_FORMAT_D24_UNORM_S8_UINT, true, 1, 0);
-	context->ClearDepthStencilView(m_gridStencil.dsView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-	ID3D11RenderTargetView* nullRenderTarget[1] = { nullptr };
-	context->OMSetRenderTargets(1, nullRenderTarget, m_gridStencil.dsView);
+	RenderDevice* device = RenderManager::GetSingleton().GetDevice();
+	m_gridStencil.Initialize(device, device->GetBackBufferWidth(), device->GetBackBufferHeight(), GPU_FORMAT::D24_UNORM_S8_UINT, true, 1, 0);
+	RenderManager::GetSingleton().ClearDepthStencil(m_gridStencil.texture, CLEAR_DEPTH | CLEAR_STENCIL, 1.0f, 0);
+	RenderManager::GetSingleton().SetRenderTarget(0, m_gridStencil.texture);
 	
-	RHANDLE quadMesh = RenderManager::GetSingleton().CreateMeshResource(Mesh::CreateQuad(context));
+	MeshHandle quadMesh = RenderManager::GetSingleton().CreateMeshResource(Mesh::CreateQuad(RenderManager::GetSingleton().GetDevice()));
 	Material& puyoMaterial = RenderManager::GetSingleton().GetMaterial(m_puyoMaterial);
 	PerObjectConstantBufferData perObjectData;
 
@@ -184,88 +256,133 @@ void PuyoGame::InitGridStencil()
 	XMMATRIX rightPosition = XMMatrixTranslation(k_rightGridX + PUYO_SIZE * 2.5f, k_gridY + PUYO_SIZE * 5.5f, -10.0f);
 	XMMATRIX gridScale = XMMatrixScaling(PUYO_SIZE * 6.0f, PUYO_SIZE * 12.0f, 1.0f);
 	XMMATRIX queueScale = XMMatrixScaling(PUYO_SIZE * 4.0f, PUYO_SIZE * 2.0f, 1.0f);
+	XMMATRIX viewProjMatrix = m_orthoCamera.GetViewProjectionMatrix();
 
 	// Draw the overlay area
 	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::STENCIL_WRITE, 3U);
 	perObjectData.WorldMatrix = XMMatrixScaling(800.0f, 600.0f, 0.0f);
-	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * m_orthoCamera.GetViewMatrix() * m_orthoCamera.GetProjectionMatrix();
+	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * viewProjMatrix;
 	RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
 	RenderManager::GetSingleton().DrawWithMaterial(quadMesh, m_puyoMaterial);
 
 	// Draw the two play areas
 	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::STENCIL_WRITE, 1U);
 	perObjectData.WorldMatrix = gridScale * leftPosition;
-	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * m_orthoCamera.GetViewMatrix() * m_orthoCamera.GetProjectionMatrix();
+	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * viewProjMatrix;
 	RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
 	RenderManager::GetSingleton().DrawWithMaterial(quadMesh, m_puyoMaterial);
 
 	perObjectData.WorldMatrix = gridScale * rightPosition;
-	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * m_orthoCamera.GetViewMatrix() * m_orthoCamera.GetProjectionMatrix();
+	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * viewProjMatrix;
 	RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
 	RenderManager::GetSingleton().DrawWithMaterial(quadMesh, m_puyoMaterial);
 
 	// Draw the cutouts for the queues
 	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::STENCIL_WRITE, 2U);
 	perObjectData.WorldMatrix = queueScale * XMMatrixTranslation(k_leftGridX + PUYO_SIZE * 8.0f, k_gridY + PUYO_SIZE * 13.5f, -10.0f);
-	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * m_orthoCamera.GetViewMatrix() * m_orthoCamera.GetProjectionMatrix();
+	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * viewProjMatrix;
 	RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
 	RenderManager::GetSingleton().DrawWithMaterial(quadMesh, m_puyoMaterial);
 
 	perObjectData.WorldMatrix = queueScale * XMMatrixTranslation(k_rightGridX - PUYO_SIZE * 3.0f, k_gridY + PUYO_SIZE * 13.5f, -10.0f);;
-	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * m_orthoCamera.GetViewMatrix() * m_orthoCamera.GetProjectionMatrix();
+	perObjectData.WorldViewProjectionMatrix = perObjectData.WorldMatrix * viewProjMatrix;
 	RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
 	RenderManager::GetSingleton().DrawWithMaterial(quadMesh, m_puyoMaterial);
 
-	RenderManager::GetSingleton().GetDeviceContext()->OMSetRenderTargets(1, RenderManager::GetSingleton().GetBackBufferRT(), m_gridStencil.dsView);
+	// The stencil only gets drawn the once
+	RenderManager::GetSingleton().DestroyMeshResource(quadMesh);
+
+	RenderManager::GetSingleton().SetRenderTarget(RenderManager::GetSingleton().GetBackBuffer(), m_gridStencil.texture);
 }
 
 
 bool PuyoGame::Update(double dt)
 {
-	if(!m_p1Instance.Update(dt)) return false;
-	if(!m_p2Instance.Update(dt)) return false;
-
-	// Clear Depth and Render Targets
-	ID3D11DeviceContext* context = RenderManager::GetSingleton().GetDeviceContext();
-	context->ClearDepthStencilView(m_gridStencil.dsView, D3D11_CLEAR_DEPTH, 1.0f, 0U);
-	context->ClearDepthStencilView(m_backfaceDepth.dsView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0U);
-	context->ClearRenderTargetView(*RenderManager::GetSingleton().GetBackBufferRT(), DirectX::Colors::Black);
-	
-	// Render the grid texture
-	/*RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::READONLY_STENCIL_EQ, 1U);
-	RenderManager::GetSingleton().Blit(m_gridTexture.srView, nullptr, SAMPLER_STATE::LINEAR_WRAP, true);*/
+	{
+		AllocationScope allocScope(ALLOC_TAG::GAME);
+
+		if (m_scripted)
+		{
+			m_p1Script.Step();
+			m_p2Script.Step();
+		}
+
+		if(!m_p1Instance.Update(dt)) return false;
+		if(!m_p2Instance.Update(dt)) return false;
+	}
+
+	// Everything has moved for this frame, so bring all the world matrices up to date in one go before drawing
+	TransformSystem::GetSingleton().UpdateAll();
+
+	AllocationScope allocScope(ALLOC_TAG::RENDER);
+
+	// Every pass this frame shares the same camera data
+	const CameraConstants& camera = m_orthoCamera.GetConstants();
+
+	// Both puyo passes come out of the same draw list
+	BuildDrawList(camera);
+
+	RenderManager& renderManager = RenderManager::GetSingleton();
+	m_frameGraph.Reset();
 
-	// Render the overlay texture
-	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::READONLY_STENCIL_EQ, 3U);
-	RenderManager::GetSingleton().Blit(m_overlayTexture.srView, nullptr, SAMPLER_STATE::LINEAR_WRAP, true);
+	FGHANDLE backBuffer = m_frameGraph.ImportTexture("Back buffer", renderManager.GetBackBuffer());
+	FGHANDLE gridStencil = m_frameGraph.ImportTexture("Grid stencil", m_gridStencil.texture);
+	FGHANDLE backfaceDepth = m_frameGraph.CreateTexture("Backface depth", FrameGraphTextureDesc(GPU_FORMAT::D32_FLOAT));
+	m_frameGraph.MarkOutput(backBuffer);
+
+	// Render the overlay texture. Only the grid stencil's depth is cleared, the stencil's from InitGridStencil.
+	unsigned int overlayPass = m_frameGraph.AddPass("Overlay", DrawOverlayPass, this);
+	m_frameGraph.SetRenderTarget(overlayPass, backBuffer, gridStencil);
+	m_frameGraph.ClearColor(overlayPass, DirectX::Colors::Black);
+	m_frameGraph.ClearDepthStencil(overlayPass, CLEAR_DEPTH);
 
 	// Render Puyo backface depth
-	ID3D11RenderTargetView* nullRenderTarget[1] = { nullptr };
-	context->OMSetRenderTargets(1, nullRenderTarget, m_backfaceDepth.dsView);
-	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::READ_WRITE);
-	RenderManager::GetSingleton().SetRasterizerState(RASTERIZER_STATE::CULL_FRONT);
-	RenderDepth();
-
-	//RenderManager::GetSingleton().SetRasterizerState(RASTERIZER_STATE::CULL_BACK);
-	//RenderManager::GetSingleton().Blit(m_backfaceDepth.srView, nullptr, SAMPLER_STATE::POINT_WRAP);
-	
-	//RenderManager::GetSingleton().Blit(m_gridStencil.srView, nullptr, SAMPLER_STATE::POINT_WRAP);
+	unsigned int backfacePass = m_frameGraph.AddPass("Backface depth", DrawBackfaceDepthPass, this);
+	m_frameGraph.SetRenderTarget(backfacePass, INVALID_FGHANDLE, backfaceDepth);
+	m_frameGraph.ClearDepthStencil(backfacePass, CLEAR_DEPTH | CLEAR_STENCIL);
 
 	// Render Puyo frontfaces using backface depth
-	RenderManager::GetSingleton().SetRasterizerState(RASTERIZER_STATE::CULL_BACK);
-	RenderManager::GetSingleton().SetBlendState(BLEND_STATE::ALPHA_BLEND);
-	RenderManager::GetSingleton().GetDeviceContext()->OMSetRenderTargets(1, RenderManager::GetSingleton().GetBackBufferRT(), m_gridStencil.dsView);
-	RenderManager::GetSingleton().SetDepthStencilState(DEPTH_STENCIL_STATE::STENCIL_GT, 3U);
+	unsigned int frontfacePass = m_frameGraph.AddPass("Frontfaces", DrawFrontfacePass, this);
+	m_frameGraph.SetRenderTarget(frontfacePass, backBuffer, gridStencil);
+	m_frameGraph.ReadTexture(frontfacePass, backfaceDepth, 0U);
 
-	//RenderManager::GetSingleton().Clear(DirectX::Colors::AliceBlue, 1.0, 0);
-	//RenderManager::GetSingleton().Blit(m_gridStencil.srView, nullptr, SAMPLER_STATE::POINT_WRAP);
-	Render();
+	m_frameGraph.Execute(renderManager, true);
 
-	RenderManager::GetSingleton().Present();
+	renderManager.Present();
 
 	return true;
 }
 
+void PuyoGame::DrawOverlayPass(void* data, const FrameGraph&)
+{
+	PuyoGame* game = (PuyoGame*)data;
+	RenderManager& renderManager = RenderManager::GetSingleton();
+
+	// Render the grid texture
+	/*renderManager.SetDepthStencilState(DEPTH_STENCIL_STATE::READONLY_STENCIL_EQ, 1U);
+	renderManager.Blit(game->m_gridTexture.texture, 0, SAMPLER_STATE::LINEAR_WRAP, true);*/
+
+	renderManager.SetDepthStencilState(DEPTH_STENCIL_STATE::READONLY_STENCIL_EQ, 3U);
+	renderManager.Blit(game->m_overlayTexture.texture, 0, SAMPLER_STATE::LINEAR_WRAP, true);
+}
+
+void PuyoGame::DrawBackfaceDepthPass(void* data, const FrameGraph&)
+{
+	PuyoGame* game = (PuyoGame*)data;
+	game->m_drawList.Execute(RenderManager::GetSingleton(), BACKFACE_DEPTH_PASS);
+}
+
+void PuyoGame::DrawFrontfacePass(void* data, const FrameGraph&)
+{
+	PuyoGame* game = (PuyoGame*)data;
+	RenderManager& renderManager = RenderManager::GetSingleton();
+
+	renderManager.SetSamplerState(SAMPLER_STATE::POINT_WRAP);
+	game->m_drawList.Execute(renderManager, FRONTFACE_PASS);
+
+	//renderManager.Blit(game->m_gridStencil.texture, 0, SAMPLER_STATE::POINT_WRAP);
+}
+
 /*
 // Irrelevant because all puyos will be drawn in orthographic projection mode from head on,
 // so there is no chance of overlap.
@@ -284,61 +401,79 @@ bool puyo_compare(const Puyo& a, const Puyo& b)
 	return dist_a > dist_b;
 }*/
 
-bool puyo_compare(const Puyo* a, const Puyo* b)
+void PuyoGame::UpdatePuyoInstances()
 {
-	return a->puyoColor < b->puyoColor;
-}
+	m_activePuyos.Update();
 
-void PuyoGame::Render()
-{
-	if (m_puyoListDirty)
+	unsigned int count = m_activePuyos.Count();
+	if (count == 0)
+		return;
+
+	// Colors go in order, so each color's puyos end up as one run of instances
+	PuyoRenderData* instances = FrameAllocator::GetSingleton().AllocArray<PuyoRenderData>(count);
+	unsigned int instance = 0;
+	for (int color = 0; color < PUYO_COLOR_COUNT; color++)
 	{
-		m_activePuyoList.sort(puyo_compare);
+		unsigned int colorCount = m_activePuyos.Count((PUYO_COLOR)color);
+		m_puyoInstanceStarts[color] = instance;
+		memcpy(&instances[instance], m_activePuyos.GetRenderData((PUYO_COLOR)color), colorCount * sizeof(PuyoRenderData));
+		instance += colorCount;
 	}
 
-	ID3D11DeviceContext* context = RenderManager::GetSingleton().GetDeviceContext();
-	ID3D11ShaderResourceView* backfaceResource[1] = { m_backfaceDepth.srView };
-	context->PSSetShaderResources(0U, 1U, backfaceResource);
-	RenderManager::GetSingleton().SetSamplerState(SAMPLER_STATE::POINT_WRAP);
+	m_puyoInstances.Update(instances, count);
+}
 
-	Material& puyoMaterial = RenderManager::GetSingleton().GetMaterial(m_subsurfaceMaterial);
-	PUYO_COLOR currentColor = PUYO_COLOR::NONE;
-	PerObjectConstantBufferData perObjectData;
-	SubsurfacePuyoPSBufferData ssData;
-	ssData.LightPos = XMExtensions::normalize(XMFLOAT3(1.0f, 1.0f, -4.0f));
-	ssData.Near = 1.0f;
-	ssData.Far = 100.0f;
+void PuyoGame::BuildDrawList(const CameraConstants& camera)
+{
+	m_drawList.Clear();
 
-	for (Puyo* puyo : m_activePuyoList)
-	{
-		if (currentColor != puyo->puyoColor)
-		{
-			currentColor = puyo->puyoColor;
-			ssData.Color = ms_PuyoColors[currentColor];
-			RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.psCBHandle, &ssData);
-		}
+	unsigned int count = m_activePuyos.Count();
+	if (count == 0)
+		return;
 
-		XMMATRIX worldMatrix = puyo->transform.GetWorldMatrix();
-		XMMATRIX viewMatrix = m_orthoCamera.GetViewMatrix();
-		XMMATRIX projMatrix = m_orthoCamera.GetProjectionMatrix();
-		perObjectData.WorldMatrix = worldMatrix;
-		perObjectData.InverseTransposeWorldMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, worldMatrix));
-		perObjectData.WorldViewProjectionMatrix = worldMatrix * viewMatrix * projMatrix;
-		
-		/*printf("--------------------------------------------------------");
-		for (int i = 0; i < 16; i++)
-		{
-			printf("|%f|", perObjectData.InverseTransposeWorldMatrix.r[i / 4].m128_f32[i % 4]);
-			if ((i + 1) % 4 != 0)
-				continue;
-			printf("\n");
-		}
-		printf("--------------------------------------------------------\n");*/
+	UpdatePuyoInstances();
+
+	// Both materials' vertex shaders read the same per frame buffer
+	PerFrameConstantBufferData perFrameData;
+	perFrameData.ViewProjectionMatrix = camera.ViewProjection;
 
-		RenderManager::GetSingleton().UpdateConstantBuffer(puyoMaterial.vsCBHandle, &perObjectData);
+	DrawPacket packet;
+	packet.mesh = m_puyoMesh;
+	packet.vsConstants = &perFrameData;
+	packet.vsConstantSize = sizeof(perFrameData);
+	packet.instanceBuffer = m_puyoInstances.buffer;
+	packet.instanceStride = m_puyoInstances.stride;
 
-		RenderManager::GetSingleton().DrawWithMaterial(m_puyoMesh, m_subsurfaceMaterial);
+	// Depth doesn't care about color, so every puyo goes in one draw
+	packet.material = m_depthOnlyMaterial;
+	packet.state = DrawState(RASTERIZER_STATE::CULL_FRONT, DEPTH_STENCIL_STATE::READ_WRITE, 0, BLEND_STATE::SOLID);
+	packet.instanceCount = count;
+	packet.startInstance = 0;
+	m_drawList.Submit(DrawList::MakeKey(BACKFACE_DEPTH_PASS, packet.state, packet.material, packet.mesh), packet);
+
+	SubsurfacePuyoPSBufferData ssData;
+	ssData.LightPos = XMExtensions::normalize(XMFLOAT3(1.0f, 1.0f, -4.0f));
+	ssData.Near = camera.ClipPlanes.x;
+	ssData.Far = camera.ClipPlanes.y;
+
+	// One draw per color, since the color lives in the pixel shader's constants
+	packet.material = m_subsurfaceMaterial;
+	packet.state = DrawState(RASTERIZER_STATE::CULL_BACK, DEPTH_STENCIL_STATE::STENCIL_GT, 3, BLEND_STATE::ALPHA_BLEND);
+	packet.psConstants = &ssData;
+	packet.psConstantSize = sizeof(ssData);
+	for (int color = 0; color < PUYO_COLOR_COUNT; color++)
+	{
+		unsigned int colorCount = m_activePuyos.Count((PUYO_COLOR)color);
+		if (colorCount == 0)
+			continue;
+
+		ssData.Color = ms_PuyoColors[color];
+		packet.instanceCount = colorCount;
+		packet.startInstance = m_puyoInstanceStarts[color];
+		m_drawList.Submit(DrawList::MakeKey(FRONTFACE_PASS, packet.state, packet.material, packet.mesh), packet);
 	}
+
+	m_drawList.Sort();
 }
 
 //void PuyoGame::Render()
@@ -374,42 +509,43 @@ void PuyoGame::Render()
 //	}
 //}
 
-void PuyoGame::RenderDepth()
-{
-	Material& depthOnlyMaterial = RenderManager::GetSingleton().GetMaterial(m_depthOnlyMaterial);
-	DepthOnlyVSBufferData vsData;
-
-	for (Puyo* puyo : m_activePuyoList)
-	{
-		XMMATRIX worldMatrix = puyo->transform.GetWorldMatrix();
-		XMMATRIX viewMatrix = m_orthoCamera.GetViewMatrix();
-		XMMATRIX projMatrix = m_orthoCamera.GetProjectionMatrix();
-		vsData.WorldViewProjectionMatrix = worldMatrix * viewMatrix * projMatrix;
-		RenderManager::GetSingleton().UpdateConstantBuffer(depthOnlyMaterial.vsCBHandle, &vsData);
-		RenderManager::GetSingleton().DrawWithMaterial(m_puyoMesh, m_depthOnlyMaterial);
-	}
-}
-
 Puyo* PuyoGame::AllocPuyo()
 {
-	// Get and initialize a new puyo object
+	// Get and initialize a new puyo object. The pool grows instead of running out, so this is only null if that failed.
 	Puyo* newPuyo = m_puyoPool.AllocObject();
+	if (!newPuyo)
+		return nullptr;
+
 	newPuyo->SetRandomColor();
-	m_activePuyoList.push_front(newPuyo);
-	
-	// Because we added a new puyo to the list, it needs to be re-sorted.
-	m_puyoListDirty = true;
+	m_activePuyos.Add(newPuyo);
 
 	return newPuyo;
 }
 
 void PuyoGame::FreePuyo(Puyo* puyo)
 {
-	m_activePuyoList.remove(puyo);
+	assert(m_puyoPool.IsAlive(puyo) && "Freeing a puyo that was already freed");
+
+	m_activePuyos.Remove(puyo);
 	m_puyoPool.FreeObject(puyo);
 }
 
-const PuyoInstance* PuyoGame::GetInstance(UINT8 playerNumber) const
+PHANDLE PuyoGame::GetPuyoHandle(const Puyo* puyo) const
+{
+	return m_puyoPool.GetHandle(puyo);
+}
+
+Puyo* PuyoGame::GetPuyo(PHANDLE handle) const
+{
+	return m_puyoPool.Get(handle);
+}
+
+const PuyoInstance* PuyoGame::GetInstance(uint8_t playerNumber) const
 {
 	return playerNumber == 0U ? &m_p1Instance : &m_p2Instance;
 }
+
+const FrameGraph& PuyoGame::GetFrameGraph() const
+{
+	return m_frameGraph;
+}
@@ -1,32 +1,34 @@
 #pragma once
 #include "Singleton.h"
 #include "RenderManager.h"
-#include "ObjectPool.h"
+#include "ConcurrentObjectPool.h"
 #include "PuyoInstance.h"
 #include "PlayerController.h"
+#include "ScriptedController.h"
 #include "Puyo.h"
+#include "PuyoRenderList.h"
 #include "BufferUtils.h"
-#include <forward_list>
+#include "DrawList.h"
+#include "FrameGraph.h"
 
 
-class PuyoGame : Singleton<PuyoGame>
+class PuyoGame : public Singleton<PuyoGame>
 {
 private:
 
 	// Resources for Drawing The Game
 	static DirectX::XMFLOAT4 ms_PuyoColors[PUYO_COLOR_COUNT];
 	Camera m_orthoCamera;
-	RHANDLE m_puyoMesh;
+	MeshHandle m_puyoMesh;
 
 	// Materials
-	RHANDLE m_puyoMaterial;
-	RHANDLE m_depthOnlyMaterial;
-	RHANDLE m_subsurfaceMaterial;
+	MaterialHandle m_puyoMaterial;
+	MaterialHandle m_depthOnlyMaterial;
+	MaterialHandle m_subsurfaceMaterial;
 
 	// Puyo Management
-	ObjectPool<Puyo> m_puyoPool{ 256 };
-	std::forward_list<Puyo*> m_activePuyoList;
-	bool m_puyoListDirty; // If true, puyo list has changed and puyos must be sorted before being drawn
+	ConcurrentObjectPool<Puyo> m_puyoPool{ 256 }; // Grows 256 puyos at a time, and any thread can allocate from it
+	PuyoRenderList m_activePuyos; // Every live puyo, already grouped by color for drawing
 
 	// Player Instances
 	PuyoInstance m_p1Instance;
@@ -36,17 +38,44 @@ private:
 	PlayerController m_p1Controller;
 	PlayerController m_p2Controller;
 
+	// Stand-ins for the players when the game is scripted
+	ScriptedController m_p1Script;
+	ScriptedController m_p2Script;
+	bool m_scripted;
+
+	void StartMatch();
+
 	void LoadAssets();
-	void Render();
-	void RenderDepth();
+
+	// The passes the puyos are drawn in, which is also their order in the draw list
+	enum PUYO_PASS
+	{
+		BACKFACE_DEPTH_PASS,
+		FRONTFACE_PASS,
+		PUYO_PASS_COUNT
+	};
+
+	// Per puyo data for the instanced draws, filled in once a frame before either pass. Each color's puyos are one run
+	// of instances, starting at m_puyoInstanceStarts[color].
+	InstanceBuffer m_puyoInstances;
+	unsigned int m_puyoInstanceStarts[PUYO_COLOR_COUNT];
+	void UpdatePuyoInstances();
+
+	// Every puyo draw for the frame, recorded up front and then executed a pass at a time
+	DrawList m_drawList;
+	void BuildDrawList(const CameraConstants& camera);
+
+	// The frame's passes and the backface depth the puyos are drawn with, which only exists while they're being drawn.
+	// The passes only read the draw list, so the graph records each one on whichever thread the job system hands it to.
+	FrameGraph m_frameGraph;
+	static void DrawOverlayPass(void* data, const FrameGraph& graph);
+	static void DrawBackfaceDepthPass(void* data, const FrameGraph& graph);
+	static void DrawFrontfacePass(void* data, const FrameGraph& graph);
 
 	// We're gonna use a stencil for this just because we can!!
 	DepthStencilBuffer m_gridStencil;
 	void InitGridStencil();
 
-	// This is used for the effect used to draw the puyos
-	DepthStencilBuffer m_backfaceDepth;
-
 	// Procedural voronoi texture used in the background of the puyo grids
 	RenderTarget2D m_gridTexture;
 
@@ -54,18 +83,30 @@ private:
 	RenderTarget2D m_overlayTexture;
 
 public:
-	PuyoGame();
+	// A scripted game plays the same canned inputs every time instead of reading the keyboard
+	explicit PuyoGame(bool scripted = false);
 	~PuyoGame();
 
+	// Returns false if either player's game is over
 	bool Update(double dt);
 
-	// Obtains a puyo from the object pool, adds it to the active list, then returns it
+	// Returns every puyo to the pool and starts both players over with empty grids
+	void RestartMatch();
+
+	// Obtains a puyo from the object pool, gives it a random color, adds it to the active list, then returns it.
+	// Returns nullptr if the pool is out of memory.
 	Puyo* AllocPuyo();
 
 	// Removes a puyo from the active list, then returns its memory to the object pool
 	void FreePuyo(Puyo*);
 
-	const PuyoInstance* GetInstance(UINT8 playerNumber) const;
+	// Handles stay safe to hold on to after the puyo is freed. GetPuyo returns nullptr for them instead of a dangling pointer.
+	PHANDLE GetPuyoHandle(const Puyo* puyo) const;
+	Puyo* GetPuyo(PHANDLE handle) const;
+
+	const PuyoInstance* GetInstance(uint8_t playerNumber) const;
+
+	const FrameGraph& GetFrameGraph() const;
 
 	static PuyoGame& GetSingleton();
 	static PuyoGame* GetSingletonPtr();
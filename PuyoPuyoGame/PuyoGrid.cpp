@@ -59,7 +59,6 @@ void PuyoGrid::CheckPuyo(int x, int y, PUYO_COLOR c, Puyo** comboStaging, int& c
 
 void PuyoGrid::AddPuyo(Puyo* puyo, int x, int y)
 {
-	printf("Puyo was at position: %d, %d \n", x, y);
 	assert(x < GRID_WIDTH);
 	assert(y < GRID_HEIGHT);
 	assert(!m_grid[x][y]);
@@ -1,5 +1,4 @@
 #pragma once
-#include "DirectXIncludes.h"
 #include "Puyo.h"
 #include "PuyoValues.h"
 
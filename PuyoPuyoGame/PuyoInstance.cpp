@@ -9,8 +9,11 @@ using namespace DirectX;
 using namespace XMExtensions;
 
 PuyoInstance::PuyoInstance(bool rightSide)
-	: m_controller(nullptr)
-	, m_gameState(PUYO_STATE::RESOLVING)
+	: m_gameState(PUYO_STATE::RESOLVING)
+	, m_currentUnit(nullptr)
+	, m_fallingCount(0)
+	, m_disappearingCount(0)
+	, m_controller(nullptr)
 {
 	// Add initialization code here!
 	transform.SetScale(XMVectorSet(PUYO_SIZE, PUYO_SIZE, PUYO_SIZE, PUYO_SIZE));
@@ -29,16 +32,16 @@ PuyoInstance::~PuyoInstance()
 void PuyoInstance::Initialize(PuyoController* controller)
 {
 	m_controller = controller;
-	m_gameState = PUYO_STATE::RESOLVING;
-	m_puyoQueue.Initialize();
+	// Without a full queue there's nothing to play with, so running out of memory here ends the game right away
+	m_gameState = m_puyoQueue.Initialize() ? PUYO_STATE::RESOLVING : PUYO_STATE::GAME_OVER;
 }
 
 void PuyoInstance::Cleanup()
 {
 	m_puyoGrid.Cleanup();
-	m_fallingPuyos.clear();
-	m_disappearingPuyos.clear();
-	
+	m_fallingCount = 0;
+	m_disappearingCount = 0;
+	m_currentUnit = nullptr;
 }
 
 // ***************************************************************
@@ -105,19 +108,25 @@ void PuyoInstance::HandleFloatingPuyos()
 
 			if (m_puyoGrid.CheckOpenSpace(i, j - 1))
 			{
-				m_fallingPuyos.push_back(m_puyoGrid.RemovePuyo(i, j));
+				AddFallingPuyo(m_puyoGrid.RemovePuyo(i, j));
 			}
 		}
 	}
 }
 
+void PuyoInstance::AddFallingPuyo(Puyo* puyo)
+{
+	assert(m_fallingCount < GRID_WIDTH * GRID_HEIGHT && "More puyos falling than fit in the grid");
+	m_fallingPuyos[m_fallingCount++] = puyo;
+}
+
 // Removes puyos in the combo list from the grid and deallocates them
-void PuyoInstance::RemoveComboPuyos(int comboSize)
+void PuyoInstance::RemoveComboPuyos(Puyo** combo, int comboSize)
 {
 	XMFLOAT2 pos;
 	for (int i = 0; i < comboSize; i++)
 	{
-		XMStoreFloat2(&pos, m_comboStaging[i]->transform.GetPosition());
+		XMStoreFloat2(&pos, combo[i]->transform.GetPosition());
 		PuyoGame::GetSingleton().FreePuyo(m_puyoGrid.RemovePuyo((int)pos.x, (int)pos.y));
 	}
 
@@ -127,17 +136,18 @@ void PuyoInstance::RemoveComboPuyos(int comboSize)
 // Identify any puyos that are part of a combo and add them to our staging area to be removed
 void PuyoInstance::CheckForCombos()
 {
-	// Clear the combo staging array
-	memset(m_comboStaging, 0, sizeof(m_comboStaging));
+	// The staging area is only needed until the combo is removed, so it comes from the frame allocator. AllocArray
+	// hands it back already cleared.
+	Puyo** comboStaging = FrameAllocator::GetSingleton().AllocArray<Puyo*>(GRID_WIDTH * GRID_HEIGHT);
 
-	int comboSize = m_puyoGrid.FindCombos(m_comboStaging);
+	int comboSize = m_puyoGrid.FindCombos(comboStaging);
 	
 	if (comboSize == 0)
 		return;
 
 	// TODO: Ideally, this won't happen yet. We will enter some fading stage where the puyos disappear before we
 	//		 call RemoveComboPuyos.
-	RemoveComboPuyos(comboSize);
+	RemoveComboPuyos(comboStaging, comboSize);
 }
 
 bool PuyoInstance::DoPlayerControl(double dt)
@@ -203,7 +213,7 @@ bool PuyoInstance::DoPlayerControl(double dt)
 	}
 	else
 	{
-		m_fallingPuyos.push_back(otherPuyo);
+		AddFallingPuyo(otherPuyo);
 	}
 
 	// If contact was made, we need to resolve!
@@ -218,11 +228,12 @@ bool PuyoInstance::DoResolve(double dt)
 	XMFLOAT2 pos;
 	float dy = dt * FALL_SPEED_FAST;
 
-	// Check each puyo in the falling puyos list to see if it has made contact with another puyo and make if fall if not
-	auto itr = m_fallingPuyos.begin();
-	while (itr != m_fallingPuyos.end())
+	// Check each puyo in the falling puyos list to see if it has made contact with another puyo and make if fall if not.
+	// The ones still falling get packed down to the front of the array in the same order.
+	int stillFalling = 0;
+	for (int i = 0; i < m_fallingCount; i++)
 	{
-		Puyo* p = *itr;
+		Puyo* p = m_fallingPuyos[i];
 		XMStoreFloat2(&pos, p->transform.GetPosition());
 		if (!CheckValidSpace(XMFLOAT2(pos.x, pos.y + dy)))
 		{
@@ -232,30 +243,42 @@ bool PuyoInstance::DoResolve(double dt)
 				y++;
 
 			m_puyoGrid.AddPuyo(p, x, y);
-			m_fallingPuyos.erase(itr++);
-
-			// TODO: Add check to go to game over if puyos are placed in game over zone
 		}
 		else
 		{
 			p->transform.Translate(XMVectorSet(0.0f, dy, 0.0f, 0.0f));
-			++itr;
+			m_fallingPuyos[stillFalling++] = p;
 		}
 	}
+	m_fallingCount = stillFalling;
 
 	// If there were still puyos left in the list after that check, we'll have to continue for another frame
-	if (m_fallingPuyos.size() > 0)
+	if (m_fallingCount > 0)
 		return true;
 
 	// If all of the falling puyos were added to the grid, we need to check for combos
 	CheckForCombos();
 
 	// If there were new falling puyos added after the combo check, we will have to continue for another frame
-	if (m_fallingPuyos.size() > 0)
+	if (m_fallingCount > 0)
 		return true;
 
+	// New units show up at the spawn point with their second puyo right above it, so once the stack reaches the spawn
+	// point there's nowhere for the next one to go
+	if (!m_puyoGrid.CheckOpenSpace((int)PUYO_SPAWN_X, (int)PUYO_SPWAN_Y))
+	{
+		m_gameState = PUYO_STATE::GAME_OVER;
+		return false;
+	}
+
 	// If we are out of falling puyos, it is time to return control to the player
 	m_currentUnit = m_puyoQueue.GetNextUnit();
+	if (!m_currentUnit)
+	{
+		m_gameState = PUYO_STATE::GAME_OVER;
+		return false;
+	}
+
 	m_currentUnit->SetParent(&transform);
 	m_currentUnit->SetPosition(PUYO_SPAWN_X, PUYO_SPWAN_Y);
 	m_gameState = PUYO_STATE::PLAYER_CONTROL;
@@ -344,8 +367,12 @@ const PuyoGrid& PuyoInstance::GetGrid() const
 	return m_puyoGrid;
 }
 
-void PuyoInstance::GetCurrentUnit(int unitStaging[5]) const
+bool PuyoInstance::GetCurrentUnit(int unitStaging[5]) const
 {
+	// Once a unit lands, its puyos belong to the grid and the pointer is stale until the next unit is dispensed
+	if (!m_currentUnit || (m_gameState != PUYO_STATE::PLAYER_CONTROL && m_gameState != PUYO_STATE::PAUSED))
+		return false;
+
 	// Position (x, y)
 	unitStaging[0] = (int)m_currentUnit->GetPosition(0).x;
 	unitStaging[1] = (int)m_currentUnit->GetPosition(0).y;
@@ -361,4 +388,6 @@ void PuyoInstance::GetCurrentUnit(int unitStaging[5]) const
 	// Colors
 	unitStaging[3] = m_currentUnit->puyos[0]->puyoColor;
 	unitStaging[4] = m_currentUnit->puyos[1]->puyoColor;
+
+	return true;
 }
@@ -4,7 +4,6 @@
 #include "PuyoQueue.h"
 #include "PuyoController.h"
 #include "PuyoValues.h"
-#include <forward_list>
 
 class PuyoInstance
 {
@@ -19,11 +18,15 @@ private:
 	PUYO_STATE m_gameState;
 
 	PuyoGrid m_puyoGrid;
-	Puyo* m_comboStaging[GRID_WIDTH * GRID_HEIGHT] = {};
 	PuyoQueue m_puyoQueue;
 	PuyoUnit* m_currentUnit;
-	std::list<Puyo*> m_fallingPuyos;
-	std::list<Puyo*> m_disappearingPuyos;
+
+	// Fixed size so nothing in here touches the heap during play. Nothing can fall or disappear that wouldn't fit in
+	// the grid.
+	Puyo* m_fallingPuyos[GRID_WIDTH * GRID_HEIGHT];
+	int m_fallingCount;
+	Puyo* m_disappearingPuyos[GRID_WIDTH * GRID_HEIGHT];
+	int m_disappearingCount;
 
 	PuyoController* m_controller;
 
@@ -33,8 +36,9 @@ private:
 	bool CheckValidMove(int dx, int dy) const;
 	void TryRotation();
 	void CheckForCombos();
-	void RemoveComboPuyos(int count);
+	void RemoveComboPuyos(Puyo** combo, int count);
 	void HandleFloatingPuyos();
+	void AddFallingPuyo(Puyo* puyo);
 
 	// State functions
 	bool DoPlayerControl(double dt);
@@ -61,8 +65,8 @@ public:
 	const PuyoGrid& GetGrid() const;
 
 	// Obtains the position (x, y), the orientation (0 = up, 1 = right, 2 = down, 3 = left), and the colors of each puyo in the unit,
-	// storing them in unitStaging.
-	void GetCurrentUnit(int unitStaging[5]) const;
+	// storing them in unitStaging. Returns false if there is no unit under control right now.
+	bool GetCurrentUnit(int unitStaging[5]) const;
 
 	// A pointer to a function in the outside game that allows this instance to send garbage puyos to a rival instance.
 	void(*SendGarbage)(int instanceID, int garbageCount);
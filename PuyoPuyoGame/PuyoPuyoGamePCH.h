@@ -1,4 +1,11 @@
 #pragma once
 
 #include "GameEngine.h"
-#include <lua.hpp>
\ No newline at end of file
+#include <lua.hpp>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+
+// These used to come from windows.h, which the game no longer includes
+using std::min;
+using std::max;
\ No newline at end of file
@@ -37,7 +37,6 @@ void PuyoUnit::Initialize(Transform* parent, Puyo* pivot, Puyo* hanging)
 	for (int i = 0; i < 2; i++)
 	{
 		puyos[i]->transform.SetParent(parent);
-		puyos[i]->SetRandomColor();
 	}
 
 	SetRotation(0, 1);
@@ -122,11 +121,12 @@ PuyoQueue::~PuyoQueue()
 {
 }
 
-void PuyoQueue::Initialize()
+bool PuyoQueue::Initialize()
 {
 	for (int i = 0; i < 4; i++)
 	{
-		InitializeUnit(m_puyoUnits[i]);
+		if (!InitializeUnit(m_puyoUnits[i]))
+			return false;
 
 		// Debug
 		m_puyoUnits[i].SetPosition((float)i, 0.0f);
@@ -134,13 +134,27 @@ void PuyoQueue::Initialize()
 	}
 
 	// Maybe call a function here to position the puyos in the proper order?
+	return true;
 }
 
-void PuyoQueue::InitializeUnit(PuyoUnit& unit)
+bool PuyoQueue::InitializeUnit(PuyoUnit& unit)
 {
-	unit.Initialize(&transform, 
-		PuyoGame::GetSingleton().AllocPuyo(), 
-		PuyoGame::GetSingleton().AllocPuyo());
+	PuyoGame& game = PuyoGame::GetSingleton();
+	Puyo* hanging = game.AllocPuyo();
+	Puyo* pivot = game.AllocPuyo();
+
+	// Out of memory. Give back whichever one we did get and leave the unit alone.
+	if (!pivot || !hanging)
+	{
+		if (pivot)
+			game.FreePuyo(pivot);
+		if (hanging)
+			game.FreePuyo(hanging);
+		return false;
+	}
+
+	unit.Initialize(&transform, pivot, hanging);
+	return true;
 }
 
 PuyoUnit* PuyoQueue::GetNextUnit()
@@ -149,7 +163,8 @@ PuyoUnit* PuyoQueue::GetNextUnit()
 	PuyoUnit& end = m_puyoUnits[head - 1 < 0 ? 3 : head - 1];
 
 	// Generate Two New Puyos for the new last spot in the queue
-	InitializeUnit(end);
+	if (!InitializeUnit(end))
+		return nullptr;
 
 	// Remove the current front of the queue and move it to the back
 	head = (++head) % 4;
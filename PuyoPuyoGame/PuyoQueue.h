@@ -47,20 +47,23 @@ private:
 	int head = 0;
 	PuyoUnit m_puyoUnits[4];
 
-	void InitializeUnit(PuyoUnit& unit);
+	// Returns false, leaving the unit untouched, if there was no memory for its puyos
+	bool InitializeUnit(PuyoUnit& unit);
 	// TODO: Add functionality for animating the queued puyos.
 
 public:
 	PuyoQueue();
 	~PuyoQueue();
 
-	void Initialize();
+	// Returns false if the puyo pool ran out of memory before the queue was filled
+	bool Initialize();
 
 	Transform transform;
 
 	// TODO: Implement this. It should perform any animations that are necessary.
 	void Update(double dt);
 
+	// Returns nullptr if there was no memory for the unit that replaces it at the back of the queue
 	PuyoUnit* GetNextUnit();
 };
 
@@ -0,0 +1,119 @@
+#include "PuyoPuyoGamePCH.h"
+#include "PuyoRenderList.h"
+#include "PuyoValues.h"
+
+using namespace DirectX;
+
+
+PuyoRenderList::PuyoRenderList()
+{
+	// Enough that even a whole match of one color never has to grow a list mid-game: two full grids plus the units
+	// in play and in the queues
+	for (int i = 0; i < PUYO_COLOR_COUNT; i++)
+	{
+		m_data[i].reserve(2 * (GRID_WIDTH * GRID_HEIGHT + 10));
+		m_puyos[i].reserve(2 * (GRID_WIDTH * GRID_HEIGHT + 10));
+		m_worldVersions[i].reserve(2 * (GRID_WIDTH * GRID_HEIGHT + 10));
+	}
+}
+
+
+PuyoRenderList::~PuyoRenderList()
+{
+}
+
+void PuyoRenderList::CopyRenderData(const Puyo* puyo, PuyoRenderData& data)
+{
+	XMStoreFloat4x3(&data.World, puyo->transform.GetWorldMatrix());
+	XMStoreFloat3x3(&data.NormalMatrix, puyo->transform.GetInverseTransposeWorldMatrix());
+}
+
+void PuyoRenderList::Add(Puyo* puyo)
+{
+	assert(puyo->puyoColor < PUYO_COLOR_COUNT);
+	assert(puyo->renderIndex == PUYO_NO_RENDER_INDEX && "Puyo is already in the render list");
+
+	PUYO_COLOR color = puyo->puyoColor;
+	puyo->renderIndex = (unsigned int)m_puyos[color].size();
+	m_puyos[color].push_back(puyo);
+	m_worldVersions[color].push_back(puyo->transform.GetWorldVersion());
+
+	m_data[color].emplace_back();
+	CopyRenderData(puyo, m_data[color].back());
+}
+
+void PuyoRenderList::Remove(Puyo* puyo)
+{
+	PUYO_COLOR color = puyo->puyoColor;
+	std::vector<Puyo*>& puyos = m_puyos[color];
+	unsigned int index = puyo->renderIndex;
+	assert(index < puyos.size() && puyos[index] == puyo && "Puyo isn't in the render list (or changed color while in it)");
+
+	// Move the last puyo of this color into the hole
+	Puyo* last = puyos.back();
+	puyos[index] = last;
+	m_data[color][index] = m_data[color].back();
+	m_worldVersions[color][index] = m_worldVersions[color].back();
+	last->renderIndex = index;
+
+	puyos.pop_back();
+	m_data[color].pop_back();
+	m_worldVersions[color].pop_back();
+
+	puyo->renderIndex = PUYO_NO_RENDER_INDEX;
+}
+
+void PuyoRenderList::Clear()
+{
+	for (int i = 0; i < PUYO_COLOR_COUNT; i++)
+	{
+		for (Puyo* puyo : m_puyos[i])
+			puyo->renderIndex = PUYO_NO_RENDER_INDEX;
+
+		m_data[i].clear();
+		m_puyos[i].clear();
+		m_worldVersions[i].clear();
+	}
+}
+
+void PuyoRenderList::Update()
+{
+	for (int color = 0; color < PUYO_COLOR_COUNT; color++)
+	{
+		const std::vector<Puyo*>& puyos = m_puyos[color];
+		std::vector<unsigned int>& worldVersions = m_worldVersions[color];
+		for (unsigned int i = 0; i < (unsigned int)puyos.size(); i++)
+		{
+			unsigned int worldVersion = puyos[i]->transform.GetWorldVersion();
+			if (worldVersion == worldVersions[i])
+				continue;
+
+			CopyRenderData(puyos[i], m_data[color][i]);
+			worldVersions[i] = worldVersion;
+		}
+	}
+}
+
+const PuyoRenderData* PuyoRenderList::GetRenderData(PUYO_COLOR color) const
+{
+	return m_data[color].data();
+}
+
+const std::vector<Puyo*>& PuyoRenderList::GetPuyos(PUYO_COLOR color) const
+{
+	return m_puyos[color];
+}
+
+unsigned int PuyoRenderList::Count(PUYO_COLOR color) const
+{
+	return (unsigned int)m_data[color].size();
+}
+
+unsigned int PuyoRenderList::Count() const
+{
+	unsigned int count = 0;
+	for (int i = 0; i < PUYO_COLOR_COUNT; i++)
+		count += (unsigned int)m_data[i].size();
+
+	return count;
+}
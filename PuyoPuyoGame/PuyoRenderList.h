@@ -0,0 +1,46 @@
+#pragma once
+#include "Puyo.h"
+#include <vector>
+
+// What the render passes need from a puyo: its world matrix (always affine, so the last column is left out) and the
+// upper 3x3 of its inverse transpose for the normals. This is also exactly what the instanced vertex shaders read.
+struct PuyoRenderData
+{
+	DirectX::XMFLOAT4X3 World;
+	DirectX::XMFLOAT3X3 NormalMatrix;
+};
+
+// The render data of every live puyo, kept by value and grouped by color, so the render passes walk each color's
+// puyos as one contiguous array and only switch the color constants once per color. Puyos remember where they sit
+// (Puyo::renderIndex), which makes removal a swap with the last puyo of the same color instead of a search.
+//
+// Update copies the matrices over from the puyos that moved since it was last called, going by their transforms'
+// world versions, so puyos sitting still on the grid cost a compare and nothing else.
+//
+// A puyo's color must not change while it is in the list. Remove it, recolor it, and add it back.
+class PuyoRenderList
+{
+private:
+	// Side by side for each color: the render data, whose it is, and the world version it was copied at
+	std::vector<PuyoRenderData> m_data[PUYO_COLOR_COUNT];
+	std::vector<Puyo*> m_puyos[PUYO_COLOR_COUNT];
+	std::vector<unsigned int> m_worldVersions[PUYO_COLOR_COUNT];
+
+	static void CopyRenderData(const Puyo* puyo, PuyoRenderData& data);
+
+public:
+	PuyoRenderList();
+	~PuyoRenderList();
+
+	void Add(Puyo* puyo);
+	void Remove(Puyo* puyo);
+	void Clear();
+
+	// Brings the render data of every puyo that moved up to date. Best called once the frame's world matrices are.
+	void Update();
+
+	const PuyoRenderData* GetRenderData(PUYO_COLOR color) const;
+	const std::vector<Puyo*>& GetPuyos(PUYO_COLOR color) const;
+	unsigned int Count(PUYO_COLOR color) const;
+	unsigned int Count() const;
+};
@@ -0,0 +1,311 @@
+#include "PuyoPuyoGamePCH.h"
+#include "PuyoSoftwareShaders.h"
+#include "SoftwareShader.h"
+
+// Shader Includes
+#include "SimpleVertexShader.h"
+#include "UnlitPixelShader.h"
+#include "DepthOnlyPS.h"
+#include "DepthOnlyVS.h"
+#include "InstancedPuyoVS.h"
+#include "InstancedDepthOnlyVS.h"
+#include "SubsurfacePuyoPS.h"
+#include "GridBackgroundPS.h"
+#include "GridBackgroundVoronoiPS.h"
+
+// Each kernel does what the HLSL in Data does, eight vertices or pixels at a time. Branches become selects, since
+// every lane has to take both sides anyway.
+//
+// The puyo pixel shaders get SimpleVertexShader's (or InstancedPuyoVS's) outputs: PositionWS in varyings 0-3, NormalWS in 4-6 and TexCoord in
+// 7-8. The grid backgrounds are drawn with RenderFullscreen, so they get the engine's BlitVertexShader's TexCoord in 0-1.
+
+// ***************************************************************************************
+// UnlitPixelShader.hlsl
+// ***************************************************************************************
+static void UnlitPS(const SoftwareShaderResources& resources, SoftwarePixelBatch& batch)
+{
+	// SingleColor: PixelColor
+	const float* pixelColor = (const float*)resources.constantBuffers[0];
+
+	for (int c = 0; c < 4; c++)
+		SIMDFloat(pixelColor[c]).Store(batch.color[c]);
+}
+
+// ***************************************************************************************
+// DepthOnlyVS.hlsl
+// ***************************************************************************************
+static void DepthOnlyVS(const SoftwareShaderResources& resources, SoftwareVertexBatch& batch)
+{
+	// DepthOnlyConstants: WorldViewProjectionMatrix
+	const float* worldViewProjection = (const float*)resources.constantBuffers[0];
+
+	SIMDFloat x = SIMDFloat::Load(batch.inputs[0][0]), y = SIMDFloat::Load(batch.inputs[0][1]), z = SIMDFloat::Load(batch.inputs[0][2]);
+	TransformVector(worldViewProjection, x, y, z, true, 4, batch.position);
+}
+
+// The instanced vertex shaders' world matrix rows, starting at input `first`. They're per instance, so every lane holds
+// the same value and the first one is all that needs reading.
+static void TransformByInstanceWorld(const SoftwareVertexBatch& batch, int first, const SIMDFloat& x, const SIMDFloat& y, const SIMDFloat& z, SIMDFloat out[3])
+{
+	for (int c = 0; c < 3; c++)
+	{
+		out[c] = MultiplyAdd(x, SIMDFloat(batch.inputs[first][c][0]),
+			MultiplyAdd(y, SIMDFloat(batch.inputs[first + 1][c][0]),
+			MultiplyAdd(z, SIMDFloat(batch.inputs[first + 2][c][0]), SIMDFloat(batch.inputs[first + 3][c][0]))));
+	}
+}
+
+// ***************************************************************************************
+// InstancedPuyoVS.hlsl
+// ***************************************************************************************
+static void InstancedPuyoVS(const SoftwareShaderResources& resources, SoftwareVertexBatch& batch)
+{
+	// PerFrame: ViewProjectionMatrix
+	const float* viewProjection = (const float*)resources.constantBuffers[0];
+
+	SIMDFloat px = SIMDFloat::Load(batch.inputs[0][0]), py = SIMDFloat::Load(batch.inputs[0][1]), pz = SIMDFloat::Load(batch.inputs[0][2]);
+	SIMDFloat nx = SIMDFloat::Load(batch.inputs[1][0]), ny = SIMDFloat::Load(batch.inputs[1][1]), nz = SIMDFloat::Load(batch.inputs[1][2]);
+
+	// PositionWS from World0-3 (inputs 3-6), then on to clip space
+	SIMDFloat world[3];
+	TransformByInstanceWorld(batch, 3, px, py, pz, world);
+	for (int c = 0; c < 3; c++)
+		world[c].Store(batch.varyings[c]);
+	SIMDFloat(1.0f).Store(batch.varyings[3]);
+	TransformVector(viewProjection, world[0], world[1], world[2], true, 4, batch.position);
+
+	// NormalWS from NormalMatrix0-2 (inputs 7-9)
+	for (int c = 0; c < 3; c++)
+	{
+		SIMDFloat normal = MultiplyAdd(nx, SIMDFloat(batch.inputs[7][c][0]),
+			MultiplyAdd(ny, SIMDFloat(batch.inputs[8][c][0]), nz * SIMDFloat(batch.inputs[9][c][0])));
+		normal.Store(batch.varyings[4 + c]);
+	}
+
+	// TexCoord
+	SIMDFloat::Load(batch.inputs[2][0]).Store(batch.varyings[7]);
+	SIMDFloat::Load(batch.inputs[2][1]).Store(batch.varyings[8]);
+}
+
+// ***************************************************************************************
+// InstancedDepthOnlyVS.hlsl
+// ***************************************************************************************
+static void InstancedDepthOnlyVS(const SoftwareShaderResources& resources, SoftwareVertexBatch& batch)
+{
+	// PerFrame: ViewProjectionMatrix
+	const float* viewProjection = (const float*)resources.constantBuffers[0];
+
+	SIMDFloat x = SIMDFloat::Load(batch.inputs[0][0]), y = SIMDFloat::Load(batch.inputs[0][1]), z = SIMDFloat::Load(batch.inputs[0][2]);
+	SIMDFloat world[3];
+	TransformByInstanceWorld(batch, 1, x, y, z, world);
+	TransformVector(viewProjection, world[0], world[1], world[2], true, 4, batch.position);
+}
+
+// ***************************************************************************************
+// DepthOnlyPS.hlsl
+// ***************************************************************************************
+static void DepthOnlyPS(const SoftwareShaderResources&, SoftwarePixelBatch& batch)
+{
+	SIMDFloat(0.0f).Store(batch.color[0]);
+	SIMDFloat(0.0f).Store(batch.color[1]);
+	SIMDFloat(0.0f).Store(batch.color[2]);
+	SIMDFloat(1.0f).Store(batch.color[3]);
+}
+
+// ***************************************************************************************
+// SubsurfacePuyoPS.hlsl
+// ***************************************************************************************
+static void SubsurfacePuyoPS(const SoftwareShaderResources& resources, SoftwarePixelBatch& batch)
+{
+	// SubsurfaceConstants: Color in c0, LightPos in c1.xyz. Near and Far aren't used (yet).
+	const float* constants = (const float*)resources.constantBuffers[0];
+	const float* color = constants;
+	const float* lightPos = constants + 4;
+
+	SIMDFloat nx = SIMDFloat::Load(batch.varyings[4]), ny = SIMDFloat::Load(batch.varyings[5]), nz = SIMDFloat::Load(batch.varyings[6]);
+	Normalize(nx, ny, nz);
+
+	// How much puyo is behind this pixel, from the backface depth pass
+	SIMDFloat backDepth[4];
+	SIMDFloat u = SIMDFloat::Load(batch.position[0]) * SIMDFloat(1.0f / 800.0f);
+	SIMDFloat v = SIMDFloat::Load(batch.position[1]) * SIMDFloat(1.0f / 600.0f);
+	SampleTexture(resources.textures[0], resources.samplers[0], u, v, backDepth);
+	SIMDFloat t = backDepth[0] - SIMDFloat::Load(batch.position[2]);
+
+	// The pows all have small whole exponents, so they're multiplies (which is what fxc makes of them too).
+	// dot(n, float3(0, 0, -1)) is just -nz.
+	SIMDFloat b = Exp(SIMDFloat(-2.0f) * t);
+
+	SIMDFloat rim = SIMDFloat(1.0f) - Abs(nz);
+	SIMDFloat rim2 = rim * rim;
+	SIMDFloat f = SIMDFloat(1.0f) - rim2 * rim2;
+
+	SIMDFloat s = Saturate(nx * SIMDFloat(lightPos[0]) + ny * SIMDFloat(lightPos[1]) + nz * SIMDFloat(lightPos[2]));
+	for (int i = 0; i < 6; i++)
+		s = s * s;
+
+	SIMDFloat edge = SIMDFloat(1.0f) + nz;
+	SIMDFloat e = edge * edge * edge;
+
+	for (int c = 0; c < 3; c++)
+		(b * SIMDFloat(color[c]) + s + e).Store(batch.color[c]);
+	f.Store(batch.color[3]);
+}
+
+// ***************************************************************************************
+// GridBackgroundPS.hlsl
+// ***************************************************************************************
+#define BRICK_SCALE 20.0f
+
+static void GridBackgroundPS(const SoftwareShaderResources&, SoftwarePixelBatch& batch)
+{
+	SIMDFloat u = SIMDFloat::Load(batch.varyings[0]) * SIMDFloat(0.7f);
+	SIMDFloat v = SIMDFloat(1.0f) - SIMDFloat::Load(batch.varyings[1]);
+
+	// Every other row of bricks is offset by half a brick
+	SIMDFloat oddRow = Fmod(v * SIMDFloat(BRICK_SCALE), SIMDFloat(2.0f)) > SIMDFloat(1.0f);
+	u += And(oddRow, SIMDFloat((1.0f / BRICK_SCALE) * 0.5f));
+
+	SIMDFloat mu = Abs(Fmod(u * SIMDFloat(BRICK_SCALE), SIMDFloat(1.0f)) - SIMDFloat(0.5f));
+	SIMDFloat mv = Abs(Fmod(v * SIMDFloat(BRICK_SCALE), SIMDFloat(1.0f)) - SIMDFloat(0.5f));
+	SIMDFloat m = Smoothstep(0.0f, 0.75f, SIMDFloat(1.0f) - Max(mu, mv));
+
+	(SIMDFloat(0.7f) * m).Store(batch.color[0]);
+	(SIMDFloat(0.32f) * m).Store(batch.color[1]);
+	(SIMDFloat(0.35f) * m).Store(batch.color[2]);
+	SIMDFloat(1.0f).Store(batch.color[3]);
+}
+
+// ***************************************************************************************
+// GridBackgroundVoronoiPS.hlsl
+// ***************************************************************************************
+static void Hash22(const SIMDFloat& x, const SIMDFloat& y, const SIMDFloat& tileScale, SIMDFloat& outX, SIMDFloat& outY)
+{
+	SIMDFloat px = Fmod(x, tileScale);
+	SIMDFloat py = Fmod(y, tileScale);
+	SIMDFloat r = SIMDFloat(523.0f) * Sin(px * SIMDFloat(53.3158f) + py * SIMDFloat(43.6143f));
+	outX = Frac(SIMDFloat(15.32354f) * r);
+	outY = Frac(SIMDFloat(17.25865f) * r);
+}
+
+static SIMDFloat Voronoi(const SIMDFloat& x, const SIMDFloat& y, const SIMDFloat& tileScale)
+{
+	SIMDFloat nx = Floor(x), ny = Floor(y);
+	SIMDFloat fx = x - nx, fy = y - ny;
+
+	// Closest cell centre. The loops go over the same cells in every lane, only which one wins differs.
+	SIMDFloat md(99.0f);
+	SIMDFloat mgx(0.0f), mgy(0.0f), mvx(0.0f), mvy(0.0f);
+	for (int i = -1; i <= 1; i++)
+	{
+		for (int j = -1; j <= 1; j++)
+		{
+			SIMDFloat gx((float)i), gy((float)j);
+			SIMDFloat ox, oy;
+			Hash22(nx + gx, ny + gy, tileScale, ox, oy);
+			SIMDFloat vx = gx + ox - fx, vy = gy + oy - fy;
+
+			SIMDFloat d = vx * vx + vy * vy;
+			SIMDFloat closer = d < md;
+			md = Select(closer, d, md);
+			mgx = Select(closer, gx, mgx);
+			mgy = Select(closer, gy, mgy);
+			mvx = Select(closer, vx, mvx);
+			mvy = Select(closer, vy, mvy);
+		}
+	}
+
+	// Distance to the nearest edge between it and its neighbours
+	md = SIMDFloat(99.0f);
+	for (int i = -2; i <= 2; i++)
+	{
+		for (int j = -2; j <= 2; j++)
+		{
+			if (i == 0 && j == 0)
+				continue;
+
+			SIMDFloat gx = mgx + SIMDFloat((float)i), gy = mgy + SIMDFloat((float)j);
+			SIMDFloat ox, oy;
+			Hash22(nx + gx, ny + gy, tileScale, ox, oy);
+			SIMDFloat vx = gx + ox - fx, vy = gy + oy - fy;
+
+			SIMDFloat dx = vx - mvx, dy = vy - mvy;
+			SIMDFloat length = Sqrt(dx * dx + dy * dy);
+			SIMDFloat edge = (SIMDFloat(0.5f) * (vx + mvx) * dx + SIMDFloat(0.5f) * (vy + mvy) * dy) / length;
+
+			// Two cells with the same centre give NaN here, which min() on a GPU ignores. Min does too, as long as the
+			// NaN is the first argument.
+			md = Min(edge, md);
+		}
+	}
+
+	return Smoothstep(-0.5f, 0.7f, md);
+}
+
+static void GridBackgroundVoronoiPS(const SoftwareShaderResources& resources, SoftwarePixelBatch& batch)
+{
+	// VoronoiConstants: Color, Scale, then TileScale in the next float4
+	const float* constants = (const float*)resources.constantBuffers[0];
+	const float* color = constants;
+	SIMDFloat scale(constants[3]);
+	SIMDFloat tileScale(constants[4]);
+
+	SIMDFloat u = SIMDFloat::Load(batch.varyings[0]) * SIMDFloat(800.0f / 600.0f) * scale;
+	SIMDFloat v = SIMDFloat::Load(batch.varyings[1]) * scale;
+
+	// Bumps from the gradient of the distance to the edges
+	const float e = 0.00005f;
+	SIMDFloat f = Voronoi(u, v, tileScale);
+	SIMDFloat gradientX = (Voronoi(u + SIMDFloat(e), v, tileScale) - Voronoi(u - SIMDFloat(e), v, tileScale)) * SIMDFloat(1.0f / (e * 2.0f));
+	SIMDFloat gradientY = (Voronoi(u, v + SIMDFloat(e), tileScale) - Voronoi(u, v - SIMDFloat(e), tileScale)) * SIMDFloat(1.0f / (e * 2.0f));
+
+	SIMDFloat nx = gradientX, ny = gradientY, nz(0.9f);
+	Normalize(nx, ny, nz);
+
+	// normalize(float3(0.0, 2.0, 0.35))
+	const float lightY = 2.0f / sqrtf(2.0f * 2.0f + 0.35f * 0.35f);
+	const float lightZ = 0.35f / sqrtf(2.0f * 2.0f + 0.35f * 0.35f);
+	SIMDFloat d = Saturate(ny * SIMDFloat(lightY) + nz * SIMDFloat(lightZ));
+
+	SIMDFloat shade = f * (SIMDFloat(0.3f) + d * SIMDFloat(0.7f));
+	for (int c = 0; c < 3; c++)
+		(SIMDFloat(color[c]) * shade).Store(batch.color[c]);
+	SIMDFloat(1.0f).Store(batch.color[3]);
+}
+
+// ***************************************************************************************
+// Registration
+// ***************************************************************************************
+void RegisterPuyoSoftwareShaders()
+{
+	// The game's SimpleVertexShader is the engine's, compiled again
+	RegisterSoftwareVertexShader(g_SimpleVertexShader, sizeof(g_SimpleVertexShader), g_SoftwareSimpleVertexShader);
+
+	SoftwarePixelShader unlitPS = { UnlitPS, 0 };
+	RegisterSoftwarePixelShader(g_UnlitPixelShader, sizeof(g_UnlitPixelShader), unlitPS);
+
+	SoftwareVertexShader depthOnlyVS = { DepthOnlyVS, { { "POSITION", 0 } }, 1, 0 };
+	RegisterSoftwareVertexShader(g_DepthOnlyVS, sizeof(g_DepthOnlyVS), depthOnlyVS);
+
+	SoftwareVertexShader instancedPuyoVS = { InstancedPuyoVS, {
+		{ "POSITION", 0 }, { "NORMAL", 0 }, { "TEXCOORD", 0 },
+		{ "WORLD", 0 }, { "WORLD", 1 }, { "WORLD", 2 }, { "WORLD", 3 },
+		{ "NORMALMATRIX", 0 }, { "NORMALMATRIX", 1 }, { "NORMALMATRIX", 2 } }, 10, 9 };
+	RegisterSoftwareVertexShader(g_InstancedPuyoVS, sizeof(g_InstancedPuyoVS), instancedPuyoVS);
+
+	SoftwareVertexShader instancedDepthOnlyVS = { InstancedDepthOnlyVS, {
+		{ "POSITION", 0 }, { "WORLD", 0 }, { "WORLD", 1 }, { "WORLD", 2 }, { "WORLD", 3 } }, 5, 0 };
+	RegisterSoftwareVertexShader(g_InstancedDepthOnlyVS, sizeof(g_InstancedDepthOnlyVS), instancedDepthOnlyVS);
+
+	SoftwarePixelShader depthOnlyPS = { DepthOnlyPS, 0 };
+	RegisterSoftwarePixelShader(g_DepthOnlyPS, sizeof(g_DepthOnlyPS), depthOnlyPS);
+
+	SoftwarePixelShader subsurfacePS = { SubsurfacePuyoPS, 7 };
+	RegisterSoftwarePixelShader(g_SubsurfacePuyoPS, sizeof(g_SubsurfacePuyoPS), subsurfacePS);
+
+	SoftwarePixelShader gridBackgroundPS = { GridBackgroundPS, 2 };
+	RegisterSoftwarePixelShader(g_GridBackgroundPS, sizeof(g_GridBackgroundPS), gridBackgroundPS);
+
+	SoftwarePixelShader gridBackgroundVoronoiPS = { GridBackgroundVoronoiPS, 2 };
+	RegisterSoftwarePixelShader(g_GridBackgroundVoronoiPS, sizeof(g_GridBackgroundVoronoiPS), gridBackgroundVoronoiPS);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Registers C++ versions of the game's shaders with the software render device, so it can draw the puyos, their
+// backface depth, the subsurface pass and the grid backgrounds. Has to happen before the shaders are created, and costs nothing on the
+// other devices.
+void RegisterPuyoSoftwareShaders();
@@ -0,0 +1,59 @@
+#include "PuyoPuyoGamePCH.h"
+#include "ScriptedController.h"
+#include <string.h>
+
+
+ScriptedController::ScriptedController(const char* script)
+	: m_script(script)
+	, m_length((unsigned int)strlen(script))
+	, m_frame(0)
+{
+	assert(m_length > 0 && "A script needs at least one frame of input");
+}
+
+ScriptedController::~ScriptedController()
+{
+}
+
+// ***************************************************************
+// PRIVATE FUNCTIONS
+// ***************************************************************
+
+char ScriptedController::GetInput() const
+{
+	return m_script[m_frame];
+}
+
+// ***************************************************************
+// PUBLIC FUNCTIONS
+// ***************************************************************
+
+void ScriptedController::Step()
+{
+	m_frame = (m_frame + 1) % m_length;
+}
+
+void ScriptedController::Reset()
+{
+	m_frame = 0;
+}
+
+bool ScriptedController::MoveLeft() const
+{
+	return GetInput() == 'L';
+}
+
+bool ScriptedController::MoveRight() const
+{
+	return GetInput() == 'R';
+}
+
+bool ScriptedController::Flip() const
+{
+	return GetInput() == 'F';
+}
+
+bool ScriptedController::Fall() const
+{
+	return GetInput() == 'D';
+}
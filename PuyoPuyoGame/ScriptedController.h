@@ -0,0 +1,29 @@
+#pragma once
+#include "PuyoController.h"
+
+// Plays back a fixed string of inputs, one character per frame, and starts over when it gets to the end. Lets a match
+// run the same way every time with nobody at the keyboard (see -alloctest in main.cpp).
+//
+//	'L' move left, 'R' move right, 'F' flip, 'D' fall fast, anything else does nothing that frame
+class ScriptedController : public PuyoController
+{
+private:
+	const char* m_script;
+	unsigned int m_length;
+	unsigned int m_frame;
+
+	char GetInput() const;
+
+public:
+	explicit ScriptedController(const char* script);
+	~ScriptedController();
+
+	// Moves on to the next frame's input. Call once per frame before the PuyoInstance it controls updates.
+	void Step();
+	void Reset();
+
+	bool MoveLeft() const final;
+	bool MoveRight() const final;
+	bool Flip() const final;
+	bool Fall() const final;
+};
@@ -1,5 +1,5 @@
 #pragma once
-#include <DirectXMath.h>
+#include "EngineMath.h"
 
 using namespace DirectX;
 
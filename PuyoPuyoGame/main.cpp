@@ -1,22 +1,106 @@
 #include "PuyoPuyoGamePCH.h"
 #include "PuyoGame.h"
+#include "SoftwareRenderDevice.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Running with "-alloctest N" plays a scripted match (restarting it whenever somebody loses) with a fixed timestep.
+// After ALLOC_TEST_WARMUP_FRAMES frames to let pools and containers grow to size, every one of the next N frames must be
+// free of heap allocations or the exit code is 1. Adding "-headless" (no frame count needed) or "-software" runs it on
+// the null or software render device instead of D3D11, which is how to run it without a GPU or off Windows.
+#define ALLOC_TEST_WARMUP_FRAMES 600
+#define ALLOC_TEST_TIMESTEP (1.0 / 60.0)
+
+// Stop printing after this many offending allocations, the first few are what matter
+#define ALLOC_TEST_MAX_REPORTS 32
+
+// Running with "-headless N" plays N frames of a scripted match on the null render device, without a window or a GPU,
+// and prints what the renderer asked the device to do per frame. Any validation error makes the exit code 1.
+// Adding "-software" draws the frames for real on the software render device instead, and "-screenshot file.tga" saves
+// the last of them. The frame graph's culling and texture sharing are checked on the same device afterwards, since the
+// game's own graph never needs either.
+#define HEADLESS_TIMESTEP (1.0 / 60.0)
 
 GameEngine* g_gameEngine;
 PuyoGame* g_puyoGame;
 
+unsigned int g_allocTestFrames = 0;
+unsigned int g_allocTestFrame = 0;
+unsigned int g_allocTestFailedFrames = 0;
+unsigned int g_allocTestReports = 0;
+
+bool g_headless = false;
+unsigned int g_headlessFrames = 0;
+unsigned int g_headlessFrame = 0;
+bool g_headlessSoftware = false;
+const char* g_screenshotPath = nullptr;
+
 bool Update(double dt);
+bool AllocTestUpdate(double dt);
+void AllocTestReport(ALLOC_TAG tag, size_t size);
+bool HeadlessUpdate(double dt);
+int RunHeadless();
+RENDER_BACKEND GetRenderBackend();
+bool CheckFrameGraph(RenderDevice* device);
 
-void main()
+int main(int argc, char* argv[])
 {
-	printf("Did this work?? \n");
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-software") == 0)
+			g_headlessSoftware = true;
+		else if (strcmp(argv[i], "-headless") == 0)
+		{
+			g_headless = true;
+			if (i < argc - 1 && argv[i + 1][0] != '-')
+				g_headlessFrames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (i == argc - 1)
+			break;
+		else if (strcmp(argv[i], "-alloctest") == 0)
+			g_allocTestFrames = (unsigned int)atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-screenshot") == 0)
+			g_screenshotPath = argv[i + 1];
+	}
+
+	if (g_allocTestFrames == 0 && g_headlessFrames > 0)
+		return RunHeadless();
+
+	if (g_allocTestFrames == 0)
+	{
+		printf("Did this work?? \n");
+
+		g_gameEngine = new GameEngine(800, 600, false, true);
+		g_puyoGame = new PuyoGame();
+
+		g_gameEngine->Run(Update);
 
-	g_gameEngine = new GameEngine(800, 600, false, true);
-	g_puyoGame = new PuyoGame();
+		delete g_puyoGame;
+		delete g_gameEngine;
+		return 0;
+	}
+
+	printf("Allocation test: %u warm-up frames, then %u frames that must not allocate \n", ALLOC_TEST_WARMUP_FRAMES, g_allocTestFrames);
+
+	g_gameEngine = new GameEngine(800, 600, false, true, GetRenderBackend());
+	g_puyoGame = new PuyoGame(true);
+
+	AllocationTracker::SetEnabled(true);
+	g_gameEngine->Run(AllocTestUpdate);
+	AllocationTracker::SetCallback(nullptr);
+	AllocationTracker::PrintReport();
 
-	g_gameEngine->Run(Update);
-	
 	delete g_puyoGame;
 	delete g_gameEngine;
+
+	if (g_allocTestFailedFrames > 0)
+	{
+		printf("FAILED: %u of %u frames allocated after warm-up \n", g_allocTestFailedFrames, g_allocTestFrames);
+		return 1;
+	}
+
+	printf("PASSED: no heap allocations in %u frames \n", g_allocTestFrames);
+	return 0;
 }
 
 bool Update(double dt)
@@ -28,4 +112,204 @@ bool Update(double dt)
 	printf("FPS: %f \r", 1.0f / dt);
 
 	return true;
-}
\ No newline at end of file
+}
+
+bool AllocTestUpdate(double)
+{
+	// The tracker wrapped up the previous frame just before this was called, so its stats cover that whole frame,
+	// input and all
+	if (g_allocTestFrame > ALLOC_TEST_WARMUP_FRAMES && AllocationTracker::GetFrameAllocations() > 0)
+	{
+		g_allocTestFailedFrames++;
+		for (int i = 0; i < (int)ALLOC_TAG::COUNT; i++)
+		{
+			AllocationStats stats = AllocationTracker::GetStats((ALLOC_TAG)i);
+			if (stats.allocations > 0)
+			{
+				printf("Frame %u: %u allocations (%llu bytes) tagged %s \n", g_allocTestFrame - 1, stats.allocations,
+					(unsigned long long)stats.bytes, AllocationTracker::GetTagName((ALLOC_TAG)i));
+			}
+		}
+	}
+
+	if (g_allocTestFrame == ALLOC_TEST_WARMUP_FRAMES + g_allocTestFrames)
+		return false;
+
+	// From here on every allocation is a failure. Reporting them as they happen gives somewhere to break and get a stack.
+	if (g_allocTestFrame == ALLOC_TEST_WARMUP_FRAMES)
+		AllocationTracker::SetCallback(AllocTestReport);
+
+	g_allocTestFrame++;
+
+	// The timer's dt would make every run different
+	if (!g_puyoGame->Update(ALLOC_TEST_TIMESTEP))
+		g_puyoGame->RestartMatch();
+
+	return true;
+}
+
+void AllocTestReport(ALLOC_TAG tag, size_t size)
+{
+	if (g_allocTestReports++ < ALLOC_TEST_MAX_REPORTS)
+		printf("Heap allocation of %llu bytes tagged %s \n", (unsigned long long)size, AllocationTracker::GetTagName(tag));
+}
+
+int RunHeadless()
+{
+	printf("Headless run: %u frames on the %s render device \n", g_headlessFrames, g_headlessSoftware ? "software" : "null");
+
+	g_gameEngine = new GameEngine(800, 600, false, true, GetRenderBackend());
+	g_puyoGame = new PuyoGame(true);
+
+	GameTimer timer;
+	timer.Update();
+	g_gameEngine->Run(HeadlessUpdate);
+	double seconds = timer.Update();
+
+	// The engine rolls the device over to a new frame before asking for one more, so the last frame is in the totals
+	RenderDevice* device = RenderManager::GetSingleton().GetDevice();
+	RenderDeviceStats total = device->GetTotalStats();
+	ConstantRingStats constants = RenderManager::GetSingleton().GetConstantRing().GetTotalStats();
+	StateCacheStats stateCache = RenderManager::GetSingleton().GetTotalStateCacheStats();
+	FrameGraphStats frameGraph = g_puyoGame->GetFrameGraph().GetTotalStats();
+
+	bool screenshotFailed = false;
+	if (g_screenshotPath)
+	{
+		if (g_headlessSoftware)
+			screenshotFailed = !static_cast<SoftwareRenderDevice*>(device)->SaveImage(device->GetBackBuffer(), g_screenshotPath);
+		else
+			printf("Only the software render device has anything to take a screenshot of \n");
+	}
+
+	bool frameGraphFailed = !CheckFrameGraph(device);
+
+	delete g_puyoGame;
+	delete g_gameEngine;
+
+	double frames = (double)g_headlessFrames;
+	printf("Per frame: %.1f draws, %.1f triangles, %.1f state changes (%.1f redundant), %.1f bytes uploaded \n",
+		total.draws / frames, total.triangles / frames, total.stateChanges / frames, total.redundantStateChanges / frames,
+		total.bytesUploaded / frames);
+	printf("%.1f constant bytes in %.1f allocations (%u overflowed, %u waits on the GPU) \n",
+		constants.bytes / frames, constants.allocations / frames, constants.overflows, constants.fenceWaits);
+	printf("%.1f binds (%.1f skipped as already bound), %.1f pipeline changes (%.1f skipped) \n",
+		stateCache.binds / frames, stateCache.bindsAvoided / frames, stateCache.pipelineChanges / frames,
+		stateCache.pipelineChangesAvoided / frames);
+	printf("%.1f passes (%.1f culled), %.1f clears, %.1f transient textures in %.1f pooled (%.1f of %.1f KB) \n",
+		frameGraph.passes / frames, frameGraph.culledPasses / frames, frameGraph.clears / frames,
+		frameGraph.transientTextures / frames, frameGraph.pooledTextures / frames, frameGraph.pooledBytes / frames / 1024.0,
+		frameGraph.transientBytes / frames / 1024.0);
+	printf("%u resources created, %.2f ms per frame \n", total.resourcesCreated, seconds * 1000.0 / frames);
+
+	if (screenshotFailed)
+	{
+		printf("FAILED: couldn't save the screenshot to %s \n", g_screenshotPath);
+		return 1;
+	}
+
+	if (frameGraphFailed)
+		return 1;
+
+	if (total.validationErrors > 0)
+	{
+		printf("FAILED: %u validation errors \n", total.validationErrors);
+		return 1;
+	}
+
+	printf("PASSED: no validation errors in %u frames \n", g_headlessFrames);
+	return 0;
+}
+
+RENDER_BACKEND GetRenderBackend()
+{
+	if (g_headlessSoftware)
+		return RENDER_BACKEND::SOFTWARE;
+	if (g_headless)
+		return RENDER_BACKEND::HEADLESS;
+
+	return RENDER_BACKEND::D3D11;
+}
+
+bool HeadlessUpdate(double)
+{
+	if (g_headlessFrame == g_headlessFrames)
+		return false;
+
+	g_headlessFrame++;
+
+	// Same fixed timestep as the allocation test, so every run draws the same thing
+	if (!g_puyoGame->Update(HEADLESS_TIMESTEP))
+		g_puyoGame->RestartMatch();
+
+	return true;
+}
+
+static void CheckFrameGraphPass(void*, const FrameGraph&)
+{
+}
+
+bool CheckFrameGraph(RenderDevice* device)
+{
+	// Down, across and back up through three targets the same size, with a debug pass nothing reads in the middle. The
+	// debug pass should be culled, and the last target should get the first one's texture since it's done with by then.
+	FrameGraphTextureDesc desc(GPU_FORMAT::R8G8B8A8_UNORM, 64, 64);
+	float black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	FrameGraph graph;
+	graph.Reset();
+
+	FGHANDLE down = graph.CreateTexture("Down", desc);
+	FGHANDLE across = graph.CreateTexture("Across", desc);
+	FGHANDLE up = graph.CreateTexture("Up", desc);
+	FGHANDLE debug = graph.CreateTexture("Debug", desc);
+	FGHANDLE backBuffer = graph.ImportTexture("Back buffer", device->GetBackBuffer());
+	graph.MarkOutput(backBuffer);
+
+	unsigned int downPass = graph.AddPass("Down", CheckFrameGraphPass, nullptr);
+	graph.SetRenderTarget(downPass, down);
+	graph.ClearColor(downPass, black);
+
+	unsigned int debugPass = graph.AddPass("Debug", CheckFrameGraphPass, nullptr);
+	graph.SetRenderTarget(debugPass, debug);
+	graph.ClearColor(debugPass, black);
+
+	unsigned int acrossPass = graph.AddPass("Across", CheckFrameGraphPass, nullptr);
+	graph.SetRenderTarget(acrossPass, across);
+	graph.ClearColor(acrossPass, black);
+	graph.ReadTexture(acrossPass, down, 0);
+
+	unsigned int upPass = graph.AddPass("Up", CheckFrameGraphPass, nullptr);
+	graph.SetRenderTarget(upPass, up);
+	graph.ClearColor(upPass, black);
+	graph.ReadTexture(upPass, across, 0);
+
+	unsigned int compositePass = graph.AddPass("Composite", CheckFrameGraphPass, nullptr);
+	graph.SetRenderTarget(compositePass, backBuffer);
+	graph.ReadTexture(compositePass, up, 0);
+
+	// Drawn for real, in a device frame of its own so anything it does wrong shows up in that frame's stats
+	graph.Execute(RenderManager::GetSingleton());
+	device->BeginFrame();
+
+	const FrameGraphStats& stats = graph.GetStats();
+	bool passed = true;
+	if (!graph.IsCulled(debugPass) || graph.IsCulled(downPass) || graph.IsCulled(compositePass) || stats.culledPasses != 1)
+	{
+		printf("FAILED: the frame graph culled %u passes, not just the debug pass \n", stats.culledPasses);
+		passed = false;
+	}
+	if (!graph.GetTexture(up) || graph.GetTexture(up) != graph.GetTexture(down) || graph.GetTexture(across) == graph.GetTexture(down) ||
+		stats.transientTextures != 3 || stats.pooledTextures != 2)
+	{
+		printf("FAILED: the frame graph put %u transient textures in %u, not 3 in 2 \n", stats.transientTextures, stats.pooledTextures);
+		passed = false;
+	}
+	if (device->GetStats().validationErrors > 0)
+	{
+		printf("FAILED: %u validation errors drawing the frame graph check \n", device->GetStats().validationErrors);
+		passed = false;
+	}
+
+	return passed;
+}